@@ -0,0 +1,114 @@
+// Depth pyramid for the effects which need depth
+// Level 0 is the eye space depth (in world units) decoded from the 24 RGB bits of the Z buffer RT,
+// each further level holds the minimum (r) and maximum (g) depth of the 2x2 texels it covers in the previous one
+// Levels are rounded down, so where the previous one has an odd size each texel also covers a third row or column:
+// otherwise the last one would miss the odd texel, and reading a level by uv spans a bit more than 2 texels of the previous one
+
+texture2D depthTex2D;
+texture2D pyramidTex2D;
+
+// level and pixel size of the level being reduced, and whether its width and height are odd (1) or not (0)
+float srcLevel;
+float2 srcPixelSize;
+float2 srcOdd;
+
+sampler depthSampler = sampler_state
+{
+	texture = <depthTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+};
+
+sampler pyramidSampler = sampler_state
+{
+	texture = <pyramidTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+	MIPFILTER = POINT;
+};
+
+struct VSOUT
+{
+	float4 vertPos : POSITION;
+	float2 UVCoord : TEXCOORD0;
+};
+
+struct VSIN
+{
+	float4 vertPos : POSITION0;
+	float2 UVCoord : TEXCOORD0;
+};
+
+VSOUT FrameVS(VSIN IN)
+{
+	VSOUT OUT;
+	OUT.vertPos = IN.vertPos;
+	OUT.UVCoord = IN.UVCoord;
+	return OUT;
+}
+
+float4 DecodePS(VSOUT IN) : COLOR0
+{
+	float4 col = tex2D(depthSampler, IN.UVCoord);
+	float posZ = ((1.0-col.z) + (1.0-col.y)*256.0 + (1.0-col.x)*(257.0*256.0));
+	return float4(posZ, posZ, 0, 0);
+}
+
+// min and max of the source texel at the given texel coordinates
+float2 srcTexel(float2 texel)
+{
+	return tex2Dlod(pyramidSampler, float4((texel + 0.5)*srcPixelSize, 0, srcLevel)).rg;
+}
+
+float2 minMax(float2 mm, float2 texel)
+{
+	float2 s = srcTexel(texel);
+	return float2(min(mm.x, s.x), max(mm.y, s.y));
+}
+
+float4 ReducePS(float2 vpos : VPOS) : COLOR0
+{
+	float2 src = floor(vpos) * 2;
+	float2 mm = srcTexel(src);
+	mm = minMax(mm, src + float2(1, 0));
+	mm = minMax(mm, src + float2(0, 1));
+	mm = minMax(mm, src + float2(1, 1));
+	if (srcOdd.x > 0)
+	{
+		mm = minMax(mm, src + float2(2, 0));
+		mm = minMax(mm, src + float2(2, 1));
+	}
+	if (srcOdd.y > 0)
+	{
+		mm = minMax(mm, src + float2(0, 2));
+		mm = minMax(mm, src + float2(1, 2));
+	}
+	if (srcOdd.x > 0 && srcOdd.y > 0)
+	{
+		mm = minMax(mm, src + float2(2, 2));
+	}
+	return float4(mm, 0, 0);
+}
+
+technique t0
+{
+	pass P0
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 DecodePS();
+		ZEnable = false;
+		AlphaBlendEnable = false;
+	}
+
+	pass P1
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 ReducePS();
+		ZEnable = false;
+		AlphaBlendEnable = false;
+	}
+}
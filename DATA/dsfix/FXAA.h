@@ -254,6 +254,18 @@ A. Or use FXAA_GREEN_AS_LUMA.
     #define FXAA_GREEN_AS_LUMA 0
 #endif
 /*--------------------------------------------------------------------------*/
+#ifndef FXAA_LUMA_FROM_RGB
+    //
+    // (DSfix) Computes luma from the color of every tap instead of reading
+    // it from alpha, so no separate pass packing luma in alpha is needed.
+    // Costs a dot product per tap instead of a full screen pass.
+    //
+    // 1 = On.
+    // 0 = Off.
+    //
+    #define FXAA_LUMA_FROM_RGB 0
+#endif
+/*--------------------------------------------------------------------------*/
 #ifndef FXAA_EARLY_EXIT
     //
     // Controls algorithm's early exit path.
@@ -702,7 +714,9 @@ NOTE the other tuning knobs are now in the shader function inputs!
 /*============================================================================
                    GREEN AS LUMA OPTION SUPPORT FUNCTION
 ============================================================================*/
-#if (FXAA_GREEN_AS_LUMA == 0)
+#if (FXAA_LUMA_FROM_RGB == 1)
+    FxaaFloat FxaaLuma(FxaaFloat4 rgba) { return dot(rgba.xyz, FxaaFloat3(0.299, 0.587, 0.114)); }
+#elif (FXAA_GREEN_AS_LUMA == 0)
     FxaaFloat FxaaLuma(FxaaFloat4 rgba) { return rgba.w; }
 #else
     FxaaFloat FxaaLuma(FxaaFloat4 rgba) { return rgba.y; }
@@ -907,6 +921,9 @@ FxaaFloat4 FxaaPixelShader(
         #define lumaW luma4B.x
     #else
         FxaaFloat4 rgbyM = FxaaTexTop(tex, posM);
+        #if (FXAA_LUMA_FROM_RGB == 1)
+            rgbyM.w = FxaaLuma(rgbyM);
+        #endif
         #if (FXAA_GREEN_AS_LUMA == 0)
             #define lumaM rgbyM.w
         #else
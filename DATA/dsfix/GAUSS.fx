@@ -1,8 +1,13 @@
 // Implementation based on the article "Efficient Gaussian blur with linear sampling"
 // http://rastergrid.com/blog/2010/09/efficient-gaussian-blur-with-linear-sampling/
+// The weights and offsets are computed for the blur amount and set by GAUSS
 
-static const float sampleWeights[3] = { 0.2270270270, 0.3162162162, 0.0702702703 };
-static const float sampleOffsets[3] = { 0.0, 1.3846153846, 3.2307692308 };
+#ifndef NUM_SAMPLES
+#define NUM_SAMPLES 3
+#endif
+
+float sampleWeights[NUM_SAMPLES];
+float sampleOffsets[NUM_SAMPLES];
 
 texture2D frameTex2D;
 
@@ -38,7 +43,7 @@ VSOUT FrameVS(VSIN IN)
 float4 HGaussianBlurPS(VSOUT IN) : COLOR0
 {
 	float4 color = tex2D(frameSampler, IN.UVCoord) * sampleWeights[0];
-	for(int i = 1; i < 3; ++i) {
+	for(int i = 1; i < NUM_SAMPLES; ++i) {
 		color += tex2D(frameSampler, IN.UVCoord + float2(sampleOffsets[i] * PIXEL_SIZE.x, 0.0)) * sampleWeights[i];
 		color += tex2D(frameSampler, IN.UVCoord - float2(sampleOffsets[i] * PIXEL_SIZE.x, 0.0)) * sampleWeights[i];
 	}
@@ -48,7 +53,7 @@ float4 HGaussianBlurPS(VSOUT IN) : COLOR0
 float4 VGaussianBlurPS(VSOUT IN) : COLOR0
 {
 	float4 color = tex2D(frameSampler, IN.UVCoord) * sampleWeights[0];
-	for(int i = 1; i < 3; ++i) {
+	for(int i = 1; i < NUM_SAMPLES; ++i) {
 		color += tex2D(frameSampler, IN.UVCoord + float2(0.0, sampleOffsets[i] * PIXEL_SIZE.y)) * sampleWeights[i];
 		color += tex2D(frameSampler, IN.UVCoord - float2(0.0, sampleOffsets[i] * PIXEL_SIZE.y)) * sampleWeights[i];
 	}
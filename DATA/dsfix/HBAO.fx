@@ -13,10 +13,6 @@ extern float FOV = 85; //Field of View in Degrees
 
 extern float luminosity_threshold = 0.3;
 
-#ifndef SCALE
-#define SCALE 1.0
-#endif
-
 #ifndef SSAO_STRENGTH_LOW
 #ifndef SSAO_STRENGTH_MEDIUM
 #ifndef SSAO_STRENGTH_HIGH
@@ -52,19 +48,9 @@ static const float farZ = 5000.0;
 static const float2 g_InvFocalLen = { tan(0.5f*radians(FOV)) / rcpres.y * rcpres.x, tan(0.5f*radians(FOV)) };
 static const float depthRange = nearZ-farZ;
 
-texture2D depthTex2D;
 texture2D frameTex2D;
 texture2D prevPassTex2D;
 
-sampler depthSampler = sampler_state
-{
-	texture = <depthTex2D>;
-	AddressU = CLAMP;
-	AddressV = CLAMP;
-	MINFILTER = LINEAR;
-	MAGFILTER = LINEAR;
-};
-
 sampler frameSampler = sampler_state
 {
 	texture = <frameTex2D>;
@@ -123,9 +109,10 @@ float2 rand(in float2 uv) {
 	return float2(noiseX,noiseY);
 }
 
-float readDepth(in float2 coord : TEXCOORD0) {
-	float4 col = tex2D(depthSampler, coord);	
-	float posZ = ((1.0-col.z) + (1.0-col.y)*256.0 + (1.0-col.x)*(257.0*256.0));
+#include "SSAO.h"
+
+float readDepth(in float2 coord : TEXCOORD0, in float lod) {
+	float posZ = readAODepth(coord, lod);
 	return 1 - (posZ-nearZ)/farZ;
 }
 
@@ -136,11 +123,9 @@ float3 getPosition(in float2 uv, in float eye_z) {
 }
 
 float4 ssao_Main( VSOUT IN ) : COLOR0 {
-	clip(1/SCALE-IN.UVCoord.x);
-	clip(1/SCALE-IN.UVCoord.y);	
-	IN.UVCoord.xy *= SCALE;
+	IN.UVCoord = beginAOPixel(IN.UVCoord);
 
-	float depth = readDepth(IN.UVCoord);
+	float depth = readDepth(IN.UVCoord, 0);
 	float3 pos = getPosition(IN.UVCoord, depth);
 	float3 dx = ddx(pos);
 	float3 dy = ddy(pos);
@@ -152,7 +137,7 @@ float4 ssao_Main( VSOUT IN ) : COLOR0 {
 	float ao = 0.0;
 	float s = 0.0;
 	
-	float2 rand_vec = rand(IN.UVCoord);
+	float2 rand_vec = aoJitter(rand(aoNoiseCoord(IN.UVCoord)));
 	float2 sample_vec_divisor = g_InvFocalLen*depth*depthRange/(aoRadiusMultiplier*5000*rcpres);
 	float2 sample_center = IN.UVCoord;
 	
@@ -172,7 +157,7 @@ float4 ssao_Main( VSOUT IN ) : COLOR0 {
 		
 		for(int k = 1; k <= N_STEPS; k++)
 		{
-			sample_depth = readDepth(sample_center + sample_coords*(k-0.5*(i%2)) );
+			sample_depth = readDepth(sample_center + sample_coords*(k-0.5*(i%2)), depthLod(sample_coords*(k-0.5*(i%2))));
 			sample_pos = getPosition(sample_center + sample_coords*(k-0.5*(i%2)), sample_depth);
 			occlusion_vector = sample_pos - pos;
 			temp_theta = dot(norm, normalize(occlusion_vector));			
@@ -203,10 +188,10 @@ float4 HBlur( VSOUT IN ) : COLOR0 {
 	float color = tex2D(passSampler, IN.UVCoord).r;
 
 	float blurred = color*0.2270270270;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(rcpres.x*1.3846153846, 0)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(rcpres.x*1.3846153846, 0)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(rcpres.x*3.2307692308, 0)).r * 0.0702702703;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(rcpres.x*3.2307692308, 0)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(aoRcpres.x*1.3846153846, 0)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(aoRcpres.x*1.3846153846, 0)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(aoRcpres.x*3.2307692308, 0)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(aoRcpres.x*3.2307692308, 0)).r * 0.0702702703;
 	
 	return blurred;
 }
@@ -215,17 +200,17 @@ float4 VBlur( VSOUT IN ) : COLOR0 {
 	float color = tex2D(passSampler, IN.UVCoord).r;
 
 	float blurred = color*0.2270270270;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(0, rcpres.y*1.3846153846)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(0, rcpres.y*1.3846153846)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(0, rcpres.y*3.2307692308)).r * 0.0702702703;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(0, rcpres.y*3.2307692308)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(0, aoRcpres.y*1.3846153846)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(0, aoRcpres.y*1.3846153846)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(0, aoRcpres.y*3.2307692308)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(0, aoRcpres.y*3.2307692308)).r * 0.0702702703;
 	
 	return blurred;
 }
 
-float4 Combine( VSOUT IN ) : COLOR0 {
-	float3 color = tex2D(frameSampler, IN.UVCoord).rgb;
-	float ao = tex2D(passSampler, IN.UVCoord/SCALE).r;
+float4 Combine( VSOUT IN, uniform bool applyAA ) : COLOR0 {
+	float3 color = readFrame(IN.UVCoord, applyAA);
+	float ao = upsampleAO(IN.UVCoord);
 	ao = clamp(ao, aoClamp, 1.0);
 
 	#ifdef LUMINANCE_CONSIDERATION
@@ -263,7 +248,32 @@ technique t0
 	}
 	pass p3
 	{
-		VertexShader = compile vs_1_1 FrameVS();
-		PixelShader = compile ps_2_0 Combine();
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 Combine(false);
+	}
+	pass p4
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 DownsampleDepth();
+	}
+	pass p5
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 DeinterleaveDepth();
+	}
+	pass p6
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 Reinterleave();
+	}
+	pass p7
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 TemporalResolve();
+	}
+	pass p8
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 Combine(true);
 	}
 }
@@ -1,5 +1,4 @@
 
-float opacity = 1.0;
 texture2D frameTex2D;
 
 sampler frameSampler = sampler_state
@@ -15,12 +14,15 @@ struct VSOUT
 {
 	float4 vertPos : POSITION;
 	float2 UVCoord : TEXCOORD0;
+	float opacity : TEXCOORD1;
 };
 
+// the opacity of each HUD region is part of its vertices, so all regions are drawn at once
 struct VSIN
 {
 	float4 vertPos : POSITION0;
 	float2 UVCoord : TEXCOORD0;
+	float opacity : TEXCOORD1;
 };
 
 VSOUT FrameVS(VSIN IN)
@@ -28,13 +30,14 @@ VSOUT FrameVS(VSIN IN)
 	VSOUT OUT;
 	OUT.vertPos = IN.vertPos;
 	OUT.UVCoord = IN.UVCoord;
+	OUT.opacity = IN.opacity;
 	return OUT;
 }
 
 float4 FramePS(VSOUT IN) : COLOR0
 {
 	float4 color = tex2D(frameSampler, IN.UVCoord);
-	return float4(color.r, color.g, color.b, color.a * opacity);
+	return float4(color.r, color.g, color.b, color.a * IN.opacity);
 }
 
 technique t0
@@ -52,6 +52,13 @@ float threshold;
 float maxSearchSteps;
 float maxSearchStepsDiag;
 
+/**
+ * Temporal mode (SMAA T2x without geometry jitter): the area texture subsample
+ * used this frame, and whether the previous frame may be blended in.
+ */
+float4 subsampleIndices;
+float historyValid;
+
 #ifdef SMAA_PRESET_CUSTOM
 #define SMAA_THRESHOLD threshold
 #define SMAA_MAX_SEARCH_STEPS maxSearchSteps
@@ -76,6 +83,7 @@ texture2D edgesTex2D;
 texture2D blendTex2D;
 texture2D areaTex2D;
 texture2D searchTex2D;
+texture2D previousTex2D;
 
 
 /**
@@ -130,6 +138,13 @@ sampler2D searchTex {
     SRGBTexture = false;
 };
 
+sampler2D previousTex {
+    Texture = <previousTex2D>;
+    AddressU  = Clamp; AddressV = Clamp;
+    MipFilter = Point; MinFilter = Point; MagFilter = Point;
+    SRGBTexture = true;
+};
+
 
 /**
  * Function wrappers
@@ -182,7 +197,7 @@ float4 DX9_SMAABlendingWeightCalculationPS(float4 position : SV_POSITION,
                                            uniform SMAATexture2D edgesTex, 
                                            uniform SMAATexture2D areaTex, 
                                            uniform SMAATexture2D searchTex) : COLOR {
-    return SMAABlendingWeightCalculationPS(texcoord, pixcoord, offset, edgesTex, areaTex, searchTex, 0);
+    return SMAABlendingWeightCalculationPS(texcoord, pixcoord, offset, edgesTex, areaTex, searchTex, subsampleIndices);
 }
 
 float4 DX9_SMAANeighborhoodBlendingPS(float4 position : SV_POSITION,
@@ -193,6 +208,33 @@ float4 DX9_SMAANeighborhoodBlendingPS(float4 position : SV_POSITION,
     return SMAANeighborhoodBlendingPS(texcoord, offset, colorTex, blendTex);
 }
 
+void DX9_SMAAResolveVS(inout float4 position : POSITION,
+                       inout float2 texcoord : TEXCOORD0) {
+    SMAAResolveVS(position, position, texcoord);
+}
+
+/**
+ * We can't jitter the game's projection and have no velocities, so instead of
+ * SMAAResolvePS we blend the two frames (which used different subsamples)
+ * only where the previous one lies within the colour range of the current
+ * neighbourhood. Anything that moved falls outside of it and gets clamped.
+ */
+float4 DX9_SMAATemporalResolvePS(float4 position : SV_POSITION,
+                                 float2 texcoord : TEXCOORD0,
+                                 uniform SMAATexture2D colorTexCurr,
+                                 uniform SMAATexture2D colorTexPrev) : COLOR {
+    float4 current = SMAASampleLevelZeroPoint(colorTexCurr, texcoord);
+    float4 left = SMAASampleLevelZeroOffset(colorTexCurr, texcoord, float2(-1.0, 0.0));
+    float4 right = SMAASampleLevelZeroOffset(colorTexCurr, texcoord, float2(1.0, 0.0));
+    float4 top = SMAASampleLevelZeroOffset(colorTexCurr, texcoord, float2(0.0, -1.0));
+    float4 bottom = SMAASampleLevelZeroOffset(colorTexCurr, texcoord, float2(0.0, 1.0));
+    float4 minColor = min(current, min(min(left, right), min(top, bottom)));
+    float4 maxColor = max(current, max(max(left, right), max(top, bottom)));
+
+    float4 previous = clamp(SMAASampleLevelZeroPoint(colorTexPrev, texcoord), minColor, maxColor);
+    return SMAALerp(current, previous, 0.5 * historyValid);
+}
+
 
 /**
  * Time for some techniques!
@@ -208,7 +250,10 @@ technique LumaEdgeDetection {
 
         // We will be creating the stencil buffer for later usage.
         StencilEnable = true;
+        TwoSidedStencilMode = false;
+        StencilFunc = ALWAYS;
         StencilPass = REPLACE;
+        StencilWriteMask = 0xff;
         StencilRef = 1;
     }
 }
@@ -224,7 +269,10 @@ technique ColorEdgeDetection {
 
         // We will be creating the stencil buffer for later usage.
         StencilEnable = true;
+        TwoSidedStencilMode = false;
+        StencilFunc = ALWAYS;
         StencilPass = REPLACE;
+        StencilWriteMask = 0xff;
         StencilRef = 1;
     }
 }
@@ -240,7 +288,10 @@ technique DepthEdgeDetection {
 
         // We will be creating the stencil buffer for later usage.
         StencilEnable = true;
+        TwoSidedStencilMode = false;
+        StencilFunc = ALWAYS;
         StencilPass = REPLACE;
+        StencilWriteMask = 0xff;
         StencilRef = 1;
     }
 }
@@ -256,8 +307,10 @@ technique BlendWeightCalculation {
 
         // Here we want to process only marked pixels.
         StencilEnable = true;
+        TwoSidedStencilMode = false;
         StencilPass = KEEP;
         StencilFunc = EQUAL;
+        StencilMask = 0xff;
         StencilRef = 1;
     }
 }
@@ -275,3 +328,15 @@ technique NeighborhoodBlending {
         StencilEnable = false;
     }
 }
+
+technique TemporalResolve {
+    pass TemporalResolve {
+        VertexShader = compile vs_3_0 DX9_SMAAResolveVS();
+        PixelShader = compile ps_3_0 DX9_SMAATemporalResolvePS(colorTex, previousTex);
+        ZEnable = false;
+        SRGBWriteEnable = true;
+        AlphaBlendEnable = false;
+        AlphaTestEnable = false;
+        StencilEnable = false;
+    }
+}
@@ -0,0 +1,268 @@
+// Shared part of the SSAO effects
+// Depth is read from the depth pyramid (see DepthPyramid.fx), samples far from the pixel being shaded read coarser levels.
+// AO is computed and blurred at AO_PIXEL_SIZE, a fraction of the render resolution (see ssaoScale).
+// The depth is first point sampled at the centers of the AO pixels into a low resolution depth texture,
+// which the combine pass then uses to upsample the AO: of the 4 nearest AO pixels, the ones whose depth
+// matches the depth of the full resolution pixel get the most weight, which keeps the edges of objects crisp.
+// With SSAO_INTERLEAVED, the AO pixels are split into 4x4 layers by their position modulo 4, laid out as
+// the tiles of an atlas of AO_LAYER_SIZE layers. Each layer is computed from its own depth layer with a
+// constant jitter, so neighbouring pixels of the AO pass fetch neighbouring texels, however far apart their
+// samples are on screen. The layers are interleaved again before the blur.
+// With SSAO_TEMPORAL, the sampling pattern is rotated each frame and the raw AO is accumulated in a history
+// buffer before the blur. There are no motion vectors, so history is rejected where the depth of the pixel changed,
+// and clamped to the range of the current AO around the pixel, which limits ghosting when the camera moves.
+// With SSAO_SMAA or SSAO_FXAA, the combine pass can also do the last pass of the AA effect (the SMAA neighborhood
+// blending with the weights in blendTex2D, or FXAA), so that the frame is read and written only once for both.
+// Needs prevPassTex2D, frameSampler, farZ and VSOUT from the including effect.
+
+#ifndef AO_PIXEL_SIZE
+#define AO_PIXEL_SIZE PIXEL_SIZE
+#endif
+#ifndef AO_LAYER_SIZE
+#define AO_LAYER_SIZE float2(1, 1)
+#endif
+
+static const float2 aoRcpres = AO_PIXEL_SIZE;
+static const float2 aoSize = 1.0 / aoRcpres;
+static const float2 fullSize = 1.0 / PIXEL_SIZE;
+static const float2 layerSize = AO_LAYER_SIZE;
+static const float2 atlasSize = layerSize*4;
+
+// tile of the layer of the pixel being shaded by the AO pass
+static float2 layerTile = float2(0, 0);
+
+// weight of the history in the temporal accumulation, and relative depth change at which it is fully rejected
+static const float historyWeight = 0.9;
+static const float historyDepthTolerance = 0.02;
+
+// frame counter for rotating the sampling pattern, and 0 if there is no usable history
+float frameIndex = 0;
+float historyValid = 0;
+
+// relative depth difference at which an AO pixel loses most of its weight in the upsample
+static const float upsampleDepthTolerance = 0.01;
+
+texture2D depthPyramidTex2D;
+texture2D lowDepthTex2D;
+texture2D layerDepthTex2D;
+texture2D historyTex2D;
+texture2D prevLowDepthTex2D;
+
+sampler depthPyramidSampler = sampler_state
+{
+	texture = <depthPyramidTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+	MIPFILTER = POINT;
+};
+
+sampler lowDepthSampler = sampler_state
+{
+	texture = <lowDepthTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+};
+
+sampler layerDepthSampler = sampler_state
+{
+	texture = <layerDepthTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+};
+
+sampler aoPointSampler = sampler_state
+{
+	texture = <prevPassTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+};
+
+sampler historySampler = sampler_state
+{
+	texture = <historyTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+};
+
+sampler prevLowDepthSampler = sampler_state
+{
+	texture = <prevLowDepthTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+};
+
+// eye space depth in world units, the closest one in the area of a texel at the given pyramid level
+float readEyeDepth(in float2 coord, in float lod) {
+	return tex2Dlod(depthPyramidSampler, float4(coord, 0, lod)).r;
+}
+
+// pyramid level for a depth sample at the given offset from the pixel being shaded:
+// full resolution within 4 pixels, one level coarser for each doubling of the distance beyond that
+float depthLod(in float2 offset) {
+	return max(0, log2(length(offset*fullSize)) - 2);
+}
+
+// linear depth, 0 at the camera and 1 at farZ
+float readLinearDepth(in float2 coord) {
+	return readEyeDepth(coord, 0)/farZ;
+}
+
+// called first in the AO pass, returns the screen coordinates of the AO pixel to shade
+float2 beginAOPixel(in float2 coord) {
+#ifdef SSAO_INTERLEAVED
+	float2 atlasPixel = floor(coord*atlasSize);
+	layerTile = floor(atlasPixel/layerSize);
+	float2 local = atlasPixel - layerTile*layerSize;
+	return (local*4 + layerTile + 0.5)*aoRcpres;
+#else
+	return coord;
+#endif
+}
+
+// coordinates for the per pixel noise of the AO pass, one per layer when interleaved
+float2 aoNoiseCoord(in float2 coord) {
+#ifdef SSAO_INTERLEAVED
+	return (layerTile + 1)*0.25;
+#else
+	return coord;
+#endif
+}
+
+// rotates the per pixel noise vector of the AO pass by the golden angle each frame when temporal
+float2 aoJitter(in float2 v) {
+#ifdef SSAO_TEMPORAL
+	float s, c;
+	sincos(frameIndex*2.3999632, s, c);
+	return float2(c*v.x - s*v.y, s*v.x + c*v.y);
+#else
+	return v;
+#endif
+}
+
+// eye space depth for the AO pass, from the layer of the pixel being shaded when interleaved
+float readAODepth(in float2 coord, in float lod) {
+#ifdef SSAO_INTERLEAVED
+	float2 local = clamp((coord*aoSize - layerTile)*0.25, 0, layerSize - 0.5);
+	return tex2Dlod(layerDepthSampler, float4((layerTile*layerSize + local)/atlasSize, 0, 0)).r;
+#else
+	return readEyeDepth(coord, lod);
+#endif
+}
+
+float4 DeinterleaveDepth( VSOUT IN ) : COLOR0 {
+	return float4(readEyeDepth(beginAOPixel(IN.UVCoord), 0), 0, 0, 1);
+}
+
+float4 Reinterleave( VSOUT IN ) : COLOR0 {
+	float2 aoPixel = floor(IN.UVCoord*aoSize);
+	float2 local = floor(aoPixel*0.25);
+	float2 tile = aoPixel - local*4;
+	return tex2D(aoPointSampler, (tile*layerSize + local + 0.5)/atlasSize);
+}
+
+float4 TemporalResolve( VSOUT IN ) : COLOR0 {
+	float current = tex2D(aoPointSampler, IN.UVCoord).r;
+
+	float lo = current, hi = current;
+	float n;
+	n = tex2D(aoPointSampler, IN.UVCoord + float2(aoRcpres.x, 0)).r; lo = min(lo, n); hi = max(hi, n);
+	n = tex2D(aoPointSampler, IN.UVCoord - float2(aoRcpres.x, 0)).r; lo = min(lo, n); hi = max(hi, n);
+	n = tex2D(aoPointSampler, IN.UVCoord + float2(0, aoRcpres.y)).r; lo = min(lo, n); hi = max(hi, n);
+	n = tex2D(aoPointSampler, IN.UVCoord - float2(0, aoRcpres.y)).r; lo = min(lo, n); hi = max(hi, n);
+	float history = clamp(tex2D(historySampler, IN.UVCoord).r, lo, hi);
+
+	float depth = tex2D(lowDepthSampler, IN.UVCoord).r;
+	float prevDepth = tex2D(prevLowDepthSampler, IN.UVCoord).r;
+	float depthMatch = saturate(1 - abs(depth - prevDepth)/(depth*historyDepthTolerance));
+
+	float ao = lerp(current, history, historyWeight*depthMatch*historyValid);
+	return float4(ao, ao, ao, 1);
+}
+
+float4 DownsampleDepth( VSOUT IN ) : COLOR0 {
+	return float4(readLinearDepth(IN.UVCoord), 0, 0, 1);
+}
+
+float upsampleAO(in float2 coord) {
+	float depth = readLinearDepth(coord);
+
+	float2 pos = coord*aoSize - 0.5;
+	float2 base = floor(pos);
+	float2 f = pos - base;
+	float2 uv00 = (base + 0.5)*aoRcpres;
+	float2 uv10 = uv00 + float2(aoRcpres.x, 0);
+	float2 uv01 = uv00 + float2(0, aoRcpres.y);
+	float2 uv11 = uv00 + aoRcpres;
+
+	float4 lowDepth = float4(tex2D(lowDepthSampler, uv00).r, tex2D(lowDepthSampler, uv10).r,
+		tex2D(lowDepthSampler, uv01).r, tex2D(lowDepthSampler, uv11).r);
+	float4 ao = float4(tex2D(aoPointSampler, uv00).r, tex2D(aoPointSampler, uv10).r,
+		tex2D(aoPointSampler, uv01).r, tex2D(aoPointSampler, uv11).r);
+
+	float4 weights = float4((1-f.x)*(1-f.y), f.x*(1-f.y), (1-f.x)*f.y, f.x*f.y);
+	weights /= upsampleDepthTolerance + abs(lowDepth - depth)/depth;
+	return dot(weights, ao) / dot(weights, 1.0);
+}
+
+#ifdef SSAO_SMAA
+#define SMAA_HLSL_3 1
+#define SMAA_PIXEL_SIZE PIXEL_SIZE
+#include "SMAA.h"
+
+texture2D blendTex2D;
+
+// SMAA blends in linear space
+sampler2D frameLinearSampler {
+	Texture = <frameTex2D>;
+	AddressU = Clamp; AddressV = Clamp;
+	MipFilter = Point; MinFilter = Linear; MagFilter = Linear;
+	SRGBTexture = true;
+};
+
+sampler2D blendSampler {
+	Texture = <blendTex2D>;
+	AddressU = Clamp; AddressV = Clamp;
+	MipFilter = Linear; MinFilter = Linear; MagFilter = Linear;
+	SRGBTexture = false;
+};
+#endif
+
+#ifdef SSAO_FXAA
+#define FXAA_PC 1
+#define FXAA_HLSL_3 1
+// there is no luma pass writing alpha
+#define FXAA_LUMA_FROM_RGB 1
+#include "FXAA.h"
+#endif
+
+// color of the frame for the combine pass, antialiased if applyAA (with the settings of SMAA.fx or FXAA.fx)
+float3 readFrame(in float2 coord, uniform bool applyAA) {
+#if defined(SSAO_SMAA)
+	if(applyAA) {
+		float4 offset[2];
+		offset[0] = coord.xyxy + PIXEL_SIZE.xyxy*float4(-1, 0, 0, -1);
+		offset[1] = coord.xyxy + PIXEL_SIZE.xyxy*float4(1, 0, 0, 1);
+		float3 color = SMAANeighborhoodBlendingPS(coord, offset, frameLinearSampler, blendSampler).rgb;
+		// back to sRGB, the AO is applied to the same colors as without AA
+		return color <= 0.0031308 ? color*12.92 : 1.055*pow(color, 1/2.4) - 0.055;
+	}
+#elif defined(SSAO_FXAA)
+	if(applyAA) {
+		return FxaaPixelShader(coord, float4(0,0,0,0), frameSampler, frameSampler, frameSampler, PIXEL_SIZE,
+			float4(0,0,0,0), float4(0,0,0,0), float4(0,0,0,0), 0.75, 0.125, 0.0312, 8.0, 0.125, 0.05, float4(0,0,0,0)).rgb;
+	}
+#endif
+	return tex2D(frameSampler, coord).rgb;
+}
@@ -0,0 +1,204 @@
+// Resampling of the frame from the render to the present resolution, used by Scaler
+// KERNEL 0 = Catmull-Rom bicubic, 1 = Lanczos3; the kernel is widened by the ratio when downsampling
+// P0/P1 are the horizontal and vertical pass, P2 is the single pass edge-adaptive upscaler
+
+#ifndef SRC_SIZE
+#define SRC_SIZE float2(1920, 1080)
+#endif
+#ifndef RATIO
+#define RATIO float2(1.0, 1.0)
+#endif
+#ifndef KERNEL
+#define KERNEL 1
+#endif
+#ifndef TAPS_H
+#define TAPS_H 6
+#endif
+#ifndef TAPS_V
+#define TAPS_V 6
+#endif
+#ifndef SHARPENING
+#define SHARPENING 0.3
+#endif
+
+static const float PI = 3.14159265;
+static const float LANCZOS_RADIUS = 3.0;
+
+texture2D srcTex2D;
+
+sampler pointSampler = sampler_state
+{
+	texture = <srcTex2D>;
+	AddressU = CLAMP;
+	AddressV = CLAMP;
+	MINFILTER = POINT;
+	MAGFILTER = POINT;
+	MIPFILTER = NONE;
+};
+
+struct VSOUT
+{
+	float4 vertPos : POSITION;
+	float2 UVCoord : TEXCOORD0;
+};
+
+struct VSIN
+{
+	float4 vertPos : POSITION0;
+	float2 UVCoord : TEXCOORD0;
+};
+
+VSOUT FrameVS(VSIN IN)
+{
+	VSOUT OUT;
+	OUT.vertPos = IN.vertPos;
+	OUT.UVCoord = IN.UVCoord;
+	return OUT;
+}
+
+float kernel(float x)
+{
+	x = abs(x);
+#if KERNEL == 0
+	if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+	if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+	return 0.0;
+#else
+	if (x < 0.0001) return 1.0;
+	if (x >= LANCZOS_RADIUS) return 0.0;
+	float px = PI * x;
+	return LANCZOS_RADIUS * sin(px) * sin(px / LANCZOS_RADIUS) / (px * px);
+#endif
+}
+
+// source pixels around the target pixel center along one axis, the weights are normalized
+float4 resample(float2 uv, float2 axis, float size, float ratio, const int taps)
+{
+	float center = dot(uv, axis) * size;
+	float first = floor(center - 0.5) - (taps / 2 - 1);
+	float widen = max(ratio, 1.0);
+	float4 sum = 0.0;
+	float weightSum = 0.0;
+	for (int i = 0; i < taps; ++i)
+	{
+		float p = first + i;
+		float w = kernel((p + 0.5 - center) / widen);
+		float2 coord = uv * (1.0 - axis) + axis * ((p + 0.5) / size);
+		sum += tex2Dlod(pointSampler, float4(coord, 0.0, 0.0)) * w;
+		weightSum += w;
+	}
+	return sum / weightSum;
+}
+
+float4 HorizontalPS(VSOUT IN) : COLOR0
+{
+	return resample(IN.UVCoord, float2(1.0, 0.0), SRC_SIZE.x, RATIO.x, TAPS_H);
+}
+
+float4 VerticalPS(VSOUT IN) : COLOR0
+{
+	return float4(resample(IN.UVCoord, float2(0.0, 1.0), SRC_SIZE.y, RATIO.y, TAPS_V).rgb, 1.0);
+}
+
+float3 fetch(float2 pixel)
+{
+	return tex2Dlod(pointSampler, float4((pixel + 0.5) / SRC_SIZE, 0.0, 0.0)).rgb;
+}
+
+float luma(float3 color)
+{
+	return dot(color, float3(0.299, 0.587, 0.114));
+}
+
+float4 catmullRomWeights(float t)
+{
+	float t2 = t * t, t3 = t2 * t;
+	return float4(-0.5 * t3 + t2 - 0.5 * t, 1.5 * t3 - 2.5 * t2 + 1.0, -1.5 * t3 + 2.0 * t2 + 0.5 * t, 0.5 * t3 - 0.5 * t2);
+}
+
+float4 AdaptivePS(VSOUT IN) : COLOR0
+{
+	float2 pos = IN.UVCoord * SRC_SIZE - 0.5;
+	float2 base = floor(pos);
+	float2 f = pos - base;
+
+	// bicubic from the 4x4 neighbourhood
+	float4 wx = catmullRomWeights(f.x), wy = catmullRomWeights(f.y);
+	float3 cubic = 0.0;
+	for (int y = 0; y < 4; ++y)
+	{
+		float3 row = fetch(base + float2(-1, y - 1)) * wx.x + fetch(base + float2(0, y - 1)) * wx.y
+		           + fetch(base + float2(1, y - 1)) * wx.z + fetch(base + float2(2, y - 1)) * wx.w;
+		cubic += row * wy[y];
+	}
+
+	// the nearest 2x2 pixels
+	float3 a = fetch(base), b = fetch(base + float2(1, 0)), c = fetch(base + float2(0, 1)), d = fetch(base + float2(1, 1));
+	float3 bilinear = lerp(lerp(a, b, f.x), lerp(c, d, f.x), f.y);
+
+	// interpolate within the triangle on the side of the diagonal which does not cross the edge
+	float diagAD = abs(luma(a) - luma(d)), diagBC = abs(luma(b) - luma(c));
+	float3 directed;
+	if (diagAD < diagBC)
+	{
+		directed = f.x > f.y ? a * (1.0 - f.x) + b * (f.x - f.y) + d * f.y
+		                     : a * (1.0 - f.y) + c * (f.y - f.x) + d * f.x;
+	}
+	else
+	{
+		directed = f.x + f.y < 1.0 ? a * (1.0 - f.x - f.y) + b * f.x + c * f.y
+		                           : b * (1.0 - f.y) + c * (1.0 - f.x) + d * (f.x + f.y - 1.0);
+	}
+	float edge = saturate(abs(diagAD - diagBC) * 4.0);
+	float3 color = lerp(cubic, directed, edge);
+
+	// sharpen against the bilinear result, within the range of the nearest pixels so it does not ring
+	color += SHARPENING * (color - bilinear);
+	color = clamp(color, min(min(a, b), min(c, d)), max(max(a, b), max(c, d)));
+	return float4(color, 1.0);
+}
+
+technique t0
+{
+	pass P0
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 HorizontalPS();
+		ZEnable = false;
+		AlphaBlendEnable = false;
+		AlphaTestEnable = false;
+		StencilEnable = false;
+		ScissorTestEnable = false;
+		CullMode = NONE;
+		ColorWriteEnable = RED | GREEN | BLUE | ALPHA;
+		SRGBWriteEnable = false;
+	}
+
+	pass P1
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 VerticalPS();
+		ZEnable = false;
+		AlphaBlendEnable = false;
+		AlphaTestEnable = false;
+		StencilEnable = false;
+		ScissorTestEnable = false;
+		CullMode = NONE;
+		ColorWriteEnable = RED | GREEN | BLUE | ALPHA;
+		SRGBWriteEnable = false;
+	}
+
+	pass P2
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 AdaptivePS();
+		ZEnable = false;
+		AlphaBlendEnable = false;
+		AlphaTestEnable = false;
+		StencilEnable = false;
+		ScissorTestEnable = false;
+		CullMode = NONE;
+		ColorWriteEnable = RED | GREEN | BLUE | ALPHA;
+		SRGBWriteEnable = false;
+	}
+}
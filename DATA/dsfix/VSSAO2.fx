@@ -14,10 +14,6 @@ extern float ThicknessModel = 50; //units in space the AO assumes objects' thick
 extern float FOV = 80; //Field of View in Degrees
 extern float luminosity_threshold = 0.5;
 
-#ifndef SCALE
-#define SCALE 1.0
-#endif
-
 #ifndef SSAO_STRENGTH_LOW
 #ifndef SSAO_STRENGTH_MEDIUM
 #ifndef SSAO_STRENGTH_HIGH
@@ -68,21 +64,6 @@ sampler sampleSampler = sampler_state
 	MaxAnisotropy = 16;
 };
 
-texture2D depthTex2D;
-sampler depthSampler = sampler_state
-{
-	texture = <depthTex2D>;
-	MinFilter = POINT;
-	MagFilter = POINT;
-	MipFilter = POINT;
-	AddressU  = Clamp;
-	AddressV  = Clamp;
-	SRGBTexture=FALSE;
-	MaxMipLevel=0;
-	MipMapLodBias=0;
-	MaxAnisotropy = 16;
-};
-
 texture2D AOTex2D;
 sampler AOSampler = sampler_state
 {
@@ -253,9 +234,10 @@ float2 rand(in float2 uv : TEXCOORD0) {
 	return float2(noiseX, noiseY);
 }
 
-float readDepth(in float2 coord : TEXCOORD0) {
-	float4 col = tex2D(depthSampler, coord);
-	float posZ = ((1.0-col.z) + (1.0-col.y)*256.0 + (1.0-col.x)*(256.0*256.0));
+#include "SSAO.h"
+
+float readDepth(in float2 coord : TEXCOORD0, in float lod) {
+	float posZ = readAODepth(coord, lod);
 	return (posZ-nearZ)/farZ;
 }
 
@@ -267,11 +249,9 @@ float3 getPosition(in float2 uv : TEXCOORD0, in float eye_z : POSITION0) {
 
 float4 ssao_Main(VSOUT IN) : COLOR0
 {
-	clip(1/SCALE-IN.UVCoord.x);
-	clip(1/SCALE-IN.UVCoord.y);	
-	IN.UVCoord.xy *= SCALE;
+	IN.UVCoord = beginAOPixel(IN.UVCoord);
 
-	float depth = readDepth(IN.UVCoord);
+	float depth = readDepth(IN.UVCoord, 0);
 	float3 pos = getPosition(IN.UVCoord, depth);
 	float3 dx = ddx(pos);
 	float3 dy = ddy(pos);
@@ -283,7 +263,7 @@ float4 ssao_Main(VSOUT IN) : COLOR0
 	float ao=tex2D(AOSampler, IN.UVCoord);
 	float s=tex2D(sampleSampler, IN.UVCoord);
 
-	float2 rand_vec = rand(IN.UVCoord);
+	float2 rand_vec = aoJitter(rand(aoNoiseCoord(IN.UVCoord)));
 	float2 sample_vec_divisor = g_InvFocalLen*depth*depthRange/(aoRadiusMultiplier*5000*rcpres);
 	float2 sample_center = IN.UVCoord + norm.xy/sample_vec_divisor*float2(1.0f,aspect);
 	float sample_center_depth = depth*depthRange + norm.z*aoRadiusMultiplier*7;
@@ -295,7 +275,7 @@ float4 ssao_Main(VSOUT IN) : COLOR0
 		float2 sample_coords = sample_center + sample_vec*float2(1.0f,aspect);
 		
 		float curr_sample_radius = sample_radius[i]*aoRadiusMultiplier*10;
-		float curr_sample_depth = depthRange*readDepth(sample_coords);
+		float curr_sample_depth = depthRange*readDepth(sample_coords, depthLod(sample_coords - IN.UVCoord));
 		
 		ao += clamp(0,curr_sample_radius+sample_center_depth-curr_sample_depth,2*curr_sample_radius);
 		ao -= clamp(0,curr_sample_radius+sample_center_depth-curr_sample_depth-ThicknessModel/(exp2(depth)),2*curr_sample_radius);
@@ -316,10 +296,10 @@ float4 HBlur( VSOUT IN ) : COLOR0 {
 	float color = tex2D(passSampler, IN.UVCoord).r;
 
 	float blurred = color*0.2270270270;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(rcpres.x*1.3846153846, 0)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(rcpres.x*1.3846153846, 0)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(rcpres.x*3.2307692308, 0)).r * 0.0702702703;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(rcpres.x*3.2307692308, 0)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(aoRcpres.x*1.3846153846, 0)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(aoRcpres.x*1.3846153846, 0)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(aoRcpres.x*3.2307692308, 0)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(aoRcpres.x*3.2307692308, 0)).r * 0.0702702703;
 	
 	return blurred;
 }
@@ -328,17 +308,17 @@ float4 VBlur( VSOUT IN ) : COLOR0 {
 	float color = tex2D(passSampler, IN.UVCoord).r;
 
 	float blurred = color*0.2270270270;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(0, rcpres.y*1.3846153846)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(0, rcpres.y*1.3846153846)).r * 0.3162162162;
-	blurred += tex2D(passSampler, IN.UVCoord + float2(0, rcpres.y*3.2307692308)).r * 0.0702702703;
-	blurred += tex2D(passSampler, IN.UVCoord - float2(0, rcpres.y*3.2307692308)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(0, aoRcpres.y*1.3846153846)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(0, aoRcpres.y*1.3846153846)).r * 0.3162162162;
+	blurred += tex2D(passSampler, IN.UVCoord + float2(0, aoRcpres.y*3.2307692308)).r * 0.0702702703;
+	blurred += tex2D(passSampler, IN.UVCoord - float2(0, aoRcpres.y*3.2307692308)).r * 0.0702702703;
 	
 	return blurred;
 }
 
-float4 Combine( VSOUT IN ) : COLOR0 {
-	float3 color = tex2D(frameSampler, IN.UVCoord).rgb;
-	float ao = tex2D(passSampler, IN.UVCoord/SCALE).r;
+float4 Combine( VSOUT IN, uniform bool applyAA ) : COLOR0 {
+	float3 color = readFrame(IN.UVCoord, applyAA);
+	float ao = upsampleAO(IN.UVCoord);
 	ao = clamp(ao, aoClamp, 1.0);
 
 	#ifdef LUMINANCE_CONSIDERATION
@@ -376,6 +356,31 @@ technique t0
 	pass p3
 	{
 		VertexShader = compile vs_3_0 FrameVS();
-		PixelShader = compile ps_3_0 Combine();
+		PixelShader = compile ps_3_0 Combine(false);
+	}
+	pass p4
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 DownsampleDepth();
+	}
+	pass p5
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 DeinterleaveDepth();
+	}
+	pass p6
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 Reinterleave();
+	}
+	pass p7
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 TemporalResolve();
+	}
+	pass p8
+	{
+		VertexShader = compile vs_3_0 FrameVS();
+		PixelShader = compile ps_3_0 Combine(true);
 	}
 }
\ No newline at end of file
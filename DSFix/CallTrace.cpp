@@ -0,0 +1,303 @@
+
+#include "CallTrace.h"
+
+#include "main.h"
+#include "Settings.h"
+#include "HudCache.h"
+
+CallTrace CallTrace::instance;
+
+void CallTrace::toggleRecording()
+{
+	toggleRequested = !toggleRequested;
+	if (toggleRequested)
+	{
+		SDLOG(0, "Call trace recording %s at the end of the frame", recording ? "stops" : "starts");
+	}
+	else
+	{
+		SDLOG(0, "Call trace recording toggle cancelled");
+	}
+}
+
+void CallTrace::start()
+{
+	fopen_s(&file, GetDirectoryFile("dsfix\\calltrace.bin"), "wb");
+	if (!file)
+	{
+		SDLOG(0, "ERROR: could not open call trace file");
+		return;
+	}
+	TraceHeader header = { MAGIC, TRACE_VERSION,
+		Settings::get().getRenderWidth(), Settings::get().getRenderHeight(), Settings::get().getPresentWidth(), Settings::get().getPresentHeight(),
+		Settings::get().getDOFOverrideResolution() };
+	fwrite(&header, sizeof(header), 1, file);
+	frame.resize(FRAME_WORDS);
+	used = 0;
+	dropped = 0;
+	frames = 0;
+	handles.clear();
+	nextHandle = 1;
+	recording = true;
+	SDLOG(0, "Call trace recording started");
+}
+
+void CallTrace::stop()
+{
+	recording = false;
+	fclose(file);
+	file = NULL;
+	frame.clear();
+	handles.clear();
+	SDLOG(0, "Call trace recording stopped after %u frames", frames);
+}
+
+bool CallTrace::endFrame()
+{
+	if (recording)
+	{
+		fwrite(&used, sizeof(used), 1, file);
+		fwrite(&dropped, sizeof(dropped), 1, file);
+		fwrite(&frame[0], sizeof(UINT32), used, file);
+		if (dropped) SDLOG(0, "WARNING: call trace frame %u overflowed, dropped %u records", frames, dropped);
+		++frames;
+		used = 0;
+		dropped = 0;
+	}
+	if (toggleRequested)
+	{
+		toggleRequested = false;
+		if (recording) stop();
+		else
+		{
+			start();
+			return recording;
+		}
+	}
+	return false;
+}
+
+UINT32* CallTrace::begin(Call call, unsigned numArgs)
+{
+	if (used + 1 + numArgs > FRAME_WORDS)
+	{
+		++dropped;
+		return NULL;
+	}
+	UINT32* record = &frame[used];
+	record[0] = call | (numArgs << 16);
+	used += 1 + numArgs;
+	return record + 1;
+}
+
+UINT32 CallTrace::handle(const void* resource, bool& isNew)
+{
+	HandleMap::const_iterator it = handles.find(resource);
+	isNew = it == handles.end();
+	if (!isNew) return it->second;
+	return handles[resource] = nextHandle++;
+}
+
+UINT32 CallTrace::texture(IDirect3DBaseTexture9* pTexture)
+{
+	if (!pTexture) return 0;
+	bool isNew;
+	UINT32 h = handle(pTexture, isNew);
+	if (isNew)
+	{
+		D3DSURFACE_DESC desc = { D3DFMT_UNKNOWN, D3DRTYPE_TEXTURE, 0, D3DPOOL_DEFAULT, D3DMULTISAMPLE_NONE, 0, 1, 1 };
+		if (pTexture->GetType() == D3DRTYPE_TEXTURE) ((IDirect3DTexture9*)pTexture)->GetLevelDesc(0, &desc);
+		if (UINT32* args = begin(TextureDesc, 7))
+		{
+			args[0] = h;
+			args[1] = desc.Width;
+			args[2] = desc.Height;
+			args[3] = pTexture->GetLevelCount();
+			args[4] = desc.Usage;
+			args[5] = desc.Format;
+			args[6] = desc.Pool;
+		}
+	}
+	return h;
+}
+
+UINT32 CallTrace::surface(IDirect3DSurface9* pSurface)
+{
+	if (!pSurface) return 0;
+	bool isNew;
+	UINT32 h = handle(pSurface, isNew);
+	if (isNew)
+	{
+		D3DSURFACE_DESC desc;
+		pSurface->GetDesc(&desc);
+		// level surfaces are replayed as part of their texture
+		UINT32 container = 0, level = 0;
+		CComPtr<IDirect3DTexture9> tex;
+		if (pSurface->GetContainer(IID_IDirect3DTexture9, (void**)&tex) == D3D_OK)
+		{
+			container = texture(tex);
+			for (DWORD i = 0; i < tex->GetLevelCount(); ++i)
+			{
+				CComPtr<IDirect3DSurface9> levelSurf;
+				tex->GetSurfaceLevel(i, &levelSurf);
+				if (levelSurf == pSurface) level = i;
+			}
+		}
+		if (UINT32* args = begin(SurfaceDesc, 7))
+		{
+			args[0] = h;
+			args[1] = desc.Width;
+			args[2] = desc.Height;
+			args[3] = desc.Format;
+			args[4] = desc.Usage;
+			args[5] = container;
+			args[6] = level;
+		}
+	}
+	return h;
+}
+
+void CallTrace::recordTextureHash(IDirect3DTexture9* pTexture, UINT32 hash)
+{
+	UINT32 h = texture(pTexture);
+	if (UINT32* args = begin(TextureHash, 2))
+	{
+		args[0] = h;
+		args[1] = hash;
+	}
+}
+
+void CallTrace::recordCreateTexture(IDirect3DTexture9* pTexture, UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool)
+{
+	bool isNew;
+	UINT32 h = handle(pTexture, isNew);
+	if (UINT32* args = begin(CreateTexture, 7))
+	{
+		args[0] = h;
+		args[1] = Width;
+		args[2] = Height;
+		args[3] = Levels;
+		args[4] = Usage;
+		args[5] = Format;
+		args[6] = Pool;
+	}
+}
+
+void CallTrace::recordCreateRenderTarget(IDirect3DSurface9* pSurface, UINT Width, UINT Height, D3DFORMAT Format)
+{
+	bool isNew;
+	UINT32 h = handle(pSurface, isNew);
+	if (UINT32* args = begin(CreateRenderTarget, 4))
+	{
+		args[0] = h;
+		args[1] = Width;
+		args[2] = Height;
+		args[3] = Format;
+	}
+}
+
+void CallTrace::recordCreateDepthStencilSurface(IDirect3DSurface9* pSurface, UINT Width, UINT Height, D3DFORMAT Format)
+{
+	bool isNew;
+	UINT32 h = handle(pSurface, isNew);
+	if (UINT32* args = begin(CreateDepthStencilSurface, 4))
+	{
+		args[0] = h;
+		args[1] = Width;
+		args[2] = Height;
+		args[3] = Format;
+	}
+}
+
+void CallTrace::recordSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
+{
+	UINT32 h = surface(pRenderTarget);
+	if (UINT32* args = begin(SetRenderTarget, 2))
+	{
+		args[0] = RenderTargetIndex;
+		args[1] = h;
+	}
+}
+
+void CallTrace::recordSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
+{
+	UINT32 h = surface(pNewZStencil);
+	if (UINT32* args = begin(SetDepthStencilSurface, 1))
+	{
+		args[0] = h;
+	}
+}
+
+void CallTrace::recordSetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture)
+{
+	UINT32 h = texture(pTexture);
+	if (UINT32* args = begin(SetTexture, 2))
+	{
+		args[0] = Stage;
+		args[1] = h;
+	}
+}
+
+void CallTrace::recordSetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+	if (UINT32* args = begin(SetRenderState, 2))
+	{
+		args[0] = State;
+		args[1] = Value;
+	}
+}
+
+void CallTrace::recordSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+	if (UINT32* args = begin(SetTextureStageState, 3))
+	{
+		args[0] = Stage;
+		args[1] = Type;
+		args[2] = Value;
+	}
+}
+
+void CallTrace::recordStretchRect(IDirect3DSurface9* pSourceSurface, IDirect3DSurface9* pDestSurface, D3DTEXTUREFILTERTYPE Filter)
+{
+	UINT32 src = surface(pSourceSurface), dst = surface(pDestSurface);
+	if (UINT32* args = begin(StretchRect, 3))
+	{
+		args[0] = src;
+		args[1] = dst;
+		args[2] = Filter;
+	}
+}
+
+void CallTrace::recordDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	if (UINT32* args = begin(DrawPrimitiveUP, 3 + VERTEX_WORDS))
+	{
+		args[0] = PrimitiveType;
+		args[1] = PrimitiveCount;
+		args[2] = VertexStreamZeroStride;
+		// only the start of the vertex data, which is all the HUD detection looks at
+		ZeroMemory(args + 3, VERTEX_WORDS * sizeof(UINT32));
+		memcpy(args + 3, pVertexStreamZeroData, std::min<size_t>(VERTEX_WORDS * sizeof(UINT32), VertexStreamZeroStride * HudCache::verticesPerDraw(PrimitiveType, PrimitiveCount)));
+	}
+}
+
+void CallTrace::recordDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	if (UINT32* args = begin(DrawIndexedPrimitiveUP, 6 + VERTEX_WORDS))
+	{
+		args[0] = PrimitiveType;
+		args[1] = MinIndex;
+		args[2] = NumVertices;
+		args[3] = PrimitiveCount;
+		args[4] = IndexDataFormat;
+		args[5] = VertexStreamZeroStride;
+		ZeroMemory(args + 6, VERTEX_WORDS * sizeof(UINT32));
+		memcpy(args + 6, pVertexStreamZeroData, std::min<size_t>(VERTEX_WORDS * sizeof(UINT32), VertexStreamZeroStride * NumVertices));
+	}
+}
+
+void CallTrace::recordReset()
+{
+	// resources recreated after the reset at a reused address get rebound by their creation record
+	begin(Reset, 0);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <d3d9.h>
+
+// Compact binary trace of the device calls which DSfix reacts to, used for offline replay and benchmarking (see TraceReplayer)
+//
+// File layout: a TraceHeader, followed by one block per frame
+// Frame block: UINT32 number of words, UINT32 number of dropped records, then the records
+// Record: UINT32 (call id | number of argument words << 16), followed by the argument words
+// Resources are identified by handles, which are numbered in order of first appearance
+class CallTrace
+{
+public:
+	enum Call
+	{
+		// resource descriptions, written the first time a resource shows up or when it is created
+		TextureDesc,        // handle, width, height, levels, usage, format, pool
+		SurfaceDesc,        // handle, width, height, format, usage, container handle, level
+		TextureHash,        // handle, hash of the file data the texture was created from
+		// hooked device calls
+		CreateTexture,      // handle, width, height, levels, usage, format, pool
+		CreateRenderTarget, // handle, width, height, format
+		CreateDepthStencilSurface, // handle, width, height, format
+		SetRenderTarget,    // index, handle
+		SetDepthStencilSurface, // handle
+		SetTexture,         // stage, handle
+		SetRenderState,     // state, value
+		SetTextureStageState, // stage, type, value
+		StretchRect,        // source handle, dest handle, filter
+		DrawPrimitiveUP,    // type, count, stride, first VERTEX_WORDS words of vertex data
+		DrawIndexedPrimitiveUP, // type, min index, vertices, count, index format, stride, first VERTEX_WORDS words of vertex data
+		Reset,
+		Present,            // not recorded, implied by the end of each frame block
+		NUM_CALLS
+	};
+
+	static const UINT32 MAGIC = 0x54465344; // "DSFT"
+	static const UINT32 TRACE_VERSION = 1;
+	static const unsigned VERTEX_WORDS = 4;
+
+	struct TraceHeader
+	{
+		UINT32 magic, version;
+		// settings which influence the detection, the replay has to run with the same ones
+		UINT32 renderWidth, renderHeight, presentWidth, presentHeight, dofResolution;
+	};
+
+private:
+	static CallTrace instance;
+
+	// frame buffer size in words, records which do not fit are dropped
+	static const unsigned FRAME_WORDS = 256 * 1024;
+
+	bool recording, toggleRequested;
+	FILE* file;
+	std::vector<UINT32> frame;
+	unsigned used, dropped, frames;
+
+	typedef std::map<const void*, UINT32> HandleMap;
+	HandleMap handles;
+	UINT32 nextHandle;
+
+	void start();
+	void stop();
+	UINT32* begin(Call call, unsigned numArgs);
+	UINT32 handle(const void* resource, bool& isNew);
+	UINT32 texture(IDirect3DBaseTexture9* pTexture);
+	UINT32 surface(IDirect3DSurface9* pSurface);
+
+public:
+	static CallTrace& get()
+	{
+		return instance;
+	}
+
+	CallTrace() : recording(false), toggleRequested(false), file(NULL), used(0), dropped(0), frames(0), nextHandle(1) {}
+
+	bool isRecording() const
+	{
+		return recording;
+	}
+	// recording starts and stops at frame boundaries
+	void toggleRecording();
+
+	void recordTextureHash(IDirect3DTexture9* pTexture, UINT32 hash);
+	void recordCreateTexture(IDirect3DTexture9* pTexture, UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool);
+	void recordCreateRenderTarget(IDirect3DSurface9* pSurface, UINT Width, UINT Height, D3DFORMAT Format);
+	void recordCreateDepthStencilSurface(IDirect3DSurface9* pSurface, UINT Width, UINT Height, D3DFORMAT Format);
+	void recordSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget);
+	void recordSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil);
+	void recordSetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture);
+	void recordSetRenderState(D3DRENDERSTATETYPE State, DWORD Value);
+	void recordSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+	void recordStretchRect(IDirect3DSurface9* pSourceSurface, IDirect3DSurface9* pDestSurface, D3DTEXTUREFILTERTYPE Filter);
+	void recordDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride);
+	void recordDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride);
+	void recordReset();
+
+	// writes the records of the finished frame and handles toggle requests, called on Present
+	// returns true if recording started, the known textures have to be recorded then (see recordTextureHash)
+	bool endFrame();
+};
@@ -0,0 +1,79 @@
+
+#include "DepthPyramid.h"
+
+DepthPyramid::DepthPyramid(IDirect3DDevice9 *device, int width, int height)
+	: Effect(device), width(width), height(height), levels(1)
+{
+	while (levels < MAX_LEVELS && (width >> levels) > 0 && (height >> levels) > 0) ++levels;
+
+	DWORD flags = D3DXFX_NOT_CLONEABLE | D3DXSHADER_OPTIMIZATION_LEVEL3;
+
+	// Load effect from file
+	SDLOG(0, "DepthPyramid load, %u levels", levels);
+	ID3DXBuffer* errors;
+	HRESULT hr = D3DXCreateEffectFromFile(device, GetDirectoryFile("dsfix\\DepthPyramid.fx"), NULL, NULL, flags, NULL, &effect, &errors);
+	if (hr != D3D_OK) SDLOG(0, "ERRORS:\n %s", errors->GetBufferPointer());
+
+	// Create buffers
+	hr = device->CreateTexture(width, height, levels, D3DUSAGE_RENDERTARGET, D3DFMT_G32R32F, D3DPOOL_DEFAULT, &pyramidTex, NULL);
+	if (hr != D3D_OK) SDLOG(0, "ERROR: DepthPyramid could not create G32R32F rendertarget");
+	pyramidSurfs.resize(levels);
+	scratchTex.resize(levels);
+	scratchSurfs.resize(levels);
+	for (unsigned l = 0; l < levels; ++l)
+	{
+		pyramidTex->GetSurfaceLevel(l, &pyramidSurfs[l]);
+		if (l == 0) continue;
+		device->CreateTexture(width >> l, height >> l, 1, D3DUSAGE_RENDERTARGET, D3DFMT_G32R32F, D3DPOOL_DEFAULT, &scratchTex[l], NULL);
+		scratchTex[l]->GetSurfaceLevel(0, &scratchSurfs[l]);
+	}
+
+	// get handles
+	depthTexHandle = effect->GetParameterByName(NULL, "depthTex2D");
+	pyramidTexHandle = effect->GetParameterByName(NULL, "pyramidTex2D");
+	srcLevelHandle = effect->GetParameterByName(NULL, "srcLevel");
+	srcPixelSizeHandle = effect->GetParameterByName(NULL, "srcPixelSize");
+	srcOddHandle = effect->GetParameterByName(NULL, "srcOdd");
+}
+
+void DepthPyramid::go(IDirect3DTexture9 *depth)
+{
+	device->SetVertexDeclaration(vertexDeclaration);
+
+	UINT passes;
+
+	// Decode
+	{
+		GpuProfiler::Scope profile("DepthPyramid", "decode");
+		device->SetRenderTarget(0, pyramidSurfs[0]);
+		effect->SetTexture(depthTexHandle, depth);
+		effect->Begin(&passes, 0);
+		effect->BeginPass(0);
+		quad(width, height);
+		effect->EndPass();
+		effect->End();
+	}
+
+	// Min/max reduction
+	{
+		GpuProfiler::Scope profile("DepthPyramid", "reduce");
+		effect->SetTexture(pyramidTexHandle, pyramidTex);
+		for (unsigned l = 1; l < levels; ++l)
+		{
+			int srcWidth = width >> (l - 1), srcHeight = height >> (l - 1);
+			D3DXVECTOR4 srcPixelSize(1.0f / srcWidth, 1.0f / srcHeight, 0.0f, 0.0f);
+			// an odd source size (e.g. 135 to 67) is reduced 3 texels wide, see DepthPyramid.fx
+			D3DXVECTOR4 srcOdd(float(srcWidth & 1), float(srcHeight & 1), 0.0f, 0.0f);
+			effect->SetFloat(srcLevelHandle, float(l - 1));
+			effect->SetVector(srcPixelSizeHandle, &srcPixelSize);
+			effect->SetVector(srcOddHandle, &srcOdd);
+			device->SetRenderTarget(0, scratchSurfs[l]);
+			effect->Begin(&passes, 0);
+			effect->BeginPass(1);
+			quad(width >> l, height >> l);
+			effect->EndPass();
+			effect->End();
+			device->StretchRect(scratchSurfs[l], NULL, pyramidSurfs[l], NULL, D3DTEXF_NONE);
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <dxgi.h>
+#include <d3d9.h>
+#include <d3dx9.h>
+#include <dxerr.h>
+
+#include "Effect.h"
+
+// Decodes the depth the game packs into the 24 RGB bits of its Z buffer RT into eye space depth (in world units),
+// and builds a mip chain of it with the minimum depth of each texel in r and the maximum in g
+// Built once per frame and shared by all effects which need depth, so that they neither unpack it per sample
+// nor need to know the packing, and can read coarse levels for samples far from the pixel they shade
+class DepthPyramid : public Effect
+{
+public:
+	static const unsigned MAX_LEVELS = 6;
+
+	DepthPyramid(IDirect3DDevice9 *device, int width, int height);
+	virtual ~DepthPyramid() {};
+
+	void go(IDirect3DTexture9 *depth);
+
+	IDirect3DTexture9* getTexture()
+	{
+		return pyramidTex;
+	}
+
+private:
+	int width, height;
+	unsigned levels;
+
+	CComPtr<ID3DXEffect> effect;
+
+	CComPtr<IDirect3DTexture9> pyramidTex;
+	std::vector<CComPtr<IDirect3DSurface9> > pyramidSurfs;
+	// a level can not be rendered while the pyramid is bound as the source, so levels above 0 are rendered here and copied
+	std::vector<CComPtr<IDirect3DTexture9> > scratchTex;
+	std::vector<CComPtr<IDirect3DSurface9> > scratchSurfs;
+
+	D3DXHANDLE depthTexHandle, pyramidTexHandle, srcLevelHandle, srcPixelSizeHandle, srcOddHandle;
+};
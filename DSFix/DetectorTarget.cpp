@@ -0,0 +1,140 @@
+#include "DetectorTarget.h"
+
+#include "main.h"
+#include "Settings.h"
+#include "NullDevice.h"
+
+HookTarget* DetectorTarget::create(NullDevice* device)
+{
+	return new DetectorTarget(device);
+}
+
+DetectorTarget::DetectorTarget(IDirect3DDevice9* device)
+	: device(device)
+{
+	hooks.setD3DDevice(device);
+	hooks.setHeadless(true);
+	initResources();
+}
+
+DetectorTarget::~DetectorTarget()
+{
+	hooks.releasePipelineResources();
+}
+
+void DetectorTarget::initResources()
+{
+	hooks.initPipelineResources();
+	// the HUD goes to its layer where RSManager has the HUD composite, which is created with the HUD mod
+	if (Settings::get().getEnableHudMod())
+	{
+		CComPtr<IDirect3DTexture9> layer;
+		device->CreateTexture(Settings::get().getRenderWidth(), Settings::get().getRenderHeight(), 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &layer, NULL);
+		hooks.registerRenderTexture(layer);
+		hooks.setHudLayer(layer);
+	}
+}
+
+void DetectorTarget::registerMainRenderTexture(IDirect3DTexture9* pTexture)
+{
+	hooks.registerMainRenderTexture(pTexture);
+}
+
+void DetectorTarget::registerRenderTexture(IDirect3DTexture9* pTexture)
+{
+	hooks.registerRenderTexture(pTexture);
+}
+
+void DetectorTarget::registerRenderSurface(IDirect3DSurface9* pSurface)
+{
+	hooks.registerRenderSurface(pSurface);
+}
+
+void DetectorTarget::registerKnownTexture(UINT32 hash, IDirect3DTexture9* pTexture)
+{
+	hooks.registerKnownTexture(hash, pTexture);
+}
+
+HRESULT DetectorTarget::redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle)
+{
+	hooks.flushDraws();
+	return hooks.redirectCreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+}
+
+HRESULT DetectorTarget::redirectCreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	hooks.flushDraws();
+	return hooks.redirectCreateRenderTarget(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
+}
+
+HRESULT DetectorTarget::redirectCreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	hooks.flushDraws();
+	return hooks.redirectCreateDepthStencilSurface(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
+}
+
+HRESULT DetectorTarget::redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
+{
+	hooks.flushDraws();
+	return hooks.redirectSetRenderTarget(RenderTargetIndex, pRenderTarget);
+}
+
+HRESULT DetectorTarget::redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
+{
+	hooks.flushDraws();
+	return hooks.redirectSetDepthStencilSurface(pNewZStencil);
+}
+
+HRESULT DetectorTarget::redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture)
+{
+	hooks.flushDraws();
+	return hooks.redirectSetTexture(Stage, pTexture);
+}
+
+HRESULT DetectorTarget::redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+	hooks.flushDraws();
+	return hooks.redirectSetRenderState(State, Value);
+}
+
+HRESULT DetectorTarget::redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+	hooks.flushDraws();
+	return hooks.redirectSetTextureStageState(Stage, Type, Value);
+}
+
+HRESULT DetectorTarget::redirectStretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter)
+{
+	// RSManager only replaces the final scale, with the present scaler
+	hooks.flushDraws();
+	return device->StretchRect(pSourceSurface, pSourceRect, pDestSurface, pDestRect, D3DTEXF_LINEAR);
+}
+
+HRESULT DetectorTarget::redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	return hooks.redirectDrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+}
+
+HRESULT DetectorTarget::redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	return hooks.redirectDrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
+}
+
+HRESULT DetectorTarget::redirectPresent(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+{
+	hooks.flushDraws();
+	hooks.endFrame();
+	return device->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+}
+
+void DetectorTarget::resetDevice()
+{
+	hooks.flushDraws();
+	hooks.releasePipelineResources();
+	initResources();
+}
+
+unsigned DetectorTarget::getFrameEvents() const
+{
+	return hooks.getPipeline().getFrameEvents();
+}
@@ -0,0 +1,178 @@
+
+#include "DrawBatcher.h"
+
+#include "main.h"
+#include "Settings.h"
+
+DrawBatcher DrawBatcher::instance;
+
+// 16 bit indices, relative to the first vertex of a batch
+static const UINT MAX_BATCH_VERTICES = 0xFFFF;
+
+DrawBatcher::DrawBatcher()
+	: device(NULL), enabled(false), vertexBytesUsed(0), indicesUsed(0), stride(0), firstVertex(0), numVertices(0), firstIndex(0),
+	numTriangles(0), numDraws(0), draws(0), batches(0), rejected(0), frames(0)
+{
+}
+
+void DrawBatcher::init(IDirect3DDevice9* pDevice)
+{
+	device = pDevice;
+	if (!Settings::get().getBatchUPDraws()) return;
+
+	if (FAILED(device->CreateVertexBuffer(VERTEX_BYTES, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, 0, D3DPOOL_DEFAULT, &vertexBuffer, NULL)) || !vertexBuffer
+		|| FAILED(device->CreateIndexBuffer(MAX_INDICES * 2, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY, D3DFMT_INDEX16, D3DPOOL_DEFAULT, &indexBuffer, NULL)) || !indexBuffer)
+	{
+		SDLOG(0, "DrawBatcher: could not create the dynamic buffers, disabled");
+		release();
+		return;
+	}
+	vertexBytesUsed = indicesUsed = 0;
+	numDraws = 0;
+	draws = batches = rejected = frames = 0;
+	enabled = true;
+	SDLOG(0, "DrawBatcher: batching UP draws in a %u KB vertex buffer", VERTEX_BYTES / 1024);
+}
+
+void DrawBatcher::release()
+{
+	// anything pending is lost with the device
+	numDraws = 0;
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+	enabled = false;
+	device = NULL;
+}
+
+bool DrawBatcher::drawPrimitiveUP(D3DPRIMITIVETYPE type, UINT count, const void* vertices, UINT stride)
+{
+	if (!enabled) return false;
+	UINT vertexCount = type == D3DPT_TRIANGLELIST ? count * 3 : count + 2;
+	return append(type, count, vertices, vertexCount, stride, NULL, D3DFMT_INDEX16, 0);
+}
+
+bool DrawBatcher::drawIndexedPrimitiveUP(D3DPRIMITIVETYPE type, UINT minIndex, UINT vertexCount, UINT count, const void* indices,
+	D3DFORMAT indexFormat, const void* vertices, UINT stride)
+{
+	if (!enabled) return false;
+	// only the used range of the vertices is copied, the indices are rebased to it
+	return append(type, count, (const BYTE*)vertices + minIndex * stride, vertexCount, stride, indices, indexFormat, minIndex);
+}
+
+bool DrawBatcher::append(D3DPRIMITIVETYPE type, UINT count, const void* vertices, UINT vertexCount, UINT newStride,
+	const void* indices, D3DFORMAT indexFormat, UINT indexBase)
+{
+	UINT indexCount = count * 3;
+	UINT vertexBytes = vertexCount * newStride;
+	if ((type != D3DPT_TRIANGLELIST && type != D3DPT_TRIANGLESTRIP) || count == 0 || !vertices
+		|| newStride == 0 || vertexCount > MAX_BATCH_VERTICES || vertexBytes > VERTEX_BYTES || indexCount > MAX_INDICES)
+	{
+		// drawn directly, after everything before it
+		flush();
+		++rejected;
+		return false;
+	}
+
+	if (numDraws && (newStride != stride || numVertices + vertexCount > MAX_BATCH_VERTICES
+		|| (firstVertex + numVertices) * stride + vertexBytes > VERTEX_BYTES || firstIndex + numTriangles * 3 + indexCount > MAX_INDICES))
+	{
+		flush();
+	}
+
+	DWORD vertexLock = D3DLOCK_NOOVERWRITE, indexLock = D3DLOCK_NOOVERWRITE;
+	if (numDraws == 0)
+	{
+		// a batch starts at a multiple of its stride, so it can be addressed with the base vertex index
+		stride = newStride;
+		firstVertex = (vertexBytesUsed + stride - 1) / stride;
+		if (firstVertex * stride + vertexBytes > VERTEX_BYTES)
+		{
+			firstVertex = 0;
+			vertexLock = D3DLOCK_DISCARD;
+		}
+		if (indicesUsed + indexCount > MAX_INDICES)
+		{
+			indicesUsed = 0;
+			indexLock = D3DLOCK_DISCARD;
+		}
+		firstIndex = indicesUsed;
+		numVertices = numTriangles = 0;
+	}
+
+	void* vertexData;
+	UINT vertexOffset = (firstVertex + numVertices) * stride;
+	if (FAILED(vertexBuffer->Lock(vertexOffset, vertexBytes, &vertexData, vertexLock)))
+	{
+		flush();
+		++rejected;
+		return false;
+	}
+	memcpy(vertexData, vertices, vertexBytes);
+	vertexBuffer->Unlock();
+	vertexBytesUsed = vertexOffset + vertexBytes;
+
+	WORD* indexData;
+	if (FAILED(indexBuffer->Lock((firstIndex + numTriangles * 3) * 2, indexCount * 2, (void**)&indexData, indexLock)))
+	{
+		// the copied vertices just stay unused
+		flush();
+		++rejected;
+		return false;
+	}
+	// strips become lists, every other triangle in swapped order to keep the winding
+	UINT triangles = 0;
+	for (UINT i = 0; i < count; ++i)
+	{
+		UINT corner[3];
+		for (UINT c = 0; c < 3; ++c)
+		{
+			UINT source = type == D3DPT_TRIANGLELIST ? i * 3 + c : i + c;
+			if (!indices) corner[c] = source;
+			else if (indexFormat == D3DFMT_INDEX32) corner[c] = ((const UINT32*)indices)[source] - indexBase;
+			else corner[c] = ((const WORD*)indices)[source] - indexBase;
+		}
+		if (type == D3DPT_TRIANGLESTRIP)
+		{
+			if (i & 1) std::swap(corner[0], corner[1]);
+			// strips are joined with degenerate triangles, which do not draw anything
+			if (corner[0] == corner[1] || corner[1] == corner[2] || corner[0] == corner[2]) continue;
+		}
+		for (UINT c = 0; c < 3; ++c) indexData[triangles * 3 + c] = (WORD)(numVertices + corner[c]);
+		++triangles;
+	}
+	indexBuffer->Unlock();
+
+	numVertices += vertexCount;
+	numTriangles += triangles;
+	indicesUsed = firstIndex + numTriangles * 3;
+	++numDraws;
+	++draws;
+	return true;
+}
+
+void DrawBatcher::flushPending()
+{
+	numDraws = 0;
+	++batches;
+	if (numTriangles > 0)
+	{
+		device->SetStreamSource(0, vertexBuffer, 0, stride);
+		device->SetIndices(indexBuffer);
+		device->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, firstVertex, 0, numVertices, firstIndex, numTriangles);
+	}
+	// as after the UP draws
+	device->SetStreamSource(0, NULL, 0, 0);
+	device->SetIndices(NULL);
+}
+
+void DrawBatcher::endFrame()
+{
+	if (!enabled) return;
+	flush();
+	if (++frames >= LOG_INTERVAL)
+	{
+		SDLOG(0, "DrawBatcher: %u UP draws in %u batches (%.1f draws per batch), %u drawn directly",
+			draws, batches, batches ? (double)draws / batches : 0.0, rejected);
+		draws = batches = rejected = frames = 0;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <d3d9.h>
+
+// Coalesces consecutive DrawPrimitiveUP / DrawIndexedPrimitiveUP calls (text and HUD glyphs) into single
+// DrawIndexedPrimitive calls from a dynamic vertex and index buffer (batchUPDraws)
+// Triangle lists and strips with the same stride are appended to the buffers with D3DLOCK_NOOVERWRITE, strips are
+// converted to lists. The device wrapper flushes the batch before every other call which changes state, draws or
+// reads back, so all draws in a batch are made with identical state. Like a real UP draw, a flush leaves stream 0
+// and the indices set to NULL.
+class DrawBatcher
+{
+	static DrawBatcher instance;
+
+	static const UINT VERTEX_BYTES = 1024 * 1024;
+	static const UINT MAX_INDICES = 96 * 1024;
+	static const unsigned LOG_INTERVAL = 600;
+
+	CComPtr<IDirect3DVertexBuffer9> vertexBuffer;
+	CComPtr<IDirect3DIndexBuffer9> indexBuffer;
+	IDirect3DDevice9* device;
+	bool enabled;
+
+	// used parts of the buffers, they are discarded when full
+	UINT vertexBytesUsed, indicesUsed;
+	// the pending batch
+	UINT stride, firstVertex, numVertices, firstIndex, numTriangles, numDraws;
+
+	// statistics since the last log
+	unsigned draws, batches, rejected, frames;
+
+	bool append(D3DPRIMITIVETYPE type, UINT count, const void* vertices, UINT vertexCount, UINT stride, const void* indices, D3DFORMAT indexFormat, UINT indexBase);
+	void flushPending();
+
+public:
+	static DrawBatcher& get()
+	{
+		return instance;
+	}
+
+	DrawBatcher();
+
+	// call with the other device resources
+	void init(IDirect3DDevice9* pDevice);
+	void release();
+
+	// return true if the draw was added to the batch, false if it has to be made directly
+	bool drawPrimitiveUP(D3DPRIMITIVETYPE type, UINT count, const void* vertices, UINT stride);
+	bool drawIndexedPrimitiveUP(D3DPRIMITIVETYPE type, UINT minIndex, UINT vertexCount, UINT count, const void* indices, D3DFORMAT indexFormat, const void* vertices, UINT stride);
+
+	// draws the pending batch, call before anything which changes or depends on the device state
+	void flush()
+	{
+		if (numDraws) flushPending();
+	}
+	// frame boundary, called on Present
+	void endFrame();
+};
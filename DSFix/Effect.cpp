@@ -1,10 +1,90 @@
 
-
 #include "Effect.h"
 
-const D3DVERTEXELEMENT9 Effect::vertexElements[3] =
+const D3DVERTEXELEMENT9 Effect::vertexElements[4] =
 {
 	{ 0, 0,  D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0 },
 	{ 0, 12, D3DDECLTYPE_FLOAT2, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD,  0 },
+	{ 0, 20, D3DDECLTYPE_FLOAT1, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_TEXCOORD,  1 },
 	D3DDECL_END()
 };
+
+std::map<IDirect3DDevice9*, Effect::SharedVertices> Effect::sharedVertices;
+
+Effect::Effect(IDirect3DDevice9* device) : device(device)
+{
+	device->CreateVertexDeclaration(vertexElements, &vertexDeclaration);
+	bool created = sharedVertices.find(device) == sharedVertices.end();
+	shared = &sharedVertices[device];
+	if (!created) return;
+
+	if (FAILED(device->CreateVertexBuffer(MAX_VERTICES * sizeof(Vertex), D3DUSAGE_WRITEONLY, 0, D3DPOOL_MANAGED, &shared->buffer, NULL)) || !shared->buffer)
+	{
+		SDLOG(0, "Effect: could not create the shared vertex buffer, drawing from memory");
+		shared->buffer = nullptr;
+	}
+}
+
+void Effect::releaseShared(IDirect3DDevice9* device)
+{
+	sharedVertices.erase(device);
+}
+
+UINT Effect::addVertices(const Vertex* vertices, UINT count)
+{
+	if (!shared->buffer) return NO_VERTICES;
+	for (size_t i = 0; i < shared->runs.size(); ++i)
+	{
+		if (shared->runs[i].second == count && memcmp(&shared->vertices[shared->runs[i].first], vertices, count * sizeof(Vertex)) == 0) return shared->runs[i].first;
+	}
+	UINT first = (UINT)shared->vertices.size();
+	if (first + count > MAX_VERTICES)
+	{
+		SDLOG(0, "Effect: shared vertex buffer full, drawing from memory");
+		return NO_VERTICES;
+	}
+	void* data;
+	if (FAILED(shared->buffer->Lock(first * sizeof(Vertex), count * sizeof(Vertex), &data, 0))) return NO_VERTICES;
+	memcpy(data, vertices, count * sizeof(Vertex));
+	shared->buffer->Unlock();
+	shared->vertices.insert(shared->vertices.end(), vertices, vertices + count);
+	shared->runs.push_back(std::make_pair(first, count));
+	return first;
+}
+
+bool Effect::useSharedVertices()
+{
+	return shared->buffer && SUCCEEDED(device->SetStreamSource(0, shared->buffer, 0, sizeof(Vertex)));
+}
+
+void Effect::quad(int width, int height)
+{
+	std::pair<int, int> size(width, height);
+	std::map<std::pair<int, int>, UINT>::const_iterator it = shared->quads.find(size);
+	if (it != shared->quads.end() && it->second != NO_VERTICES && useSharedVertices())
+	{
+		device->DrawPrimitive(D3DPT_TRIANGLESTRIP, it->second, 2);
+		return;
+	}
+
+	// aligned fullscreen quad
+	D3DXVECTOR2 pixelSize = D3DXVECTOR2(1.0f / float(width), 1.0f / float(height));
+	Vertex quad[4] =
+	{
+		{ -1.0f - pixelSize.x,  1.0f + pixelSize.y, 0.5f, 0.0f, 0.0f, 1.0f },
+		{  1.0f - pixelSize.x,  1.0f + pixelSize.y, 0.5f, 1.0f, 0.0f, 1.0f },
+		{ -1.0f - pixelSize.x, -1.0f + pixelSize.y, 0.5f, 0.0f, 1.0f, 1.0f },
+		{  1.0f - pixelSize.x, -1.0f + pixelSize.y, 0.5f, 1.0f, 1.0f, 1.0f }
+	};
+	if (it == shared->quads.end())
+	{
+		UINT first = addVertices(quad, 4);
+		shared->quads[size] = first;
+		if (first != NO_VERTICES && useSharedVertices())
+		{
+			device->DrawPrimitive(D3DPT_TRIANGLESTRIP, first, 2);
+			return;
+		}
+	}
+	device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(quad[0]));
+}
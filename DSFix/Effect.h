@@ -1,36 +1,64 @@
 #pragma once
 
+#include <map>
+#include <vector>
+
 #include <d3d9.h>
 #include <d3dx9.h>
 
 #include "main.h"
+#include "GpuProfiler.h"
 
 // Base class for effects
+// All effects of a device draw from one vertex buffer, shared by all instances, which holds a fullscreen quad for each
+// rendertarget size used and any other geometry the effects add (the HUD regions). It is in the managed pool,
+// so it survives device resets; if it can not be created or is full, quads are drawn with DrawPrimitiveUP.
+// The buffer holds a reference to the device, so it has to be released with releaseShared before the device is.
 class Effect
 {
+public:
+	struct Vertex
+	{
+		float x, y, z;
+		float u, v;
+		float opacity; // only used by the HUD
+	};
+
+	static const UINT NO_VERTICES = UINT_MAX;
+
 protected:
 	CComPtr<IDirect3DDevice9> device;
 	CComPtr<IDirect3DVertexDeclaration9> vertexDeclaration;
 
-	static const D3DVERTEXELEMENT9 vertexElements[3];
+	static const D3DVERTEXELEMENT9 vertexElements[4];
+
+	// returns the first vertex of a copy of vertices in the shared buffer, reusing an identical run if there is one
+	UINT addVertices(const Vertex* vertices, UINT count);
+	// sets the shared buffer as stream 0
+	bool useSharedVertices();
 
 public:
-	Effect(IDirect3DDevice9* device) : device(device)
-	{
-		device->CreateVertexDeclaration(vertexElements , &vertexDeclaration);
-	}
+	Effect(IDirect3DDevice9* device);
+
+	void quad(int width, int height);
+
+	// releases the shared vertex buffer of a device, all its effects must be released already
+	static void releaseShared(IDirect3DDevice9* device);
 
-	void quad(int width, int height)
+private:
+	static const UINT MAX_VERTICES = 1024;
+
+	struct SharedVertices
 	{
-		// Draw aligned fullscreen quad
-		D3DXVECTOR2 pixelSize = D3DXVECTOR2(1.0f / float(width), 1.0f / float(height));
-		float quad[4][5] =
-		{
-			{ -1.0f - pixelSize.x,  1.0f + pixelSize.y, 0.5f, 0.0f, 0.0f },
-			{  1.0f - pixelSize.x,  1.0f + pixelSize.y, 0.5f, 1.0f, 0.0f },
-			{ -1.0f - pixelSize.x, -1.0f + pixelSize.y, 0.5f, 0.0f, 1.0f },
-			{  1.0f - pixelSize.x, -1.0f + pixelSize.y, 0.5f, 1.0f, 1.0f }
-		};
-		device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(quad[0]));
-	}
+		CComPtr<IDirect3DVertexBuffer9> buffer;
+		// copy of the buffer contents, and the runs of vertices added to it
+		std::vector<Vertex> vertices;
+		std::vector<std::pair<UINT, UINT> > runs;
+		// first vertex of the fullscreen quad for each size
+		std::map<std::pair<int, int>, UINT> quads;
+	};
+	static std::map<IDirect3DDevice9*, SharedVertices> sharedVertices;
+
+	// the entry of this effect's device
+	SharedVertices* shared;
 };
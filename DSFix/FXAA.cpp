@@ -34,6 +34,13 @@ FXAA::FXAA(IDirect3DDevice9 *device, int width, int height, Quality quality)
 	};
 	defines.push_back(qualityMacros[(int)quality]);
 
+	fusedLuma = Settings::get().getFxaaFusedLuma();
+	if (fusedLuma)
+	{
+		D3DXMACRO lumaMacro = { "FXAA_LUMA_FROM_RGB", "1" };
+		defines.push_back(lumaMacro);
+	}
+
 	D3DXMACRO null = { NULL, NULL };
 	defines.push_back(null);
 
@@ -45,9 +52,12 @@ FXAA::FXAA(IDirect3DDevice9 *device, int width, int height, Quality quality)
 	HRESULT hr = D3DXCreateEffectFromFile(device, GetDirectoryFile("dsfix\\FXAA.fx"), &defines.front(), NULL, flags, NULL, &effect, &errors);
 	if(hr != D3D_OK) SDLOG(0, "ERRORS:\n %s", errors->GetBufferPointer());
 
-	// Create buffer
-	device->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer1Tex, NULL);
-	buffer1Tex->GetSurfaceLevel(0, &buffer1Surf);
+	// Create buffer for the luma pass
+	if (!fusedLuma)
+	{
+		device->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer1Tex, NULL);
+		buffer1Tex->GetSurfaceLevel(0, &buffer1Surf);
+	}
 
 	// get handles
 	frameTexHandle = effect->GetParameterByName(NULL, "frameTex2D");
@@ -57,12 +67,20 @@ void FXAA::go(IDirect3DTexture9 *frame, IDirect3DSurface9 *dst)
 {
 	device->SetVertexDeclaration(vertexDeclaration);
 
-	lumaPass(frame, buffer1Surf);
-	fxaaPass(buffer1Tex, dst);
+	if (fusedLuma)
+	{
+		fxaaPass(frame, dst);
+	}
+	else
+	{
+		lumaPass(frame, buffer1Surf);
+		fxaaPass(buffer1Tex, dst);
+	}
 }
 
 void FXAA::lumaPass(IDirect3DTexture9 *frame, IDirect3DSurface9 *dst)
 {
+	GpuProfiler::Scope profile("FXAA", "luma");
 	device->SetRenderTarget(0, dst);
 
 	// Setup variables
@@ -79,6 +97,7 @@ void FXAA::lumaPass(IDirect3DTexture9 *frame, IDirect3DSurface9 *dst)
 
 void FXAA::fxaaPass(IDirect3DTexture9 *src, IDirect3DSurface9* dst)
 {
+	GpuProfiler::Scope profile("FXAA", "fxaa");
 	device->SetRenderTarget(0, dst);
 
 	// Setup variables
@@ -19,6 +19,8 @@ public:
 
 private:
 	int width, height;
+	// luma is computed in the FXAA pass itself, instead of being written to alpha by lumaPass first
+	bool fusedLuma;
 
 	CComPtr<ID3DXEffect> effect;
 
@@ -0,0 +1,216 @@
+
+#include "FrameCapture.h"
+
+#include <fstream>
+#include <time.h>
+
+#include "main.h"
+#include "d3dutil.h"
+#include "Settings.h"
+#include "PipelineDetector.h"
+
+FrameCapture FrameCapture::instance;
+
+FrameCapture::FrameCapture() : state(IDLE), bufferWidth(0), bufferHeight(0), device(NULL)
+{
+}
+
+void FrameCapture::init(IDirect3DDevice9* pDevice)
+{
+	device = pDevice;
+}
+
+void FrameCapture::release()
+{
+	if (state != IDLE) SDLOG(0, "FrameCapture: device released, dropped the capture to %s", directory.c_str());
+	finish();
+	device = NULL;
+}
+
+bool FrameCapture::allocate()
+{
+	bufferWidth = Settings::get().getRenderWidth();
+	bufferHeight = Settings::get().getRenderHeight();
+	unsigned count = Settings::get().getCaptureBuffers();
+	buffers.resize(count);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		if (!buffers[i].create(device, bufferWidth, bufferHeight, D3DFMT_A8R8G8B8))
+		{
+			SDLOG(0, "FrameCapture: could only allocate %u of %u %ux%u buffers", i, count, bufferWidth, bufferHeight);
+			buffers.resize(i);
+			break;
+		}
+	}
+	return !buffers.empty();
+}
+
+bool FrameCapture::begin()
+{
+	if (!device) return false;
+	if (state != IDLE)
+	{
+		SDLOG(0, "FrameCapture: still writing the previous capture, not capturing");
+		return false;
+	}
+	if (!allocate())
+	{
+		SDLOG(0, "FrameCapture: no buffers, not capturing");
+		finish();
+		return false;
+	}
+
+	char timebuf[128];
+	time_t ltime;
+	time(&ltime);
+	struct tm timeinfo;
+	localtime_s(&timeinfo, &ltime);
+	strftime(timebuf, 128, "capture_%Y-%m-%d_%H-%M-%S", &timeinfo);
+	directory = timebuf;
+	if (!CreateDirectory(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		SDLOG(0, "FrameCapture: could not create %s, not capturing", directory.c_str());
+		finish();
+		return false;
+	}
+
+	SDLOG(0, "FrameCapture: capturing the next frame to %s with %u buffers", directory.c_str(), buffers.size());
+	stages.clear();
+	state = RECORDING;
+	return true;
+}
+
+void FrameCapture::captureStage(IDirect3DSurface9* renderTarget, unsigned index, unsigned events)
+{
+	if (state != RECORDING || !renderTarget) return;
+
+	Stage stage;
+	stage.index = index;
+	stage.surface = renderTarget;
+	CComPtr<IDirect3DSurface9> depthStencil;
+	device->GetDepthStencilSurface(&depthStencil);
+	stage.depthStencil = depthStencil;
+	renderTarget->GetDesc(&stage.desc);
+	stage.width = std::min(stage.desc.Width, bufferWidth);
+	stage.height = std::min(stage.desc.Height, bufferHeight);
+	for (unsigned e = 0; e < PipelineDetector::NUM_EVENTS; ++e)
+	{
+		if (!PipelineDetector::has(events, (PipelineDetector::Event)e)) continue;
+		if (!stage.events.empty()) stage.events += "+";
+		stage.events += PipelineDetector::getEventName((PipelineDetector::Event)e);
+	}
+	stage.buffer = -1;
+
+	unsigned used = 0;
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		if (stages[i].buffer >= 0) ++used;
+	}
+	if (used == buffers.size())
+	{
+		stage.status = "out of buffers";
+	}
+	else
+	{
+		// also converts the format; surfaces larger than a buffer are scaled down
+		RECT rect = { 0, 0, (LONG)stage.width, (LONG)stage.height };
+		bool scaled = stage.width != stage.desc.Width || stage.height != stage.desc.Height;
+		if (SUCCEEDED(device->StretchRect(renderTarget, NULL, buffers[used].getCopy(), &rect, scaled ? D3DTEXF_LINEAR : D3DTEXF_NONE)))
+		{
+			char filename[64];
+			sprintf_s(filename, "%03u_%p.png", index, renderTarget);
+			stage.filename = filename;
+			stage.buffer = (int)used;
+			stage.status = scaled ? "copied (scaled)" : "copied";
+		}
+		else
+		{
+			stage.status = "copy failed";
+		}
+	}
+	SDLOG(2, "FrameCapture: stage %u, surface %p: %s", index, renderTarget, stage.status);
+	stages.push_back(stage);
+}
+
+void FrameCapture::endFrame()
+{
+	if (state == RECORDING)
+	{
+		// the readbacks count from the end of the captured frame
+		for (size_t i = 0; i < stages.size(); ++i)
+		{
+			if (stages[i].buffer >= 0) buffers[stages[i].buffer].start();
+		}
+		state = READING_BACK;
+		SDLOG(0, "FrameCapture: frame done, %u stages", stages.size());
+		return;
+	}
+	if (state != READING_BACK) return;
+
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		Stage& stage = stages[i];
+		if (stage.buffer >= 0 && !buffers[stage.buffer].endFrame())
+		{
+			stage.buffer = -1;
+			stage.status = "readback failed";
+		}
+	}
+	if (lockBuffers())
+	{
+		// all at once, beyond the queue limit of the writer, since these are the only copies
+		ImageWriter::get().writeAll(images);
+		writeManifest();
+		finish();
+	}
+}
+
+bool FrameCapture::lockBuffers()
+{
+	// locked in stage order, stopping at the first one which is not ready
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		Stage& stage = stages[i];
+		if (stage.buffer < 0) continue;
+		Readback& buffer = buffers[stage.buffer];
+		std::unique_ptr<ImageWriter::Image> image;
+		Readback::Status status = buffer.lock(image, stage.width, stage.height, false);
+		if (status == Readback::LOCK_WAITING) return false;
+		stage.buffer = -1;
+		if (status == Readback::LOCK_FAILED)
+		{
+			stage.status = "lock failed";
+			continue;
+		}
+
+		image->filename = directory + "\\" + stage.filename;
+		images.push_back(std::move(image));
+		// the memory of the buffer is not needed anymore
+		buffer.release();
+	}
+	return true;
+}
+
+void FrameCapture::writeManifest()
+{
+	std::string filename = directory + "\\manifest.csv";
+	std::ofstream out(filename.c_str());
+	out << "stage,rendertarget,depthstencil,format,width,height,captured_width,captured_height,events,file,status\n";
+	char pointers[64];
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		const Stage& stage = stages[i];
+		sprintf_s(pointers, "%p,%p", stage.surface, stage.depthStencil);
+		out << stage.index << "," << pointers << "," << D3DFormatToString(stage.desc.Format) << "," << stage.desc.Width << "," << stage.desc.Height << ","
+			<< stage.width << "," << stage.height << "," << stage.events << "," << stage.filename << "," << stage.status << "\n";
+	}
+	SDLOG(0, "FrameCapture: %u stages captured, images queued for writing, manifest in %s", stages.size(), filename.c_str());
+}
+
+void FrameCapture::finish()
+{
+	buffers.clear();
+	stages.clear();
+	images.clear();
+	state = IDLE;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "d3d9.h"
+#include "ImageWriter.h"
+#include "Readback.h"
+
+// Captures all rendertargets of a single frame (the singleFrameFullCapture action) without stalling it
+// When the game switches away from a rendertarget, it is copied on the GPU into one of captureBuffers render sized
+// buffers, which are only allocated for the capture. The buffers are read back over the following frames (see Readback),
+// then written by the ImageWriter, along with a manifest.csv listing all stages in order.
+class FrameCapture
+{
+	static FrameCapture instance;
+
+	std::vector<Readback> buffers; // D3DFMT_A8R8G8B8
+
+	// one rendertarget switch of the captured frame
+	struct Stage
+	{
+		unsigned index; // rendertarget switches before this one in the frame
+		IDirect3DSurface9* surface;
+		IDirect3DSurface9* depthStencil;
+		D3DSURFACE_DESC desc;
+		UINT width, height; // of the copy, smaller than the surface if it does not fit into a buffer
+		std::string events;
+		std::string filename;
+		int buffer; // -1 if it was not copied
+		const char* status;
+	};
+	std::vector<Stage> stages;
+	// locked so far, handed to the ImageWriter when all are
+	std::vector<std::unique_ptr<ImageWriter::Image> > images;
+
+	enum State { IDLE, RECORDING, READING_BACK };
+	State state;
+	UINT bufferWidth, bufferHeight;
+	std::string directory;
+
+	IDirect3DDevice9* device;
+
+	bool allocate();
+	// false while some buffers are not ready to be locked yet
+	bool lockBuffers();
+	void writeManifest();
+	void finish();
+
+public:
+	static FrameCapture& get()
+	{
+		return instance;
+	}
+
+	FrameCapture();
+
+	// call with the other device resources, a capture which is still in progress is dropped on release
+	void init(IDirect3DDevice9* pDevice);
+	void release();
+
+	// allocates the buffers and captures the next frame, returns false if that is not possible
+	bool begin();
+	bool isRecording() const
+	{
+		return state == RECORDING;
+	}
+	// copies the rendertarget the game switches away from; index counts the switches in the frame
+	void captureStage(IDirect3DSurface9* renderTarget, unsigned index, unsigned events);
+	// frame boundary, called on Present
+	void endFrame();
+};
@@ -8,10 +8,12 @@
 
 #include "Settings.h"
 
-GAUSS::GAUSS(IDirect3DDevice9 *device, int width, int height)
-	: Effect(device), width(width), height(height)
+GAUSS::GAUSS(IDirect3DDevice9 *device, int width, int height, unsigned iterations)
+	: Effect(device), width(width), height(height), iterations(std::max(iterations, 1u)), kernel(std::max(iterations, 1u))
 {
 	SDLOG(0, "Gauss construct");
+	SDLOG(0, "Gauss kernel for %u iterations: %u taps per side (%f of the weight dropped), %u linear samples", this->iterations, kernel.numTaps, kernel.dropped, kernel.numSamples);
+
 	// Setup the defines for compiling the effect
 	std::vector<D3DXMACRO> defines;
 	std::stringstream s;
@@ -22,6 +24,13 @@ GAUSS::GAUSS(IDirect3DDevice9 *device, int width, int height)
 	D3DXMACRO pixelSizeMacro = { "PIXEL_SIZE", pixelSizeText.c_str() };
 	defines.push_back(pixelSizeMacro);
 
+	// Setup sample count macro
+	std::stringstream sn;
+	sn << kernel.numSamples;
+	std::string numSamplesText = sn.str();
+	D3DXMACRO numSamplesMacro = { "NUM_SAMPLES", numSamplesText.c_str() };
+	defines.push_back(numSamplesMacro);
+
 	D3DXMACRO null = { NULL, NULL };
 	defines.push_back(null);
 
@@ -39,6 +48,10 @@ GAUSS::GAUSS(IDirect3DDevice9 *device, int width, int height)
 
 	// get handles
 	frameTexHandle = effect->GetParameterByName(NULL, "frameTex2D");
+	sampleWeightsHandle = effect->GetParameterByName(NULL, "sampleWeights");
+	sampleOffsetsHandle = effect->GetParameterByName(NULL, "sampleOffsets");
+	effect->SetFloatArray(sampleWeightsHandle, kernel.sampleWeights, kernel.numSamples);
+	effect->SetFloatArray(sampleOffsetsHandle, kernel.sampleOffsets, kernel.numSamples);
 }
 
 void GAUSS::go(IDirect3DTexture9 *input, IDirect3DSurface9 *dst)
@@ -48,20 +61,26 @@ void GAUSS::go(IDirect3DTexture9 *input, IDirect3DSurface9 *dst)
 	UINT passes;
 
 	// Horizontal blur
-	device->SetRenderTarget(0, buffer1Surf);
-	effect->SetTexture(frameTexHandle, input);
-	effect->Begin(&passes, 0);
-	effect->BeginPass(0);
-	quad(width, height);
-	effect->EndPass();
-	effect->End();
+	{
+		GpuProfiler::Scope profile("GAUSS", "hblur");
+		device->SetRenderTarget(0, buffer1Surf);
+		effect->SetTexture(frameTexHandle, input);
+		effect->Begin(&passes, 0);
+		effect->BeginPass(0);
+		quad(width, height);
+		effect->EndPass();
+		effect->End();
+	}
 
 	// Vertical blur
-	device->SetRenderTarget(0, dst);
-	effect->SetTexture(frameTexHandle, buffer1Tex);
-	effect->Begin(&passes, 0);
-	effect->BeginPass(1);
-	quad(width, height);
-	effect->EndPass();
-	effect->End();
+	{
+		GpuProfiler::Scope profile("GAUSS", "vblur");
+		device->SetRenderTarget(0, dst);
+		effect->SetTexture(frameTexHandle, buffer1Tex);
+		effect->Begin(&passes, 0);
+		effect->BeginPass(1);
+		quad(width, height);
+		effect->EndPass();
+		effect->End();
+	}
 }
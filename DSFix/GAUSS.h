@@ -6,22 +6,28 @@
 #include <dxerr.h>
 
 #include "Effect.h"
+#include "GaussKernel.h"
 
+// Separable Gaussian blur, equivalent to applying a 9 tap kernel a given number of times
+// The iterated kernel is computed on the CPU and folded into linear samples (see GaussKernel),
+// so any number of iterations costs one horizontal and one vertical pass
 class GAUSS : public Effect
 {
 public:
-	GAUSS(IDirect3DDevice9 *device, int width, int height);
+	GAUSS(IDirect3DDevice9 *device, int width, int height, unsigned iterations);
 	virtual ~GAUSS() {};
 
 	void go(IDirect3DTexture9 *input, IDirect3DSurface9 *dst);
 
 private:
 	int width, height;
+	unsigned iterations;
+	GaussKernel kernel;
 
 	CComPtr<ID3DXEffect> effect;
 
 	CComPtr<IDirect3DTexture9> buffer1Tex;
 	CComPtr<IDirect3DSurface9> buffer1Surf;
 
-	D3DXHANDLE frameTexHandle;
+	D3DXHANDLE frameTexHandle, sampleWeightsHandle, sampleOffsetsHandle;
 };
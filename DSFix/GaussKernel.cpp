@@ -0,0 +1,52 @@
+#include "GaussKernel.h"
+
+#include <cstdlib>
+
+// one side of the kernel the blur used to be iterated with, from the center outwards
+static const double baseKernel[] = { 0.2270270270, 0.1945945946, 0.1216216216, 0.0540540541, 0.0162162162 };
+static const unsigned baseRadius = 4;
+
+std::vector<double> GaussKernel::iterated(unsigned iterations)
+{
+	// full kernels, radius baseRadius * iterations
+	std::vector<double> kernel(1, 1.0);
+	for (unsigned it = 0; it < iterations; ++it)
+	{
+		std::vector<double> next(kernel.size() + baseRadius * 2, 0.0);
+		for (size_t i = 0; i < kernel.size(); ++i)
+		{
+			for (int t = -(int)baseRadius; t <= (int)baseRadius; ++t) next[i + baseRadius + t] += kernel[i] * baseKernel[abs(t)];
+		}
+		kernel.swap(next);
+	}
+	return std::vector<double>(kernel.begin() + kernel.size() / 2, kernel.end());
+}
+
+GaussKernel::GaussKernel(unsigned iterations)
+{
+	std::vector<double> taps = iterated(iterations);
+
+	// drop the tail which does not matter visually, and whatever does not fit into MAX_SAMPLES
+	size_t n = taps.size();
+	double tail = 0.0;
+	while (n > 1 && (n > MAX_SAMPLES * 2 - 1 || tail + taps[n - 1] < 0.0005))
+	{
+		tail += taps[--n];
+	}
+	taps.resize(n);
+	numTaps = (unsigned)n - 1;
+	dropped = tail * 2;
+	double sum = taps[0];
+	for (size_t i = 1; i < taps.size(); ++i) sum += 2 * taps[i];
+
+	// center tap on its own, then pairs of taps in one linear sample each
+	numSamples = 1;
+	sampleWeights[0] = float(taps[0] / sum);
+	sampleOffsets[0] = 0.0f;
+	for (size_t i = 1; i < taps.size(); i += 2, ++numSamples)
+	{
+		double w1 = taps[i], w2 = i + 1 < taps.size() ? taps[i + 1] : 0.0;
+		sampleWeights[numSamples] = float((w1 + w2) / sum);
+		sampleOffsets[numSamples] = float((i * w1 + (i + 1) * w2) / (w1 + w2));
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+// The kernel of the DoF blur (see GAUSS): a 9 tap Gaussian applied a given number of times, folded into linear
+// samples (each sample between two texels weighs both with one bilinear fetch) for a single separable pass
+// No Direct3D here, bench/GaussKernelTest.cpp checks the samples against the iterated kernel
+class GaussKernel
+{
+public:
+	// linear samples per side, including the center one: covers 30 texels on each side
+	static const unsigned MAX_SAMPLES = 16;
+
+	unsigned numSamples;
+	float sampleWeights[MAX_SAMPLES], sampleOffsets[MAX_SAMPLES];
+	// taps per side which are covered by the samples, and the weight of the ones which are not (both sides)
+	unsigned numTaps;
+	double dropped;
+
+	explicit GaussKernel(unsigned iterations);
+
+	// discrete weights of the iterated kernel, from the center outwards
+	static std::vector<double> iterated(unsigned iterations);
+};
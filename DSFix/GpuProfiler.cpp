@@ -0,0 +1,195 @@
+
+#include "GpuProfiler.h"
+
+#include <fstream>
+
+#include "main.h"
+
+GpuProfiler GpuProfiler::instance;
+
+GpuProfiler::GpuProfiler()
+	: current(0), frameStarted(false), openPass(-1), device(NULL), enabled(false), available(false),
+	collectedFrames(0), droppedFrames(0), framesSinceLog(0)
+{
+	for (unsigned f = 0; f < NUM_FRAMES; ++f)
+	{
+		frames[f].numPasses = 0;
+		frames[f].pending = false;
+	}
+}
+
+void GpuProfiler::init(IDirect3DDevice9* pDevice)
+{
+	device = pDevice;
+	available = device->CreateQuery(D3DQUERYTYPE_TIMESTAMP, NULL) == D3D_OK
+		&& device->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, NULL) == D3D_OK
+		&& device->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, NULL) == D3D_OK;
+	if (!available)
+	{
+		SDLOG(0, "GpuProfiler: timestamp queries not supported, profiling unavailable");
+		return;
+	}
+	for (unsigned f = 0; f < NUM_FRAMES; ++f)
+	{
+		Frame& frame = frames[f];
+		device->CreateQuery(D3DQUERYTYPE_TIMESTAMPDISJOINT, &frame.disjoint);
+		device->CreateQuery(D3DQUERYTYPE_TIMESTAMPFREQ, &frame.frequency);
+		for (unsigned i = 0; i < MAX_PASSES * 2; ++i) device->CreateQuery(D3DQUERYTYPE_TIMESTAMP, &frame.timestamps[i]);
+		frame.numPasses = 0;
+		frame.pending = false;
+	}
+	frameStarted = false;
+	openPass = -1;
+}
+
+void GpuProfiler::release()
+{
+	for (unsigned f = 0; f < NUM_FRAMES; ++f)
+	{
+		Frame& frame = frames[f];
+		frame.disjoint = nullptr;
+		frame.frequency = nullptr;
+		for (unsigned i = 0; i < MAX_PASSES * 2; ++i) frame.timestamps[i] = nullptr;
+		frame.numPasses = 0;
+		frame.pending = false;
+	}
+	available = false;
+	frameStarted = false;
+	openPass = -1;
+	device = NULL;
+}
+
+void GpuProfiler::toggle()
+{
+	enabled = !enabled;
+	if (!enabled)
+	{
+		for (unsigned f = 0; f < NUM_FRAMES; ++f) frames[f].pending = false;
+		frameStarted = false;
+		openPass = -1;
+	}
+	SDLOG(0, "GpuProfiler %s%s", enabled ? "enabled" : "disabled", available ? "" : " (but unavailable)");
+}
+
+void GpuProfiler::endFrame()
+{
+	if (!enabled || !available) return;
+
+	if (frameStarted)
+	{
+		Frame& frame = frames[current];
+		frame.disjoint->Issue(D3DISSUE_END);
+		frame.frequency->Issue(D3DISSUE_END);
+		frame.pending = true;
+	}
+	openPass = -1;
+
+	// the next slot was issued FRAME_LATENCY frames ago
+	current = (current + 1) % NUM_FRAMES;
+	Frame& next = frames[current];
+	if (next.pending) collect(next);
+	next.numPasses = 0;
+	next.disjoint->Issue(D3DISSUE_BEGIN);
+	frameStarted = true;
+
+	if (++framesSinceLog >= LOG_INTERVAL)
+	{
+		log();
+		framesSinceLog = 0;
+	}
+}
+
+void GpuProfiler::beginPass(const char* effect, const char* pass)
+{
+	if (!enabled || !frameStarted || openPass >= 0) return;
+	Frame& frame = frames[current];
+	if (frame.numPasses >= MAX_PASSES) return;
+	openPass = frame.numPasses++;
+	frame.effects[openPass] = effect;
+	frame.passes[openPass] = pass;
+	frame.timestamps[openPass * 2]->Issue(D3DISSUE_END);
+}
+
+void GpuProfiler::endPass()
+{
+	if (openPass < 0) return;
+	frames[current].timestamps[openPass * 2 + 1]->Issue(D3DISSUE_END);
+	openPass = -1;
+}
+
+void GpuProfiler::collect(Frame& frame)
+{
+	frame.pending = false;
+	BOOL disjoint = TRUE;
+	UINT64 frequency = 0;
+	// no D3DGETDATA_FLUSH, results which are not there yet are not waited for
+	if (frame.disjoint->GetData(&disjoint, sizeof(disjoint), 0) != S_OK || disjoint
+		|| frame.frequency->GetData(&frequency, sizeof(frequency), 0) != S_OK || frequency == 0)
+	{
+		++droppedFrames;
+		return;
+	}
+	std::map<std::string, double> times;
+	for (unsigned i = 0; i < frame.numPasses; ++i)
+	{
+		UINT64 begin, end;
+		if (frame.timestamps[i * 2]->GetData(&begin, sizeof(begin), 0) != S_OK
+			|| frame.timestamps[i * 2 + 1]->GetData(&end, sizeof(end), 0) != S_OK)
+		{
+			++droppedFrames;
+			return;
+		}
+		double ms = (end - begin) * 1000.0 / frequency;
+		// repeated passes of an effect within a frame add up
+		times[frame.effects[i]] += ms;
+		times[std::string(frame.effects[i]) + " " + frame.passes[i]] += ms;
+	}
+	for (std::map<std::string, double>::const_iterator it = times.begin(); it != times.end(); ++it) addSample(it->first, it->second);
+	++collectedFrames;
+}
+
+void GpuProfiler::addSample(const std::string& name, double ms)
+{
+	StatsMap::iterator it = stats.find(name);
+	if (it == stats.end())
+	{
+		Stats s = {};
+		s.min = ms;
+		it = stats.insert(std::make_pair(name, s)).first;
+	}
+	Stats& s = it->second;
+	if (s.count == WINDOW) s.sum -= s.samples[s.next];
+	else ++s.count;
+	s.samples[s.next] = ms;
+	s.sum += ms;
+	s.next = (s.next + 1) % WINDOW;
+	s.min = std::min(s.min, ms);
+	s.max = std::max(s.max, ms);
+}
+
+void GpuProfiler::log()
+{
+	SDLOG(0, "GpuProfiler: %u frames measured, %u dropped; averages over the last %u frames:", collectedFrames, droppedFrames, WINDOW);
+	for (StatsMap::const_iterator it = stats.begin(); it != stats.end(); ++it)
+	{
+		const Stats& s = it->second;
+		SDLOG(0, " - %24s: %7.3f ms (min %7.3f, max %7.3f)", it->first.c_str(), s.sum / s.count, s.min, s.max);
+	}
+}
+
+void GpuProfiler::exportCsv(const char* filename)
+{
+	std::ofstream out(filename);
+	out << "pass,average_ms,min_ms,max_ms,frames\n";
+	for (StatsMap::const_iterator it = stats.begin(); it != stats.end(); ++it)
+	{
+		const Stats& s = it->second;
+		out << it->first << "," << s.sum / s.count << "," << s.min << "," << s.max << "," << s.count << "\n";
+	}
+	SDLOG(0, "GpuProfiler: exported %u entries to %s", stats.size(), filename);
+}
+
+void GpuProfiler::exportDefault()
+{
+	exportCsv(GetDirectoryFile("dsfix\\gpuprofile.csv"));
+}
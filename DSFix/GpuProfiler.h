@@ -0,0 +1,97 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "d3d9.h"
+
+// Measures the GPU time of our effect passes using timestamp queries
+// Results are read back FRAME_LATENCY frames after they were issued, so we never wait for the GPU
+// (frames whose results are not ready by then are dropped), and accumulated into rolling averages
+// per effect and per pass, which are logged periodically and can be exported as CSV
+class GpuProfiler
+{
+	static GpuProfiler instance;
+
+	static const unsigned FRAME_LATENCY = 3;
+	static const unsigned NUM_FRAMES = FRAME_LATENCY + 1;
+	static const unsigned MAX_PASSES = 32;
+	// frames in the rolling averages, and frames between log outputs
+	static const unsigned WINDOW = 120;
+	static const unsigned LOG_INTERVAL = 600;
+
+	struct Frame
+	{
+		CComPtr<IDirect3DQuery9> disjoint, frequency;
+		// begin and end timestamp of each pass
+		CComPtr<IDirect3DQuery9> timestamps[MAX_PASSES * 2];
+		const char* effects[MAX_PASSES];
+		const char* passes[MAX_PASSES];
+		unsigned numPasses;
+		bool pending; // issued, but not read back yet
+	};
+	Frame frames[NUM_FRAMES];
+	unsigned current;
+	bool frameStarted;
+	int openPass;
+
+	// GPU time in ms of the last WINDOW frames the pass (or effect) was used in, min and max since the first one
+	struct Stats
+	{
+		double samples[WINDOW];
+		unsigned next, count;
+		double sum, min, max;
+	};
+	typedef std::map<std::string, Stats> StatsMap;
+	StatsMap stats;
+
+	IDirect3DDevice9* device;
+	bool enabled, available;
+	unsigned collectedFrames, droppedFrames, framesSinceLog;
+
+	void collect(Frame& frame);
+	void addSample(const std::string& name, double ms);
+
+public:
+	static GpuProfiler& get()
+	{
+		return instance;
+	}
+
+	GpuProfiler();
+
+	// creates the queries, call with the other device resources; the profiler stays unavailable if the device does not support them
+	void init(IDirect3DDevice9* pDevice);
+	void release();
+
+	void toggle();
+	bool isEnabled() const
+	{
+		return enabled;
+	}
+
+	// frame boundary, called on Present
+	void endFrame();
+	// passes can not be nested, inner ones are ignored
+	void beginPass(const char* effect, const char* pass);
+	void endPass();
+
+	void log();
+	void exportCsv(const char* filename);
+	// export to dsfix\gpuprofile.csv, used by the exportGpuProfile action
+	void exportDefault();
+
+	// profiles the enclosing scope as one pass
+	class Scope
+	{
+	public:
+		Scope(const char* effect, const char* pass)
+		{
+			GpuProfiler::get().beginPass(effect, pass);
+		}
+		~Scope()
+		{
+			GpuProfiler::get().endPass();
+		}
+	};
+};
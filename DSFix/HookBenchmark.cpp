@@ -0,0 +1,219 @@
+
+#include "HookBenchmark.h"
+
+#include "main.h"
+#include "NullDevice.h"
+
+// a HUD quad as the game draws it, positions first
+static INT16 quadVertices[] = { 0, 0, 0, 0, 64, 0, 0, 0, 0, 64, 0, 0, 64, 64, 0, 0 };
+static const UINT QUAD_STRIDE = 4 * sizeof(INT16);
+static const UINT16 quadIndices[] = { 0, 1, 2, 2, 1, 3 };
+
+HookBenchmark::HookBenchmark(HookTargetFactory factory)
+	: device(new NullDevice()), healthbarTex(NULL), categoryIconsTex(NULL), textTex(NULL)
+{
+	QueryPerformanceFrequency(&frequency);
+	target.reset(factory(device));
+
+	// rendertargets in the sizes the game requests, so that they go through the same overrides
+	createRenderTexture(1024, 720, mainTex, mainRT);
+	createRenderTexture(1024, 720, zTex, zRT);
+	for (unsigned i = 0; i < 2; ++i) createRenderTexture(512, 360, dofTex[i], dofRT[i]);
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		createRenderTexture(1024, 720, otherTex[i], otherRT[i]);
+		target->redirectCreateTexture(256, 256, 0, 0, D3DFMT_DXT5, D3DPOOL_MANAGED, &sceneTex[i], NULL);
+	}
+
+	// the known textures are created by D3DX in the game, register them by hash the same way
+#define TEXTURE(_name, _hash) \
+	{ \
+		CComPtr<IDirect3DTexture9> tex; \
+		device->CreateTexture(256, 256, 1, 0, D3DFMT_DXT5, D3DPOOL_MANAGED, &tex, NULL); \
+		target->registerKnownTexture(_hash, tex); \
+		knownTextures.push_back(tex); \
+		if (strcmp(#_name, "HudHealthbar") == 0) healthbarTex = tex; \
+		if (strcmp(#_name, "CategoryIconsHumanityCount") == 0) categoryIconsTex = tex; \
+		if (strcmp(#_name, "Text00") == 0) textTex = tex; \
+	}
+#include "Textures.def"
+#undef TEXTURE
+}
+
+HookBenchmark::~HookBenchmark()
+{
+	// resources have to go before the device
+	knownTextures.clear();
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		otherRT[i] = nullptr;
+		otherTex[i] = nullptr;
+		sceneTex[i] = nullptr;
+	}
+	for (unsigned i = 0; i < 2; ++i)
+	{
+		dofRT[i] = nullptr;
+		dofTex[i] = nullptr;
+	}
+	zRT = nullptr;
+	zTex = nullptr;
+	mainRT = nullptr;
+	mainTex = nullptr;
+	target.reset();
+	device->Release();
+}
+
+void HookBenchmark::createRenderTexture(UINT width, UINT height, CComPtr<IDirect3DTexture9>& tex, CComPtr<IDirect3DSurface9>& surf)
+{
+	target->redirectCreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &tex, NULL);
+	tex->GetSurfaceLevel(0, &surf);
+}
+
+void HookBenchmark::draws(unsigned count)
+{
+	for (unsigned i = 0; i < count; ++i) target->redirectDrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quadVertices, QUAD_STRIDE);
+}
+
+void HookBenchmark::hudDraws(unsigned count)
+{
+	for (unsigned i = 0; i < count; ++i) target->redirectDrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, 0, 4, 2, quadIndices, D3DFMT_INDEX16, quadVertices, QUAD_STRIDE);
+}
+
+// One frame following the structure of the game's pipeline, so that all pipeline signatures fire
+void HookBenchmark::frame()
+{
+	// shadow and depth passes, the 11th switch goes to the Z buffer RT
+	for (unsigned i = 0; i < 10; ++i)
+	{
+		target->redirectSetRenderTarget(0, (i % 2) ? (IDirect3DSurface9*)otherRT[i % 4] : (IDirect3DSurface9*)mainRT);
+		for (unsigned stage = 0; stage < 2; ++stage) target->redirectSetTexture(stage, sceneTex[(i + stage) % 4]);
+		draws(8);
+	}
+	target->redirectSetRenderTarget(0, zRT);
+	draws(8);
+
+	// main scene and post processing, alternating between the main RT and others
+	for (unsigned i = 0; i < 12; ++i)
+	{
+		target->redirectSetRenderTarget(0, mainRT);
+		target->redirectSetTexture(0, sceneTex[i % 4]);
+		draws(16);
+		target->redirectSetRenderTarget(0, otherRT[i % 4]);
+		target->redirectSetTexture(0, otherTex[(i + 1) % 4]);
+		draws(1);
+	}
+
+	// depth of field, sampling the other target on stage 1 (so that the texture sequence below starts over)
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		target->redirectSetRenderTarget(0, dofRT[0]);
+		target->redirectSetTexture(1, dofTex[1]);
+		draws(1);
+		target->redirectSetRenderTarget(0, dofRT[1]);
+		target->redirectSetTexture(1, dofTex[0]);
+		draws(1);
+	}
+
+	// final combination: textures 0 to 3, followed by 6 switches, then the HUD
+	for (unsigned stage = 0; stage < 4; ++stage) target->redirectSetTexture(stage, otherTex[stage]);
+	for (unsigned i = 0; i < 6; ++i)
+	{
+		target->redirectSetRenderTarget(0, (i % 2) ? (IDirect3DSurface9*)otherRT[0] : (IDirect3DSurface9*)mainRT);
+		draws(1);
+	}
+	// the HUD is drawn indexed, the subtitle text is not
+	target->redirectSetTexture(0, healthbarTex);
+	hudDraws(5);
+	target->redirectSetTexture(0, categoryIconsTex);
+	hudDraws(2);
+	target->redirectSetTexture(0, textTex);
+	draws(20);
+	hudDraws(1);
+
+	target->redirectPresent(NULL, NULL, NULL, NULL);
+}
+
+void HookBenchmark::report(const char* name, LONGLONG ticks, unsigned long long calls)
+{
+	double ns = ticks * 1000000000.0 / frequency.QuadPart / calls;
+	SDLOG(0, " - %20s: %10llu calls, %10.1f ns/call", name, calls, ns);
+}
+
+void HookBenchmark::benchSetRenderTarget()
+{
+	IDirect3DSurface9* targets[] = { mainRT, otherRT[0], mainRT, otherRT[1], zRT, dofRT[0], dofRT[1], otherRT[2] };
+	LARGE_INTEGER start, stop;
+	LONGLONG ticks = 0;
+	for (unsigned done = 0; done < CALLS; done += CALLS_PER_FRAME)
+	{
+		QueryPerformanceCounter(&start);
+		for (unsigned i = 0; i < CALLS_PER_FRAME; ++i) target->redirectSetRenderTarget(0, targets[i % 8]);
+		QueryPerformanceCounter(&stop);
+		ticks += stop.QuadPart - start.QuadPart;
+		target->redirectPresent(NULL, NULL, NULL, NULL);
+	}
+	report("SetRenderTarget", ticks, CALLS);
+}
+
+void HookBenchmark::benchSetTexture()
+{
+	IDirect3DTexture9* textures[] = { sceneTex[0], sceneTex[1], otherTex[0], textTex, sceneTex[2], healthbarTex, sceneTex[3], categoryIconsTex };
+	LARGE_INTEGER start, stop;
+	LONGLONG ticks = 0;
+	for (unsigned done = 0; done < CALLS; done += CALLS_PER_FRAME)
+	{
+		QueryPerformanceCounter(&start);
+		for (unsigned i = 0; i < CALLS_PER_FRAME; ++i) target->redirectSetTexture(i % 4, textures[i % 8]);
+		QueryPerformanceCounter(&stop);
+		ticks += stop.QuadPart - start.QuadPart;
+		target->redirectPresent(NULL, NULL, NULL, NULL);
+	}
+	report("SetTexture", ticks, CALLS);
+}
+
+void HookBenchmark::benchDrawPrimitiveUP()
+{
+	target->redirectSetRenderTarget(0, mainRT);
+	target->redirectSetTexture(0, textTex);
+	LARGE_INTEGER start, stop;
+	QueryPerformanceCounter(&start);
+	draws(CALLS);
+	QueryPerformanceCounter(&stop);
+	report("DrawPrimitiveUP", stop.QuadPart - start.QuadPart, CALLS);
+	target->redirectPresent(NULL, NULL, NULL, NULL);
+}
+
+void HookBenchmark::benchPresent()
+{
+	LARGE_INTEGER start, stop;
+	QueryPerformanceCounter(&start);
+	for (unsigned i = 0; i < CALLS; ++i) target->redirectPresent(NULL, NULL, NULL, NULL);
+	QueryPerformanceCounter(&stop);
+	report("Present", stop.QuadPart - start.QuadPart, CALLS);
+}
+
+void HookBenchmark::benchFrame()
+{
+	device->resetCallCounts();
+	LARGE_INTEGER start, stop;
+	QueryPerformanceCounter(&start);
+	for (unsigned i = 0; i < FRAMES; ++i) frame();
+	QueryPerformanceCounter(&stop);
+	report("Synthetic frame", stop.QuadPart - start.QuadPart, FRAMES);
+	unsigned long long calls = 0;
+	for (unsigned c = 0; c < NullDevice::NUM_CALLS; ++c) calls += device->getCallCount((NullDevice::Call)c);
+	SDLOG(0, " - %20s: %10.1f device calls/frame", "", (double)calls / FRAMES);
+}
+
+void HookBenchmark::run(HookTargetFactory factory)
+{
+	SDLOG(0, "Hook layer benchmark started");
+	HookBenchmark bench(factory);
+	bench.benchSetRenderTarget();
+	bench.benchSetTexture();
+	bench.benchDrawPrimitiveUP();
+	bench.benchPresent();
+	bench.benchFrame();
+	bench.device->logStatistics();
+	SDLOG(0, "Hook layer benchmark completed");
+}
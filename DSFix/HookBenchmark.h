@@ -0,0 +1,51 @@
+#pragma once
+
+#include <d3d9.h>
+
+#include "HookTarget.h"
+
+// Microbenchmarks of our hook layer, which run synthetic call sequences through the redirect functions
+// of a HookTarget on a NullDevice and log the time per call
+// In the DLL, that is a headless RSManager with its resources and effects created as configured, so the effect
+// passes, the HUD layout and the UP draw batching are part of the measured paths (without any GPU work).
+// bench/HookBench.cpp runs the same benchmark on the pipeline detection only, as a standalone tool.
+class HookBenchmark
+{
+	static const unsigned CALLS = 200000;
+	// calls between two Presents, so that the pipeline detection keeps cycling through its states
+	static const unsigned CALLS_PER_FRAME = 64;
+	static const unsigned FRAMES = 2000;
+
+	NullDevice* device;
+	std::unique_ptr<HookTarget> target;
+
+	CComPtr<IDirect3DTexture9> mainTex, zTex, dofTex[2], otherTex[4], sceneTex[4];
+	CComPtr<IDirect3DSurface9> mainRT, zRT, dofRT[2], otherRT[4];
+	// all textures of the known texture database, the ones used by the HUD sequence separately
+	std::vector<CComPtr<IDirect3DTexture9> > knownTextures;
+	IDirect3DTexture9* healthbarTex;
+	IDirect3DTexture9* categoryIconsTex;
+	IDirect3DTexture9* textTex;
+
+	LARGE_INTEGER frequency;
+
+	HookBenchmark(HookTargetFactory factory);
+	~HookBenchmark();
+
+	void createRenderTexture(UINT width, UINT height, CComPtr<IDirect3DTexture9>& tex, CComPtr<IDirect3DSurface9>& surf);
+
+	void draws(unsigned count);
+	void hudDraws(unsigned count);
+	void frame();
+
+	void report(const char* name, LONGLONG ticks, unsigned long long calls);
+	void benchSetRenderTarget();
+	void benchSetTexture();
+	void benchDrawPrimitiveUP();
+	void benchPresent();
+	void benchFrame();
+
+public:
+	// runs all benchmarks, used by the benchmarkHooks action
+	static void run(HookTargetFactory factory);
+};
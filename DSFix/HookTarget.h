@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3d9.h>
+
+class NullDevice;
+
+// The hooked calls as the benchmark and the trace replay drive them, with the signatures of the RSManager redirects
+// In the DLL, RSManagerTarget runs them through a headless RSManager with its effects. The standalone tools in bench/
+// use DetectorTarget, which runs the same PipelineHooks without the effects.
+class HookTarget
+{
+public:
+	virtual ~HookTarget() {}
+
+	// resources which existed before a trace started, or were created outside of the hooked calls
+	virtual void registerMainRenderTexture(IDirect3DTexture9* pTexture) = 0;
+	virtual void registerRenderTexture(IDirect3DTexture9* pTexture) = 0;
+	virtual void registerRenderSurface(IDirect3DSurface9* pSurface) = 0;
+	virtual void registerKnownTexture(UINT32 hash, IDirect3DTexture9* pTexture) = 0;
+
+	virtual HRESULT redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) = 0;
+	virtual HRESULT redirectCreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) = 0;
+	virtual HRESULT redirectCreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) = 0;
+	virtual HRESULT redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) = 0;
+	virtual HRESULT redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil) = 0;
+	virtual HRESULT redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture) = 0;
+	virtual HRESULT redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value) = 0;
+	virtual HRESULT redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) = 0;
+	virtual HRESULT redirectStretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter) = 0;
+	virtual HRESULT redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) = 0;
+	virtual HRESULT redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) = 0;
+	virtual HRESULT redirectPresent(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion) = 0;
+	// a device Reset: our resources are released and created again
+	virtual void resetDevice() = 0;
+
+	// the pipeline events since the last Present
+	virtual unsigned getFrameEvents() const = 0;
+};
+
+// creates a target running on the given device
+typedef HookTarget* (*HookTargetFactory)(NullDevice* device);
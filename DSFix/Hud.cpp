@@ -7,9 +7,10 @@
 #include <vector>
 
 #include "Settings.h"
+#include "HudLayout.h"
 
 HUD::HUD(IDirect3DDevice9 *device, int width, int height)
-	: Effect(device), width(width), height(height)
+	: Effect(device), width(width), height(height), firstVertex(NO_VERTICES)
 {
 
 	DWORD flags = D3DXFX_NOT_CLONEABLE;
@@ -22,70 +23,62 @@ HUD::HUD(IDirect3DDevice9 *device, int width, int height)
 
 	// get handles
 	frameTexHandle = effect->GetParameterByName(NULL, "frameTex2D");
-	opacityHandle = effect->GetParameterByName(NULL, "opacity");
-}
-
-void HUD::go(IDirect3DTexture9 *input, IDirect3DSurface9 *dst)
-{
-	device->SetVertexDeclaration(vertexDeclaration);
-	device->SetRenderTarget(0, dst);
-	effect->SetTexture(frameTexHandle, input);
 
-	float scale = Settings::get().getHudScaleFactor();
+	// with the layout table, the elements are scaled when they are drawn into the layer
+	float scale = HudLayout::get().isEnabled() ? 1.0f : Settings::get().getHudScaleFactor();
 	float iscale = 1.0f-scale;
 
-	UINT passes;
-
 	// upper left
-	effect->SetFloat(opacityHandle, Settings::get().getHudTopLeftOpacity());
-	effect->Begin(&passes, 0);
-	effect->BeginPass(0);
+	float opacity = Settings::get().getHudTopLeftOpacity();
 	rect(0.0f, 0.0f, 1.0f, 0.21f,
-	     0.0f, 0.0f, 1.0f*scale, 0.21f*scale);
-	effect->EndPass();
-	effect->End();
+	     0.0f, 0.0f, 1.0f*scale, 0.21f*scale, opacity);
 
 	// lower left
-	effect->SetFloat(opacityHandle, Settings::get().getHudBottomLeftOpacity());
-	effect->Begin(&passes, 0);
-	effect->BeginPass(0);
+	opacity = Settings::get().getHudBottomLeftOpacity();
 	if(Settings::get().getEnableMinimalHud())
 	{
 		rect(0.145f, 0.527f, 0.074f, 0.204f,
-		     0.1f*scale, 0.77f + 0.2f*iscale, 0.074f*scale, 0.204f*scale);
+		     0.1f*scale, 0.77f + 0.2f*iscale, 0.074f*scale, 0.204f*scale, opacity);
 		rect(0.145f, 0.731f, 0.074f, 0.204f,
-		     0.1f*scale + 0.074f*scale + 0.01f, 0.77f + 0.2f*iscale, 0.074f*scale, 0.204f*scale);
+		     0.1f*scale + 0.074f*scale + 0.01f, 0.77f + 0.2f*iscale, 0.074f*scale, 0.204f*scale, opacity);
 	}
 	else
 	{
 		rect(0.0f, 0.5f, 0.5f, 0.5f,
-		     0.0f, 0.5f + 0.5f*iscale, 0.5f*scale, 0.5f*scale);
+		     0.0f, 0.5f + 0.5f*iscale, 0.5f*scale, 0.5f*scale, opacity);
 	}
-	effect->EndPass();
-	effect->End();
 
 	// lower right
-	effect->SetFloat(opacityHandle, Settings::get().getHudBottomRightOpacity());
-	effect->Begin(&passes, 0);
-	effect->BeginPass(0);
+	opacity = Settings::get().getHudBottomRightOpacity();
 	rect(0.8f, 0.8f, 0.2f, 0.2f,
-	     0.8f + 0.2f*iscale, 0.8f + 0.2f*iscale, 0.2f*scale, 0.2f*scale);
-	effect->EndPass();
-	effect->End();
+	     0.8f + 0.2f*iscale, 0.8f + 0.2f*iscale, 0.2f*scale, 0.2f*scale, opacity);
 
 	// center
-	effect->SetFloat(opacityHandle, 1.0f);
+	rect(0.37f, 0.22f, 0.4f, 0.5f,
+	     0.37f + 0.15f*iscale, 0.22f + 0.15f*iscale, 0.4f*scale, 0.5f*scale, 1.0f);
+
+	firstVertex = addVertices(&vertices[0], (UINT)vertices.size());
+}
+
+void HUD::go(IDirect3DTexture9 *input, IDirect3DSurface9 *dst)
+{
+	GpuProfiler::Scope profile("HUD", "composite");
+	device->SetVertexDeclaration(vertexDeclaration);
+	device->SetRenderTarget(0, dst);
+	effect->SetTexture(frameTexHandle, input);
+
+	// all regions in one draw, the opacity is per vertex
+	UINT passes, triangles = (UINT)vertices.size() / 3;
 	effect->Begin(&passes, 0);
 	effect->BeginPass(0);
-	rect(0.37f, 0.22f, 0.4f, 0.5f,
-	     0.37f + 0.15f*iscale, 0.22f + 0.15f*iscale, 0.4f*scale, 0.5f*scale);
+	if (firstVertex != NO_VERTICES && useSharedVertices()) device->DrawPrimitive(D3DPT_TRIANGLELIST, firstVertex, triangles);
+	else device->DrawPrimitiveUP(D3DPT_TRIANGLELIST, triangles, &vertices[0], sizeof(Vertex));
 	effect->EndPass();
 	effect->End();
-
 }
 
 void HUD::rect(float srcLeft, float srcTop, float srcWidth, float srcHeight,
-               float trgLeft, float trgTop, float trgWidth, float trgHeight)
+               float trgLeft, float trgTop, float trgWidth, float trgHeight, float opacity)
 {
 	trgTop = -(trgTop*2.0f-1.0f);
 	trgLeft = trgLeft*2.0f-1.0f;
@@ -93,12 +86,14 @@ void HUD::rect(float srcLeft, float srcTop, float srcWidth, float srcHeight,
 	float trgBottom = trgTop - trgHeight*2.0f;
 	float srcRight = srcLeft + srcWidth;
 	float srcBottom = srcTop + srcHeight;
-	float quad[4][5] =
+	Vertex quad[4] =
 	{
-		{ trgLeft,  trgTop, 0.5f, srcLeft,  srcTop    },
-		{ trgRight, trgTop, 0.5f, srcRight, srcTop    },
-		{ trgLeft,     trgBottom, 0.5f, srcLeft,  srcBottom },
-		{ trgRight,    trgBottom, 0.5f, srcRight, srcBottom }
+		{ trgLeft,  trgTop, 0.5f, srcLeft,  srcTop, opacity    },
+		{ trgRight, trgTop, 0.5f, srcRight, srcTop, opacity    },
+		{ trgLeft,     trgBottom, 0.5f, srcLeft,  srcBottom, opacity },
+		{ trgRight,    trgBottom, 0.5f, srcRight, srcBottom, opacity }
 	};
-	device->DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, quad, sizeof(quad[0]));
+	// two triangles of the former strip
+	static const int order[6] = { 0, 1, 2, 2, 1, 3 };
+	for (int i = 0; i < 6; ++i) vertices.push_back(quad[order[i]]);
 }
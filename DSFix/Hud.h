@@ -17,8 +17,11 @@ private:
 	CComPtr<ID3DXEffect> effect;
 
 	D3DXHANDLE frameTexHandle;
-	D3DXHANDLE opacityHandle;
+
+	// all HUD regions as a triangle list, with their opacity, and where they are in the shared vertex buffer
+	std::vector<Vertex> vertices;
+	UINT firstVertex;
 
 	void rect(float srcLeft, float srcTop, float srcWidth, float srcHeight,
-	          float trgLeft, float trgTop, float trgWidth, float trgHeight);
+	          float trgLeft, float trgTop, float trgWidth, float trgHeight, float opacity);
 };
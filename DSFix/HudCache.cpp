@@ -0,0 +1,130 @@
+
+#include "HudCache.h"
+
+#include "main.h"
+
+HudCache HudCache::instance;
+
+// FNV-1a on 32 bit words, the HUD draws only have a few thousand vertices in total
+static const UINT32 FNV_OFFSET = 2166136261u;
+static const UINT32 FNV_PRIME = 16777619u;
+
+HudCache::HudCache()
+	: enabled(false), recording(false), skipping(false), layerValid(false), hash(FNV_OFFSET), lastHash(0), stableFrames(0),
+	frames(0), skippedFrames(0), lateFrames(0), framesSinceLog(0), draws(0), skippedDraws(0)
+{
+}
+
+void HudCache::add(UINT32 value)
+{
+	hash = (hash ^ value) * FNV_PRIME;
+}
+
+void HudCache::add(const void* data, size_t size)
+{
+	const BYTE* bytes = (const BYTE*)data;
+	size_t words = size / 4;
+	for (size_t i = 0; i < words; ++i)
+	{
+		UINT32 word;
+		memcpy(&word, bytes + i * 4, 4);
+		add(word);
+	}
+	for (size_t i = words * 4; i < size; ++i) add(bytes[i]);
+}
+
+void HudCache::invalidate()
+{
+	layerValid = false;
+	skipping = false;
+	stableFrames = 0;
+}
+
+bool HudCache::beginHud()
+{
+	if (!enabled) return false;
+	recording = true;
+	skipping = layerValid && stableFrames >= STABLE_FRAMES;
+	hash = FNV_OFFSET;
+	return skipping;
+}
+
+void HudCache::endHud()
+{
+	if (!recording) return;
+	recording = false;
+
+	bool same = hash == lastHash;
+	stableFrames = same ? stableFrames + 1 : 0;
+	lastHash = hash;
+	++frames;
+	if (skipping)
+	{
+		if (same)
+		{
+			++skippedFrames;
+		}
+		else
+		{
+			// the HUD changed while it was not drawn, render it again next frame
+			++lateFrames;
+			layerValid = false;
+		}
+	}
+	else
+	{
+		layerValid = true;
+	}
+	skipping = false;
+
+	if (++framesSinceLog >= LOG_INTERVAL)
+	{
+		SDLOG(0, "HudCache: skipped %u of %u HUD frames (%.1f%%) and %u of %u draws, %u changes shown a frame late",
+			skippedFrames, frames, 100.0 * skippedFrames / frames, skippedDraws, draws, lateFrames);
+		framesSinceLog = 0;
+	}
+}
+
+void HudCache::addDraw(IDirect3DBaseTexture9* texture, D3DPRIMITIVETYPE type, UINT count, const void* vertices, UINT numVertices, UINT stride,
+	const void* indices, D3DFORMAT indexFormat)
+{
+	if (!recording) return;
+	++draws;
+	if (skipping) ++skippedDraws;
+	add((UINT32)(UINT_PTR)texture);
+	add((UINT32)type);
+	add(count);
+	add(stride);
+	add(vertices, (size_t)numVertices * stride);
+	if (indices) add(indices, (size_t)verticesPerDraw(type, count) * (indexFormat == D3DFMT_INDEX32 ? 4 : 2));
+}
+
+void HudCache::addState(UINT32 kind, UINT32 index, UINT32 value)
+{
+	if (!recording) return;
+	add(kind);
+	add(index);
+	add(value);
+}
+
+void HudCache::addConstants(UINT32 kind, UINT start, const void* data, size_t size)
+{
+	if (!recording) return;
+	add(kind);
+	add(start);
+	add(data, size);
+}
+
+UINT HudCache::verticesPerDraw(D3DPRIMITIVETYPE type, UINT count)
+{
+	switch (type)
+	{
+	case D3DPT_POINTLIST: return count;
+	case D3DPT_LINELIST: return count * 2;
+	case D3DPT_LINESTRIP: return count + 1;
+	case D3DPT_TRIANGLELIST: return count * 3;
+	case D3DPT_TRIANGLESTRIP:
+	case D3DPT_TRIANGLEFAN: return count + 2;
+	default: return 0;
+	}
+}
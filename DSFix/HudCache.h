@@ -0,0 +1,76 @@
+#pragma once
+
+#include <d3d9.h>
+
+// Skips re-rendering the game's HUD while it does not change (enableHudCache, needs enableHudMod)
+// Every draw into the HUD layer and every state change while the HUD is rendered goes into a fingerprint.
+// Once the fingerprint was the same for STABLE_FRAMES frames, the game's draws into the layer are dropped and
+// the layer kept from the last rendered frame is composited again. The fingerprint is still computed, and when it
+// differs the layer is rendered again from the next frame on; so a change right after a skipped frame shows up one
+// frame late. The skip rate is logged every LOG_INTERVAL frames.
+class HudCache
+{
+	static HudCache instance;
+
+	static const unsigned STABLE_FRAMES = 2;
+	static const unsigned LOG_INTERVAL = 600;
+
+	bool enabled, recording, skipping, layerValid;
+	UINT32 hash, lastHash;
+	unsigned stableFrames;
+	unsigned frames, skippedFrames, lateFrames, framesSinceLog;
+	unsigned draws, skippedDraws;
+
+	void add(const void* data, size_t size);
+	void add(UINT32 value);
+
+public:
+	// kinds of state changes in addState and addConstants
+	enum StateKind
+	{
+		RENDER_STATE, TEXTURE_STAGE_STATE, SAMPLER_STATE, TEXTURE, SHADER,
+		VERTEX_SHADER_CONSTANTS, PIXEL_SHADER_CONSTANTS
+	};
+
+	static HudCache& get()
+	{
+		return instance;
+	}
+
+	HudCache();
+
+	void setEnabled(bool enable)
+	{
+		enabled = enable;
+		invalidate();
+	}
+	bool isEnabled() const
+	{
+		return enabled;
+	}
+	// between beginHud and endHud
+	bool isRecording() const
+	{
+		return recording;
+	}
+	// the draws into the layer are to be dropped this frame
+	bool isSkipping() const
+	{
+		return recording && skipping;
+	}
+
+	// the layer is gone or was overwritten (device reset), the next HUD is rendered
+	void invalidate();
+
+	// start of the HUD, returns true if the layer is kept from the last frame (it must not be cleared then)
+	bool beginHud();
+	void endHud();
+
+	void addDraw(IDirect3DBaseTexture9* texture, D3DPRIMITIVETYPE type, UINT count, const void* vertices, UINT numVertices, UINT stride,
+		const void* indices = NULL, D3DFORMAT indexFormat = D3DFMT_INDEX16);
+	void addState(UINT32 kind, UINT32 index, UINT32 value);
+	void addConstants(UINT32 kind, UINT start, const void* data, size_t size);
+
+	// vertices (or indices) used by a draw of count primitives
+	static UINT verticesPerDraw(D3DPRIMITIVETYPE type, UINT count);
+};
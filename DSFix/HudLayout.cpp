@@ -0,0 +1,202 @@
+
+#include "HudLayout.h"
+
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+
+#include "main.h"
+#include "Settings.h"
+#include "HudCache.h"
+
+HudLayout HudLayout::instance;
+
+static const char* roleNames[HudLayout::NUM_ROLES] = { "any", "healthbar", "text", "icons", "effects", "gui", "other" };
+
+HudLayout::HudLayout()
+	: enabled(false), spaceWidth(0.0f), spaceHeight(0.0f), layoutValid(false), positionType(D3DDECLTYPE_UNUSED),
+	positionOffset(0), pretransformed(false), colorOffset(-1)
+{
+}
+
+const char* HudLayout::getRoleName(Role role)
+{
+	return role < NUM_ROLES ? roleNames[role] : "unknown";
+}
+
+void HudLayout::load()
+{
+	elements.clear();
+	spaceWidth = spaceHeight = 0.0f;
+	enabled = Settings::get().getEnableHudMod() && Settings::get().getEnableHudLayout();
+	if (!enabled) return;
+
+	std::ifstream lfile;
+	lfile.open(GetDirectoryFile("dsfix\\hudlayout.txt"), std::ios::in);
+	if (!lfile.is_open())
+	{
+		SDLOG(0, "HudLayout: could not open dsfix\\hudlayout.txt, the HUD is not scaled");
+		return;
+	}
+	float globalScale = Settings::get().getHudScaleFactor();
+	char buffer[256];
+	while (!lfile.eof())
+	{
+		lfile.getline(buffer, 256);
+		if (buffer[0] == '#') continue;
+		if (lfile.gcount() <= 1) continue;
+
+		char name[64], role[16];
+		Element e;
+		if (sscanf_s(buffer, "space %f %f", &spaceWidth, &spaceHeight) == 2) continue;
+		int read = sscanf_s(buffer, "%63s %15s %f %f %f %f %f %f %f %f", name, (unsigned)_countof(name), role, (unsigned)_countof(role),
+			&e.left, &e.top, &e.right, &e.bottom, &e.anchorX, &e.anchorY, &e.scale, &e.opacity);
+		if (read != 10)
+		{
+			SDLOG(0, "HudLayout: ignoring line \"%s\"", buffer);
+			continue;
+		}
+		e.name = name;
+		e.role = NUM_ROLES;
+		for (int r = 0; r < NUM_ROLES; ++r)
+		{
+			if (e.role == NUM_ROLES && strcmp(role, roleNames[r]) == 0) e.role = (Role)r;
+		}
+		if (e.role == NUM_ROLES)
+		{
+			SDLOG(0, "HudLayout: unknown role %s of element %s", role, name);
+			continue;
+		}
+		// the element scales are relative to hudScaleFactor
+		e.scale *= globalScale;
+		elements.push_back(e);
+		SDLOG(2, "HudLayout: %s (%s) in %.3f,%.3f - %.3f,%.3f, anchor %.3f,%.3f, scale %.3f, opacity %.2f",
+			name, role, e.left, e.top, e.right, e.bottom, e.anchorX, e.anchorY, e.scale, e.opacity);
+	}
+	lfile.close();
+	SDLOG(0, "HudLayout: %u elements loaded", elements.size());
+	// what is in the HUD layer does not match the new layout
+	HudCache::get().invalidate();
+}
+
+void HudLayout::release()
+{
+	lastDeclaration = nullptr;
+	layoutValid = false;
+}
+
+bool HudLayout::updateLayout(IDirect3DDevice9* device)
+{
+	CComPtr<IDirect3DVertexDeclaration9> declaration;
+	device->GetVertexDeclaration(&declaration);
+	if (declaration == lastDeclaration) return layoutValid;
+	lastDeclaration = declaration;
+	layoutValid = false;
+	colorOffset = -1;
+	if (!declaration) return false;
+
+	D3DVERTEXELEMENT9 decl[MAXD3DDECLLENGTH + 1];
+	UINT numElements = 0;
+	if (FAILED(declaration->GetDeclaration(decl, &numElements))) return false;
+	for (UINT i = 0; i < numElements && decl[i].Stream != 0xFF; ++i)
+	{
+		const D3DVERTEXELEMENT9& element = decl[i];
+		if (element.Stream != 0 || element.UsageIndex != 0) continue;
+		if (element.Usage == D3DDECLUSAGE_POSITION || element.Usage == D3DDECLUSAGE_POSITIONT)
+		{
+			switch (element.Type)
+			{
+			case D3DDECLTYPE_FLOAT2: case D3DDECLTYPE_FLOAT3: case D3DDECLTYPE_FLOAT4:
+			case D3DDECLTYPE_SHORT2: case D3DDECLTYPE_SHORT4:
+				positionType = (D3DDECLTYPE)element.Type;
+				positionOffset = element.Offset;
+				pretransformed = element.Usage == D3DDECLUSAGE_POSITIONT;
+				layoutValid = true;
+				break;
+			default:
+				SDLOG(2, "HudLayout: unsupported position type %d", element.Type);
+			}
+		}
+		else if (element.Usage == D3DDECLUSAGE_COLOR && element.Type == D3DDECLTYPE_D3DCOLOR)
+		{
+			colorOffset = element.Offset;
+		}
+	}
+	return layoutValid;
+}
+
+const HudLayout::Element* HudLayout::match(Role role, float x, float y) const
+{
+	for (size_t i = 0; i < elements.size(); ++i)
+	{
+		const Element& e = elements[i];
+		if ((e.role == ROLE_ANY || e.role == role) && x >= e.left && x <= e.right && y >= e.top && y <= e.bottom) return &e;
+	}
+	return NULL;
+}
+
+const void* HudLayout::apply(IDirect3DDevice9* device, Role role, const void* vertices, UINT first, UINT count, UINT stride)
+{
+	if (!enabled || elements.empty() || !vertices || count == 0 || !updateLayout(device)) return vertices;
+
+	float width = spaceWidth, height = spaceHeight;
+	if (pretransformed || width <= 0.0f || height <= 0.0f)
+	{
+		D3DVIEWPORT9 viewport;
+		device->GetViewport(&viewport);
+		width = (float)viewport.Width;
+		height = (float)viewport.Height;
+	}
+	bool isShort = positionType == D3DDECLTYPE_SHORT2 || positionType == D3DDECLTYPE_SHORT4;
+
+	// the draw is identified by the center of its bounds
+	const BYTE* source = (const BYTE*)vertices + first * stride;
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (UINT i = 0; i < count; ++i)
+	{
+		const BYTE* position = source + i * stride + positionOffset;
+		float x = isShort ? ((const INT16*)position)[0] : ((const float*)position)[0];
+		float y = isShort ? ((const INT16*)position)[1] : ((const float*)position)[1];
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+	}
+	const Element* e = match(role, (minX + maxX) * 0.5f / width, (minY + maxY) * 0.5f / height);
+	if (!e)
+	{
+		SDLOG(4, "HudLayout: no element for %s draw at %.1f,%.1f - %.1f,%.1f", getRoleName(role), minX, minY, maxX, maxY);
+		return vertices;
+	}
+	if (e->scale == 1.0f && e->opacity >= 1.0f) return vertices;
+
+	// the game's vertices must not be changed, only the used range is copied
+	scratch.resize((size_t)(first + count) * stride);
+	BYTE* target = &scratch[0] + first * stride;
+	memcpy(target, source, (size_t)count * stride);
+	float anchorX = e->anchorX * width, anchorY = e->anchorY * height;
+	BYTE alpha = (BYTE)(std::max(0.0f, std::min(1.0f, e->opacity)) * 255.0f + 0.5f);
+	for (UINT i = 0; i < count; ++i)
+	{
+		BYTE* vertex = target + i * stride;
+		BYTE* position = vertex + positionOffset;
+		if (isShort)
+		{
+			INT16* p = (INT16*)position;
+			p[0] = (INT16)floor(anchorX + (p[0] - anchorX) * e->scale + 0.5f);
+			p[1] = (INT16)floor(anchorY + (p[1] - anchorY) * e->scale + 0.5f);
+		}
+		else
+		{
+			float* p = (float*)position;
+			p[0] = anchorX + (p[0] - anchorX) * e->scale;
+			p[1] = anchorY + (p[1] - anchorY) * e->scale;
+		}
+		if (colorOffset >= 0 && alpha < 255)
+		{
+			D3DCOLOR* color = (D3DCOLOR*)(vertex + colorOffset);
+			*color = (*color & 0x00FFFFFF) | ((((*color >> 24) * alpha + 127) / 255) << 24);
+		}
+	}
+	return &scratch[0];
+}
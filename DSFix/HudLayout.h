@@ -0,0 +1,72 @@
+#pragma once
+
+#include <d3d9.h>
+
+// Per-element HUD layout (enableHudLayout, needs enableHudMod), read from dsfix\hudlayout.txt
+// Every element is identified by the role of the texture it is drawn with and a region the center of a draw has to
+// be in, and has its own scale, anchor and opacity. The game's UP draws of the HUD are transformed by rewriting the
+// positions (and vertex color alpha) of a copy of their vertices, so any number of elements costs no extra pass;
+// the HUD layer is then composited without scaling. Elements are matched in the order of the file.
+class HudLayout
+{
+public:
+	// what a draw's texture is used for
+	enum Role
+	{
+		ROLE_ANY, ROLE_HEALTHBAR, ROLE_TEXT, ROLE_ICONS, ROLE_EFFECTS, ROLE_GUI, ROLE_OTHER, NUM_ROLES
+	};
+
+private:
+	static HudLayout instance;
+
+	struct Element
+	{
+		std::string name;
+		Role role;
+		// region of the draw center and fixed point of the scaling, in 0..1 of the HUD space
+		float left, top, right, bottom;
+		float anchorX, anchorY;
+		float scale, opacity;
+	};
+	std::vector<Element> elements;
+	bool enabled;
+	// extent of untransformed positions, 0 to use the viewport
+	float spaceWidth, spaceHeight;
+
+	// where the position and color are in the current vertex declaration
+	CComPtr<IDirect3DVertexDeclaration9> lastDeclaration;
+	bool layoutValid;
+	D3DDECLTYPE positionType;
+	UINT positionOffset;
+	bool pretransformed;
+	int colorOffset;
+
+	std::vector<BYTE> scratch;
+
+	bool updateLayout(IDirect3DDevice9* device);
+	const Element* match(Role role, float x, float y) const;
+
+public:
+	static HudLayout& get()
+	{
+		return instance;
+	}
+
+	HudLayout();
+
+	bool isEnabled() const
+	{
+		return enabled;
+	}
+
+	// (re)reads the table, if enableHudLayout is set
+	void load();
+	// drops the reference to the device's vertex declaration
+	void release();
+
+	// returns the vertices to draw, which are a transformed copy if the draw belongs to an element
+	// first and count give the range of vertices the draw uses
+	const void* apply(IDirect3DDevice9* device, Role role, const void* vertices, UINT first, UINT count, UINT stride);
+
+	static const char* getRoleName(Role role);
+};
@@ -0,0 +1,636 @@
+
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <thread>
+
+namespace
+{
+	// deflate
+
+	const unsigned WINDOW_SIZE = 1 << 15;
+	const unsigned HASH_BITS = 15;
+	const unsigned MIN_MATCH = 3;
+	const unsigned MAX_MATCH = 258;
+	// candidates tried per position, and match length at which the search stops
+	const unsigned MAX_CHAIN = 16;
+	const unsigned GOOD_MATCH = 64;
+	// tokens per dynamic Huffman block
+	const size_t BLOCK_TOKENS = 1 << 16;
+
+	const unsigned NUM_LITLEN = 286;
+	const unsigned NUM_DIST = 30;
+	const unsigned NUM_CODELEN = 19;
+	const unsigned END_OF_BLOCK = 256;
+
+	const unsigned lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const unsigned codeLengthOrder[NUM_CODELEN] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	unsigned lengthCode(unsigned length)
+	{
+		unsigned code = 0;
+		while (code < 28 && lengthBase[code + 1] <= length) ++code;
+		return code;
+	}
+
+	unsigned distCode(unsigned dist)
+	{
+		unsigned code = 0;
+		while (code < 29 && distBase[code + 1] <= dist) ++code;
+		return code;
+	}
+
+	// literals are stored as is, matches as MATCH_FLAG | length << 16 | distance
+	const uint32_t MATCH_FLAG = 0x80000000u;
+
+	class BitWriter
+	{
+		std::vector<uint8_t>& out;
+		uint64_t bits;
+		unsigned count;
+
+	public:
+		BitWriter(std::vector<uint8_t>& out) : out(out), bits(0), count(0) {}
+
+		void put(uint32_t value, unsigned n)
+		{
+			bits |= (uint64_t)value << count;
+			count += n;
+			while (count >= 8)
+			{
+				out.push_back((uint8_t)bits);
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+		void align()
+		{
+			if (count > 0) put(0, 8 - count);
+		}
+	};
+
+	// Huffman code lengths limited to maxBits; frequencies are flattened until the tree fits
+	void buildLengths(const uint32_t* freqs, unsigned n, unsigned maxBits, uint8_t* lengths)
+	{
+		std::vector<uint32_t> f(freqs, freqs + n);
+		for (;;)
+		{
+			std::fill(lengths, lengths + n, 0);
+			typedef std::pair<uint32_t, int> Node; // weight, node index
+			std::priority_queue<Node, std::vector<Node>, std::greater<Node> > heap;
+			std::vector<int> parent;
+			for (unsigned i = 0; i < n; ++i)
+			{
+				if (!f[i]) continue;
+				heap.push(Node(f[i], (int)parent.size()));
+				parent.push_back(-1);
+			}
+			if (parent.empty()) return;
+			if (parent.size() == 1)
+			{
+				for (unsigned i = 0; i < n; ++i) if (f[i]) lengths[i] = 1;
+				return;
+			}
+			while (heap.size() > 1)
+			{
+				Node a = heap.top(); heap.pop();
+				Node b = heap.top(); heap.pop();
+				int node = (int)parent.size();
+				parent.push_back(-1);
+				parent[a.second] = node;
+				parent[b.second] = node;
+				heap.push(Node(a.first + b.first, node));
+			}
+			// parents always come after their children, so depths can be resolved from the root down
+			std::vector<unsigned> depth(parent.size(), 0);
+			for (int i = (int)parent.size() - 2; i >= 0; --i) depth[i] = depth[parent[i]] + 1;
+			unsigned maxDepth = 0, leaf = 0;
+			for (unsigned i = 0; i < n; ++i)
+			{
+				if (!f[i]) continue;
+				lengths[i] = (uint8_t)depth[leaf++];
+				maxDepth = std::max(maxDepth, (unsigned)lengths[i]);
+			}
+			if (maxDepth <= maxBits) return;
+			for (unsigned i = 0; i < n; ++i) if (f[i]) f[i] = (f[i] >> 1) | 1;
+		}
+	}
+
+	// canonical codes, bit reversed for writing LSB first
+	void buildCodes(const uint8_t* lengths, unsigned n, uint16_t* codes)
+	{
+		unsigned count[16] = {}, next[16] = {};
+		for (unsigned i = 0; i < n; ++i) ++count[lengths[i]];
+		count[0] = 0;
+		unsigned code = 0;
+		for (unsigned bits = 1; bits < 16; ++bits)
+		{
+			code = (code + count[bits - 1]) << 1;
+			next[bits] = code;
+		}
+		for (unsigned i = 0; i < n; ++i)
+		{
+			unsigned len = lengths[i];
+			if (!len) continue;
+			unsigned c = next[len]++, reversed = 0;
+			for (unsigned b = 0; b < len; ++b) reversed |= ((c >> b) & 1) << (len - 1 - b);
+			codes[i] = (uint16_t)reversed;
+		}
+	}
+
+	void findMatches(const uint8_t* data, size_t size, std::vector<uint32_t>& tokens)
+	{
+		std::vector<int32_t> head(1 << HASH_BITS, -1), prev(WINDOW_SIZE, -1);
+		tokens.reserve(size / 2);
+		size_t pos = 0;
+		auto hash = [&](size_t p) { return ((data[p] << 10) ^ (data[p + 1] << 5) ^ data[p + 2]) & ((1 << HASH_BITS) - 1); };
+		auto insert = [&](size_t p)
+		{
+			if (p + MIN_MATCH > size) return;
+			unsigned h = hash(p);
+			prev[p & (WINDOW_SIZE - 1)] = head[h];
+			head[h] = (int32_t)p;
+		};
+		while (pos < size)
+		{
+			unsigned bestLength = 0, bestDist = 0;
+			if (pos + MIN_MATCH <= size)
+			{
+				unsigned maxLength = (unsigned)std::min<size_t>(MAX_MATCH, size - pos);
+				int32_t candidate = head[hash(pos)];
+				for (unsigned chain = 0; chain < MAX_CHAIN && candidate >= 0 && pos - candidate < WINDOW_SIZE; ++chain)
+				{
+					const uint8_t* a = data + candidate;
+					const uint8_t* b = data + pos;
+					if (a[bestLength] == b[bestLength])
+					{
+						unsigned length = 0;
+						while (length < maxLength && a[length] == b[length]) ++length;
+						if (length > bestLength)
+						{
+							bestLength = length;
+							bestDist = (unsigned)(pos - candidate);
+							if (length >= GOOD_MATCH || length == maxLength) break;
+						}
+					}
+					int32_t next = prev[candidate & (WINDOW_SIZE - 1)];
+					if (next >= candidate) break;
+					candidate = next;
+				}
+			}
+			if (bestLength >= MIN_MATCH)
+			{
+				tokens.push_back(MATCH_FLAG | (bestLength << 16) | bestDist);
+				for (unsigned i = 0; i < bestLength; ++i) insert(pos + i);
+				pos += bestLength;
+			}
+			else
+			{
+				tokens.push_back(data[pos]);
+				insert(pos);
+				++pos;
+			}
+		}
+	}
+
+	void writeBlock(BitWriter& writer, const uint32_t* tokens, size_t count, bool final)
+	{
+		uint32_t litFreqs[NUM_LITLEN] = {}, distFreqs[NUM_DIST] = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t t = tokens[i];
+			if (t & MATCH_FLAG)
+			{
+				++litFreqs[257 + lengthCode((t >> 16) & 0x1ff)];
+				++distFreqs[distCode(t & 0xffff)];
+			}
+			else ++litFreqs[t];
+		}
+		litFreqs[END_OF_BLOCK] = 1;
+
+		uint8_t lengths[NUM_LITLEN + NUM_DIST];
+		uint8_t* litLengths = lengths;
+		uint8_t* distLengths = lengths + NUM_LITLEN;
+		buildLengths(litFreqs, NUM_LITLEN, 15, litLengths);
+		buildLengths(distFreqs, NUM_DIST, 15, distLengths);
+		unsigned numLit = NUM_LITLEN, numDist = NUM_DIST;
+		while (numLit > 257 && !litLengths[numLit - 1]) --numLit;
+		while (numDist > 1 && !distLengths[numDist - 1]) --numDist;
+
+		// run length encode the code lengths of both trees as one sequence
+		std::vector<uint8_t> all(litLengths, litLengths + numLit);
+		all.insert(all.end(), distLengths, distLengths + numDist);
+		std::vector<uint16_t> rle; // symbol | extra bits value << 8
+		uint32_t clFreqs[NUM_CODELEN] = {};
+		for (size_t i = 0; i < all.size();)
+		{
+			uint8_t len = all[i];
+			size_t run = 1;
+			while (i + run < all.size() && all[i + run] == len) ++run;
+			if (len == 0 && run >= 3)
+			{
+				size_t r = std::min<size_t>(run, 138);
+				if (r >= 11) { rle.push_back((uint16_t)(18 | ((r - 11) << 8))); ++clFreqs[18]; }
+				else { rle.push_back((uint16_t)(17 | ((r - 3) << 8))); ++clFreqs[17]; }
+				i += r;
+			}
+			else if (len != 0 && run >= 4)
+			{
+				rle.push_back(len);
+				++clFreqs[len];
+				size_t r = std::min<size_t>(run - 1, 6);
+				rle.push_back((uint16_t)(16 | ((r - 3) << 8)));
+				++clFreqs[16];
+				i += r + 1;
+			}
+			else
+			{
+				rle.push_back(len);
+				++clFreqs[len];
+				++i;
+			}
+		}
+		// inflate rejects a code length code with a single symbol, give it a second one
+		if (std::count(clFreqs, clFreqs + NUM_CODELEN, 0u) == NUM_CODELEN - 1) ++clFreqs[clFreqs[0] ? 1 : 0];
+		uint8_t clLengths[NUM_CODELEN];
+		buildLengths(clFreqs, NUM_CODELEN, 7, clLengths);
+		unsigned numCl = NUM_CODELEN;
+		while (numCl > 4 && !clLengths[codeLengthOrder[numCl - 1]]) --numCl;
+
+		uint16_t litCodes[NUM_LITLEN] = {}, distCodes[NUM_DIST] = {}, clCodes[NUM_CODELEN] = {};
+		buildCodes(litLengths, NUM_LITLEN, litCodes);
+		buildCodes(distLengths, NUM_DIST, distCodes);
+		buildCodes(clLengths, NUM_CODELEN, clCodes);
+
+		writer.put(final ? 1 : 0, 1);
+		writer.put(2, 2);
+		writer.put(numLit - 257, 5);
+		writer.put(numDist - 1, 5);
+		writer.put(numCl - 4, 4);
+		for (unsigned i = 0; i < numCl; ++i) writer.put(clLengths[codeLengthOrder[i]], 3);
+		for (size_t i = 0; i < rle.size(); ++i)
+		{
+			unsigned symbol = rle[i] & 0xff, extra = rle[i] >> 8;
+			writer.put(clCodes[symbol], clLengths[symbol]);
+			if (symbol == 16) writer.put(extra, 2);
+			else if (symbol == 17) writer.put(extra, 3);
+			else if (symbol == 18) writer.put(extra, 7);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t t = tokens[i];
+			if (t & MATCH_FLAG)
+			{
+				unsigned length = (t >> 16) & 0x1ff, dist = t & 0xffff;
+				unsigned lc = lengthCode(length), dc = distCode(dist);
+				writer.put(litCodes[257 + lc], litLengths[257 + lc]);
+				writer.put(length - lengthBase[lc], lengthExtra[lc]);
+				writer.put(distCodes[dc], distLengths[dc]);
+				writer.put(dist - distBase[dc], distExtra[dc]);
+			}
+			else writer.put(litCodes[t], litLengths[t]);
+		}
+		writer.put(litCodes[END_OF_BLOCK], litLengths[END_OF_BLOCK]);
+	}
+
+	// raw deflate data of one chunk, ending byte aligned
+	void deflateChunk(const uint8_t* data, size_t size, bool final, std::vector<uint8_t>& out)
+	{
+		std::vector<uint32_t> tokens;
+		findMatches(data, size, tokens);
+		BitWriter writer(out);
+		for (size_t begin = 0; begin < tokens.size(); begin += BLOCK_TOKENS)
+		{
+			size_t count = std::min(BLOCK_TOKENS, tokens.size() - begin);
+			writeBlock(writer, &tokens[begin], count, final && begin + count == tokens.size());
+		}
+		if (!final)
+		{
+			// empty stored block, which aligns to a byte boundary
+			writer.put(0, 3);
+			writer.align();
+			out.push_back(0x00);
+			out.push_back(0x00);
+			out.push_back(0xff);
+			out.push_back(0xff);
+		}
+		writer.align();
+	}
+
+	// checksums
+
+	const uint32_t ADLER_BASE = 65521;
+
+	uint32_t adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t a = 1, b = 0;
+		while (size > 0)
+		{
+			size_t n = std::min<size_t>(size, 5552);
+			size -= n;
+			while (n--)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= ADLER_BASE;
+			b %= ADLER_BASE;
+		}
+		return (b << 16) | a;
+	}
+
+	// checksum of the concatenation, from the checksums of both parts (as adler32_combine in zlib)
+	uint32_t adler32Combine(uint32_t adler1, uint32_t adler2, size_t size2)
+	{
+		uint32_t rem = (uint32_t)(size2 % ADLER_BASE);
+		uint32_t sum1 = adler1 & 0xffff;
+		uint32_t sum2 = (rem * sum1) % ADLER_BASE;
+		sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+		sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + ADLER_BASE - rem;
+		if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+		if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+		if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+		if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+		return sum1 | (sum2 << 16);
+	}
+
+	uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		static uint32_t table[256];
+		static bool initialized = false;
+		if (!initialized)
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+			initialized = true;
+		}
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back((uint8_t)(value >> 24));
+		out.push_back((uint8_t)(value >> 16));
+		out.push_back((uint8_t)(value >> 8));
+		out.push_back((uint8_t)value);
+	}
+
+	// PNG
+
+	// one row as RGB(A), from BGRA
+	void convertRow(const ImageEncoder::Image& image, unsigned y, uint8_t* row)
+	{
+		const uint8_t* src = image.pixels + (size_t)y * image.pitch;
+		unsigned bpp = image.withAlpha ? 4 : 3;
+		for (unsigned x = 0; x < image.width; ++x, src += 4, row += bpp)
+		{
+			row[0] = src[2];
+			row[1] = src[1];
+			row[2] = src[0];
+			if (bpp == 4) row[3] = src[3];
+		}
+	}
+
+	uint8_t paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+		if (pa <= pb && pa <= pc) return (uint8_t)a;
+		if (pb <= pc) return (uint8_t)b;
+		return (uint8_t)c;
+	}
+
+	// filters the row with each PNG filter and keeps the one with the smallest sum of absolute values
+	void filterRow(const uint8_t* row, const uint8_t* prev, size_t size, unsigned bpp, uint8_t* out, std::vector<uint8_t>& scratch)
+	{
+		scratch.resize(size);
+		uint64_t bestCost = ~0ull;
+		for (uint8_t filter = 0; filter < 5; ++filter)
+		{
+			uint64_t cost = 0;
+			for (size_t i = 0; i < size; ++i)
+			{
+				int a = i >= bpp ? row[i - bpp] : 0;
+				int b = prev ? prev[i] : 0;
+				int c = (i >= bpp && prev) ? prev[i - bpp] : 0;
+				uint8_t predicted = 0;
+				switch (filter)
+				{
+				case 1: predicted = (uint8_t)a; break;
+				case 2: predicted = (uint8_t)b; break;
+				case 3: predicted = (uint8_t)((a + b) >> 1); break;
+				case 4: predicted = paeth(a, b, c); break;
+				}
+				uint8_t v = (uint8_t)(row[i] - predicted);
+				scratch[i] = v;
+				cost += v < 128 ? v : 256 - v;
+			}
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				out[0] = filter;
+				memcpy(out + 1, &scratch[0], size);
+			}
+		}
+	}
+
+	struct Chunk
+	{
+		unsigned firstRow, rows;
+		std::vector<uint8_t> deflated;
+		uint32_t adler;
+		size_t filteredSize;
+	};
+
+	void encodeChunk(const ImageEncoder::Image& image, Chunk& chunk, bool final)
+	{
+		unsigned bpp = image.withAlpha ? 4 : 3;
+		size_t rowSize = (size_t)image.width * bpp;
+		std::vector<uint8_t> filtered((rowSize + 1) * chunk.rows), prev(rowSize), row(rowSize), scratch;
+		if (chunk.firstRow > 0) convertRow(image, chunk.firstRow - 1, &prev[0]);
+		for (unsigned r = 0; r < chunk.rows; ++r)
+		{
+			unsigned y = chunk.firstRow + r;
+			convertRow(image, y, &row[0]);
+			filterRow(&row[0], y > 0 ? &prev[0] : NULL, rowSize, bpp, &filtered[r * (rowSize + 1)], scratch);
+			row.swap(prev);
+		}
+		chunk.filteredSize = filtered.size();
+		chunk.adler = adler32(&filtered[0], filtered.size());
+		deflateChunk(&filtered[0], filtered.size(), final, chunk.deflated);
+	}
+
+	void writePngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+	{
+		putBigEndian(out, (uint32_t)size);
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		if (size) out.insert(out.end(), data, data + size);
+		putBigEndian(out, crc32(&out[start], size + 4));
+	}
+}
+
+void ImageEncoder::encodePng(const Image& image, unsigned threads, std::vector<uint8_t>& out)
+{
+	if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// a few chunks per thread to even out the load, but not so small that compression suffers
+	unsigned bpp = image.withAlpha ? 4 : 3;
+	size_t rowSize = (size_t)image.width * bpp + 1;
+	unsigned minRows = (unsigned)std::max<size_t>(1, (256 * 1024) / rowSize);
+	unsigned rowsPerChunk = std::max(minRows, (image.height + threads * 4 - 1) / (threads * 4));
+	std::vector<Chunk> chunks;
+	for (unsigned y = 0; y < image.height; y += rowsPerChunk)
+	{
+		Chunk chunk;
+		chunk.firstRow = y;
+		chunk.rows = std::min(rowsPerChunk, image.height - y);
+		chunk.adler = 1;
+		chunk.filteredSize = 0;
+		chunks.push_back(chunk);
+	}
+
+	std::atomic<unsigned> next(0);
+	auto worker = [&]()
+	{
+		for (unsigned i = next++; i < chunks.size(); i = next++) encodeChunk(image, chunks[i], i + 1 == chunks.size());
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < std::min<size_t>(threads, chunks.size()); ++t) pool.push_back(std::thread(worker));
+	worker();
+	for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+
+	std::vector<uint8_t> zlib;
+	size_t total = 2 + 4;
+	for (size_t i = 0; i < chunks.size(); ++i) total += chunks[i].deflated.size();
+	zlib.reserve(total);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	uint32_t adler = 1;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		zlib.insert(zlib.end(), chunks[i].deflated.begin(), chunks[i].deflated.end());
+		adler = adler32Combine(adler, chunks[i].adler, chunks[i].filteredSize);
+	}
+	putBigEndian(zlib, adler);
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	out.clear();
+	out.reserve(zlib.size() + 64);
+	out.insert(out.end(), signature, signature + 8);
+	std::vector<uint8_t> header;
+	putBigEndian(header, image.width);
+	putBigEndian(header, image.height);
+	header.push_back(8); // bit depth
+	header.push_back(image.withAlpha ? 6 : 2); // RGBA or RGB
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	writePngChunk(out, "IHDR", &header[0], header.size());
+	writePngChunk(out, "IDAT", &zlib[0], zlib.size());
+	writePngChunk(out, "IEND", NULL, 0);
+}
+
+void ImageEncoder::encodeQoi(const Image& image, std::vector<uint8_t>& out)
+{
+	out.clear();
+	out.reserve((size_t)image.width * image.height * 2 + 22);
+	out.push_back('q');
+	out.push_back('o');
+	out.push_back('i');
+	out.push_back('f');
+	putBigEndian(out, image.width);
+	putBigEndian(out, image.height);
+	out.push_back(image.withAlpha ? 4 : 3);
+	out.push_back(0); // sRGB
+
+	uint8_t seen[64][4] = {};
+	uint8_t pr = 0, pg = 0, pb = 0, pa = 255;
+	unsigned run = 0;
+	for (unsigned y = 0; y < image.height; ++y)
+	{
+		const uint8_t* src = image.pixels + (size_t)y * image.pitch;
+		for (unsigned x = 0; x < image.width; ++x, src += 4)
+		{
+			uint8_t r = src[2], g = src[1], b = src[0], a = image.withAlpha ? src[3] : 255;
+			if (r == pr && g == pg && b == pb && a == pa)
+			{
+				if (++run == 62)
+				{
+					out.push_back((uint8_t)(0xc0 | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				out.push_back((uint8_t)(0xc0 | (run - 1)));
+				run = 0;
+			}
+			unsigned index = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+			if (seen[index][0] == r && seen[index][1] == g && seen[index][2] == b && seen[index][3] == a)
+			{
+				out.push_back((uint8_t)index);
+			}
+			else
+			{
+				seen[index][0] = r;
+				seen[index][1] = g;
+				seen[index][2] = b;
+				seen[index][3] = a;
+				if (a == pa)
+				{
+					int dr = (int8_t)(r - pr), dg = (int8_t)(g - pg), db = (int8_t)(b - pb);
+					int dgr = dr - dg, dgb = db - dg;
+					if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					{
+						out.push_back((uint8_t)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+					}
+					else if (dgr >= -8 && dgr <= 7 && dg >= -32 && dg <= 31 && dgb >= -8 && dgb <= 7)
+					{
+						out.push_back((uint8_t)(0x80 | (dg + 32)));
+						out.push_back((uint8_t)(((dgr + 8) << 4) | (dgb + 8)));
+					}
+					else
+					{
+						out.push_back(0xfe);
+						out.push_back(r);
+						out.push_back(g);
+						out.push_back(b);
+					}
+				}
+				else
+				{
+					out.push_back(0xff);
+					out.push_back(r);
+					out.push_back(g);
+					out.push_back(b);
+					out.push_back(a);
+				}
+			}
+			pr = r;
+			pg = g;
+			pb = b;
+			pa = a;
+		}
+	}
+	if (run > 0) out.push_back((uint8_t)(0xc0 | (run - 1)));
+	static const uint8_t padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	out.insert(out.end(), padding, padding + 8);
+}
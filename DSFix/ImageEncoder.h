@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Fast lossless image encoders for screenshots and dumps, independent of Direct3D and Windows
+// (see bench/ImageEncoderBench.cpp for timings)
+// PNG: rows are filtered and deflated in independent chunks on several threads; each chunk is byte aligned
+// with an empty stored block, so the chunks concatenate into one zlib stream. Matches can not reach into the
+// previous chunk, which costs a little compression.
+// QOI: single pass, several times faster than PNG, with somewhat larger files
+class ImageEncoder
+{
+public:
+	// rows of 32 bit BGRA pixels, as locked from a D3DFMT_A8R8G8B8 or D3DFMT_X8R8G8B8 surface, pitch bytes apart
+	// alpha is only written with withAlpha
+	struct Image
+	{
+		const uint8_t* pixels;
+		unsigned width, height, pitch;
+		bool withAlpha;
+	};
+
+	// threads 0 uses all hardware threads
+	static void encodePng(const Image& image, unsigned threads, std::vector<uint8_t>& out);
+	static void encodeQoi(const Image& image, std::vector<uint8_t>& out);
+};
@@ -0,0 +1,146 @@
+
+#include "ImageWriter.h"
+
+#include "ImageEncoder.h"
+
+ImageWriter ImageWriter::instance;
+
+std::unique_ptr<ImageWriter::Image> ImageWriter::Image::fromLocked(const D3DLOCKED_RECT& rect, unsigned width, unsigned height, bool withAlpha)
+{
+	std::unique_ptr<Image> image(new Image);
+	image->assignLocked(rect, width, height, withAlpha);
+	return image;
+}
+
+void ImageWriter::Image::assignLocked(const D3DLOCKED_RECT& rect, unsigned width, unsigned height, bool withAlpha)
+{
+	this->width = width;
+	this->height = height;
+	this->withAlpha = withAlpha;
+	pitch = width * 4;
+	pixels.resize(pitch * height);
+	for (unsigned y = 0; y < height; ++y)
+	{
+		memcpy(&pixels[y * pitch], (const BYTE*)rect.pBits + y * rect.Pitch, pitch);
+	}
+}
+
+ImageWriter::ImageWriter() : thread(NULL), written(0), failed(0)
+{
+	InitializeCriticalSection(&lock);
+	InitializeConditionVariable(&queued);
+	InitializeConditionVariable(&taken);
+}
+
+bool ImageWriter::write(std::unique_ptr<Image> image, bool wait)
+{
+	EnterCriticalSection(&lock);
+	if (!thread) thread = CreateThread(NULL, 0, workerThread, this, 0, NULL);
+	while (wait && queue.size() >= MAX_QUEUED) SleepConditionVariableCS(&taken, &lock, INFINITE);
+	bool accepted = queue.size() < MAX_QUEUED;
+	if (accepted)
+	{
+		queue.push_back(std::move(image));
+		WakeConditionVariable(&queued);
+	}
+	LeaveCriticalSection(&lock);
+	if (!accepted) SDLOG(0, "ImageWriter: queue full, dropped %s", image->filename.c_str());
+	return accepted;
+}
+
+void ImageWriter::writeAll(std::vector<std::unique_ptr<Image> >& images)
+{
+	EnterCriticalSection(&lock);
+	if (!thread) thread = CreateThread(NULL, 0, workerThread, this, 0, NULL);
+	for (size_t i = 0; i < images.size(); ++i) queue.push_back(std::move(images[i]));
+	WakeConditionVariable(&queued);
+	LeaveCriticalSection(&lock);
+	images.clear();
+}
+
+DWORD WINAPI ImageWriter::workerThread(LPVOID param)
+{
+	static_cast<ImageWriter*>(param)->work();
+	return 0;
+}
+
+void ImageWriter::work()
+{
+	for (;;)
+	{
+		EnterCriticalSection(&lock);
+		while (queue.empty()) SleepConditionVariableCS(&queued, &lock, INFINITE);
+		std::unique_ptr<Image> image = std::move(queue.front());
+		queue.pop_front();
+		WakeConditionVariable(&taken);
+		LeaveCriticalSection(&lock);
+
+		LARGE_INTEGER start, end, frequency;
+		QueryPerformanceCounter(&start);
+		size_t encodedSize = 0;
+		bool ok = writeFile(*image, encodedSize);
+		QueryPerformanceCounter(&end);
+		QueryPerformanceFrequency(&frequency);
+		if (ok) ++written;
+		else ++failed;
+		double ms = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+		size_t rawSize = (size_t)image->width * image->height * (image->withAlpha ? 4 : 3);
+		SDLOG(0, "ImageWriter: %s %s (%ux%u) in %.1f ms, %.1f MB/s, %.1f%% of raw, %u written, %u failed", ok ? "wrote" : "FAILED to write",
+			image->filename.c_str(), image->width, image->height, ms, rawSize / (ms * 1000.0), 100.0 * encodedSize / rawSize, written, failed);
+	}
+}
+
+bool ImageWriter::writeFile(const Image& image, size_t& encodedSize)
+{
+	ImageEncoder::Image source = { &image.pixels[0], image.width, image.height, image.pitch, image.withAlpha };
+	std::vector<uint8_t> encoded;
+	size_t dot = image.filename.rfind('.');
+	if (dot != std::string::npos && _stricmp(image.filename.c_str() + dot, ".qoi") == 0) ImageEncoder::encodeQoi(source, encoded);
+	else ImageEncoder::encodePng(source, 0, encoded);
+	encodedSize = encoded.size();
+
+	FILE* file = NULL;
+	if (fopen_s(&file, image.filename.c_str(), "wb") != 0 || !file) return false;
+	bool ok = fwrite(&encoded[0], 1, encoded.size(), file) == encoded.size();
+	return fclose(file) == 0 && ok;
+}
+
+bool ImageWriter::writeSurface(IDirect3DSurface9* surface, const std::string& filename, bool withAlpha)
+{
+	D3DSURFACE_DESC desc;
+	CComPtr<IDirect3DDevice9> device;
+	if (FAILED(surface->GetDesc(&desc)) || FAILED(surface->GetDevice(&device))) return false;
+
+	// render targets can not be locked, so they are read back first
+	CComPtr<IDirect3DSurface9> source = surface;
+	if (desc.Usage & D3DUSAGE_RENDERTARGET)
+	{
+		source = nullptr;
+		if (FAILED(device->CreateOffscreenPlainSurface(desc.Width, desc.Height, desc.Format, D3DPOOL_SYSTEMMEM, &source, NULL))
+			|| FAILED(device->GetRenderTargetData(surface, source)))
+		{
+			SDLOG(0, "ImageWriter: could not read back %s", filename.c_str());
+			return false;
+		}
+	}
+	// everything else (including compressed textures) is converted by D3DX
+	CComPtr<IDirect3DSurface9> converted = source;
+	if (desc.Format != D3DFMT_A8R8G8B8 && desc.Format != D3DFMT_X8R8G8B8)
+	{
+		converted = nullptr;
+		if (FAILED(device->CreateOffscreenPlainSurface(desc.Width, desc.Height, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &converted, NULL))
+			|| FAILED(D3DXLoadSurfaceFromSurface(converted, NULL, NULL, source, NULL, NULL, D3DX_FILTER_NONE, 0)))
+		{
+			SDLOG(0, "ImageWriter: could not convert %s from format %d", filename.c_str(), desc.Format);
+			return false;
+		}
+	}
+	withAlpha = withAlpha && desc.Format != D3DFMT_X8R8G8B8;
+
+	D3DLOCKED_RECT rect;
+	if (FAILED(converted->LockRect(&rect, NULL, D3DLOCK_READONLY))) return false;
+	std::unique_ptr<Image> image = Image::fromLocked(rect, desc.Width, desc.Height, withAlpha);
+	image->filename = filename;
+	converted->UnlockRect();
+	return write(std::move(image), true);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "main.h"
+
+// Encodes and writes images on a background thread, so that the render thread only has to hand over the pixels
+// The worker is started with the first image and keeps running until the process exits
+// Files ending in .qoi are written as QOI, everything else as PNG (see ImageEncoder)
+class ImageWriter
+{
+public:
+	// 32 bit BGRA pixels, as locked from a D3DFMT_X8R8G8B8 or D3DFMT_A8R8G8B8 surface (alpha is only written with withAlpha)
+	struct Image
+	{
+		std::string filename;
+		unsigned width, height, pitch;
+		bool withAlpha;
+		std::vector<BYTE> pixels;
+
+		Image() : width(0), height(0), pitch(0), withAlpha(false) { }
+
+		// copies the top left width x height pixels of a locked 32 bit surface, the filename is left to the caller
+		static std::unique_ptr<Image> fromLocked(const D3DLOCKED_RECT& rect, unsigned width, unsigned height, bool withAlpha);
+		// the same into this image, reusing its pixel memory
+		void assignLocked(const D3DLOCKED_RECT& rect, unsigned width, unsigned height, bool withAlpha);
+	};
+
+private:
+	static ImageWriter instance;
+	// images waiting to be written, beyond this new ones are dropped rather than piling up in memory
+	static const unsigned MAX_QUEUED = 16;
+
+	std::deque<std::unique_ptr<Image> > queue;
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE queued, taken;
+	HANDLE thread;
+	unsigned written, failed;
+
+	static DWORD WINAPI workerThread(LPVOID param);
+	void work();
+	bool writeFile(const Image& image, size_t& encodedSize);
+
+public:
+	static ImageWriter& get()
+	{
+		return instance;
+	}
+
+	ImageWriter();
+
+	// queues the image for writing, returns false if the queue is full and it was dropped
+	// with wait, blocks until there is room instead (for dumps, which must not lose images)
+	bool write(std::unique_ptr<Image> image, bool wait = false);
+	// queues all images regardless of the limit, for batches which are already in memory anyway (frame captures)
+	void writeAll(std::vector<std::unique_ptr<Image> >& images);
+	// copies any render target or texture surface to memory right away (this stalls until the GPU is done with it),
+	// converting it to 32 bit, and queues it; for dumps, screenshots should go through the ScreenshotManager
+	bool writeSurface(IDirect3DSurface9* surface, const std::string& filename, bool withAlpha);
+};
@@ -0,0 +1,195 @@
+
+#include "InstantReplay.h"
+
+#include <time.h>
+
+#include "main.h"
+#include "Settings.h"
+
+InstantReplay InstantReplay::instance;
+
+InstantReplay::InstantReplay()
+	: nextCopy(0), nextStaging(0), nextEntry(0), width(0), height(0), frame(0), stride(1), budget(0.0), costSum(0.0), costMax(0.0),
+	costNext(0), costCount(0), framesSinceLog(0), device(NULL), enabled(false)
+{
+	for (unsigned i = 0; i < NUM_COPIES; ++i) copies[i].pending = false;
+	for (unsigned i = 0; i < NUM_STAGING; ++i) staging[i].pending = false;
+}
+
+void InstantReplay::init(IDirect3DDevice9* pDevice)
+{
+	device = pDevice;
+	unsigned frames = Settings::get().getInstantReplayFrames();
+	if (frames == 0) return;
+
+	CComPtr<IDirect3DSurface9> backBuffer;
+	D3DSURFACE_DESC desc;
+	if (FAILED(device->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &backBuffer)) || FAILED(backBuffer->GetDesc(&desc))) return;
+	height = std::min(desc.Height, Settings::get().getInstantReplayHeight());
+	width = desc.Width * height / desc.Height;
+	budget = Settings::get().getInstantReplayBudget();
+
+	for (unsigned i = 0; i < NUM_COPIES; ++i)
+	{
+		copies[i].pending = false;
+		if (FAILED(device->CreateRenderTarget(width, height, D3DFMT_X8R8G8B8, D3DMULTISAMPLE_NONE, 0, false, &copies[i].surface, NULL)))
+		{
+			SDLOG(0, "InstantReplay: could not create %ux%u render targets, disabled", width, height);
+			release();
+			return;
+		}
+	}
+	for (unsigned i = 0; i < NUM_STAGING; ++i)
+	{
+		staging[i].pending = false;
+		if (FAILED(device->CreateOffscreenPlainSurface(width, height, D3DFMT_X8R8G8B8, D3DPOOL_SYSTEMMEM, &staging[i].surface, NULL)))
+		{
+			SDLOG(0, "InstantReplay: could not create %ux%u system memory surfaces, disabled", width, height);
+			release();
+			return;
+		}
+	}
+	ring.resize(frames);
+	nextCopy = nextStaging = nextEntry = 0;
+	stride = 1;
+	costSum = costMax = 0.0;
+	costNext = costCount = framesSinceLog = 0;
+	enabled = true;
+	SDLOG(0, "InstantReplay: keeping the last %u frames at %ux%u, budget %.2f ms per frame", ring.size(), width, height, budget);
+}
+
+void InstantReplay::release()
+{
+	for (unsigned i = 0; i < NUM_COPIES; ++i)
+	{
+		copies[i].surface = nullptr;
+		copies[i].pending = false;
+	}
+	for (unsigned i = 0; i < NUM_STAGING; ++i)
+	{
+		staging[i].surface = nullptr;
+		staging[i].pending = false;
+	}
+	ring.clear();
+	enabled = false;
+	device = NULL;
+}
+
+void InstantReplay::endFrame()
+{
+	if (!enabled) return;
+	LARGE_INTEGER start, end, frequency;
+	QueryPerformanceCounter(&start);
+	record();
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	addCost((end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+	++frame;
+}
+
+void InstantReplay::record()
+{
+	if (frame % stride != 0) return;
+	// the copy made NUM_COPIES recorded frames ago should be done by now
+	Copy& copy = copies[nextCopy];
+	nextCopy = (nextCopy + 1) % NUM_COPIES;
+	if (copy.pending) readBack(copy);
+
+	CComPtr<IDirect3DSurface9> backBuffer;
+	if (FAILED(device->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &backBuffer))) return;
+	copy.pending = SUCCEEDED(device->StretchRect(backBuffer, NULL, copy.surface, NULL, D3DTEXF_LINEAR));
+	copy.frame = frame;
+}
+
+void InstantReplay::readBack(Copy& copy)
+{
+	copy.pending = false;
+	// the readback issued into this surface a recorded frame ago should be done by now
+	Copy& readback = staging[nextStaging];
+	nextStaging = (nextStaging + 1) % NUM_STAGING;
+	if (readback.pending) store(readback);
+	readback.pending = SUCCEEDED(device->GetRenderTargetData(copy.surface, readback.surface));
+	readback.frame = copy.frame;
+}
+
+void InstantReplay::store(Copy& readback)
+{
+	readback.pending = false;
+	D3DLOCKED_RECT rect;
+	if (FAILED(readback.surface->LockRect(&rect, NULL, D3DLOCK_READONLY))) return;
+	Entry& entry = ring[nextEntry];
+	if (!entry.image) entry.image.reset(new ImageWriter::Image);
+	entry.image->assignLocked(rect, width, height, false);
+	readback.surface->UnlockRect();
+	entry.frame = readback.frame;
+	nextEntry = (nextEntry + 1) % ring.size();
+}
+
+void InstantReplay::addCost(double ms)
+{
+	if (costCount == WINDOW) costSum -= costs[costNext];
+	else ++costCount;
+	costs[costNext] = ms;
+	costSum += ms;
+	costMax = std::max(costMax, ms);
+	costNext = (costNext + 1) % WINDOW;
+
+	// skipped frames count as free, so a larger stride lowers the average
+	if (costNext == 0 && costCount == WINDOW)
+	{
+		double average = costSum / WINDOW;
+		if (average > budget)
+		{
+			++stride;
+			SDLOG(0, "InstantReplay: %.3f ms per frame is over the budget, recording every %u frames", average, stride);
+		}
+		else if (stride > 1 && average * stride / (stride - 1) < budget * 0.5)
+		{
+			--stride;
+			SDLOG(2, "InstantReplay: %.3f ms per frame, recording every %u frames", average, stride);
+		}
+	}
+	if (++framesSinceLog >= LOG_INTERVAL)
+	{
+		SDLOG(0, "InstantReplay: %.3f ms per frame on average, %.3f max, recording every %u frames", costSum / costCount, costMax, stride);
+		framesSinceLog = 0;
+		costMax = 0.0;
+	}
+}
+
+void InstantReplay::flush()
+{
+	if (!enabled)
+	{
+		SDLOG(0, "InstantReplay: not enabled (instantReplayFrames 0), nothing to flush");
+		return;
+	}
+
+	char timebuf[128];
+	time_t ltime;
+	time(&ltime);
+	struct tm timeinfo;
+	localtime_s(&timeinfo, &ltime);
+	strftime(timebuf, 128, "replay_%Y-%m-%d_%H-%M-%S", &timeinfo);
+	std::string directory = Settings::get().getScreenshotDir() + "\\" + timebuf;
+	if (!CreateDirectory(directory.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		SDLOG(0, "InstantReplay: could not create %s", directory.c_str());
+		return;
+	}
+	const char* extension = Settings::get().getScreenshotFormat() == "qoi" ? "qoi" : "png";
+
+	// oldest first; the images are handed over rather than copied, the ring allocates new ones as it fills again
+	std::vector<std::unique_ptr<ImageWriter::Image> > images;
+	for (size_t i = 0; i < ring.size(); ++i)
+	{
+		Entry& entry = ring[(nextEntry + i) % ring.size()];
+		if (!entry.image) continue;
+		char filename[64];
+		sprintf_s(filename, "\\%03u_frame%u.%s", images.size(), entry.frame, extension);
+		entry.image->filename = directory + filename;
+		images.push_back(std::move(entry.image));
+	}
+	SDLOG(0, "InstantReplay: flushing %u frames to %s", images.size(), directory.c_str());
+	ImageWriter::get().writeAll(images);
+}
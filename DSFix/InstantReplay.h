@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "d3d9.h"
+#include "ImageWriter.h"
+
+// Keeps the last instantReplayFrames final frames (with HUD), downscaled to instantReplayHeight, in system memory,
+// so that a glitch can still be saved after it was noticed (the flushInstantReplay action)
+// Each frame is copied on the GPU into one of a few render targets and read back NUM_COPIES - 1 frames later, when
+// the GPU is done with it, into a staging surface, whose pixels go into the ring of images another recorded frame later.
+// The CPU time this takes is measured every frame; while its average exceeds instantReplayBudget ms, only every
+// second, third, ... frame is recorded. A flush hands the images over to the ImageWriter as they are.
+class InstantReplay
+{
+	static InstantReplay instance;
+
+	// render targets the frames are copied to, a frame is read back when its copy comes around again
+	static const unsigned NUM_COPIES = 3;
+	// system memory surfaces the frames are read back to, a readback is stored in the ring when its surface comes around again
+	static const unsigned NUM_STAGING = 2;
+	// frames in the cost average, and frames between log outputs
+	static const unsigned WINDOW = 60;
+	static const unsigned LOG_INTERVAL = 600;
+
+	struct Copy
+	{
+		CComPtr<IDirect3DSurface9> surface;
+		bool pending;
+		unsigned frame;
+	};
+	Copy copies[NUM_COPIES];
+	unsigned nextCopy;
+	Copy staging[NUM_STAGING];
+	unsigned nextStaging;
+
+	struct Entry
+	{
+		std::unique_ptr<ImageWriter::Image> image; // NULL if empty, allocated on first use and after a flush
+		unsigned frame;
+	};
+	std::vector<Entry> ring;
+	unsigned nextEntry;
+
+	UINT width, height;
+	unsigned frame;
+	// only every stride-th frame is recorded, adjusted to stay within the budget
+	unsigned stride;
+	double budget;
+	double costs[WINDOW];
+	double costSum, costMax;
+	unsigned costNext, costCount, framesSinceLog;
+
+	IDirect3DDevice9* device;
+	bool enabled;
+
+	void record();
+	void readBack(Copy& copy);
+	void store(Copy& readback);
+	void addCost(double ms);
+
+public:
+	static InstantReplay& get()
+	{
+		return instance;
+	}
+
+	InstantReplay();
+
+	// call with the other device resources; allocates the ring if enabled in the settings
+	void init(IDirect3DDevice9* pDevice);
+	void release();
+
+	// copies the back buffer, call on Present before presenting
+	void endFrame();
+	// writes all frames in the ring to a new directory, on the ImageWriter thread; the ring starts out empty again
+	void flush();
+};
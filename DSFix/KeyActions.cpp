@@ -13,6 +13,12 @@
 #include "SaveManager.h"
 #include "Settings.h"
 #include "RenderstateManager.h"
+#include "CallTrace.h"
+#include "TraceReplayer.h"
+#include "HookBenchmark.h"
+#include "RSManagerTarget.h"
+#include "GpuProfiler.h"
+#include "InstantReplay.h"
 
 KeyActions KeyActions::instance;
 
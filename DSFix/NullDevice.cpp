@@ -0,0 +1,1530 @@
+
+#include "NullDevice.h"
+
+#include <type_traits>
+
+#include "main.h"
+
+// bits per pixel of the formats we may encounter, for the memory statistics
+static UINT formatBits(D3DFORMAT format)
+{
+	switch (format)
+	{
+	case D3DFMT_DXT1:
+		return 4;
+	case D3DFMT_A8: case D3DFMT_L8: case D3DFMT_P8: case D3DFMT_DXT2: case D3DFMT_DXT3: case D3DFMT_DXT4: case D3DFMT_DXT5:
+		return 8;
+	case D3DFMT_R5G6B5: case D3DFMT_X1R5G5B5: case D3DFMT_A1R5G5B5: case D3DFMT_A4R4G4B4: case D3DFMT_A8L8: case D3DFMT_L16:
+	case D3DFMT_R16F: case D3DFMT_D16: case D3DFMT_D16_LOCKABLE: case D3DFMT_D15S1:
+		return 16;
+	case D3DFMT_A16B16G16R16: case D3DFMT_A16B16G16R16F: case D3DFMT_G32R32F:
+		return 64;
+	case D3DFMT_A32B32G32R32F:
+		return 128;
+	default:
+		return 32;
+	}
+}
+
+// bytes per 4x4 block of the block compressed formats, 0 for the others
+static UINT blockBytes(D3DFORMAT format)
+{
+	switch (format)
+	{
+	case D3DFMT_DXT1:
+		return 8;
+	case D3DFMT_DXT2: case D3DFMT_DXT3: case D3DFMT_DXT4: case D3DFMT_DXT5:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+// NullSurface ////////////////////////////////////////////////////////////////
+
+NullSurface::NullSurface(NullDevice* device, IDirect3DBaseTexture9* container, UINT width, UINT height, D3DFORMAT format, DWORD usage, D3DPOOL pool, D3DMULTISAMPLE_TYPE multiSample)
+	: refCount(1), device(device), container(container)
+{
+	desc.Format = format;
+	desc.Type = D3DRTYPE_SURFACE;
+	desc.Usage = usage;
+	desc.Pool = pool;
+	desc.MultiSampleType = multiSample;
+	desc.MultiSampleQuality = 0;
+	desc.Width = width;
+	desc.Height = height;
+	// texture levels are accounted for by their texture
+	if (!container) device->resourceCreated(getSize());
+}
+
+NullSurface::~NullSurface()
+{
+	if (!container) device->resourceDestroyed(getSize());
+}
+
+UINT NullSurface::getSize() const
+{
+	UINT samples = desc.MultiSampleType >= D3DMULTISAMPLE_2_SAMPLES ? desc.MultiSampleType : 1;
+	return desc.Width * desc.Height * formatBits(desc.Format) / 8 * samples;
+}
+
+UINT NullSurface::getPitch() const
+{
+	if (UINT bytes = blockBytes(desc.Format)) return std::max((desc.Width + 3) / 4, 1u) * bytes;
+	return desc.Width * formatBits(desc.Format) / 8;
+}
+
+UINT NullSurface::getRows() const
+{
+	if (blockBytes(desc.Format)) return std::max((desc.Height + 3) / 4, 1u);
+	return desc.Height;
+}
+
+HRESULT APIENTRY NullSurface::QueryInterface(REFIID riid, void** ppvObj)
+{
+	if (!ppvObj) return E_POINTER;
+	if (riid == IID_IUnknown || riid == IID_IDirect3DResource9 || riid == IID_IDirect3DSurface9)
+	{
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
+	*ppvObj = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG APIENTRY NullSurface::AddRef()
+{
+	// texture levels live as long as their texture
+	if (container) return container->AddRef();
+	return ++refCount;
+}
+
+ULONG APIENTRY NullSurface::Release()
+{
+	if (container) return container->Release();
+	ULONG count = --refCount;
+	if (count == 0) delete this;
+	return count;
+}
+
+HRESULT APIENTRY NullSurface::GetDevice(IDirect3DDevice9** ppDevice)
+{
+	if (!ppDevice) return D3DERR_INVALIDCALL;
+	*ppDevice = (IDirect3DDevice9*)device;
+	(*ppDevice)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullSurface::SetPrivateData(REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags)
+{
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullSurface::GetPrivateData(REFGUID refguid, void* pData, DWORD* pSizeOfData)
+{
+	return D3DERR_NOTFOUND;
+}
+
+HRESULT APIENTRY NullSurface::FreePrivateData(REFGUID refguid)
+{
+	return D3DERR_NOTFOUND;
+}
+
+DWORD APIENTRY NullSurface::SetPriority(DWORD PriorityNew)
+{
+	return 0;
+}
+
+DWORD APIENTRY NullSurface::GetPriority()
+{
+	return 0;
+}
+
+void APIENTRY NullSurface::PreLoad()
+{
+}
+
+D3DRESOURCETYPE APIENTRY NullSurface::GetType()
+{
+	return D3DRTYPE_SURFACE;
+}
+
+HRESULT APIENTRY NullSurface::GetContainer(REFIID riid, void** ppContainer)
+{
+	if (!ppContainer) return D3DERR_INVALIDCALL;
+	if (container) return container->QueryInterface(riid, ppContainer);
+	return ((IDirect3DDevice9*)device)->QueryInterface(riid, ppContainer);
+}
+
+HRESULT APIENTRY NullSurface::GetDesc(D3DSURFACE_DESC *pDesc)
+{
+	if (!pDesc) return D3DERR_INVALIDCALL;
+	*pDesc = desc;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullSurface::LockRect(D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
+{
+	if (!pLockedRect) return D3DERR_INVALIDCALL;
+	UINT pitch = getPitch();
+	if (memory.empty()) memory.resize((size_t)pitch * getRows());
+	size_t offset = 0;
+	if (pRect)
+	{
+		if (UINT bytes = blockBytes(desc.Format)) offset = (size_t)(pRect->top / 4) * pitch + (pRect->left / 4) * bytes;
+		else offset = (size_t)pRect->top * pitch + pRect->left * formatBits(desc.Format) / 8;
+	}
+	if (offset >= memory.size()) return D3DERR_INVALIDCALL;
+	pLockedRect->Pitch = pitch;
+	pLockedRect->pBits = &memory[offset];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullSurface::UnlockRect()
+{
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullSurface::GetDC(HDC *phdc)
+{
+	return D3DERR_INVALIDCALL;
+}
+
+HRESULT APIENTRY NullSurface::ReleaseDC(HDC hdc)
+{
+	return D3DERR_INVALIDCALL;
+}
+
+// NullTexture ////////////////////////////////////////////////////////////////
+
+NullTexture::NullTexture(NullDevice* device, UINT width, UINT height, UINT numLevels, DWORD usage, D3DFORMAT format, D3DPOOL pool)
+	: refCount(1), device(device), size(0)
+{
+	// 0 levels means a full mip chain
+	for (UINT level = 0; numLevels == 0 || level < numLevels; ++level)
+	{
+		UINT w = std::max(width >> level, 1u), h = std::max(height >> level, 1u);
+		levels.push_back(new NullSurface(device, this, w, h, format, usage, pool, D3DMULTISAMPLE_NONE));
+		size += levels.back()->getSize();
+		if (w == 1 && h == 1) break;
+	}
+	device->resourceCreated(size);
+}
+
+NullTexture::~NullTexture()
+{
+	for (size_t i = 0; i < levels.size(); ++i) delete levels[i];
+	device->resourceDestroyed(size);
+}
+
+HRESULT APIENTRY NullTexture::QueryInterface(REFIID riid, void** ppvObj)
+{
+	if (!ppvObj) return E_POINTER;
+	if (riid == IID_IUnknown || riid == IID_IDirect3DResource9 || riid == IID_IDirect3DBaseTexture9 || riid == IID_IDirect3DTexture9)
+	{
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
+	*ppvObj = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG APIENTRY NullTexture::AddRef()
+{
+	return ++refCount;
+}
+
+ULONG APIENTRY NullTexture::Release()
+{
+	ULONG count = --refCount;
+	if (count == 0) delete this;
+	return count;
+}
+
+HRESULT APIENTRY NullTexture::GetDevice(IDirect3DDevice9** ppDevice)
+{
+	if (!ppDevice) return D3DERR_INVALIDCALL;
+	*ppDevice = (IDirect3DDevice9*)device;
+	(*ppDevice)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullTexture::SetPrivateData(REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags)
+{
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullTexture::GetPrivateData(REFGUID refguid, void* pData, DWORD* pSizeOfData)
+{
+	return D3DERR_NOTFOUND;
+}
+
+HRESULT APIENTRY NullTexture::FreePrivateData(REFGUID refguid)
+{
+	return D3DERR_NOTFOUND;
+}
+
+DWORD APIENTRY NullTexture::SetPriority(DWORD PriorityNew)
+{
+	return 0;
+}
+
+DWORD APIENTRY NullTexture::GetPriority()
+{
+	return 0;
+}
+
+void APIENTRY NullTexture::PreLoad()
+{
+}
+
+D3DRESOURCETYPE APIENTRY NullTexture::GetType()
+{
+	return D3DRTYPE_TEXTURE;
+}
+
+DWORD APIENTRY NullTexture::SetLOD(DWORD LODNew)
+{
+	return 0;
+}
+
+DWORD APIENTRY NullTexture::GetLOD()
+{
+	return 0;
+}
+
+DWORD APIENTRY NullTexture::GetLevelCount()
+{
+	return levels.size();
+}
+
+HRESULT APIENTRY NullTexture::SetAutoGenFilterType(D3DTEXTUREFILTERTYPE FilterType)
+{
+	return D3D_OK;
+}
+
+D3DTEXTUREFILTERTYPE APIENTRY NullTexture::GetAutoGenFilterType()
+{
+	return D3DTEXF_LINEAR;
+}
+
+void APIENTRY NullTexture::GenerateMipSubLevels()
+{
+}
+
+HRESULT APIENTRY NullTexture::GetLevelDesc(UINT Level, D3DSURFACE_DESC *pDesc)
+{
+	if (Level >= levels.size()) return D3DERR_INVALIDCALL;
+	return levels[Level]->GetDesc(pDesc);
+}
+
+HRESULT APIENTRY NullTexture::GetSurfaceLevel(UINT Level, IDirect3DSurface9** ppSurfaceLevel)
+{
+	if (Level >= levels.size() || !ppSurfaceLevel) return D3DERR_INVALIDCALL;
+	*ppSurfaceLevel = levels[Level];
+	(*ppSurfaceLevel)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullTexture::LockRect(UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags)
+{
+	if (Level >= levels.size()) return D3DERR_INVALIDCALL;
+	return levels[Level]->LockRect(pLockedRect, pRect, Flags);
+}
+
+HRESULT APIENTRY NullTexture::UnlockRect(UINT Level)
+{
+	if (Level >= levels.size()) return D3DERR_INVALIDCALL;
+	return levels[Level]->UnlockRect();
+}
+
+HRESULT APIENTRY NullTexture::AddDirtyRect(CONST RECT* pDirtyRect)
+{
+	return D3D_OK;
+}
+
+// NullObject /////////////////////////////////////////////////////////////////
+
+template <class Interface>
+NullObject<Interface>::NullObject(NullDevice* device, REFIID iid, UINT size)
+	: refCount(1), iid(iid), size(size), device(device)
+{
+	device->resourceCreated(size);
+}
+
+template <class Interface>
+NullObject<Interface>::~NullObject()
+{
+	device->resourceDestroyed(size);
+}
+
+template <class Interface>
+HRESULT APIENTRY NullObject<Interface>::QueryInterface(REFIID riid, void** ppvObj)
+{
+	if (!ppvObj) return E_POINTER;
+	if (riid == IID_IUnknown || riid == iid || (std::is_base_of<IDirect3DResource9, Interface>::value && riid == IID_IDirect3DResource9))
+	{
+		*ppvObj = static_cast<Interface*>(this);
+		AddRef();
+		return S_OK;
+	}
+	*ppvObj = NULL;
+	return E_NOINTERFACE;
+}
+
+template <class Interface>
+ULONG APIENTRY NullObject<Interface>::AddRef()
+{
+	return ++refCount;
+}
+
+template <class Interface>
+ULONG APIENTRY NullObject<Interface>::Release()
+{
+	ULONG count = --refCount;
+	if (count == 0) delete this;
+	return count;
+}
+
+template <class Interface>
+HRESULT APIENTRY NullObject<Interface>::GetDevice(IDirect3DDevice9** ppDevice)
+{
+	if (!ppDevice) return D3DERR_INVALIDCALL;
+	*ppDevice = (IDirect3DDevice9*)device;
+	(*ppDevice)->AddRef();
+	return D3D_OK;
+}
+
+template class NullObject<IDirect3DVertexBuffer9>;
+template class NullObject<IDirect3DIndexBuffer9>;
+template class NullObject<IDirect3DStateBlock9>;
+template class NullObject<IDirect3DVertexDeclaration9>;
+template class NullObject<IDirect3DVertexShader9>;
+template class NullObject<IDirect3DPixelShader9>;
+
+// NullBuffer /////////////////////////////////////////////////////////////////
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+NullBuffer<Interface, Desc, Type>::NullBuffer(NullDevice* device, REFIID iid, const Desc& desc)
+	: NullObject<Interface>(device, iid, desc.Size), desc(desc), memory(desc.Size)
+{
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+HRESULT APIENTRY NullBuffer<Interface, Desc, Type>::SetPrivateData(REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags)
+{
+	return D3D_OK;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+HRESULT APIENTRY NullBuffer<Interface, Desc, Type>::GetPrivateData(REFGUID refguid, void* pData, DWORD* pSizeOfData)
+{
+	return D3DERR_NOTFOUND;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+HRESULT APIENTRY NullBuffer<Interface, Desc, Type>::FreePrivateData(REFGUID refguid)
+{
+	return D3DERR_NOTFOUND;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+DWORD APIENTRY NullBuffer<Interface, Desc, Type>::SetPriority(DWORD PriorityNew)
+{
+	return 0;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+DWORD APIENTRY NullBuffer<Interface, Desc, Type>::GetPriority()
+{
+	return 0;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+void APIENTRY NullBuffer<Interface, Desc, Type>::PreLoad()
+{
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+D3DRESOURCETYPE APIENTRY NullBuffer<Interface, Desc, Type>::GetType()
+{
+	return Type;
+}
+
+// a size of 0 locks the rest of the buffer
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+HRESULT APIENTRY NullBuffer<Interface, Desc, Type>::Lock(UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags)
+{
+	if (!ppbData || OffsetToLock > memory.size() || SizeToLock > memory.size() - OffsetToLock) return D3DERR_INVALIDCALL;
+	*ppbData = memory.data() + OffsetToLock;
+	return D3D_OK;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+HRESULT APIENTRY NullBuffer<Interface, Desc, Type>::Unlock()
+{
+	return D3D_OK;
+}
+
+template <class Interface, class Desc, D3DRESOURCETYPE Type>
+HRESULT APIENTRY NullBuffer<Interface, Desc, Type>::GetDesc(Desc *pDesc)
+{
+	if (!pDesc) return D3DERR_INVALIDCALL;
+	*pDesc = desc;
+	return D3D_OK;
+}
+
+template class NullBuffer<IDirect3DVertexBuffer9, D3DVERTEXBUFFER_DESC, D3DRTYPE_VERTEXBUFFER>;
+template class NullBuffer<IDirect3DIndexBuffer9, D3DINDEXBUFFER_DESC, D3DRTYPE_INDEXBUFFER>;
+
+// NullStateBlock /////////////////////////////////////////////////////////////
+
+NullStateBlock::NullStateBlock(NullDevice* device)
+	: NullObject<IDirect3DStateBlock9>(device, IID_IDirect3DStateBlock9, 0)
+{
+}
+
+HRESULT APIENTRY NullStateBlock::Capture()
+{
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullStateBlock::Apply()
+{
+	return D3D_OK;
+}
+
+// NullVertexDeclaration //////////////////////////////////////////////////////
+
+NullVertexDeclaration::NullVertexDeclaration(NullDevice* device, CONST D3DVERTEXELEMENT9* pVertexElements)
+	: NullObject<IDirect3DVertexDeclaration9>(device, IID_IDirect3DVertexDeclaration9, 0)
+{
+	// up to and including D3DDECL_END
+	do
+	{
+		elements.push_back(*pVertexElements);
+	} while ((pVertexElements++)->Stream != 0xFF);
+}
+
+HRESULT APIENTRY NullVertexDeclaration::GetDeclaration(D3DVERTEXELEMENT9* pElement, UINT* pNumElements)
+{
+	if (!pNumElements) return D3DERR_INVALIDCALL;
+	*pNumElements = elements.size();
+	if (pElement) std::copy(elements.begin(), elements.end(), pElement);
+	return D3D_OK;
+}
+
+// NullShader /////////////////////////////////////////////////////////////////
+
+// the size of the function is only known from its end token
+static size_t shaderLength(CONST DWORD* pFunction)
+{
+	size_t length = 1;
+	while (pFunction[length - 1] != 0x0000FFFF) ++length;
+	return length;
+}
+
+template <class Interface>
+NullShader<Interface>::NullShader(NullDevice* device, REFIID iid, CONST DWORD* pFunction)
+	: NullObject<Interface>(device, iid, shaderLength(pFunction) * sizeof(DWORD)), function(pFunction, pFunction + shaderLength(pFunction))
+{
+}
+
+template <class Interface>
+HRESULT APIENTRY NullShader<Interface>::GetFunction(void* pData, UINT* pSizeOfData)
+{
+	if (!pSizeOfData) return D3DERR_INVALIDCALL;
+	UINT size = function.size() * sizeof(DWORD);
+	if (pData)
+	{
+		if (*pSizeOfData < size) return D3DERR_INVALIDCALL;
+		memcpy(pData, function.data(), size);
+	}
+	*pSizeOfData = size;
+	return D3D_OK;
+}
+
+template class NullShader<IDirect3DVertexShader9>;
+template class NullShader<IDirect3DPixelShader9>;
+
+// NullQuery //////////////////////////////////////////////////////////////////
+
+NullQuery::NullQuery(NullDevice* device, D3DQUERYTYPE type)
+	: refCount(1), device(device), type(type), timestamp(0)
+{
+}
+
+bool NullQuery::isSupported(D3DQUERYTYPE type)
+{
+	return type == D3DQUERYTYPE_TIMESTAMP || type == D3DQUERYTYPE_TIMESTAMPDISJOINT || type == D3DQUERYTYPE_TIMESTAMPFREQ;
+}
+
+HRESULT APIENTRY NullQuery::QueryInterface(REFIID riid, void** ppvObj)
+{
+	if (!ppvObj) return E_POINTER;
+	if (riid == IID_IUnknown || riid == IID_IDirect3DQuery9)
+	{
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
+	*ppvObj = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG APIENTRY NullQuery::AddRef()
+{
+	return ++refCount;
+}
+
+ULONG APIENTRY NullQuery::Release()
+{
+	ULONG count = --refCount;
+	if (count == 0) delete this;
+	return count;
+}
+
+HRESULT APIENTRY NullQuery::GetDevice(IDirect3DDevice9** ppDevice)
+{
+	if (!ppDevice) return D3DERR_INVALIDCALL;
+	*ppDevice = (IDirect3DDevice9*)device;
+	(*ppDevice)->AddRef();
+	return D3D_OK;
+}
+
+D3DQUERYTYPE APIENTRY NullQuery::GetType()
+{
+	return type;
+}
+
+DWORD APIENTRY NullQuery::GetDataSize()
+{
+	return type == D3DQUERYTYPE_TIMESTAMPDISJOINT ? sizeof(BOOL) : sizeof(UINT64);
+}
+
+HRESULT APIENTRY NullQuery::Issue(DWORD dwIssueFlags)
+{
+	if (type == D3DQUERYTYPE_TIMESTAMP && (dwIssueFlags & D3DISSUE_END)) timestamp = device->nextTimestamp();
+	return D3D_OK;
+}
+
+// results are available immediately
+HRESULT APIENTRY NullQuery::GetData(void* pData, DWORD dwSize, DWORD dwGetDataFlags)
+{
+	if (!pData || dwSize < GetDataSize()) return dwSize == 0 ? S_OK : D3DERR_INVALIDCALL;
+	switch (type)
+	{
+	case D3DQUERYTYPE_TIMESTAMP:
+		*(UINT64*)pData = timestamp;
+		break;
+	case D3DQUERYTYPE_TIMESTAMPFREQ:
+		*(UINT64*)pData = FREQUENCY;
+		break;
+	default:
+		*(BOOL*)pData = FALSE;
+		break;
+	}
+	return S_OK;
+}
+
+// NullDevice /////////////////////////////////////////////////////////////////
+
+NullDevice::NullDevice(UINT backBufferWidth, UINT backBufferHeight)
+	: refCount(1), backBufferWidth(backBufferWidth), backBufferHeight(backBufferHeight), recordingStateBlock(false),
+	numResources(0), resourceMemory(0), peakResourceMemory(0), timestamp(0)
+{
+	for (unsigned i = 0; i < NUM_STREAMS; ++i) streams[i].offset = streams[i].stride = 0;
+	resetCallCounts();
+	// like on a real device, rendering goes to the back buffer until another target is set
+	backBuffer.Attach(new NullSurface(this, NULL, backBufferWidth, backBufferHeight, D3DFMT_X8R8G8B8, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, D3DMULTISAMPLE_NONE));
+	renderTargets[0] = backBuffer;
+}
+
+const char* NullDevice::getCallName(Call call)
+{
+	switch (call)
+	{
+#define CALL(_name) case Call##_name: return #_name;
+#include "NullDeviceCalls.def"
+#undef CALL
+	default: break;
+	}
+	return "Unknown";
+}
+
+void NullDevice::resetCallCounts()
+{
+	for (unsigned i = 0; i < NUM_CALLS; ++i) calls[i] = 0;
+}
+
+void NullDevice::logStatistics()
+{
+	SDLOG(0, "NullDevice: %u resources, %llu KB (peak %llu KB)", numResources, resourceMemory / 1024, peakResourceMemory / 1024);
+	for (unsigned i = 0; i < NUM_CALLS; ++i)
+	{
+		if (calls[i]) SDLOG(0, " - %28s: %10llu calls", getCallName((Call)i), calls[i]);
+	}
+}
+
+void NullDevice::resourceCreated(UINT size)
+{
+	++numResources;
+	resourceMemory += size;
+	peakResourceMemory = std::max(peakResourceMemory, resourceMemory);
+}
+
+void NullDevice::resourceDestroyed(UINT size)
+{
+	--numResources;
+	resourceMemory -= size;
+}
+
+HRESULT APIENTRY NullDevice::QueryInterface(REFIID riid, void** ppvObj)
+{
+	if (!ppvObj) return E_POINTER;
+	if (riid == IID_IUnknown || riid == IID_IDirect3DDevice9)
+	{
+		*ppvObj = this;
+		AddRef();
+		return S_OK;
+	}
+	*ppvObj = NULL;
+	return E_NOINTERFACE;
+}
+
+ULONG APIENTRY NullDevice::AddRef()
+{
+	return ++refCount;
+}
+
+ULONG APIENTRY NullDevice::Release()
+{
+	ULONG count = --refCount;
+	if (count == 0) delete this;
+	return count;
+}
+
+HRESULT APIENTRY NullDevice::TestCooperativeLevel()
+{
+	++calls[CallTestCooperativeLevel];
+	return D3D_OK;
+}
+
+UINT APIENTRY NullDevice::GetAvailableTextureMem()
+{
+	++calls[CallGetAvailableTextureMem];
+	return (UINT)(512 * 1024 * 1024 - std::min<UINT64>(resourceMemory, 512 * 1024 * 1024));
+}
+
+HRESULT APIENTRY NullDevice::EvictManagedResources()
+{
+	++calls[CallEvictManagedResources];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetDirect3D(IDirect3D9** ppD3D9)
+{
+	++calls[CallGetDirect3D];
+	if (ppD3D9) *ppD3D9 = NULL;
+	return D3DERR_NOTAVAILABLE;
+}
+
+// a shader model 3 card, for D3DX and our effects
+HRESULT APIENTRY NullDevice::GetDeviceCaps(D3DCAPS9* pCaps)
+{
+	++calls[CallGetDeviceCaps];
+	if (!pCaps) return D3DERR_INVALIDCALL;
+	ZeroMemory(pCaps, sizeof(*pCaps));
+	pCaps->DeviceType = D3DDEVTYPE_HAL;
+	pCaps->DevCaps = D3DDEVCAPS_HWTRANSFORMANDLIGHT | D3DDEVCAPS_PUREDEVICE;
+	pCaps->TextureCaps = D3DPTEXTURECAPS_ALPHA | D3DPTEXTURECAPS_MIPMAP;
+	pCaps->MaxTextureWidth = pCaps->MaxTextureHeight = 8192;
+	pCaps->MaxTextureBlendStages = pCaps->MaxSimultaneousTextures = 8;
+	pCaps->MaxPrimitiveCount = 0xFFFFFF;
+	pCaps->MaxVertexIndex = 0xFFFFFF;
+	pCaps->MaxStreams = NUM_STREAMS;
+	pCaps->MaxStreamStride = 255;
+	pCaps->VertexShaderVersion = D3DVS_VERSION(3, 0);
+	pCaps->MaxVertexShaderConst = 256;
+	pCaps->PixelShaderVersion = D3DPS_VERSION(3, 0);
+	pCaps->PixelShader1xMaxValue = 65504.0f;
+	pCaps->NumSimultaneousRTs = NUM_RENDERTARGETS;
+	pCaps->MaxVShaderInstructionsExecuted = pCaps->MaxPShaderInstructionsExecuted = 65535;
+	pCaps->MaxVertexShader30InstructionSlots = pCaps->MaxPixelShader30InstructionSlots = 32768;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetDisplayMode(UINT iSwapChain, D3DDISPLAYMODE* pMode)
+{
+	++calls[CallGetDisplayMode];
+	if (pMode) ZeroMemory(pMode, sizeof(*pMode));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetCreationParameters(D3DDEVICE_CREATION_PARAMETERS *pParameters)
+{
+	++calls[CallGetCreationParameters];
+	if (pParameters) ZeroMemory(pParameters, sizeof(*pParameters));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetCursorProperties(UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap)
+{
+	++calls[CallSetCursorProperties];
+	return D3D_OK;
+}
+
+void APIENTRY NullDevice::SetCursorPosition(int X, int Y, DWORD Flags)
+{
+	++calls[CallSetCursorPosition];
+}
+
+BOOL APIENTRY NullDevice::ShowCursor(BOOL bShow)
+{
+	++calls[CallShowCursor];
+	return FALSE;
+}
+
+HRESULT APIENTRY NullDevice::CreateAdditionalSwapChain(D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DSwapChain9** pSwapChain)
+{
+	++calls[CallCreateAdditionalSwapChain];
+	if (pSwapChain) *pSwapChain = NULL;
+	return D3DERR_NOTAVAILABLE;
+}
+
+HRESULT APIENTRY NullDevice::GetSwapChain(UINT iSwapChain, IDirect3DSwapChain9** pSwapChain)
+{
+	++calls[CallGetSwapChain];
+	if (pSwapChain) *pSwapChain = NULL;
+	return D3DERR_NOTAVAILABLE;
+}
+
+UINT APIENTRY NullDevice::GetNumberOfSwapChains()
+{
+	++calls[CallGetNumberOfSwapChains];
+	return 1;
+}
+
+HRESULT APIENTRY NullDevice::Reset(D3DPRESENT_PARAMETERS* pPresentationParameters)
+{
+	++calls[CallReset];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::Present(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+{
+	++calls[CallPresent];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetBackBuffer(UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer)
+{
+	++calls[CallGetBackBuffer];
+	if (!ppBackBuffer || iSwapChain != 0 || iBackBuffer != 0) return D3DERR_INVALIDCALL;
+	*ppBackBuffer = backBuffer;
+	(*ppBackBuffer)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetRasterStatus(UINT iSwapChain, D3DRASTER_STATUS* pRasterStatus)
+{
+	++calls[CallGetRasterStatus];
+	if (pRasterStatus) ZeroMemory(pRasterStatus, sizeof(*pRasterStatus));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetDialogBoxMode(BOOL bEnableDialogs)
+{
+	++calls[CallSetDialogBoxMode];
+	return D3D_OK;
+}
+
+void APIENTRY NullDevice::SetGammaRamp(UINT iSwapChain, DWORD Flags, CONST D3DGAMMARAMP* pRamp)
+{
+	++calls[CallSetGammaRamp];
+}
+
+void APIENTRY NullDevice::GetGammaRamp(UINT iSwapChain, D3DGAMMARAMP* pRamp)
+{
+	++calls[CallGetGammaRamp];
+	if (pRamp) ZeroMemory(pRamp, sizeof(*pRamp));
+}
+
+HRESULT APIENTRY NullDevice::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateTexture];
+	if (!ppTexture) return D3DERR_INVALIDCALL;
+	*ppTexture = new NullTexture(this, Width, Height, Levels, Usage, Format, Pool);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateVolumeTexture(UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateVolumeTexture];
+	if (ppVolumeTexture) *ppVolumeTexture = NULL;
+	return D3DERR_NOTAVAILABLE;
+}
+
+HRESULT APIENTRY NullDevice::CreateCubeTexture(UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateCubeTexture];
+	if (ppCubeTexture) *ppCubeTexture = NULL;
+	return D3DERR_NOTAVAILABLE;
+}
+
+HRESULT APIENTRY NullDevice::CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateVertexBuffer];
+	if (!ppVertexBuffer) return D3DERR_INVALIDCALL;
+	D3DVERTEXBUFFER_DESC desc = { D3DFMT_VERTEXDATA, D3DRTYPE_VERTEXBUFFER, Usage, Pool, Length, FVF };
+	*ppVertexBuffer = new NullVertexBuffer(this, IID_IDirect3DVertexBuffer9, desc);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateIndexBuffer(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer9** ppIndexBuffer, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateIndexBuffer];
+	if (!ppIndexBuffer) return D3DERR_INVALIDCALL;
+	D3DINDEXBUFFER_DESC desc = { Format, D3DRTYPE_INDEXBUFFER, Usage, Pool, Length };
+	*ppIndexBuffer = new NullIndexBuffer(this, IID_IDirect3DIndexBuffer9, desc);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateRenderTarget];
+	if (!ppSurface) return D3DERR_INVALIDCALL;
+	*ppSurface = new NullSurface(this, NULL, Width, Height, Format, D3DUSAGE_RENDERTARGET, D3DPOOL_DEFAULT, MultiSample);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateDepthStencilSurface];
+	if (!ppSurface) return D3DERR_INVALIDCALL;
+	*ppSurface = new NullSurface(this, NULL, Width, Height, Format, D3DUSAGE_DEPTHSTENCIL, D3DPOOL_DEFAULT, MultiSample);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::UpdateSurface(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestinationSurface, CONST POINT* pDestPoint)
+{
+	++calls[CallUpdateSurface];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::UpdateTexture(IDirect3DBaseTexture9* pSourceTexture, IDirect3DBaseTexture9* pDestinationTexture)
+{
+	++calls[CallUpdateTexture];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetRenderTargetData(IDirect3DSurface9* pRenderTarget, IDirect3DSurface9* pDestSurface)
+{
+	++calls[CallGetRenderTargetData];
+	if (!pRenderTarget || !pDestSurface) return D3DERR_INVALIDCALL;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetFrontBufferData(UINT iSwapChain, IDirect3DSurface9* pDestSurface)
+{
+	++calls[CallGetFrontBufferData];
+	if (!pDestSurface) return D3DERR_INVALIDCALL;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::StretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter)
+{
+	++calls[CallStretchRect];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::ColorFill(IDirect3DSurface9* pSurface, CONST RECT* pRect, D3DCOLOR color)
+{
+	++calls[CallColorFill];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateOffscreenPlainSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DPOOL Pool, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	++calls[CallCreateOffscreenPlainSurface];
+	if (!ppSurface) return D3DERR_INVALIDCALL;
+	*ppSurface = new NullSurface(this, NULL, Width, Height, Format, 0, Pool, D3DMULTISAMPLE_NONE);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
+{
+	++calls[CallSetRenderTarget];
+	if (RenderTargetIndex >= NUM_RENDERTARGETS) return D3DERR_INVALIDCALL;
+	renderTargets[RenderTargetIndex] = pRenderTarget;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget)
+{
+	++calls[CallGetRenderTarget];
+	if (RenderTargetIndex >= NUM_RENDERTARGETS || !ppRenderTarget) return D3DERR_INVALIDCALL;
+	*ppRenderTarget = renderTargets[RenderTargetIndex];
+	if (!*ppRenderTarget) return D3DERR_NOTFOUND;
+	(*ppRenderTarget)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
+{
+	++calls[CallSetDepthStencilSurface];
+	depthStencil = pNewZStencil;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetDepthStencilSurface(IDirect3DSurface9** ppZStencilSurface)
+{
+	++calls[CallGetDepthStencilSurface];
+	if (!ppZStencilSurface) return D3DERR_INVALIDCALL;
+	*ppZStencilSurface = depthStencil;
+	if (!*ppZStencilSurface) return D3DERR_NOTFOUND;
+	(*ppZStencilSurface)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::BeginScene()
+{
+	++calls[CallBeginScene];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::EndScene()
+{
+	++calls[CallEndScene];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::Clear(DWORD Count, CONST D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil)
+{
+	++calls[CallClear];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix)
+{
+	++calls[CallSetTransform];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetTransform(D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix)
+{
+	++calls[CallGetTransform];
+	if (pMatrix) ZeroMemory(pMatrix, sizeof(*pMatrix));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::MultiplyTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix)
+{
+	++calls[CallMultiplyTransform];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetViewport(CONST D3DVIEWPORT9* pViewport)
+{
+	++calls[CallSetViewport];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetViewport(D3DVIEWPORT9* pViewport)
+{
+	++calls[CallGetViewport];
+	if (pViewport) ZeroMemory(pViewport, sizeof(*pViewport));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetMaterial(CONST D3DMATERIAL9* pMaterial)
+{
+	++calls[CallSetMaterial];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetMaterial(D3DMATERIAL9* pMaterial)
+{
+	++calls[CallGetMaterial];
+	if (pMaterial) ZeroMemory(pMaterial, sizeof(*pMaterial));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetLight(DWORD Index, CONST D3DLIGHT9* pLight)
+{
+	++calls[CallSetLight];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetLight(DWORD Index, D3DLIGHT9* pLight)
+{
+	++calls[CallGetLight];
+	if (pLight) ZeroMemory(pLight, sizeof(*pLight));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::LightEnable(DWORD Index, BOOL Enable)
+{
+	++calls[CallLightEnable];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetLightEnable(DWORD Index, BOOL* pEnable)
+{
+	++calls[CallGetLightEnable];
+	if (pEnable) ZeroMemory(pEnable, sizeof(*pEnable));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetClipPlane(DWORD Index, CONST float* pPlane)
+{
+	++calls[CallSetClipPlane];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetClipPlane(DWORD Index, float* pPlane)
+{
+	++calls[CallGetClipPlane];
+	if (pPlane) ZeroMemory(pPlane, 4 * sizeof(float));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+	++calls[CallSetRenderState];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetRenderState(D3DRENDERSTATETYPE State, DWORD* pValue)
+{
+	++calls[CallGetRenderState];
+	if (pValue) ZeroMemory(pValue, sizeof(*pValue));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateStateBlock(D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB)
+{
+	++calls[CallCreateStateBlock];
+	if (!ppSB) return D3DERR_INVALIDCALL;
+	*ppSB = new NullStateBlock(this);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::BeginStateBlock()
+{
+	++calls[CallBeginStateBlock];
+	if (recordingStateBlock) return D3DERR_INVALIDCALL;
+	recordingStateBlock = true;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::EndStateBlock(IDirect3DStateBlock9** ppSB)
+{
+	++calls[CallEndStateBlock];
+	if (!ppSB || !recordingStateBlock) return D3DERR_INVALIDCALL;
+	recordingStateBlock = false;
+	*ppSB = new NullStateBlock(this);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetClipStatus(CONST D3DCLIPSTATUS9* pClipStatus)
+{
+	++calls[CallSetClipStatus];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetClipStatus(D3DCLIPSTATUS9* pClipStatus)
+{
+	++calls[CallGetClipStatus];
+	if (pClipStatus) ZeroMemory(pClipStatus, sizeof(*pClipStatus));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetTexture(DWORD Stage, IDirect3DBaseTexture9** ppTexture)
+{
+	++calls[CallGetTexture];
+	if (!ppTexture) return D3DERR_INVALIDCALL;
+	*ppTexture = Stage < NUM_STAGES ? textures[Stage].p : NULL;
+	if (*ppTexture) (*ppTexture)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture)
+{
+	++calls[CallSetTexture];
+	if (Stage >= NUM_STAGES) return D3D_OK;
+	textures[Stage] = pTexture;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue)
+{
+	++calls[CallGetTextureStageState];
+	if (pValue) ZeroMemory(pValue, sizeof(*pValue));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+	++calls[CallSetTextureStageState];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD* pValue)
+{
+	++calls[CallGetSamplerState];
+	if (pValue) ZeroMemory(pValue, sizeof(*pValue));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value)
+{
+	++calls[CallSetSamplerState];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::ValidateDevice(DWORD* pNumPasses)
+{
+	++calls[CallValidateDevice];
+	if (pNumPasses) *pNumPasses = 1;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetPaletteEntries(UINT PaletteNumber, CONST PALETTEENTRY* pEntries)
+{
+	++calls[CallSetPaletteEntries];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetPaletteEntries(UINT PaletteNumber, PALETTEENTRY* pEntries)
+{
+	++calls[CallGetPaletteEntries];
+	if (pEntries) ZeroMemory(pEntries, 256 * sizeof(PALETTEENTRY));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetCurrentTexturePalette(UINT PaletteNumber)
+{
+	++calls[CallSetCurrentTexturePalette];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetCurrentTexturePalette(UINT *PaletteNumber)
+{
+	++calls[CallGetCurrentTexturePalette];
+	if (PaletteNumber) ZeroMemory(PaletteNumber, sizeof(*PaletteNumber));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetScissorRect(CONST RECT* pRect)
+{
+	++calls[CallSetScissorRect];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetScissorRect(RECT* pRect)
+{
+	++calls[CallGetScissorRect];
+	if (pRect) ZeroMemory(pRect, sizeof(*pRect));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetSoftwareVertexProcessing(BOOL bSoftware)
+{
+	++calls[CallSetSoftwareVertexProcessing];
+	return D3D_OK;
+}
+
+BOOL APIENTRY NullDevice::GetSoftwareVertexProcessing()
+{
+	++calls[CallGetSoftwareVertexProcessing];
+	return FALSE;
+}
+
+HRESULT APIENTRY NullDevice::SetNPatchMode(float nSegments)
+{
+	++calls[CallSetNPatchMode];
+	return D3D_OK;
+}
+
+float APIENTRY NullDevice::GetNPatchMode()
+{
+	++calls[CallGetNPatchMode];
+	return 0.0f;
+}
+
+HRESULT APIENTRY NullDevice::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
+{
+	++calls[CallDrawPrimitive];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::DrawIndexedPrimitive(D3DPRIMITIVETYPE PrimitiveType, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount)
+{
+	++calls[CallDrawIndexedPrimitive];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	++calls[CallDrawPrimitiveUP];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	++calls[CallDrawIndexedPrimitiveUP];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags)
+{
+	++calls[CallProcessVertices];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateVertexDeclaration(CONST D3DVERTEXELEMENT9* pVertexElements, IDirect3DVertexDeclaration9** ppDecl)
+{
+	++calls[CallCreateVertexDeclaration];
+	if (!pVertexElements || !ppDecl) return D3DERR_INVALIDCALL;
+	*ppDecl = new NullVertexDeclaration(this, pVertexElements);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetVertexDeclaration(IDirect3DVertexDeclaration9* pDecl)
+{
+	++calls[CallSetVertexDeclaration];
+	vertexDeclaration = pDecl;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetVertexDeclaration(IDirect3DVertexDeclaration9** ppDecl)
+{
+	++calls[CallGetVertexDeclaration];
+	if (!ppDecl) return D3DERR_INVALIDCALL;
+	*ppDecl = vertexDeclaration;
+	if (*ppDecl) (*ppDecl)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetFVF(DWORD FVF)
+{
+	++calls[CallSetFVF];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetFVF(DWORD* pFVF)
+{
+	++calls[CallGetFVF];
+	if (pFVF) ZeroMemory(pFVF, sizeof(*pFVF));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateVertexShader(CONST DWORD* pFunction, IDirect3DVertexShader9** ppShader)
+{
+	++calls[CallCreateVertexShader];
+	if (!pFunction || !ppShader) return D3DERR_INVALIDCALL;
+	*ppShader = new NullVertexShader(this, IID_IDirect3DVertexShader9, pFunction);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetVertexShader(IDirect3DVertexShader9* pShader)
+{
+	++calls[CallSetVertexShader];
+	vertexShader = pShader;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetVertexShader(IDirect3DVertexShader9** ppShader)
+{
+	++calls[CallGetVertexShader];
+	if (!ppShader) return D3DERR_INVALIDCALL;
+	*ppShader = vertexShader;
+	if (*ppShader) (*ppShader)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetVertexShaderConstantF(UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount)
+{
+	++calls[CallSetVertexShaderConstantF];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetVertexShaderConstantF(UINT StartRegister, float* pConstantData, UINT Vector4fCount)
+{
+	++calls[CallGetVertexShaderConstantF];
+	if (pConstantData) ZeroMemory(pConstantData, Vector4fCount * 4 * sizeof(float));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetVertexShaderConstantI(UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount)
+{
+	++calls[CallSetVertexShaderConstantI];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetVertexShaderConstantI(UINT StartRegister, int* pConstantData, UINT Vector4iCount)
+{
+	++calls[CallGetVertexShaderConstantI];
+	if (pConstantData) ZeroMemory(pConstantData, Vector4iCount * 4 * sizeof(int));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetVertexShaderConstantB(UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount)
+{
+	++calls[CallSetVertexShaderConstantB];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetVertexShaderConstantB(UINT StartRegister, BOOL* pConstantData, UINT BoolCount)
+{
+	++calls[CallGetVertexShaderConstantB];
+	if (pConstantData) ZeroMemory(pConstantData, BoolCount * sizeof(BOOL));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride)
+{
+	++calls[CallSetStreamSource];
+	if (StreamNumber >= NUM_STREAMS) return D3DERR_INVALIDCALL;
+	streams[StreamNumber].buffer = pStreamData;
+	streams[StreamNumber].offset = OffsetInBytes;
+	streams[StreamNumber].stride = Stride;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride)
+{
+	++calls[CallGetStreamSource];
+	if (StreamNumber >= NUM_STREAMS || !ppStreamData || !pOffsetInBytes || !pStride) return D3DERR_INVALIDCALL;
+	*ppStreamData = streams[StreamNumber].buffer;
+	if (*ppStreamData) (*ppStreamData)->AddRef();
+	*pOffsetInBytes = streams[StreamNumber].offset;
+	*pStride = streams[StreamNumber].stride;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetStreamSourceFreq(UINT StreamNumber, UINT Setting)
+{
+	++calls[CallSetStreamSourceFreq];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetStreamSourceFreq(UINT StreamNumber, UINT* pSetting)
+{
+	++calls[CallGetStreamSourceFreq];
+	if (pSetting) ZeroMemory(pSetting, sizeof(*pSetting));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetIndices(IDirect3DIndexBuffer9* pIndexData)
+{
+	++calls[CallSetIndices];
+	indices = pIndexData;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetIndices(IDirect3DIndexBuffer9** ppIndexData)
+{
+	++calls[CallGetIndices];
+	if (!ppIndexData) return D3DERR_INVALIDCALL;
+	*ppIndexData = indices;
+	if (*ppIndexData) (*ppIndexData)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreatePixelShader(CONST DWORD* pFunction, IDirect3DPixelShader9** ppShader)
+{
+	++calls[CallCreatePixelShader];
+	if (!pFunction || !ppShader) return D3DERR_INVALIDCALL;
+	*ppShader = new NullPixelShader(this, IID_IDirect3DPixelShader9, pFunction);
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetPixelShader(IDirect3DPixelShader9* pShader)
+{
+	++calls[CallSetPixelShader];
+	pixelShader = pShader;
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetPixelShader(IDirect3DPixelShader9** ppShader)
+{
+	++calls[CallGetPixelShader];
+	if (!ppShader) return D3DERR_INVALIDCALL;
+	*ppShader = pixelShader;
+	if (*ppShader) (*ppShader)->AddRef();
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetPixelShaderConstantF(UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount)
+{
+	++calls[CallSetPixelShaderConstantF];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetPixelShaderConstantF(UINT StartRegister, float* pConstantData, UINT Vector4fCount)
+{
+	++calls[CallGetPixelShaderConstantF];
+	if (pConstantData) ZeroMemory(pConstantData, Vector4fCount * 4 * sizeof(float));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetPixelShaderConstantI(UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount)
+{
+	++calls[CallSetPixelShaderConstantI];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetPixelShaderConstantI(UINT StartRegister, int* pConstantData, UINT Vector4iCount)
+{
+	++calls[CallGetPixelShaderConstantI];
+	if (pConstantData) ZeroMemory(pConstantData, Vector4iCount * 4 * sizeof(int));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::SetPixelShaderConstantB(UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount)
+{
+	++calls[CallSetPixelShaderConstantB];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::GetPixelShaderConstantB(UINT StartRegister, BOOL* pConstantData, UINT BoolCount)
+{
+	++calls[CallGetPixelShaderConstantB];
+	if (pConstantData) ZeroMemory(pConstantData, BoolCount * sizeof(BOOL));
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::DrawRectPatch(UINT Handle, CONST float* pNumSegs, CONST D3DRECTPATCH_INFO* pRectPatchInfo)
+{
+	++calls[CallDrawRectPatch];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::DrawTriPatch(UINT Handle, CONST float* pNumSegs, CONST D3DTRIPATCH_INFO* pTriPatchInfo)
+{
+	++calls[CallDrawTriPatch];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::DeletePatch(UINT Handle)
+{
+	++calls[CallDeletePatch];
+	return D3D_OK;
+}
+
+HRESULT APIENTRY NullDevice::CreateQuery(D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery)
+{
+	++calls[CallCreateQuery];
+	if (!NullQuery::isSupported(Type))
+	{
+		if (ppQuery) *ppQuery = NULL;
+		return D3DERR_NOTAVAILABLE;
+	}
+	// a NULL query pointer only checks for support
+	if (ppQuery) *ppQuery = new NullQuery(this, Type);
+	return D3D_OK;
+}
@@ -0,0 +1,149 @@
+
+#include "PipelineDetector.h"
+
+#include "main.h"
+#include "Settings.h"
+
+PipelineDetector::PipelineDetector()
+	: mainRT(NULL), zRT(NULL), switches(0), frameEvents(0)
+{
+	// gather the steps of each signature
+	std::vector<unsigned> steps[NUM_SIGNATURES];
+#define SIGNATURE(_name, _inputs, _mismatch, _repeat, _restartedBy)
+#define STEP(_name, _count, _accepts) \
+	steps[_name - FIRST_SIGNATURE].insert(steps[_name - FIRST_SIGNATURE].end(), (size_t)(_count), (unsigned)(_accepts));
+#include "PipelineSignatures.def"
+#undef STEP
+#undef SIGNATURE
+
+	// and build the transition table from them
+#define SIGNATURE(_name, _inputs, _mismatch, _repeat, _restartedBy) \
+	compile(_name - FIRST_SIGNATURE, _inputs, _mismatch, _repeat, steps[_name - FIRST_SIGNATURE]); \
+	restarts[_name - FIRST_SIGNATURE] = _restartedBy;
+#define STEP(_name, _count, _accepts)
+#include "PipelineSignatures.def"
+#undef STEP
+#undef SIGNATURE
+
+	reset();
+}
+
+const char* PipelineDetector::getEventName(Event e)
+{
+	switch (e)
+	{
+	case MainRT: return "MainRT";
+#define SIGNATURE(_name, _inputs, _mismatch, _repeat, _restartedBy) case _name: return #_name;
+#define STEP(_name, _count, _accepts)
+#include "PipelineSignatures.def"
+#undef STEP
+#undef SIGNATURE
+	default: break;
+	}
+	return "Unknown";
+}
+
+void PipelineDetector::compile(unsigned sig, unsigned inputs, Mismatch mismatch, Repeat repeat, const std::vector<unsigned>& steps)
+{
+	unsigned numSteps = steps.size();
+	if (numSteps >= STATE_MASK)
+	{
+		SDLOG(0, "ERROR: pipeline signature %s has too many steps (%u), ignoring it", getEventName((Event)(sig + FIRST_SIGNATURE)), numSteps);
+		numSteps = 0;
+	}
+	// one row per state, the last one (all steps matched) is only reached by signatures firing once per frame
+	offsets[sig] = table.size();
+	for (unsigned state = 0; state <= numSteps; ++state)
+	{
+		for (unsigned input = 0; input < NUM_INPUTS; ++input)
+		{
+			UINT8 next = state;
+			if (state < numSteps && ((inputs >> input) & 1))
+			{
+				if ((steps[state] >> input) & 1)
+				{
+					next = state + 1;
+					if (next == numSteps) next = STATE_FIRE | (repeat == REPEAT ? 0 : numSteps);
+				}
+				else if (mismatch == RESET)
+				{
+					next = 0;
+				}
+			}
+			table.push_back(next);
+		}
+	}
+}
+
+void PipelineDetector::reset()
+{
+	for (unsigned i = 0; i < NUM_SIGNATURES; ++i) states[i] = 0;
+	mainRT = NULL;
+	zRT = NULL;
+	switches = 0;
+	frameEvents = 0;
+}
+
+unsigned PipelineDetector::feed(Input input)
+{
+	unsigned events = 0;
+	for (unsigned i = 0; i < NUM_SIGNATURES; ++i)
+	{
+		UINT8 next = table[offsets[i] + states[i] * NUM_INPUTS + input];
+		states[i] = next & STATE_MASK;
+		events |= (unsigned)(next >> 7) << (i + FIRST_SIGNATURE);
+	}
+	if (events)
+	{
+		frameEvents |= events;
+		for (unsigned i = 0; i < NUM_SIGNATURES; ++i)
+		{
+			if (restarts[i] & events) states[i] = 0;
+		}
+		for (unsigned e = FIRST_SIGNATURE; e < NUM_EVENTS; ++e)
+		{
+			if (has(events, (Event)e))
+			{
+				SDLOG(2, "Pipeline event: %s", getEventName((Event)e));
+			}
+		}
+	}
+	return events;
+}
+
+unsigned PipelineDetector::renderTargetSwitch(IDirect3DSurface9* oldRT, IDirect3DSurface9* newRT, bool fromDof)
+{
+	unsigned events = 0;
+	if (switches++ == 0)
+	{
+		// store it for later use
+		mainRT = newRT;
+		events |= 1 << MainRT;
+		frameEvents |= events;
+		SDLOG(2, "Storing RT as main RT: %p", mainRT);
+	}
+	unsigned input = RT_OTHER;
+	if (oldRT == mainRT) input = RT_FROM_MAIN;
+	else if (fromDof) input = RT_FROM_DOF;
+	if (newRT == mainRT) input += RT_TO_MAIN - RT_OTHER;
+	events |= feed((Input)input);
+	if (has(events, ZBuffer))
+	{
+		zRT = newRT;
+		SDLOG(2, "Storing RT as Z buffer RT: %p", zRT);
+	}
+	return events;
+}
+
+unsigned PipelineDetector::textureSet(DWORD stage, IDirect3DBaseTexture9* pTexture)
+{
+	if (pTexture && stage < 4) return feed((Input)(TEX_STAGE0 + stage));
+	return feed(TEX_OTHER);
+}
+
+unsigned PipelineDetector::hudDraw(bool healthbar, bool categoryIcons)
+{
+	if (healthbar) return feed(HUD_HEALTHBAR);
+	if (categoryIcons) return feed(HUD_CATEGORYICONS);
+	return feed(HUD_OTHER);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+
+#include <d3d9.h>
+
+// Identifies positions in the render pipeline of the game from the stream of device calls
+// The signatures of these positions (PipelineSignatures.def) are compiled into a single transition table,
+// each relevant call maps to one input symbol which advances all signatures with a single table lookup
+class PipelineDetector
+{
+public:
+	// Input symbols, each relevant call is mapped to exactly one of them
+	enum Input
+	{
+		// rendertarget switches, by relation of the old and new target to the main RT and the first DoF target
+		RT_OTHER, RT_FROM_MAIN, RT_FROM_DOF, RT_TO_MAIN, RT_MAIN_TO_MAIN, RT_DOF_TO_MAIN,
+		// texture settings
+		TEX_STAGE0, TEX_STAGE1, TEX_STAGE2, TEX_STAGE3, TEX_OTHER,
+		// draws while rendering the HUD
+		HUD_HEALTHBAR, HUD_CATEGORYICONS, HUD_OTHER,
+		NUM_INPUTS
+	};
+
+	// Sets of input symbols, used in the signature definitions
+	enum InputSet
+	{
+		ANY_RT = (1 << RT_OTHER) | (1 << RT_FROM_MAIN) | (1 << RT_FROM_DOF) | (1 << RT_TO_MAIN) | (1 << RT_MAIN_TO_MAIN) | (1 << RT_DOF_TO_MAIN),
+		TO_MAIN = (1 << RT_TO_MAIN) | (1 << RT_MAIN_TO_MAIN) | (1 << RT_DOF_TO_MAIN),
+		FROM_MAIN = (1 << RT_FROM_MAIN) | (1 << RT_MAIN_TO_MAIN),
+		FROM_DOF = (1 << RT_FROM_DOF) | (1 << RT_DOF_TO_MAIN),
+		NO_MAIN = (1 << RT_OTHER) | (1 << RT_FROM_DOF),
+		TEX0 = 1 << TEX_STAGE0,
+		TEX1 = 1 << TEX_STAGE1,
+		TEX2 = 1 << TEX_STAGE2,
+		TEX3 = 1 << TEX_STAGE3,
+		ANY_TEX = TEX0 | TEX1 | TEX2 | TEX3 | (1 << TEX_OTHER),
+		HEALTHBAR = 1 << HUD_HEALTHBAR,
+		CATEGORYICONS = 1 << HUD_CATEGORYICONS,
+		NOT_CATEGORYICONS = (1 << HUD_HEALTHBAR) | (1 << HUD_OTHER),
+		ANY_HUD = HEALTHBAR | NOT_CATEGORYICONS | CATEGORYICONS
+	};
+
+	enum Mismatch { HOLD, RESET };
+	enum Repeat { ONCE, REPEAT };
+
+	// Events, the detector functions return a mask of these (1 << event)
+	enum Event
+	{
+		MainRT, // the first rendertarget of the frame is the main rendering target
+#define SIGNATURE(_name, _inputs, _mismatch, _repeat, _restartedBy) _name,
+#define STEP(_name, _count, _accepts)
+#include "PipelineSignatures.def"
+#undef STEP
+#undef SIGNATURE
+		NUM_EVENTS
+	};
+	static const unsigned FIRST_SIGNATURE = MainRT + 1;
+	static const unsigned NUM_SIGNATURES = NUM_EVENTS - FIRST_SIGNATURE;
+
+	static bool has(unsigned events, Event e)
+	{
+		return ((events >> e) & 1) != 0;
+	}
+	static const char* getEventName(Event e);
+
+	PipelineDetector();
+
+	// forget all progress and identified surfaces, called at the start of each frame
+	void reset();
+
+	unsigned renderTargetSwitch(IDirect3DSurface9* oldRT, IDirect3DSurface9* newRT, bool fromDof);
+	unsigned textureSet(DWORD stage, IDirect3DBaseTexture9* pTexture);
+	unsigned hudDraw(bool healthbar, bool categoryIcons);
+	unsigned feed(Input input);
+
+	IDirect3DSurface9* getMainRT() const
+	{
+		return mainRT;
+	}
+	IDirect3DSurface9* getZRT() const
+	{
+		return zRT;
+	}
+	unsigned getRenderTargetSwitches() const
+	{
+		return switches;
+	}
+	// all events which fired since the last reset
+	unsigned getFrameEvents() const
+	{
+		return frameEvents;
+	}
+
+private:
+	// table entries: next state in the low bits, STATE_FIRE set if the signature completes
+	static const UINT8 STATE_FIRE = 0x80;
+	static const UINT8 STATE_MASK = 0x7f;
+
+	std::vector<UINT8> table;
+	unsigned offsets[NUM_SIGNATURES];
+	unsigned restarts[NUM_SIGNATURES];
+	UINT8 states[NUM_SIGNATURES];
+
+	IDirect3DSurface9* mainRT;
+	IDirect3DSurface9* zRT;
+	unsigned switches;
+	unsigned frameEvents;
+
+	void compile(unsigned sig, unsigned inputs, Mismatch mismatch, Repeat repeat, const std::vector<unsigned>& steps);
+};
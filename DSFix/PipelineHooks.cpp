@@ -0,0 +1,506 @@
+#include "PipelineHooks.h"
+
+#include "main.h"
+#include "d3dutil.h"
+#include "Settings.h"
+#include "HudCache.h"
+
+PipelineHooks::PipelineHooks() : d3ddev(NULL), doHud(true), hideHud(false), onHudRT(false), pausedHudRT(false), hudStarted(false),
+	numKnownTextures(0), foundKnownTextures(0), mainRenderTexIndex(0), mainRenderSurfIndex(0), currentRT(NULL), targetScaleX(1.0f), targetScaleY(1.0f),
+	headless(false), batcher(&DrawBatcher::get()), hudLayout(&HudLayout::get())
+{
+#define TEXTURE(_name, _hash) \
+	texture##_name = NULL; \
+	++numKnownTextures;
+#include "Textures.def"
+#undef TEXTURE
+}
+
+void PipelineHooks::initPipelineResources()
+{
+	hudLayout->load();
+	batcher->init(d3ddev);
+}
+
+void PipelineHooks::releasePipelineResources()
+{
+	hudLayerSurf = nullptr;
+	hudLayerTex = nullptr;
+	prevRenderTarget = nullptr;
+	prevRenderTex = nullptr;
+	batcher->release();
+	hudLayout->release();
+
+	// all default pool surfaces are gone after a reset, the game will create (and we will register) new ones
+	surfaceInfos.clear();
+	setCurrentRT(NULL);
+	pipeline.reset();
+}
+
+void PipelineHooks::setHudLayer(IDirect3DTexture9* pTexture)
+{
+	hudLayerSurf = nullptr;
+	hudLayerTex = pTexture;
+	if (pTexture) pTexture->GetSurfaceLevel(0, &hudLayerSurf);
+}
+
+void PipelineHooks::registerMainRenderTexture(IDirect3DTexture9* pTexture)
+{
+	if (pTexture)
+	{
+		mainRenderTexIndices.insert(std::make_pair(pTexture, mainRenderTexIndex));
+		SDLOG(4, "Registering main render tex: %p as #%d", pTexture, mainRenderTexIndex);
+		mainRenderTexIndex++;
+	}
+}
+
+void PipelineHooks::registerMainRenderSurface(IDirect3DSurface9* pSurface)
+{
+	if (pSurface)
+	{
+		mainRenderSurfIndices.insert(std::make_pair(pSurface, mainRenderSurfIndex));
+		SDLOG(4, "Registering main render surface: %p as #%d", pSurface, mainRenderSurfIndex);
+		mainRenderSurfIndex++;
+	}
+}
+
+void PipelineHooks::registerRenderTexture(IDirect3DTexture9* pTexture, float scaleX, float scaleY)
+{
+	if (!pTexture) return;
+	CComPtr<IDirect3DSurface9> surf;
+	D3DSURFACE_DESC desc;
+	if (pTexture->GetSurfaceLevel(0, &surf) != D3D_OK || surf->GetDesc(&desc) != D3D_OK) return;
+	// the level 0 surface lives as long as its texture, so storing the raw pointers is fine
+	SurfaceInfo& info = surfaceInfos[surf.p];
+	info.width = desc.Width;
+	info.height = desc.Height;
+	info.format = desc.Format;
+	info.texture = pTexture;
+	info.scaleX = scaleX;
+	info.scaleY = scaleY;
+	SDLOG(4, "Registering render texture %p with surface %p (%4u/%4u)", pTexture, surf.p, desc.Width, desc.Height);
+}
+
+void PipelineHooks::registerRenderSurface(IDirect3DSurface9* pSurface, float scaleX, float scaleY)
+{
+	if (!pSurface) return;
+	D3DSURFACE_DESC desc;
+	if (pSurface->GetDesc(&desc) != D3D_OK) return;
+	SurfaceInfo& info = surfaceInfos[pSurface];
+	info.width = desc.Width;
+	info.height = desc.Height;
+	info.format = desc.Format;
+	info.texture = NULL;
+	info.scaleX = scaleX;
+	info.scaleY = scaleY;
+	SDLOG(4, "Registering render surface %p (%4u/%4u)", pSurface, desc.Width, desc.Height);
+}
+
+const PipelineHooks::SurfaceInfo* PipelineHooks::getSurfaceInfo(IDirect3DSurface9* pSurface)
+{
+	SurfInfoMap::const_iterator it = surfaceInfos.find(pSurface);
+	if (it != surfaceInfos.end()) return &it->second;
+	return NULL;
+}
+
+bool PipelineHooks::isRenderSized(const SurfaceInfo* info)
+{
+	return info && info->width == Settings::get().getRenderWidth() && info->height == Settings::get().getRenderHeight();
+}
+
+HRESULT PipelineHooks::redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle)
+{
+	SDLOG(1, "CreateTexture w/h: %4u/%4u    format: %s    RENDERTARGET=%d", Width, Height, D3DFormatToString(Format), Usage & D3DUSAGE_RENDERTARGET);
+	UINT requestedWidth = Width, requestedHeight = Height;
+	ResolutionRules::Target target = ResolutionRules::get().apply(Width, Height, ResolutionRules::textureKind(Usage), Format);
+	HRESULT res = d3ddev->CreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+	if (res == D3D_OK && target == ResolutionRules::RENDER && (Usage & D3DUSAGE_RENDERTARGET)) registerMainRenderTexture(*ppTexture);
+	if (res == D3D_OK && (Usage & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL)))
+	{
+		// only the rule scaled targets are rendered to with scaled viewports, the others are handled by the game
+		bool scaled = target == ResolutionRules::SCALE || target == ResolutionRules::SIZE;
+		registerRenderTexture(*ppTexture, scaled ? float(Width) / requestedWidth : 1.0f, scaled ? float(Height) / requestedHeight : 1.0f);
+	}
+	return res;
+}
+
+HRESULT PipelineHooks::redirectCreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	SDLOG(1, "CreateRenderTarget w/h: %4u/%4u  format: %s", Width, Height, D3DFormatToString(Format));
+	UINT requestedWidth = Width, requestedHeight = Height;
+	ResolutionRules::Target target = ResolutionRules::get().apply(Width, Height, ResolutionRules::RENDER_SURFACE, Format);
+	HRESULT hr = d3ddev->CreateRenderTarget(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
+	if (SUCCEEDED(hr))
+	{
+		bool scaled = target == ResolutionRules::SCALE || target == ResolutionRules::SIZE;
+		registerRenderSurface(*ppSurface, scaled ? float(Width) / requestedWidth : 1.0f, scaled ? float(Height) / requestedHeight : 1.0f);
+		if (target == ResolutionRules::RENDER) registerMainRenderSurface(*ppSurface);
+	}
+	return hr;
+}
+
+HRESULT PipelineHooks::redirectCreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	SDLOG(4, "CreateDepthStencilSurface w/h: %4u/%4u  format: %s", Width, Height, D3DFormatToString(Format));
+	UINT requestedWidth = Width, requestedHeight = Height;
+	ResolutionRules::Target target = ResolutionRules::get().apply(Width, Height, ResolutionRules::DEPTH_SURFACE, Format);
+	HRESULT hr = d3ddev->CreateDepthStencilSurface(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
+	if (SUCCEEDED(hr))
+	{
+		bool scaled = target == ResolutionRules::SCALE || target == ResolutionRules::SIZE;
+		registerRenderSurface(*ppSurface, scaled ? float(Width) / requestedWidth : 1.0f, scaled ? float(Height) / requestedHeight : 1.0f);
+	}
+	return hr;
+}
+
+void PipelineHooks::setCurrentRT(IDirect3DSurface9* pSurface)
+{
+	currentRT = pSurface;
+	const SurfaceInfo* info = getSurfaceInfo(pSurface);
+	targetScaleX = info ? info->scaleX : 1.0f;
+	targetScaleY = info ? info->scaleY : 1.0f;
+}
+
+D3DVIEWPORT9 PipelineHooks::scaleViewport(const D3DVIEWPORT9& vp) const
+{
+	D3DVIEWPORT9 scaled = vp;
+	if (targetScaleX == 1.0f && targetScaleY == 1.0f) return scaled;
+	scaled.X = (DWORD)(vp.X * targetScaleX + 0.5f);
+	scaled.Y = (DWORD)(vp.Y * targetScaleY + 0.5f);
+	scaled.Width = (DWORD)((vp.X + vp.Width) * targetScaleX + 0.5f) - scaled.X;
+	scaled.Height = (DWORD)((vp.Y + vp.Height) * targetScaleY + 0.5f) - scaled.Y;
+	return scaled;
+}
+
+RECT PipelineHooks::scaleRect(const RECT& r) const
+{
+	RECT scaled = r;
+	if (targetScaleX == 1.0f && targetScaleY == 1.0f) return scaled;
+	scaled.left = (LONG)(r.left * targetScaleX + 0.5f);
+	scaled.top = (LONG)(r.top * targetScaleY + 0.5f);
+	scaled.right = (LONG)(r.right * targetScaleX + 0.5f);
+	scaled.bottom = (LONG)(r.bottom * targetScaleY + 0.5f);
+	return scaled;
+}
+
+HRESULT PipelineHooks::redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
+{
+	IDirect3DSurface9* oldRenderTarget = currentRT;
+	const SurfaceInfo* oldInfo = getSurfaceInfo(oldRenderTarget);
+	unsigned events = pipeline.renderTargetSwitch(oldRenderTarget, pRenderTarget, oldInfo && ResolutionRules::isDof(oldInfo->width, oldInfo->height) == 1);
+	renderTargetSwitched(oldRenderTarget, oldInfo, events);
+
+	// we just finished rendering the frame (pre-HUD)
+	if (PipelineDetector::has(events, PipelineDetector::HudStart) && hudLayerSurf && doHud)
+	{
+		// final renderbuffer has to be from texture, just making sure here
+		IDirect3DTexture9* tex = oldInfo ? oldInfo->texture : NULL;
+		// check size just to make even more sure
+		if (tex && isRenderSized(oldInfo))
+		{
+			SDLOG(0, "Starting HUD rendering");
+			onHudRT = true;
+			d3ddev->SetRenderTarget(0, hudLayerSurf);
+			setCurrentRT(hudLayerSurf);
+			// an unchanged HUD is not drawn again, the layer is kept
+			if (headless || !HudCache::get().beginHud()) d3ddev->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_RGBA(0, 0, 0, 0), 0.0f, 0);
+			prevRenderTex = tex;
+			prevRenderTarget = pRenderTarget;
+
+			d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+			d3ddev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_ADD);
+			d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+			d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
+			return S_OK;
+		}
+	}
+	if (onHudRT)
+	{
+		finishHudRendering();
+	}
+	if (RenderTargetIndex == 0) setCurrentRT(pRenderTarget);
+	return d3ddev->SetRenderTarget(RenderTargetIndex, pRenderTarget);
+}
+
+HRESULT PipelineHooks::redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9 * pTexture)
+{
+	if (HudCache::get().isRecording()) HudCache::get().addState(HudCache::TEXTURE, Stage, (UINT32)(UINT_PTR)pTexture);
+	if (pTexture == NULL) return d3ddev->SetTexture(Stage, pTexture);
+	textureSet(Stage, pTexture);
+	if (!hudStarted && isTextureHudHealthbar(pTexture))
+	{
+		SDLOG(1, "HUD started!");
+		hudStarted = true;
+	}
+
+	pipeline.textureSet(Stage, pTexture);
+	return d3ddev->SetTexture(Stage, pTexture);
+}
+
+HRESULT PipelineHooks::redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
+{
+	//if(lastReplacement >= 0) {
+	//	SDLOG(1, "Redirected SetDepthStencilSurface(%p) to %p", pNewZStencil, renderTexDSBuffers[lastReplacement]);
+	//	d3ddev->SetDepthStencilSurface(renderTexDSBuffers[lastReplacement]);
+	//}
+	//lastReplacement = -1;
+	return d3ddev->SetDepthStencilSurface(pNewZStencil);
+}
+
+void PipelineHooks::registerKnownTexture(UINT32 hash, IDirect3DTexture9* pTexture)
+{
+	if (foundKnownTextures < numKnownTextures)
+	{
+#define TEXTURE(_name, _hash) \
+		if(hash == _hash) { \
+			texture##_name = pTexture; \
+			++foundKnownTextures; \
+			SDLOG(1, "RenderstateManager: recognized known texture %s at %u", #_name, pTexture); \
+		}
+#include "Textures.def"
+#undef TEXTURE
+		if (foundKnownTextures == numKnownTextures)
+		{
+			SDLOG(1, "RenderstateManager: all known textures found!");
+		}
+	}
+}
+
+HRESULT PipelineHooks::redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	if (hudStarted && hideHud)
+	{
+		return D3D_OK;
+	}
+	bool isTargetIndicator = false;
+	if (pausedHudRT)
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		// check for target indicator
+		if (isTextureHudHealthbar(t))
+		{
+			INT16 *vertices = (INT16*)pVertexStreamZeroData;
+			if (vertices[3] > -2000)
+			{
+				resumeHudRendering();
+			}
+		}
+		else
+		{
+			resumeHudRendering();
+		}
+	}
+	if (onHudRT)
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		SDLOG(4, "On HUD, redirectDrawIndexedPrimitiveUP texture: %s", getTextureName(t));
+		unsigned events = pipeline.hudDraw(isTextureHudHealthbar(t), isTextureCategoryIconsHumanityCount(t));
+		// check for target indicator
+		if (isTextureHudHealthbar(t))
+		{
+			INT16 *vertices = (INT16*)pVertexStreamZeroData;
+			if (vertices[3] < -2000)
+			{
+				isTargetIndicator = true;
+				pauseHudRendering();
+			}
+		}
+		if (PipelineDetector::has(events, PipelineDetector::HudEnd))
+		{
+			finishHudRendering();
+		}
+		else if (!isTargetIndicator)
+		{
+			//d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+			//d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_ADD);
+			//d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+			//d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
+		}
+	}
+	if (onHudRT && HudCache::get().isRecording())
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		HudCache::get().addDraw(t, PrimitiveType, PrimitiveCount, pVertexStreamZeroData, MinIndex + NumVertices, VertexStreamZeroStride, pIndexData, IndexDataFormat);
+		if (HudCache::get().isSkipping()) return D3D_OK;
+	}
+	if ((onHudRT || pausedHudRT) && hudLayout->isEnabled())
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		pVertexStreamZeroData = hudLayout->apply(d3ddev, getHudRole(t), pVertexStreamZeroData, MinIndex, NumVertices, VertexStreamZeroStride);
+	}
+	if (batcher->drawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride))
+	{
+		return D3D_OK;
+	}
+	HRESULT hr = d3ddev->DrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
+	//if(onHudRT) {
+	//	if(takeScreenshot) dumpSurface("HUD_IndexPrimUP", rgbaBuffer1Surf);
+	//}
+	return hr;
+}
+
+HRESULT PipelineHooks::redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	if (hudStarted && hideHud)
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		bool hide = isTextureText(t);
+		hide = hide || isTextureButtonsEffects(t);
+		hide = hide || isTextureHudEffectIcons(t);
+		if (hide) return D3D_OK;
+	}
+	if (pausedHudRT)
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		bool isText = isTextureText(t);
+		SDLOG(4, "On HUD, PAUSED, redirectDrawPrimitiveUP texture: %s", getTextureName(t));
+		//// Print vertices
+		//SDLOG(0, "Vertices: ");
+		//INT16 *values = (INT16*)pVertexStreamZeroData;
+		//for(size_t i=0; i<PrimitiveCount+2; ++i) {
+		//	SDLOG(0, "%8hd, ", values[i]);
+		//	if((i+1)%2 == 0) SDLOG(0, "; ");
+		//	if((i+1)%8 == 0) SDLOG(0, "");
+		//}
+		if (isText && PrimitiveCount >= 12) resumeHudRendering();
+	}
+	bool subbed = false;
+	if (onHudRT)
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		bool isSub = isTextureText00(t);
+		SDLOG(4, "On HUD, redirectDrawPrimitiveUP texture: %s", getTextureName(t));
+		if (isSub)
+		{
+			pauseHudRendering();
+			subbed = true;
+		}
+	}
+	if (onHudRT && HudCache::get().isRecording())
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		HudCache::get().addDraw(t, PrimitiveType, PrimitiveCount, pVertexStreamZeroData, HudCache::verticesPerDraw(PrimitiveType, PrimitiveCount), VertexStreamZeroStride);
+		if (HudCache::get().isSkipping()) return D3D_OK;
+	}
+	if ((onHudRT || pausedHudRT) && hudLayout->isEnabled())
+	{
+		CComPtr<IDirect3DBaseTexture9> t;
+		d3ddev->GetTexture(0, &t);
+		pVertexStreamZeroData = hudLayout->apply(d3ddev, getHudRole(t), pVertexStreamZeroData, 0, HudCache::verticesPerDraw(PrimitiveType, PrimitiveCount), VertexStreamZeroStride);
+	}
+	HRESULT hr = D3D_OK;
+	if (!batcher->drawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride))
+	{
+		hr = d3ddev->DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+	}
+	if (subbed) resumeHudRendering();
+	//if(onHudRT) {
+	//	if(takeScreenshot) dumpSurface("HUD_PrimUP", rgbaBuffer1Surf);
+	//}
+	return hr;
+}
+
+bool PipelineHooks::isTextureText(IDirect3DBaseTexture9* t)
+{
+	return isTextureText00(t) || isTextureText01(t) || isTextureText02(t) || isTextureText03(t)
+		|| isTextureText04(t) || isTextureText05(t) || isTextureText06(t) || isTextureText07(t)
+		|| isTextureText08(t) || isTextureText09(t) || isTextureText10(t) || isTextureText11(t)
+		|| isTextureText12(t);
+}
+
+HudLayout::Role PipelineHooks::getHudRole(IDirect3DBaseTexture9* t)
+{
+	if (isTextureHudHealthbar(t)) return HudLayout::ROLE_HEALTHBAR;
+	if (isTextureText(t)) return HudLayout::ROLE_TEXT;
+	if (isTextureSpellsGestures(t) || isTextureArmorIcons1(t) || isTextureArmorIcons2(t) || isTextureArmorIcons3(t)
+		|| isTextureItemIcons(t) || isTextureWeaponIcons(t) || isTextureWeaponIcons2HudBack(t) || isTextureRingIcons(t)
+		|| isTextureKeyIcons(t) || isTextureCategoryIconsHumanityCount(t)) return HudLayout::ROLE_ICONS;
+	if (isTextureHudEffectIcons(t) || isTextureButtonsEffects(t)) return HudLayout::ROLE_EFFECTS;
+	if (isTextureGuiElements1(t)) return HudLayout::ROLE_GUI;
+	return HudLayout::ROLE_OTHER;
+}
+
+const char* PipelineHooks::getTextureName(IDirect3DBaseTexture9* pTexture)
+{
+#define TEXTURE(_name, _hash) \
+	if(texture##_name == pTexture) return #_name;
+#include "Textures.def"
+#undef TEXTURE
+	return "Unknown";
+}
+
+void PipelineHooks::finishHudRendering()
+{
+	SDLOG(2, "FinishHudRendering");
+	// these change the state directly on the device
+	batcher->flush();
+	if (!headless) HudCache::get().endHud();
+	d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
+	d3ddev->SetRenderTarget(0, prevRenderTarget);
+	setCurrentRT(prevRenderTarget);
+	onHudRT = false;
+	// draw HUD to screen
+	compositeHud();
+}
+
+void PipelineHooks::pauseHudRendering()
+{
+	SDLOG(3, "PauseHudRendering");
+	batcher->flush();
+	d3ddev->SetRenderTarget(0, prevRenderTarget);
+	setCurrentRT(prevRenderTarget);
+	d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_BLENDTEXTUREALPHA);
+	onHudRT = false;
+	pausedHudRT = true;
+}
+
+void PipelineHooks::resumeHudRendering()
+{
+	SDLOG(3, "ResumeHudRendering");
+	batcher->flush();
+	d3ddev->SetRenderTarget(0, hudLayerSurf);
+	setCurrentRT(hudLayerSurf);
+	d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
+	d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+	onHudRT = true;
+	pausedHudRT = false;
+}
+
+HRESULT PipelineHooks::redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+	if (HudCache::get().isRecording()) HudCache::get().addState(HudCache::TEXTURE_STAGE_STATE, Stage * 256 + Type, Value);
+	//if(allowStateChanges()) {
+	return d3ddev->SetTextureStageState(Stage, Type, Value);
+	//} else {
+	//	SDLOG(3, "SetTextureStageState suppressed: %u  -  %u  -  %u", Stage, Type, Value);
+	//}
+	//return D3D_OK;
+}
+
+HRESULT PipelineHooks::redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+	if (HudCache::get().isRecording()) HudCache::get().addState(HudCache::RENDER_STATE, State, Value);
+	if (State == D3DRS_COLORWRITEENABLE && !allowStateChanges()) return D3D_OK;
+	//if(allowStateChanges()) {
+	return d3ddev->SetRenderState(State, Value);
+	//} else {
+	//	SDLOG(3, "SetRenderState suppressed: %u  -  %u", State, Value);
+	//}
+	//return D3D_OK;
+}
+
+void PipelineHooks::endFrame()
+{
+	hudStarted = false;
+	pipeline.reset();
+	batcher->endFrame();
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <d3d9.h>
+#include "HudLayout.h"
+#include "DrawBatcher.h"
+#include "PipelineDetector.h"
+#include "ResolutionRules.h"
+
+// The handling of the hooked calls which RSManager shares with the DetectorTarget of the standalone tools (see bench/):
+// the resolution rules, the surface metadata, the pipeline detection and the redirection of the game's HUD to its layer,
+// with the HudCache, the HudLayout and the DrawBatcher. Our effects run from the virtual hooks, so this needs no D3DX.
+class PipelineHooks
+{
+protected:
+	IDirect3DDevice9 *d3ddev;
+
+	bool doHud;
+	bool hideHud;
+	bool onHudRT, pausedHudRT;
+	bool hudStarted;
+
+#define TEXTURE(_name, _hash) \
+	protected: \
+	static const UINT32 texture##_name##Hash = _hash; \
+	IDirect3DTexture9* texture##_name; \
+	bool isTexture##_name(IDirect3DBaseTexture9* pTexture) { return texture##_name && ((IDirect3DTexture9*)pTexture) == texture##_name; };
+#include "Textures.def"
+#undef TEXTURE
+	bool isTextureText(IDirect3DBaseTexture9* pTexture);
+	HudLayout::Role getHudRole(IDirect3DBaseTexture9* pTexture);
+	const char* getTextureName(IDirect3DBaseTexture9* pTexture);
+
+	unsigned numKnownTextures, foundKnownTextures;
+
+	unsigned mainRenderTexIndex, mainRenderSurfIndex;
+	typedef std::map<IDirect3DTexture9*, int> TexIntMap;
+	TexIntMap mainRenderTexIndices;
+	typedef std::map<IDirect3DSurface9*, int> SurfIntMap;
+	SurfIntMap mainRenderSurfIndices;
+
+	// Position in the render pipeline, identified from the sequence of rendertarget switches, texture settings and HUD draws
+	// we use the number of switches between rendertargets to figure out where we are in the pipeline. Yeah, it's flaky
+	PipelineDetector pipeline;
+
+	// Surface metadata, recorded when surfaces are created through the hooked functions
+	// this allows the pipeline detection to run without querying the device or the surfaces on every call
+	struct SurfaceInfo
+	{
+		UINT width, height;
+		D3DFORMAT format;
+		IDirect3DTexture9* texture; // owning texture, NULL for plain surfaces
+		float scaleX, scaleY; // created size over the size the game asked for, if a resolution rule scaled it
+	};
+	typedef std::map<IDirect3DSurface9*, SurfaceInfo> SurfInfoMap;
+	SurfInfoMap surfaceInfos;
+	const SurfaceInfo* getSurfaceInfo(IDirect3DSurface9* pSurface);
+	bool isRenderSized(const SurfaceInfo* info);
+
+	// rendertarget 0 as currently bound on the device (by the game or by us)
+	IDirect3DSurface9* currentRT;
+	// the scale of currentRT, the game's viewports and scissor rects are scaled by it
+	float targetScaleX, targetScaleY;
+	void setCurrentRT(IDirect3DSurface9* pSurface);
+
+	// the game's HUD is rendered here instead of onto prevRenderTarget, NULL when it is drawn as is
+	CComPtr<IDirect3DTexture9> hudLayerTex;
+	CComPtr<IDirect3DSurface9> hudLayerSurf;
+	CComPtr<IDirect3DSurface9> prevRenderTarget;
+	CComPtr<IDirect3DTexture9> prevRenderTex;
+
+	// running without the game (trace replay), skips everything which touches global state or waits
+	bool headless;
+	// the singletons normally, a headless manager has its own as they hold resources of its device
+	DrawBatcher* batcher;
+	HudLayout* hudLayout;
+	std::unique_ptr<DrawBatcher> headlessBatcher;
+	std::unique_ptr<HudLayout> headlessHudLayout;
+
+	// on every rendertarget switch, with the pipeline events it caused and the rendertarget switched away from
+	virtual void renderTargetSwitched(IDirect3DSurface9* oldRenderTarget, const SurfaceInfo* oldInfo, unsigned events) { }
+	// on every texture set, before the pipeline detection sees it
+	virtual void textureSet(DWORD Stage, IDirect3DBaseTexture9* pTexture) { }
+	// at the end of the HUD, with prevRenderTarget bound again: draws the layer onto it
+	virtual void compositeHud() { }
+
+public:
+	PipelineHooks();
+	virtual ~PipelineHooks() { }
+
+	void setD3DDevice(IDirect3DDevice9 *pD3Ddev)
+	{
+		d3ddev = pD3Ddev;
+	}
+
+	// call before initResources
+	void setHeadless(bool enabled)
+	{
+		headless = enabled;
+		headlessBatcher.reset(enabled ? new DrawBatcher() : NULL);
+		headlessHudLayout.reset(enabled ? new HudLayout() : NULL);
+		batcher = enabled ? headlessBatcher.get() : &DrawBatcher::get();
+		hudLayout = enabled ? headlessHudLayout.get() : &HudLayout::get();
+	}
+	// draws the batched UP draws, which the device wrapper does before every call it forwards
+	void flushDraws()
+	{
+		batcher->flush();
+	}
+
+	const PipelineDetector& getPipeline() const
+	{
+		return pipeline;
+	}
+
+	// the HUD layer (and the batching) live with the device, the layer is set after initPipelineResources
+	void initPipelineResources();
+	void releasePipelineResources();
+	void setHudLayer(IDirect3DTexture9* pTexture);
+
+	D3DVIEWPORT9 scaleViewport(const D3DVIEWPORT9& vp) const;
+	RECT scaleRect(const RECT& r) const;
+
+	void toggleHideHud()
+	{
+		hideHud = !hideHud;
+	}
+	void toggleChangeHud()
+	{
+		doHud = !doHud;
+	}
+
+	bool allowStateChanges()
+	{
+		return !onHudRT;
+	}
+
+	void registerMainRenderTexture(IDirect3DTexture9* pTexture);
+	void registerMainRenderSurface(IDirect3DSurface9* pSurface);
+	void registerRenderTexture(IDirect3DTexture9* pTexture, float scaleX = 1.0f, float scaleY = 1.0f);
+	void registerRenderSurface(IDirect3DSurface9* pSurface, float scaleX = 1.0f, float scaleY = 1.0f);
+	void registerKnownTexture(UINT32 hash, IDirect3DTexture9* pTexture);
+
+	HRESULT redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle);
+	HRESULT redirectCreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle);
+	HRESULT redirectCreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle);
+	HRESULT redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget);
+
+	void finishHudRendering();
+	void pauseHudRendering();
+	void resumeHudRendering();
+
+	HRESULT redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9 * pTexture);
+	HRESULT redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil);
+	HRESULT redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride);
+	HRESULT redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride);
+	HRESULT redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+	HRESULT redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value);
+	// the frame boundary, on Present
+	void endFrame();
+};
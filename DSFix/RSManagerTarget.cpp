@@ -0,0 +1,128 @@
+#include "RSManagerTarget.h"
+
+#include "main.h"
+#include "NullDevice.h"
+
+HookTarget* RSManagerTarget::create(NullDevice* device)
+{
+	return new RSManagerTarget(device);
+}
+
+RSManagerTarget::RSManagerTarget(IDirect3DDevice9* device)
+	: device(device), rs(new RSManager())
+{
+	rs->setD3DDevice(device);
+	rs->setHeadless(true);
+	rs->initResources();
+}
+
+RSManagerTarget::~RSManagerTarget()
+{
+	rs->releaseResources();
+	rs.reset();
+	// created by the effects on our device, they have to go before it
+	Effect::releaseShared(device);
+	SMAA::releaseShared(device);
+}
+
+void RSManagerTarget::registerMainRenderTexture(IDirect3DTexture9* pTexture)
+{
+	rs->registerMainRenderTexture(pTexture);
+}
+
+void RSManagerTarget::registerRenderTexture(IDirect3DTexture9* pTexture)
+{
+	rs->registerRenderTexture(pTexture);
+}
+
+void RSManagerTarget::registerRenderSurface(IDirect3DSurface9* pSurface)
+{
+	rs->registerRenderSurface(pSurface);
+}
+
+void RSManagerTarget::registerKnownTexture(UINT32 hash, IDirect3DTexture9* pTexture)
+{
+	rs->registerKnownTexture(hash, pTexture);
+}
+
+HRESULT RSManagerTarget::redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle)
+{
+	rs->flushDraws();
+	return rs->redirectCreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+}
+
+HRESULT RSManagerTarget::redirectCreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	rs->flushDraws();
+	return rs->redirectCreateRenderTarget(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
+}
+
+HRESULT RSManagerTarget::redirectCreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
+{
+	rs->flushDraws();
+	return rs->redirectCreateDepthStencilSurface(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
+}
+
+HRESULT RSManagerTarget::redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
+{
+	rs->flushDraws();
+	return rs->redirectSetRenderTarget(RenderTargetIndex, pRenderTarget);
+}
+
+HRESULT RSManagerTarget::redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
+{
+	rs->flushDraws();
+	return rs->redirectSetDepthStencilSurface(pNewZStencil);
+}
+
+HRESULT RSManagerTarget::redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture)
+{
+	rs->flushDraws();
+	return rs->redirectSetTexture(Stage, pTexture);
+}
+
+HRESULT RSManagerTarget::redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
+{
+	rs->flushDraws();
+	return rs->redirectSetRenderState(State, Value);
+}
+
+HRESULT RSManagerTarget::redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
+{
+	rs->flushDraws();
+	return rs->redirectSetTextureStageState(Stage, Type, Value);
+}
+
+HRESULT RSManagerTarget::redirectStretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter)
+{
+	rs->flushDraws();
+	return rs->redirectStretchRect(pSourceSurface, pSourceRect, pDestSurface, pDestRect, Filter);
+}
+
+HRESULT RSManagerTarget::redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	return rs->redirectDrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+}
+
+HRESULT RSManagerTarget::redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
+{
+	return rs->redirectDrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
+}
+
+HRESULT RSManagerTarget::redirectPresent(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion)
+{
+	rs->flushDraws();
+	return rs->redirectPresent(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
+}
+
+void RSManagerTarget::resetDevice()
+{
+	rs->flushDraws();
+	rs->releaseResources();
+	rs->initResources();
+}
+
+unsigned RSManagerTarget::getFrameEvents() const
+{
+	return rs->getPipeline().getFrameEvents();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "HookTarget.h"
+#include "RenderstateManager.h"
+
+// Runs the hooked calls through a separate, headless RSManager on a NullDevice, with its resources and effects created
+// as configured, so that the effect passes, the HUD layout and the UP draw batching are part of the measured paths
+// The batched draws are flushed before every other call, as the device wrapper does
+class RSManagerTarget : public HookTarget
+{
+	IDirect3DDevice9* device;
+	std::unique_ptr<RSManager> rs;
+
+	RSManagerTarget(IDirect3DDevice9* device);
+
+public:
+	static HookTarget* create(NullDevice* device);
+	~RSManagerTarget();
+
+	void registerMainRenderTexture(IDirect3DTexture9* pTexture);
+	void registerRenderTexture(IDirect3DTexture9* pTexture);
+	void registerRenderSurface(IDirect3DSurface9* pSurface);
+	void registerKnownTexture(UINT32 hash, IDirect3DTexture9* pTexture);
+
+	HRESULT redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle);
+	HRESULT redirectCreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle);
+	HRESULT redirectCreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle);
+	HRESULT redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget);
+	HRESULT redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil);
+	HRESULT redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9* pTexture);
+	HRESULT redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value);
+	HRESULT redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value);
+	HRESULT redirectStretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter);
+	HRESULT redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride);
+	HRESULT redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride);
+	HRESULT redirectPresent(CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion);
+	void resetDevice();
+
+	unsigned getFrameEvents() const;
+};
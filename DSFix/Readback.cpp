@@ -0,0 +1,63 @@
+
+#include "Readback.h"
+
+#include "main.h"
+
+bool Readback::create(IDirect3DDevice9* device, UINT width, UINT height, D3DFORMAT format)
+{
+	if (copy && this->width == width && this->height == height && this->format == format) return true;
+	release();
+	if (FAILED(device->CreateRenderTarget(width, height, format, D3DMULTISAMPLE_NONE, 0, false, &copy, NULL))
+		|| FAILED(device->CreateOffscreenPlainSurface(width, height, format, D3DPOOL_SYSTEMMEM, &staging, NULL)))
+	{
+		release();
+		return false;
+	}
+	this->width = width;
+	this->height = height;
+	this->format = format;
+	return true;
+}
+
+void Readback::release()
+{
+	copy = nullptr;
+	staging = nullptr;
+	width = height = 0;
+	format = D3DFMT_UNKNOWN;
+	pending = false;
+}
+
+void Readback::start()
+{
+	age = 0;
+	pending = true;
+}
+
+bool Readback::endFrame()
+{
+	if (!pending) return true;
+	++age;
+	if (age != READBACK_FRAME) return true;
+	CComPtr<IDirect3DDevice9> device;
+	if (FAILED(copy->GetDevice(&device)) || FAILED(device->GetRenderTargetData(copy, staging)))
+	{
+		pending = false;
+		return false;
+	}
+	return true;
+}
+
+Readback::Status Readback::lock(std::unique_ptr<ImageWriter::Image>& image, UINT width, UINT height, bool withAlpha)
+{
+	if (!pending) return LOCK_FAILED;
+	if (age < LOCK_FRAME) return LOCK_WAITING;
+	D3DLOCKED_RECT rect;
+	HRESULT hr = staging->LockRect(&rect, NULL, D3DLOCK_READONLY | D3DLOCK_DONOTWAIT);
+	if (hr == D3DERR_WASSTILLDRAWING) return LOCK_WAITING;
+	pending = false;
+	if (FAILED(hr)) return LOCK_FAILED;
+	image = ImageWriter::Image::fromLocked(rect, width, height, withAlpha);
+	staging->UnlockRect();
+	return LOCKED;
+}
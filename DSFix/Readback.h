@@ -0,0 +1,60 @@
+#pragma once
+
+#include "d3d9.h"
+#include "ImageWriter.h"
+
+// A copy of a render target, read back to system memory without stalling the render thread
+// (for the ScreenshotManager and the FrameCapture): the copy is made into one of our render targets on the GPU,
+// the readback issued READBACK_FRAME frames later, and the system memory surface locked from LOCK_FRAME on,
+// as soon as the GPU is done with it
+class Readback
+{
+public:
+	// frames after the copy at which the readback is issued, and from which the staging surface is locked
+	static const unsigned READBACK_FRAME = 1;
+	static const unsigned LOCK_FRAME = 2;
+
+	enum Status { LOCK_WAITING, LOCKED, LOCK_FAILED };
+
+	Readback() : width(0), height(0), format(D3DFMT_UNKNOWN), age(0), pending(false) { }
+
+	// creates the surfaces, unless they already have this size and format
+	bool create(IDirect3DDevice9* device, UINT width, UINT height, D3DFORMAT format);
+	void release();
+
+	// the render target to copy to; call start once the copy is issued
+	IDirect3DSurface9* getCopy()
+	{
+		return copy;
+	}
+	UINT getWidth() const
+	{
+		return width;
+	}
+	UINT getHeight() const
+	{
+		return height;
+	}
+	void start();
+	bool isPending() const
+	{
+		return pending;
+	}
+	unsigned getAge() const
+	{
+		return age;
+	}
+
+	// frame boundary, called on Present while pending: issues the readback, returns false if that failed
+	bool endFrame();
+	// LOCK_WAITING until the readback is complete, then the top left width x height pixels as an image
+	Status lock(std::unique_ptr<ImageWriter::Image>& image, UINT width, UINT height, bool withAlpha);
+
+private:
+	CComPtr<IDirect3DSurface9> copy;    // render target
+	CComPtr<IDirect3DSurface9> staging; // system memory
+	UINT width, height;
+	D3DFORMAT format;
+	unsigned age; // frames since the copy
+	bool pending;
+};
@@ -16,6 +16,15 @@
 #include "SaveManager.h"
 #include "KeyActions.h"
 #include "FPS.h"
+#include "CallTrace.h"
+#include "GpuProfiler.h"
+#include "ScreenshotManager.h"
+#include "ImageWriter.h"
+#include "FrameCapture.h"
+#include "InstantReplay.h"
+#include "HudCache.h"
+#include "DrawBatcher.h"
+#include "ResolutionRules.h"
 
 #include "WinUtil.h"
 
@@ -39,14 +48,41 @@ void RSManager::initResources()
 	}
 	if (Settings::get().getSsaoStrength()) ssao.reset(new SSAO(d3ddev, rw, rh, Settings::get().getSsaoStrength() - 1,
 		(Settings::get().getSsaoType() == "VSSAO") ? SSAO::VSSAO : ((Settings::get().getSsaoType() == "HBAO") ? SSAO::HBAO : SSAO::SCAO)));
-	if (Settings::get().getDOFBlurAmount()) gauss.reset(new GAUSS(d3ddev, dofRes * 16 / 9, dofRes));
+	// SSAO is the only user of the depth pyramid for now
+	if (Settings::get().getSsaoStrength()) depthPyramid.reset(new DepthPyramid(d3ddev, rw, rh));
+	if (Settings::get().getDOFBlurAmount()) gauss.reset(new GAUSS(d3ddev, dofRes * 16 / 9, dofRes, Settings::get().getDOFBlurAmount()));
+	initPipelineResources();
 	if (Settings::get().getEnableHudMod()) hud.reset(new HUD(d3ddev, rw, rh));
+	unsigned pw = Settings::get().getPresentWidth(), ph = Settings::get().getPresentHeight();
+	Scaler::Mode scalerMode;
+	if ((pw != rw || ph != rh) && Scaler::parseMode(Settings::get().getPresentScaling(), scalerMode))
+		scaler.reset(new Scaler(d3ddev, rw, rh, pw, ph, scalerMode, Settings::get().getPresentSharpening()));
 	d3ddev->CreateTexture(rw, rh, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &rgbaBuffer1Tex, NULL);
 	rgbaBuffer1Tex->GetSurfaceLevel(0, &rgbaBuffer1Surf);
+	registerRenderTexture(rgbaBuffer1Tex);
+	// the HUD cache belongs to the real device, a headless manager always redraws the HUD
+	bool hudCache = !headless && hud && Settings::get().getEnableHudCache();
+	if (!headless) HudCache::get().setEnabled(hudCache);
+	if (hudCache)
+	{
+		CComPtr<IDirect3DTexture9> layer;
+		d3ddev->CreateTexture(rw, rh, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &layer, NULL);
+		registerRenderTexture(layer);
+		setHudLayer(layer);
+	}
+	// without the HUD mod, the game's HUD is not redirected
+	else if (hud) setHudLayer(rgbaBuffer1Tex);
 	d3ddev->CreateDepthStencilSurface(rw, rh, D3DFMT_D24S8, D3DMULTISAMPLE_NONE, 0, false, &depthStencilSurf, NULL);
 	d3ddev->CreateStateBlock(D3DSBT_ALL, &prevStateBlock);
-	if (Settings::get().getEnableTextureOverride() && Settings::get().getEnableTexturePrefetch())
-		prefetchTextures();
+	if (!headless)
+	{
+		GpuProfiler::get().init(d3ddev);
+		ScreenshotManager::get().init(d3ddev);
+		FrameCapture::get().init(d3ddev);
+		InstantReplay::get().init(d3ddev);
+		if (Settings::get().getEnableTextureOverride() && Settings::get().getEnableTexturePrefetch())
+			prefetchTextures();
+	}
 
 	SDLOG(0, "RenderstateManager resource initialization completed");
 }
@@ -123,22 +159,37 @@ void RSManager::releaseResources()
 	smaa = nullptr;
 	fxaa = nullptr;
 	ssao = nullptr;
+	depthPyramid = nullptr;
 	gauss = nullptr;
 	hud = nullptr;
+	scaler = nullptr;
+	releasePipelineResources();
+	// the singletons belong to the real device, a headless replay must not release them
+	if (!headless)
+	{
+		GpuProfiler::get().release();
+		ScreenshotManager::get().release();
+		FrameCapture::get().release();
+		InstantReplay::get().release();
+		HudCache::get().invalidate();
+	}
 
 	SDLOG(0, "RenderstateManager resource release completed");
 }
 
 HRESULT RSManager::redirectPresent(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride, CONST RGNDATA *pDirtyRegion)
 {
-	while (paused)
+	if (!headless)
 	{
-		Sleep(1);
-		KeyActions::get().processIO();
-	}
+		while (paused)
+		{
+			Sleep(1);
+			KeyActions::get().processIO();
+		}
 
-	// tick SaveManager
-	SaveManager::get().tick();
+		// tick SaveManager
+		SaveManager::get().tick();
+	}
 
 	capturing = false;
 	if (captureNextFrame)
@@ -147,7 +198,7 @@ HRESULT RSManager::redirectPresent(CONST RECT *pSourceRect, CONST RECT *pDestRec
 		captureNextFrame = false;
 		SDLOG(0, "== CAPTURING FRAME ==");
 	}
-	if (timingIntroMode)
+	if (timingIntroMode && !headless)
 	{
 		skippedPresents++;
 		if (skippedPresents >= 1200u && !Settings::get().getUnlockFPS())
@@ -163,16 +214,18 @@ HRESULT RSManager::redirectPresent(CONST RECT *pSourceRect, CONST RECT *pDestRec
 		return S_OK;
 	}
 	skippedPresents = 0;
-	hudStarted = false;
-	nrts = 0;
-	doft[0] = 0;
-	doft[1] = 0;
-	doft[2] = 0;
-	mainRT = NULL;
-	mainRTuses = 0;
-	zSurf = NULL;
-
-	frameTimeManagement();
+	endFrame();
+
+	if (!headless)
+	{
+		GpuProfiler::get().endFrame();
+		ScreenshotManager::get().endFrame();
+		FrameCapture::get().endFrame();
+		InstantReplay::get().endFrame();
+		// the capture starts with the frame after this Present
+		if (capturing) capturing = FrameCapture::get().begin();
+		frameTimeManagement();
+	}
 	return d3ddev->Present(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
 }
 
@@ -214,260 +267,103 @@ D3DPRESENT_PARAMETERS RSManager::adjustPresentationParameters(const D3DPRESENT_P
 void RSManager::dumpSurface(const char* name, IDirect3DSurface9* surface)
 {
 	char fullname[128];
-	sprintf_s(fullname, 128, "dump%03d_%s.tga", dumpCaptureIndex++, name);
-	D3DXSaveSurfaceToFile(fullname, D3DXIFF_TGA, surface, NULL, NULL);
-}
-
-void getDofRes(UINT inW, UINT inH, UINT& outW, UINT& outH)
-{
-	if (Settings::get().getDOFOverrideResolution() == 0)
-	{
-		outW = inW;
-		outH = inH;
-		return;
-	}
-	else
-	{
-		UINT divFactor = Settings::get().getDisableDofScaling() ? 1 : 360 / inH;
-		UINT topWidth = Settings::get().getDOFOverrideResolution() * 16 / 9, topHeight = Settings::get().getDOFOverrideResolution();
-		outW = topWidth / divFactor;
-		outH = topHeight / divFactor;
-	}
-}
-
-void RSManager::registerMainRenderTexture(IDirect3DTexture9* pTexture)
-{
-	if (pTexture)
-	{
-		mainRenderTexIndices.insert(std::make_pair(pTexture, mainRenderTexIndex));
-		SDLOG(4, "Registering main render tex: %p as #%d", pTexture, mainRenderTexIndex);
-		mainRenderTexIndex++;
-	}
+	sprintf_s(fullname, 128, "dump%03d_%s.png", dumpCaptureIndex++, name);
+	ImageWriter::get().writeSurface(surface, fullname, false);
 }
 
-void RSManager::registerMainRenderSurface(IDirect3DSurface9* pSurface)
+void RSManager::renderTargetSwitched(IDirect3DSurface9* oldRenderTarget, const SurfaceInfo* oldInfo, unsigned events)
 {
-	if (pSurface)
-	{
-		mainRenderSurfIndices.insert(std::make_pair(pSurface, mainRenderSurfIndex));
-		SDLOG(4, "Registering main render surface: %p as #%d", pSurface, mainRenderSurfIndex);
-		mainRenderSurfIndex++;
-	}
-}
-
-HRESULT RSManager::redirectCreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle)
-{
-	SDLOG(1, "CreateTexture w/h: %4u/%4u    format: %s    RENDERTARGET=%d", Width, Height, D3DFormatToString(Format), Usage & D3DUSAGE_RENDERTARGET);
-	if (Width == 1024 && Height == 720)
-	{
-		SDLOG(1, " - OVERRIDE to %4u/%4u!", Settings::get().getRenderWidth(), Settings::get().getRenderHeight());
-		HRESULT res = d3ddev->CreateTexture(Settings::get().getRenderWidth(), Settings::get().getRenderHeight(), Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
-		if (res == D3D_OK && (Usage & D3DUSAGE_RENDERTARGET)) RSManager::get().registerMainRenderTexture(*ppTexture);
-		return res;
-	}
-	if ((Width == 512 && Height == 360) || (Width == 256 && Height == 180))
-	{
-		UINT w, h;
-		getDofRes(Width, Height, w, h);
-		SDLOG(1, " - OVERRIDE DoF to %4u/%4u!", w, h);
-		return d3ddev->CreateTexture(w, h, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
-	}
-	if (Width == 1280 && Height == 720)
-	{
-		SDLOG(1, " - OVERRIDE to %4u/%4u!", Settings::get().getPresentWidth(), Settings::get().getPresentHeight());
-		return d3ddev->CreateTexture(Settings::get().getPresentWidth(), Settings::get().getPresentHeight(), Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
-	}
-	HRESULT res = d3ddev->CreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
-	return res;
-}
-
-HRESULT RSManager::redirectSetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
-{
-	nrts++;
-	if (capturing)
-	{
-		CComPtr<IDirect3DSurface9> oldRenderTarget, depthStencilSurface;
-		d3ddev->GetRenderTarget(0, &oldRenderTarget);
-		d3ddev->GetDepthStencilSurface(&depthStencilSurface);
-		char buffer[64];
-		sprintf_s(buffer, "%03d_oldRenderTarget_%p_.tga", nrts, oldRenderTarget.p);
-		SDLOG(0, "Capturing surface %p as %s", oldRenderTarget, buffer);
-		D3DXSaveSurfaceToFile(buffer, D3DXIFF_TGA, oldRenderTarget, NULL, NULL);
-		if (depthStencilSurface)
-		{
-			sprintf_s(buffer, "%03d_oldRenderTargetDepth_%p_.tga", nrts, oldRenderTarget.p);
-			SDLOG(0, "Capturing depth surface %p as %s", depthStencilSurface, buffer);
-			D3DXSaveSurfaceToFile(buffer, D3DXIFF_TGA, depthStencilSurface, NULL, NULL);
-		}
-	}
-
-	if (nrts == 1)   // we are switching to the RT that will be the main rendering target for this frame
-	{
-		// store it for later use
-		mainRT = pRenderTarget;
-		SDLOG(0, "Storing RT as main RT: %p", mainRT);
-	}
-
-	if (nrts == 11)   // we are switching to the RT used to store the Z value in the 24 RGB bits (among other things)
-	{
-		// lets store it for later use
-		zSurf = pRenderTarget;
-		SDLOG(0, "Storing RT as Z buffer RT: %p", zSurf);
-	}
-
-	if (mainRT && pRenderTarget == mainRT)
-	{
-		SDLOG(0, "MainRT uses: %d + 1", mainRTuses);
-		++mainRTuses;
-	}
+	if (capturing) FrameCapture::get().captureStage(oldRenderTarget, pipeline.getRenderTargetSwitches(), events);
 
 	// we are switching away from the initial 3D-rendered image, do AA and SSAO
-	if (mainRTuses == 2 && mainRT && zSurf && ((ssao && doSsao) || (doAA && (smaa || fxaa))))
+	if (PipelineDetector::has(events, PipelineDetector::SceneDone) && pipeline.getZRT() && ((ssao && doSsao) || (doAA && (smaa || fxaa))))
 	{
-		CComPtr<IDirect3DSurface9> oldRenderTarget;
-		d3ddev->GetRenderTarget(0, &oldRenderTarget);
-		if (oldRenderTarget == mainRT)
+		// final renderbuffer has to be from texture, just making sure here
+		IDirect3DTexture9* tex = oldInfo ? oldInfo->texture : NULL;
+		if (tex)
 		{
-			// final renderbuffer has to be from texture, just making sure here
-			CComPtr<IDirect3DTexture9> tex = getSurfTexture(oldRenderTarget);
-			if (tex)
+			// check size just to make even more sure
+			if (isRenderSized(oldInfo))
 			{
-				// check size just to make even more sure
-				D3DSURFACE_DESC desc;
-				oldRenderTarget->GetDesc(&desc);
-				if (desc.Width == Settings::get().getRenderWidth() && desc.Height == Settings::get().getRenderHeight())
+				const SurfaceInfo* zInfo = getSurfaceInfo(pipeline.getZRT());
+				IDirect3DTexture9* zTex = zInfo ? zInfo->texture : NULL;
+				//if(takeScreenshot) D3DXSaveTextureToFile("0effect_pre.bmp", D3DXIFF_BMP, tex, NULL);
+				//if(takeScreenshot) D3DXSaveTextureToFile("0effect_z.bmp", D3DXIFF_BMP, zTex, NULL);
+				storeRenderState();
+				d3ddev->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+				d3ddev->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
+				d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
+				// decode depth once for all effects using it
+				bool depthReady = false;
+				if (depthPyramid && zTex && ssao && doSsao)
 				{
-					CComPtr<IDirect3DTexture9> zTex = getSurfTexture(zSurf);
-					//if(takeScreenshot) D3DXSaveTextureToFile("0effect_pre.bmp", D3DXIFF_BMP, tex, NULL);
-					//if(takeScreenshot) D3DXSaveTextureToFile("0effect_z.bmp", D3DXIFF_BMP, zTex, NULL);
-					storeRenderState();
-					d3ddev->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
-					d3ddev->SetRenderState(D3DRS_CULLMODE, D3DCULL_CCW);
-					d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
-					// perform AA processing
-					if (!lowFPSmode && doAA && (smaa || fxaa))
-					{
-						if (smaa) smaa->go(tex, tex, rgbaBuffer1Surf, SMAA::INPUT_COLOR);
-						else fxaa->go(tex, rgbaBuffer1Surf);
-						d3ddev->StretchRect(rgbaBuffer1Surf, NULL, oldRenderTarget, NULL, D3DTEXF_NONE);
-					}
-					// perform SSAO
-					if (ssao && doSsao)
+					depthPyramid->go(zTex);
+					depthReady = true;
+				}
+				bool doingAA = !lowFPSmode && doAA && (smaa || fxaa);
+				bool doingSsao = ssao && doSsao && depthReady;
+				// with both, the SSAO combine pass does the last AA pass as well, saving a full screen pass and copy
+				bool fusedAA = doingAA && doingSsao && ssao->getFusedAA() == (smaa ? SSAO::AA_SMAA : SSAO::AA_FXAA);
+				IDirect3DTexture9* smaaBlend = NULL;
+				// perform AA processing
+				if (doingAA)
+				{
+					if (smaa)
 					{
-						ssao->go(tex, zTex, rgbaBuffer1Surf);
-						d3ddev->StretchRect(rgbaBuffer1Surf, NULL, oldRenderTarget, NULL, D3DTEXF_NONE);
+						// the edge detection marks edges in the stencil of our depthStencilSurf, the blending weights
+						// are only calculated where it is set, so it has to start out clear
+						d3ddev->Clear(0, NULL, D3DCLEAR_STENCIL, 0, 1.0f, 0);
+						if (fusedAA) smaaBlend = smaa->goWeightsOnly(tex, SMAA::INPUT_COLOR);
+						else smaa->go(tex, tex, rgbaBuffer1Surf, SMAA::INPUT_COLOR);
 					}
-					restoreRenderState();
-					//if(takeScreenshot) D3DXSaveSurfaceToFile("1effect_buff.bmp", D3DXIFF_BMP, rgbaBuffer1Surf, NULL, NULL);
-					//if(takeScreenshot) D3DXSaveSurfaceToFile("1effect_post.bmp", D3DXIFF_BMP, oldRenderTarget, NULL, NULL);
+					else if (!fusedAA) fxaa->go(tex, rgbaBuffer1Surf);
+					if (!fusedAA) d3ddev->StretchRect(rgbaBuffer1Surf, NULL, oldRenderTarget, NULL, D3DTEXF_NONE);
+				}
+				// perform SSAO
+				if (doingSsao)
+				{
+					ssao->go(tex, depthPyramid->getTexture(), rgbaBuffer1Surf, fusedAA, smaaBlend);
+					d3ddev->StretchRect(rgbaBuffer1Surf, NULL, oldRenderTarget, NULL, D3DTEXF_NONE);
 				}
+				restoreRenderState();
+				//if(takeScreenshot) D3DXSaveSurfaceToFile("1effect_buff.bmp", D3DXIFF_BMP, rgbaBuffer1Surf, NULL, NULL);
+				//if(takeScreenshot) D3DXSaveSurfaceToFile("1effect_post.bmp", D3DXIFF_BMP, oldRenderTarget, NULL, NULL);
 			}
 		}
 	}
 
 	// DoF blur stuff
-	if (gauss && doDofGauss)
+	if (PipelineDetector::has(events, PipelineDetector::DofBlur) && gauss && doDofGauss)
 	{
-		CComPtr<IDirect3DSurface9> oldRenderTarget;
-		d3ddev->GetRenderTarget(0, &oldRenderTarget);
-		D3DSURFACE_DESC desc;
-		oldRenderTarget->GetDesc(&desc);
-		unsigned dofIndex = isDof(desc.Width, desc.Height);
-		if (dofIndex)
+		//if(takeScreenshot) D3DXSaveSurfaceToFile("dof1.bmp", D3DXIFF_BMP, oldRenderTarget, NULL, NULL);
+		IDirect3DTexture9* oldRTtex = oldInfo->texture;
+		if (oldRTtex)
 		{
-			doft[dofIndex]++;
-			SDLOG(6, "DOF index: %u, doft: %u", dofIndex, doft[dofIndex]);
-			//if(takeScreenshot) {
-			//	char buffer[256];
-			//	sprintf(buffer, "dof%1u_doft%1u.bmp", dofIndex, doft[dofIndex]);
-			//	D3DXSaveSurfaceToFile(buffer, D3DXIFF_BMP, oldRenderTarget, NULL, NULL);
-			//}
-			if (dofIndex == 1 && doft[1] == 4)
-			{
-				CComPtr<IDirect3DTexture9> oldRTtex = getSurfTexture(oldRenderTarget);
-				if (oldRTtex)
-				{
-					storeRenderState();
-					for (size_t i = 0; i < Settings::get().getDOFBlurAmount(); ++i) gauss->go(oldRTtex, oldRenderTarget);
-					restoreRenderState();
-				}
-			}
+			storeRenderState();
+			gauss->go(oldRTtex, oldRenderTarget);
+			restoreRenderState();
 		}
 	}
 
 	// Timing for hudless screenshots
-	if (mainRTuses == 11 && takeScreenshot)
+	if (PipelineDetector::has(events, PipelineDetector::HudlessFrame) && takeScreenshot && oldInfo)
 	{
-		CComPtr<IDirect3DSurface9> oldRenderTarget;
-		d3ddev->GetRenderTarget(0, &oldRenderTarget);
-		if (oldRenderTarget != mainRT)
-		{
-			static int toggleSS = 0;
-			toggleSS = (toggleSS + 1) % 2;
-			if (!toggleSS)
-			{
-				takeScreenshot = false;
-				SDLOG(0, "Capturing screenshot");
-				char timebuf[128], buffer[512];
-				time_t ltime;
-				time(&ltime);
-				struct tm timeinfo;
-				localtime_s(&timeinfo, &ltime);
-
-				strftime(timebuf, 128, "screenshot_%Y-%m-%d_%H-%M-%S.png", &timeinfo);
-				sprintf_s(buffer, "%s\\%s", Settings::get().getScreenshotDir().c_str(), timebuf);
-				SDLOG(0, " - to %s", buffer);
-
-				D3DSURFACE_DESC desc;
-				oldRenderTarget->GetDesc(&desc);
-				CComPtr<IDirect3DSurface9> convertedSurface;
-				d3ddev->CreateRenderTarget(desc.Width, desc.Height, D3DFMT_X8R8G8B8, D3DMULTISAMPLE_NONE, 0, true, &convertedSurface, NULL);
-				D3DXLoadSurfaceFromSurface(convertedSurface, NULL, NULL, oldRenderTarget, NULL, NULL, D3DX_FILTER_POINT, 0);
-				D3DXSaveSurfaceToFile(buffer, D3DXIFF_PNG, convertedSurface, NULL, NULL);
-			}
-		}
-	}
+		takeScreenshot = false;
+		SDLOG(0, "Capturing screenshot");
+		char timebuf[128], buffer[512];
+		time_t ltime;
+		time(&ltime);
+		struct tm timeinfo;
+		localtime_s(&timeinfo, &ltime);
 
-	if (rddp >= 4)   // we just finished rendering the frame (pre-HUD)
-	{
-		CComPtr<IDirect3DSurface9>oldRenderTarget;
-		d3ddev->GetRenderTarget(0, &oldRenderTarget);
-		// final renderbuffer has to be from texture, just making sure here
-		CComPtr <IDirect3DTexture9> tex = getSurfTexture(oldRenderTarget);
-		if (tex)
-		{
-			// check size just to make even more sure
-			D3DSURFACE_DESC desc;
-			oldRenderTarget->GetDesc(&desc);
-			if (desc.Width == Settings::get().getRenderWidth() && desc.Height == Settings::get().getRenderHeight())
-			{
-				// HUD stuff
-				if (hud && doHud && rddp == 9)
-				{
-					SDLOG(0, "Starting HUD rendering");
-					hddp = 0;
-					onHudRT = true;
-					d3ddev->SetRenderTarget(0, rgbaBuffer1Surf);
-					d3ddev->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_RGBA(0, 0, 0, 0), 0.0f, 0);
-					prevRenderTex = tex;
-					prevRenderTarget = pRenderTarget;
-
-					d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
-					d3ddev->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_ADD);
-					d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-					d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
-					return S_OK;
-				}
-			}
-		}
-	}
-	if (onHudRT)
-	{
-		finishHudRendering();
+		strftime(timebuf, 128, "screenshot_%Y-%m-%d_%H-%M-%S.", &timeinfo);
+		strcat_s(timebuf, Settings::get().getScreenshotFormat() == "qoi" ? "qoi" : "png");
+		sprintf_s(buffer, "%s\\%s", Settings::get().getScreenshotDir().c_str(), timebuf);
+		SDLOG(0, " - to %s", buffer);
+
+		// read back and written over the next frames
+		ScreenshotManager::get().capture(oldRenderTarget, buffer);
 	}
-	if (rddp < 4 || rddp > 8) rddp = 0;
-	else rddp++;
-	return d3ddev->SetRenderTarget(RenderTargetIndex, pRenderTarget);
 }
 
 HRESULT RSManager::redirectStretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter)
@@ -478,12 +374,30 @@ HRESULT RSManager::redirectStretchRect(IDirect3DSurface9* pSourceSurface, CONST
 	//	if(capturing) dumpSurface("redirectStretchRect", it->second);
 	//	return d3ddev->StretchRect(it->second, pSourceRect, pDestSurface, pDestRect, Filter);
 	//}
+	// the final scale from the render to the present resolution
+	if (scaler && !pSourceRect && !pDestRect)
+	{
+		const SurfaceInfo* srcInfo = getSurfaceInfo(pSourceSurface);
+		D3DSURFACE_DESC desc;
+		if (isRenderSized(srcInfo) && SUCCEEDED(pDestSurface->GetDesc(&desc))
+			&& desc.Width == Settings::get().getPresentWidth() && desc.Height == Settings::get().getPresentHeight())
+		{
+			CComPtr<IDirect3DSurface9> renderTarget, depthStencil;
+			d3ddev->GetRenderTarget(0, &renderTarget);
+			d3ddev->GetDepthStencilSurface(&depthStencil);
+			storeRenderState();
+			scaler->go(pSourceSurface, srcInfo->texture, pDestSurface);
+			d3ddev->SetRenderTarget(0, renderTarget);
+			d3ddev->SetDepthStencilSurface(depthStencil);
+			restoreRenderState();
+			return D3D_OK;
+		}
+	}
 	return d3ddev->StretchRect(pSourceSurface, pSourceRect, pDestSurface, pDestRect, D3DTEXF_LINEAR);
 }
 
-HRESULT RSManager::redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9 * pTexture)
+void RSManager::textureSet(DWORD Stage, IDirect3DBaseTexture9* pTexture)
 {
-	if (pTexture == NULL) return d3ddev->SetTexture(Stage, pTexture);
 	//TexIntMap::iterator it = renderTexIndices.find((IDirect3DTexture9*)pTexture);
 	//if(it != renderTexIndices.end() && it->second == 2) {
 	//	IDirect3DSurface9* surf0;
@@ -501,50 +415,19 @@ HRESULT RSManager::redirectSetTexture(DWORD Stage, IDirect3DBaseTexture9 * pText
 	//	sprintf(buffer, "tex%4d__", index);
 	//	dumpSurface(buffer, surf);
 	//}
-	if (Settings::get().getSkipIntro() && !timingIntroMode && isTextureBandainamcoLogo(pTexture))
-	{
-		SDLOG(1, "Intro mode started!");
-		timingIntroMode = true;
-	}
-	if (timingIntroMode && (isTextureGuiElements1(pTexture) || isTextureMenuscreenLogo(pTexture) || isTextureText(pTexture)))
-	{
-		SDLOG(1, "Intro mode ended due to texture!");
-		timingIntroMode = false;
-	}
-	if (!hudStarted && isTextureHudHealthbar(pTexture))
-	{
-		SDLOG(1, "HUD started!");
-		hudStarted = true;
-	}
-
-	if (pTexture && rddp == 0 && Stage == 0)
+	if (!headless)
 	{
-		++rddp;
-	}
-	else if (pTexture && rddp == 1 && Stage == 1)
-	{
-		++rddp;
-	}
-	else if (pTexture && rddp == 2 && Stage == 2)
-	{
-		++rddp;
-	}
-	else if (pTexture && rddp == 3 && Stage == 3)
-	{
-		++rddp;
+		if (Settings::get().getSkipIntro() && !timingIntroMode && isTextureBandainamcoLogo(pTexture))
+		{
+			SDLOG(1, "Intro mode started!");
+			timingIntroMode = true;
+		}
+		if (timingIntroMode && (isTextureGuiElements1(pTexture) || isTextureMenuscreenLogo(pTexture) || isTextureText(pTexture)))
+		{
+			SDLOG(1, "Intro mode ended due to texture!");
+			timingIntroMode = false;
+		}
 	}
-	else rddp = 0;
-	return d3ddev->SetTexture(Stage, pTexture);
-}
-
-HRESULT RSManager::redirectSetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
-{
-	//if(lastReplacement >= 0) {
-	//	SDLOG(1, "Redirected SetDepthStencilSurface(%p) to %p", pNewZStencil, renderTexDSBuffers[lastReplacement]);
-	//	d3ddev->SetDepthStencilSurface(renderTexDSBuffers[lastReplacement]);
-	//}
-	//lastReplacement = -1;
-	return d3ddev->SetDepthStencilSurface(pNewZStencil);
 }
 
 unsigned RSManager::getTextureIndex(IDirect3DTexture9* ppTexture)
@@ -557,38 +440,30 @@ unsigned RSManager::getTextureIndex(IDirect3DTexture9* ppTexture)
 void RSManager::registerD3DXCreateTextureFromFileInMemory(LPCVOID pSrcData, UINT SrcDataSize, LPDIRECT3DTEXTURE9 pTexture)
 {
 	SDLOG(1, "RenderstateManager: registerD3DXCreateTextureFromFileInMemory %p", pTexture);
+	bool tracing = CallTrace::get().isRecording();
+	if (!Settings::get().getEnableTextureDumping() && !tracing && foundKnownTextures >= numKnownTextures) return;
+
+	UINT32 hash = SuperFastHash((char*)const_cast<void*>(pSrcData), SrcDataSize);
+	if (tracing) CallTrace::get().recordTextureHash(pTexture, hash);
 	if (Settings::get().getEnableTextureDumping())
 	{
-		UINT32 hash = SuperFastHash((char*)const_cast<void*>(pSrcData), SrcDataSize);
 		SDLOG(1, " - size: %8u, hash: %8x", SrcDataSize, hash);
 
 		CComPtr<IDirect3DSurface9> surf;
 		pTexture->GetSurfaceLevel(0, &surf);
 		char buffer[128];
-		sprintf_s(buffer, "dsfix/tex_dump/%08x.tga", hash);
-		D3DXSaveSurfaceToFile(GetDirectoryFile(buffer), D3DXIFF_TGA, surf, NULL, NULL);
+		sprintf_s(buffer, "dsfix/tex_dump/%08x.png", hash);
+		ImageWriter::get().writeSurface(surf, GetDirectoryFile(buffer), true);
 	}
-	registerKnowTexture(pSrcData, SrcDataSize, pTexture);
+	registerKnownTexture(hash, pTexture);
 }
 
-void RSManager::registerKnowTexture(LPCVOID pSrcData, UINT SrcDataSize, LPDIRECT3DTEXTURE9 pTexture)
+void RSManager::traceKnownTextures()
 {
-	if (foundKnownTextures < numKnownTextures)
-	{
-		UINT32 hash = SuperFastHash((char*)const_cast<void*>(pSrcData), SrcDataSize);
 #define TEXTURE(_name, _hash) \
-		if(hash == _hash) { \
-			texture##_name = pTexture; \
-			++foundKnownTextures; \
-			SDLOG(1, "RenderstateManager: recognized known texture %s at %u", #_name, pTexture); \
-		}
+	if(texture##_name) CallTrace::get().recordTextureHash(texture##_name, _hash);
 #include "Textures.def"
 #undef TEXTURE
-		if (foundKnownTextures == numKnownTextures)
-		{
-			SDLOG(1, "RenderstateManager: all known textures found!");
-		}
-	}
 }
 
 void RSManager::registerD3DXCompileShader(LPCSTR pSrcData, UINT srcDataLen, const D3DXMACRO* pDefines, LPD3DXINCLUDE pInclude, LPCSTR pFunctionName, LPCSTR pProfile, DWORD Flags, LPD3DXBUFFER * ppShader, LPD3DXBUFFER * ppErrorMsgs, LPD3DXCONSTANTTABLE * ppConstantTable)
@@ -597,15 +472,6 @@ void RSManager::registerD3DXCompileShader(LPCSTR pSrcData, UINT srcDataLen, cons
 	SDLOG(0, "============= source:\n%s\n====================", pSrcData);
 }
 
-IDirect3DTexture9* RSManager::getSurfTexture(IDirect3DSurface9* pSurface)
-{
-	CComPtr<IUnknown> pContainer;
-	HRESULT hr = pSurface->GetContainer(IID_IDirect3DTexture9, (void**)&pContainer);
-	if (D3D_OK == hr)
-		return (IDirect3DTexture9*)pContainer.Detach();
-	return NULL;
-}
-
 void RSManager::enableSingleFrameCapture()
 {
 	captureNextFrame = true;
@@ -635,7 +501,7 @@ void RSManager::reloadScao()
 
 void RSManager::reloadGauss()
 {
-	gauss.reset(new GAUSS(d3ddev, Settings::get().getDOFOverrideResolution() * 16 / 9, Settings::get().getDOFOverrideResolution()));
+	gauss.reset(new GAUSS(d3ddev, Settings::get().getDOFOverrideResolution() * 16 / 9, Settings::get().getDOFOverrideResolution(), Settings::get().getDOFBlurAmount()));
 	SDLOG(0, "Reloaded GAUSS");
 }
 
@@ -652,154 +518,12 @@ void RSManager::reloadAA()
 	SDLOG(0, "Reloaded AA");
 }
 
-HRESULT RSManager::redirectDrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
-{
-	if (hudStarted && hideHud)
-	{
-		return D3D_OK;
-	}
-	bool isTargetIndicator = false;
-	if (pausedHudRT)
-	{
-		CComPtr<IDirect3DBaseTexture9> t;
-		d3ddev->GetTexture(0, &t);
-		// check for target indicator
-		if (isTextureHudHealthbar(t))
-		{
-			INT16 *vertices = (INT16*)pVertexStreamZeroData;
-			if (vertices[3] > -2000)
-			{
-				resumeHudRendering();
-			}
-		}
-		else
-		{
-			resumeHudRendering();
-		}
-	}
-	if (onHudRT)
-	{
-		CComPtr<IDirect3DBaseTexture9> t;
-		d3ddev->GetTexture(0, &t);
-		SDLOG(4, "On HUD, redirectDrawIndexedPrimitiveUP texture: %s", getTextureName(t));
-		if ((hddp < 5 && isTextureHudHealthbar(t)) || (hddp >= 5 && hddp < 7 && isTextureCategoryIconsHumanityCount(t)) || (hddp >= 7 && !isTextureCategoryIconsHumanityCount(t))) hddp++;
-		// check for target indicator
-		if (isTextureHudHealthbar(t))
-		{
-			INT16 *vertices = (INT16*)pVertexStreamZeroData;
-			if (vertices[3] < -2000)
-			{
-				isTargetIndicator = true;
-				pauseHudRendering();
-			}
-		}
-		if (hddp == 8)
-		{
-			finishHudRendering();
-		}
-		else if (!isTargetIndicator)
-		{
-			//d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
-			//d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_ADD);
-			//d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
-			//d3ddev->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_CURRENT);
-		}
-	}
-	HRESULT hr = d3ddev->DrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
-	//if(onHudRT) {
-	//	if(takeScreenshot) dumpSurface("HUD_IndexPrimUP", rgbaBuffer1Surf);
-	//}
-	return hr;
-}
-
-HRESULT RSManager::redirectDrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride)
-{
-	if (hudStarted && hideHud)
-	{
-		CComPtr<IDirect3DBaseTexture9> t;
-		d3ddev->GetTexture(0, &t);
-		bool hide = isTextureText(t);
-		hide = hide || isTextureButtonsEffects(t);
-		hide = hide || isTextureHudEffectIcons(t);
-		if (hide) return D3D_OK;
-	}
-	if (pausedHudRT)
-	{
-		CComPtr<IDirect3DBaseTexture9> t;
-		d3ddev->GetTexture(0, &t);
-		bool isText = isTextureText(t);
-		SDLOG(4, "On HUD, PAUSED, redirectDrawPrimitiveUP texture: %s", getTextureName(t));
-		//// Print vertices
-		//SDLOG(0, "Vertices: ");
-		//INT16 *values = (INT16*)pVertexStreamZeroData;
-		//for(size_t i=0; i<PrimitiveCount+2; ++i) {
-		//	SDLOG(0, "%8hd, ", values[i]);
-		//	if((i+1)%2 == 0) SDLOG(0, "; ");
-		//	if((i+1)%8 == 0) SDLOG(0, "");
-		//}
-		if (isText && PrimitiveCount >= 12) resumeHudRendering();
-	}
-	bool subbed = false;
-	if (onHudRT)
-	{
-		CComPtr<IDirect3DBaseTexture9> t;
-		d3ddev->GetTexture(0, &t);
-		bool isText = isTextureText(t);
-		bool isSub = isTextureText00(t);
-		SDLOG(4, "On HUD, redirectDrawPrimitiveUP texture: %s", getTextureName(t));
-		//if(isText && PrimitiveCount <= 10) pauseHudRendering();
-		if (isSub)
-		{
-			pauseHudRendering();
-			subbed = true;
-		}
-	}
-	HRESULT hr = d3ddev->DrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
-	if (subbed) resumeHudRendering();
-	//if(onHudRT) {
-	//	if(takeScreenshot) dumpSurface("HUD_PrimUP", rgbaBuffer1Surf);
-	//}
-	return hr;
-}
-
-void RSManager::reloadHudVertices()
-{
-	SDLOG(0, "Reloading HUD vertices");
-	std::ifstream vfile;
-	vfile.open(GetDirectoryFile("hudvertices.txt"), std::ios::in);
-	if (vfile.is_open())
-	{
-		char buffer[256];
-		size_t index = 0;
-		SDLOG(0, "- starting");
-		while (!vfile.eof())
-		{
-			vfile.getline(buffer, 256);
-			if (buffer[0] == '#') continue;
-			if (vfile.gcount() <= 4) continue;
-
-			sscanf_s(buffer, "%hd %hd", &hudVertices[index], &hudVertices[index + 1]);
-			SDLOG(0, "- read %hd, %hd", hudVertices[index], hudVertices[index + 1]);
-			index += 2;
-		}
-		vfile.close();
-	}
-}
-
-bool RSManager::isTextureText(IDirect3DBaseTexture9* t)
+void RSManager::reloadHudLayout()
 {
-	return isTextureText00(t) || isTextureText01(t) || isTextureText02(t) || isTextureText03(t)
-		|| isTextureText04(t) || isTextureText05(t) || isTextureText06(t) || isTextureText07(t)
-		|| isTextureText08(t) || isTextureText09(t) || isTextureText10(t) || isTextureText11(t)
-		|| isTextureText12(t);
-}
-
-unsigned RSManager::isDof(unsigned width, unsigned height)
-{
-	unsigned topWidth = Settings::get().getDOFOverrideResolution() * 16 / 9, topHeight = Settings::get().getDOFOverrideResolution();
-	if (width == topWidth && height == topHeight) return 1;
-	if (width == topWidth / 2 && height == topHeight / 2) return 2;
-	return 0;
+	hudLayout->load();
+	// the composite depends on whether the layout scales the HUD
+	if (hud) hud.reset(new HUD(d3ddev, Settings::get().getRenderWidth(), Settings::get().getRenderHeight()));
+	SDLOG(0, "Reloaded HUD layout");
 }
 
 HRESULT RSManager::redirectD3DXCreateTextureFromFileInMemoryEx(LPDIRECT3DDEVICE9 pDevice, LPCVOID pSrcData, UINT SrcDataSize, UINT Width, UINT Height, UINT MipLevels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, DWORD Filter, DWORD MipFilter, D3DCOLOR ColorKey, D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette, LPDIRECT3DTEXTURE9* ppTexture)
@@ -857,69 +581,14 @@ void RSManager::restoreRenderState()
 	prevStateBlock->Apply();
 }
 
-const char* RSManager::getTextureName(IDirect3DBaseTexture9* pTexture)
-{
-#define TEXTURE(_name, _hash) \
-	if(texture##_name == pTexture) return #_name;
-#include "Textures.def"
-#undef TEXTURE
-	return "Unknown";
-}
-
-void RSManager::finishHudRendering()
+void RSManager::compositeHud()
 {
-	SDLOG(2, "FinishHudRendering");
-	if (takeScreenshot) dumpSurface("HUD_end", rgbaBuffer1Surf);
-	d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
-	d3ddev->SetRenderTarget(0, prevRenderTarget);
-	onHudRT = false;
-	// draw HUD to screen
+	if (takeScreenshot) dumpSurface("HUD_end", hudLayerSurf);
 	storeRenderState();
-	hud->go(rgbaBuffer1Tex, prevRenderTarget);
+	hud->go(hudLayerTex, prevRenderTarget);
 	restoreRenderState();
 }
 
-void RSManager::pauseHudRendering()
-{
-	SDLOG(3, "PauseHudRendering");
-	d3ddev->SetRenderTarget(0, prevRenderTarget);
-	d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE);
-	d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_BLENDTEXTUREALPHA);
-	onHudRT = false;
-	pausedHudRT = true;
-}
-
-void RSManager::resumeHudRendering()
-{
-	SDLOG(3, "ResumeHudRendering");
-	d3ddev->SetRenderTarget(0, rgbaBuffer1Surf);
-	d3ddev->SetRenderState(D3DRS_COLORWRITEENABLE, D3DCOLORWRITEENABLE_RED | D3DCOLORWRITEENABLE_GREEN | D3DCOLORWRITEENABLE_BLUE | D3DCOLORWRITEENABLE_ALPHA);
-	d3ddev->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
-	onHudRT = true;
-	pausedHudRT = false;
-}
-
-HRESULT RSManager::redirectSetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
-{
-	//if(allowStateChanges()) {
-	return d3ddev->SetTextureStageState(Stage, Type, Value);
-	//} else {
-	//	SDLOG(3, "SetTextureStageState suppressed: %u  -  %u  -  %u", Stage, Type, Value);
-	//}
-	//return D3D_OK;
-}
-
-HRESULT RSManager::redirectSetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
-{
-	if (State == D3DRS_COLORWRITEENABLE && !allowStateChanges()) return D3D_OK;
-	//if(allowStateChanges()) {
-	return d3ddev->SetRenderState(State, Value);
-	//} else {
-	//	SDLOG(3, "SetRenderState suppressed: %u  -  %u", State, Value);
-	//}
-	//return D3D_OK;
-}
-
 void RSManager::frameTimeManagement()
 {
 	double renderTime = getElapsedTime() - lastPresentTime;
@@ -0,0 +1,181 @@
+
+#include "ResolutionRules.h"
+
+#include "main.h"
+#include "d3dutil.h"
+
+ResolutionRules ResolutionRules::instance;
+
+static const struct
+{
+	const char* name;
+	unsigned kinds;
+} kindNames[] =
+{
+	{ "any", ResolutionRules::ALL_KINDS },
+	{ "texture", ResolutionRules::TEXTURE },
+	{ "rendertexture", ResolutionRules::RENDER_TEXTURE },
+	{ "depthtexture", ResolutionRules::DEPTH_TEXTURE },
+	{ "rendersurface", ResolutionRules::RENDER_SURFACE },
+	{ "depthsurface", ResolutionRules::DEPTH_SURFACE },
+	{ "textures", ResolutionRules::TEXTURE | ResolutionRules::RENDER_TEXTURE | ResolutionRules::DEPTH_TEXTURE },
+	{ "render", ResolutionRules::RENDER_TEXTURE | ResolutionRules::RENDER_SURFACE },
+	{ "depth", ResolutionRules::DEPTH_TEXTURE | ResolutionRules::DEPTH_SURFACE },
+};
+
+// formats which can be named in rules, others by their number
+static const D3DFORMAT namedFormats[] =
+{
+	D3DFMT_A8R8G8B8, D3DFMT_X8R8G8B8, D3DFMT_R5G6B5, D3DFMT_A2R10G10B10, D3DFMT_A2B10G10R10, D3DFMT_A8B8G8R8,
+	D3DFMT_G16R16, D3DFMT_A16B16G16R16, D3DFMT_R16F, D3DFMT_G16R16F, D3DFMT_A16B16G16R16F, D3DFMT_R32F,
+	D3DFMT_G32R32F, D3DFMT_A32B32G32R32F, D3DFMT_A8, D3DFMT_L8, D3DFMT_L16, D3DFMT_D16, D3DFMT_D24S8,
+	D3DFMT_D24X8, D3DFMT_D32, D3DFMT_D32F_LOCKABLE, D3DFMT_DXT1, D3DFMT_DXT3, D3DFMT_DXT5
+};
+
+void ResolutionRules::add(const Rule& rule)
+{
+	// the ini rules go before the built-in ones
+	std::vector<Rule>& list = rules[key(rule.width, rule.height)];
+	std::vector<Rule>::iterator it = list.begin();
+	if (!rule.builtin)
+	{
+		while (it != list.end() && !it->builtin) ++it;
+	}
+	else
+	{
+		it = list.end();
+	}
+	list.insert(it, rule);
+}
+
+bool ResolutionRules::parse(const char* text)
+{
+	char kind[32], format[32], target[32];
+	Rule rule;
+	if (sscanf_s(text, "%ux%u %31s %31s %31s", &rule.width, &rule.height, kind, (unsigned)_countof(kind),
+		format, (unsigned)_countof(format), target, (unsigned)_countof(target)) != 5)
+	{
+		SDLOG(0, "ResolutionRules: ignoring \"%s\", expected <width>x<height> <kind> <format> <target>", text);
+		return false;
+	}
+
+	rule.kinds = 0;
+	for (size_t i = 0; i < _countof(kindNames); ++i)
+	{
+		if (_stricmp(kind, kindNames[i].name) == 0) rule.kinds = kindNames[i].kinds;
+	}
+	if (rule.kinds == 0)
+	{
+		SDLOG(0, "ResolutionRules: unknown kind \"%s\" in \"%s\"", kind, text);
+		return false;
+	}
+
+	rule.format = D3DFMT_UNKNOWN;
+	if (_stricmp(format, "any") != 0)
+	{
+		for (size_t i = 0; i < _countof(namedFormats); ++i)
+		{
+			if (_stricmp(format, D3DFormatToString(namedFormats[i], false)) == 0) rule.format = namedFormats[i];
+		}
+		unsigned number;
+		if (rule.format == D3DFMT_UNKNOWN && sscanf_s(format, "%u", &number) == 1) rule.format = (D3DFORMAT)number;
+		if (rule.format == D3DFMT_UNKNOWN)
+		{
+			SDLOG(0, "ResolutionRules: unknown format \"%s\" in \"%s\"", format, text);
+			return false;
+		}
+	}
+
+	rule.scale = 1.0f;
+	rule.targetWidth = rule.targetHeight = 0;
+	if (_stricmp(target, "keep") == 0) rule.target = KEEP;
+	else if (_stricmp(target, "render") == 0) rule.target = RENDER;
+	else if (_stricmp(target, "present") == 0) rule.target = PRESENT;
+	else if (_stricmp(target, "dof") == 0) rule.target = DOF;
+	else if (target[0] == '*' && sscanf_s(target + 1, "%f", &rule.scale) == 1 && rule.scale > 0.0f) rule.target = SCALE;
+	else if (sscanf_s(target, "%ux%u", &rule.targetWidth, &rule.targetHeight) == 2 && rule.targetWidth > 0 && rule.targetHeight > 0) rule.target = SIZE;
+	else
+	{
+		SDLOG(0, "ResolutionRules: unknown target \"%s\" in \"%s\"", target, text);
+		return false;
+	}
+
+	rule.builtin = false;
+	add(rule);
+	SDLOG(0, "ResolutionRules: %s", text);
+	return true;
+}
+
+void ResolutionRules::addBuiltinRules()
+{
+	// the main buffers of the game, DoF and the textures at the size of the 1280x720 backbuffer
+	static const Rule builtinRules[] =
+	{
+		{ 1024, 720, ALL_KINDS, D3DFMT_UNKNOWN, RENDER, 1.0f, 0, 0, true },
+		{ 512, 360, TEXTURE | RENDER_TEXTURE | DEPTH_TEXTURE, D3DFMT_UNKNOWN, DOF, 1.0f, 0, 0, true },
+		{ 256, 180, TEXTURE | RENDER_TEXTURE | DEPTH_TEXTURE, D3DFMT_UNKNOWN, DOF, 1.0f, 0, 0, true },
+		{ 1280, 720, TEXTURE | RENDER_TEXTURE | DEPTH_TEXTURE, D3DFMT_UNKNOWN, PRESENT, 1.0f, 0, 0, true },
+	};
+	for (size_t i = 0; i < _countof(builtinRules); ++i) add(builtinRules[i]);
+}
+
+const ResolutionRules::Rule* ResolutionRules::find(UINT width, UINT height, Kind kind, D3DFORMAT format) const
+{
+	RuleMap::const_iterator it = rules.find(key(width, height));
+	if (it == rules.end()) return NULL;
+	for (size_t i = 0; i < it->second.size(); ++i)
+	{
+		const Rule& rule = it->second[i];
+		if ((rule.kinds & kind) && (rule.format == D3DFMT_UNKNOWN || rule.format == format)) return &rule;
+	}
+	return NULL;
+}
+
+ResolutionRules::Target ResolutionRules::apply(UINT& width, UINT& height, Kind kind, D3DFORMAT format) const
+{
+	const Rule* rule = find(width, height, kind, format);
+	if (!rule) return KEEP;
+	UINT w = width, h = height;
+	switch (rule->target)
+	{
+	case RENDER:
+		w = Settings::get().getRenderWidth();
+		h = Settings::get().getRenderHeight();
+		break;
+	case PRESENT:
+		w = Settings::get().getPresentWidth();
+		h = Settings::get().getPresentHeight();
+		break;
+	case DOF:
+		if (Settings::get().getDOFOverrideResolution())
+		{
+			// the game's DoF buffers are 360 and 180 high, larger ones from ini rules get the full DoF resolution
+			UINT divFactor = Settings::get().getDisableDofScaling() ? 1 : std::max(1u, 360 / height);
+			w = Settings::get().getDOFOverrideResolution() * 16 / 9 / divFactor;
+			h = Settings::get().getDOFOverrideResolution() / divFactor;
+		}
+		break;
+	case SCALE:
+		w = std::max(1u, (UINT)(width * rule->scale + 0.5f));
+		h = std::max(1u, (UINT)(height * rule->scale + 0.5f));
+		break;
+	case SIZE:
+		w = rule->targetWidth;
+		h = rule->targetHeight;
+		break;
+	default:
+		break;
+	}
+	if (w != width || h != height) SDLOG(1, " - OVERRIDE to %4u/%4u!", w, h);
+	width = w;
+	height = h;
+	return rule->target;
+}
+
+unsigned ResolutionRules::isDof(UINT width, UINT height)
+{
+	UINT topWidth = Settings::get().getDOFOverrideResolution() * 16 / 9, topHeight = Settings::get().getDOFOverrideResolution();
+	if (width == topWidth && height == topHeight) return 1;
+	if (width == topWidth / 2 && height == topHeight / 2) return 2;
+	return 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <d3d9.h>
+
+// Resolution overrides for the textures and surfaces the game creates
+// Each rule matches a created size, the kind of resource and a format, and gives the size to create instead:
+// a scale factor, an absolute size, or the render, present or DoF resolution. The rules from the ini
+// ("resolutionRule" lines) come first, in their order, followed by the built-in rules for the main buffers, DoF and
+// the present sized textures. Rules are kept per source size, so a lookup is a hash lookup and a few compares.
+class ResolutionRules
+{
+public:
+	// what is being created, rules match a combination of these
+	enum Kind
+	{
+		TEXTURE = 1, RENDER_TEXTURE = 2, DEPTH_TEXTURE = 4, RENDER_SURFACE = 8, DEPTH_SURFACE = 16,
+		ALL_KINDS = 31
+	};
+
+	enum Target
+	{
+		KEEP, SCALE, SIZE, RENDER, PRESENT, DOF
+	};
+
+	struct Rule
+	{
+		UINT width, height;
+		unsigned kinds;
+		D3DFORMAT format; // D3DFMT_UNKNOWN matches any
+		Target target;
+		float scale;
+		UINT targetWidth, targetHeight;
+		bool builtin;
+	};
+
+private:
+	static ResolutionRules instance;
+
+	typedef std::unordered_map<UINT64, std::vector<Rule> > RuleMap;
+	RuleMap rules;
+
+	static UINT64 key(UINT width, UINT height)
+	{
+		return ((UINT64)width << 32) | height;
+	}
+	void add(const Rule& rule);
+
+public:
+	static ResolutionRules& get()
+	{
+		return instance;
+	}
+
+	void clear()
+	{
+		rules.clear();
+	}
+	// parses the part of an ini line after "resolutionRule", returns false (and logs) if it is invalid
+	bool parse(const char* text);
+	void addBuiltinRules();
+
+	// the first rule matching a resource, NULL if it is created as requested
+	const Rule* find(UINT width, UINT height, Kind kind, D3DFORMAT format) const;
+	// overrides the size with the first matching rule and the current settings, returns the target of the rule
+	Target apply(UINT& width, UINT& height, Kind kind, D3DFORMAT format) const;
+
+	// 1 if a size is the full DoF resolution, 2 if it is the half one, 0 otherwise
+	static unsigned isDof(UINT width, UINT height);
+
+	static Kind textureKind(DWORD usage)
+	{
+		if (usage & D3DUSAGE_RENDERTARGET) return RENDER_TEXTURE;
+		if (usage & D3DUSAGE_DEPTHSTENCIL) return DEPTH_TEXTURE;
+		return TEXTURE;
+	}
+};
@@ -42,8 +42,6 @@
 #include <vector>
 #include <sstream>
 #include "SMAA.h"
-#include "SearchTex.h"
-#include "AreaTex.h"
 
 #include "Settings.h"
 
@@ -66,11 +64,14 @@
 #endif
 #pragma endregion
 
+std::map<IDirect3DDevice9 *, SMAA::LookupTextures> SMAA::sharedLookup;
+
 SMAA::SMAA(IDirect3DDevice9 *device, int width, int height, Preset preset, const ExternalStorage &storage)
 	: Effect(device),
 	  threshold(0.1f),
 	  maxSearchSteps(8),
-	  width(width), height(height)
+	  width(width), height(height),
+	  historyValid(false), current(0)
 {
 	HRESULT hr;
 
@@ -138,9 +139,21 @@ SMAA::SMAA(IDirect3DDevice9 *device, int width, int height, Preset preset, const
 		releaseBlendResources = true;
 	}
 
-	// Load the precomputed textures.
-	loadAreaTex();
-	loadSearchTex();
+	// The temporal mode keeps the AA results of the last two frames.
+	temporal = Settings::get().getAATemporal();
+	if (temporal)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			V(device->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &historyTex[i], NULL));
+			V(historyTex[i]->GetSurfaceLevel(0, &historySurface[i]));
+		}
+	}
+
+	// Get the precomputed textures.
+	loadLookupTextures();
+	areaTex = sharedLookup[device].areaTex;
+	searchTex = sharedLookup[device].searchTex;
 
 	// Create some handles for techniques and variables.
 	thresholdHandle = effect->GetParameterByName(NULL, "threshold");
@@ -151,11 +164,15 @@ SMAA::SMAA(IDirect3DDevice9 *device, int width, int height, Preset preset, const
 	depthTexHandle = effect->GetParameterByName(NULL, "depthTex2D");
 	edgesTexHandle = effect->GetParameterByName(NULL, "edgesTex2D");
 	blendTexHandle = effect->GetParameterByName(NULL, "blendTex2D");
+	previousTexHandle = effect->GetParameterByName(NULL, "previousTex2D");
+	subsampleIndicesHandle = effect->GetParameterByName(NULL, "subsampleIndices");
+	historyValidHandle = effect->GetParameterByName(NULL, "historyValid");
 	lumaEdgeDetectionHandle = effect->GetTechniqueByName("LumaEdgeDetection");
 	colorEdgeDetectionHandle = effect->GetTechniqueByName("ColorEdgeDetection");
 	depthEdgeDetectionHandle = effect->GetTechniqueByName("DepthEdgeDetection");
 	blendWeightCalculationHandle = effect->GetTechniqueByName("BlendWeightCalculation");
 	neighborhoodBlendingHandle = effect->GetTechniqueByName("NeighborhoodBlending");
+	temporalResolveHandle = effect->GetTechniqueByName("TemporalResolve");
 }
 
 void SMAA::go(IDirect3DTexture9 *edges,
@@ -171,40 +188,61 @@ void SMAA::go(IDirect3DTexture9 *edges,
 	// And here we go!
 	edgesDetectionPass(edges, input);
 	blendingWeightsCalculationPass();
-	neighborhoodBlendingPass(src, dst);
+	if (temporal)
+	{
+		// Blend into the history, and resolve it against the previous frame.
+		neighborhoodBlendingPass(src, historySurface[current]);
+		temporalResolvePass(dst);
+		current = 1 - current;
+		historyValid = true;
+	}
+	else neighborhoodBlendingPass(src, dst);
 }
 
-
-void SMAA::loadAreaTex()
+IDirect3DTexture9 *SMAA::goWeightsOnly(IDirect3DTexture9 *edges, Input input)
 {
 	HRESULT hr;
-	V(device->CreateTexture(AREATEX_WIDTH, AREATEX_HEIGHT, 1, D3DUSAGE_DYNAMIC, D3DFMT_A8L8, D3DPOOL_DEFAULT, &areaTex, NULL));
-	D3DLOCKED_RECT rect;
-	V(areaTex->LockRect(0, &rect, NULL, D3DLOCK_DISCARD));
-	for (int i = 0; i < AREATEX_HEIGHT; i++)
-		CopyMemory(((char *)rect.pBits) + i * rect.Pitch, areaTexBytes + i * AREATEX_PITCH, AREATEX_PITCH);
-	V(areaTex->UnlockRect(0));
+
+	V(device->SetVertexDeclaration(vertexDeclaration));
+
+	edgesDetectionPass(edges, input);
+	blendingWeightsCalculationPass();
+	return blendTex;
 }
 
 
-void SMAA::loadSearchTex()
+void SMAA::loadLookupTextures()
 {
+	LookupTextures &shared = sharedLookup[device];
+	if (shared.areaTex && shared.searchTex) return;
+
+	// The area texture is stored as D3DFMT_A8L8, the search texture as
+	// D3DFMT_L8. They are used as they are, without mipmaps or filtering.
 	HRESULT hr;
-	V(device->CreateTexture(SEARCHTEX_WIDTH, SEARCHTEX_HEIGHT, 1, D3DUSAGE_DYNAMIC, D3DFMT_L8, D3DPOOL_DEFAULT, &searchTex, NULL));
-	D3DLOCKED_RECT rect;
-	V(searchTex->LockRect(0, &rect, NULL, D3DLOCK_DISCARD));
-	for (int i = 0; i < SEARCHTEX_HEIGHT; i++)
-		CopyMemory(((char *)rect.pBits) + i * rect.Pitch, searchTexBytes + i * SEARCHTEX_PITCH, SEARCHTEX_PITCH);
-	V(searchTex->UnlockRect(0));
+	shared.areaTex = nullptr;
+	shared.searchTex = nullptr;
+	V(D3DXCreateTextureFromFileEx(device, GetDirectoryFile("dsfix\\SMAA_AreaTex.dds"), D3DX_DEFAULT_NONPOW2, D3DX_DEFAULT_NONPOW2, 1, 0,
+		D3DFMT_UNKNOWN, D3DPOOL_MANAGED, D3DX_FILTER_NONE, D3DX_FILTER_NONE, 0, NULL, NULL, &shared.areaTex));
+	if (FAILED(hr)) SDLOG(0, "ERROR: could not load SMAA_AreaTex.dds");
+	V(D3DXCreateTextureFromFileEx(device, GetDirectoryFile("dsfix\\SMAA_SearchTex.dds"), D3DX_DEFAULT_NONPOW2, D3DX_DEFAULT_NONPOW2, 1, 0,
+		D3DFMT_UNKNOWN, D3DPOOL_MANAGED, D3DX_FILTER_NONE, D3DX_FILTER_NONE, 0, NULL, NULL, &shared.searchTex));
+	if (FAILED(hr)) SDLOG(0, "ERROR: could not load SMAA_SearchTex.dds");
+	SDLOG(0, "SMAA lookup textures loaded");
+}
+
+void SMAA::releaseShared(IDirect3DDevice9 *device)
+{
+	sharedLookup.erase(device);
 }
 
 
 void SMAA::edgesDetectionPass(IDirect3DTexture9 *edges, Input input)
 {
 	//D3DPERF_BeginEvent(D3DCOLOR_XRGB(0, 0, 0), L"SMAA: 1st pass");
+	GpuProfiler::Scope profile("SMAA", "edges");
 	HRESULT hr;
 
-	// Set the render target and clear both the color and the stencil buffers.
+	// Set the render target and clear it (the stencil is cleared by the caller, see go).
 	V(device->SetRenderTarget(0, edgeSurface));
 	V(device->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_ARGB(0, 0, 0, 0), 1.0f, 0));
 
@@ -245,6 +283,7 @@ void SMAA::edgesDetectionPass(IDirect3DTexture9 *edges, Input input)
 void SMAA::blendingWeightsCalculationPass()
 {
 	//D3DPERF_BeginEvent(D3DCOLOR_XRGB(0, 0, 0), L"SMAA: 2nd pass");
+	GpuProfiler::Scope profile("SMAA", "weights");
 	HRESULT hr;
 
 	// Set the render target and clear it.
@@ -257,6 +296,16 @@ void SMAA::blendingWeightsCalculationPass()
 	V(effect->SetTexture(searchTexHandle, searchTex));
 	V(effect->SetTechnique(blendWeightCalculationHandle));
 
+	// In temporal mode, alternate between the two subsamples of SMAA T2x, so
+	// that the resolve averages the coverage at two positions in the pixel.
+	D3DXVECTOR4 subsampleIndices(0.0f, 0.0f, 0.0f, 0.0f);
+	if (temporal)
+	{
+		float index = current == 0 ? 1.0f : 2.0f;
+		subsampleIndices = D3DXVECTOR4(index, index, index, 0.0f);
+	}
+	V(effect->SetVector(subsampleIndicesHandle, &subsampleIndices));
+
 	// And here we go!
 	UINT passes;
 	V(effect->Begin(&passes, 0));
@@ -271,6 +320,7 @@ void SMAA::blendingWeightsCalculationPass()
 void SMAA::neighborhoodBlendingPass(IDirect3DTexture9 *src, IDirect3DSurface9 *dst)
 {
 	//D3DPERF_BeginEvent(D3DCOLOR_XRGB(0, 0, 0), L"SMAA: 3rd pass");
+	GpuProfiler::Scope profile("SMAA", "blending");
 	HRESULT hr;
 
 	// Blah blah blah
@@ -289,3 +339,22 @@ void SMAA::neighborhoodBlendingPass(IDirect3DTexture9 *src, IDirect3DSurface9 *d
 
 	//D3DPERF_EndEvent();
 }
+
+void SMAA::temporalResolvePass(IDirect3DSurface9 *dst)
+{
+	GpuProfiler::Scope profile("SMAA", "resolve");
+	HRESULT hr;
+
+	V(device->SetRenderTarget(0, dst));
+	V(effect->SetTexture(colorTexHandle, historyTex[current]));
+	V(effect->SetTexture(previousTexHandle, historyTex[1 - current]));
+	V(effect->SetFloat(historyValidHandle, historyValid ? 1.0f : 0.0f));
+	V(effect->SetTechnique(temporalResolveHandle));
+
+	UINT passes;
+	V(effect->Begin(&passes, 0));
+	V(effect->BeginPass(0));
+	quad(width, height);
+	V(effect->EndPass());
+	V(effect->End());
+}
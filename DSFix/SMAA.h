@@ -44,6 +44,7 @@
 #include <d3d9.h>
 #include <d3dx9.h>
 #include <dxerr.h>
+#include <map>
 
 #include "Effect.h"
 #include "main.h"
@@ -114,6 +115,13 @@ public:
 	        IDirect3DSurface9 *dst,
 	        Input input);
 
+	/**
+	 * Only runs the edge detection and blending weight passes, for when the
+	 * neighborhood blending is done by a later effect (see SSAO::go).
+	 * Returns the blending weights. Same notes as for 'go' apply.
+	 */
+	IDirect3DTexture9 *goWeightsOnly(IDirect3DTexture9 *edges, Input input);
+
 	/**
 	 * Maximum length to search for patterns. Each step is two pixels wide.
 	 */
@@ -138,12 +146,28 @@ public:
 		this->threshold = threshold;
 	}
 
+	/**
+	 * In temporal mode, the next frame is not blended with the previous one.
+	 * Call this whenever consecutive frames are not related (e.g. after AA was
+	 * toggled off and on again).
+	 */
+	void resetHistory()
+	{
+		historyValid = false;
+	}
+
+	/**
+	 * Releases the lookup textures of a device. All its SMAA instances must
+	 * be released already.
+	 */
+	static void releaseShared(IDirect3DDevice9 *device);
+
 private:
-	void loadAreaTex();
-	void loadSearchTex();
+	void loadLookupTextures();
 	void edgesDetectionPass(IDirect3DTexture9 *edges, Input input);
 	void blendingWeightsCalculationPass();
 	void neighborhoodBlendingPass(IDirect3DTexture9 *src, IDirect3DSurface9 *dst);
+	void temporalResolvePass(IDirect3DSurface9 *dst);
 
 	CComPtr<ID3DXEffect> effect;
 
@@ -158,12 +182,28 @@ private:
 	CComPtr<IDirect3DTexture9> areaTex;
 	CComPtr<IDirect3DTexture9> searchTex;
 
+	// The precomputed lookup textures never change. They are loaded once per
+	// device into the managed pool and shared by all instances, so device
+	// resets and AA reloads reuse them.
+	struct LookupTextures
+	{
+		CComPtr<IDirect3DTexture9> areaTex, searchTex;
+	};
+	static std::map<IDirect3DDevice9 *, LookupTextures> sharedLookup;
+
+	// temporal mode: the AA results of the current and the previous frame, alternating
+	bool temporal, historyValid;
+	unsigned current;
+	CComPtr<IDirect3DTexture9> historyTex[2];
+	CComPtr<IDirect3DSurface9> historySurface[2];
+
 	D3DXHANDLE thresholdHandle, maxSearchStepsHandle;
 	D3DXHANDLE areaTexHandle, searchTexHandle;
 	D3DXHANDLE colorTexHandle, depthTexHandle;
 	D3DXHANDLE edgesTexHandle, blendTexHandle;
+	D3DXHANDLE previousTexHandle, subsampleIndicesHandle, historyValidHandle;
 	D3DXHANDLE lumaEdgeDetectionHandle, colorEdgeDetectionHandle, depthEdgeDetectionHandle,
-	           blendWeightCalculationHandle, neighborhoodBlendingHandle;
+	           blendWeightCalculationHandle, neighborhoodBlendingHandle, temporalResolveHandle;
 
 	int maxSearchSteps;
 	float threshold;
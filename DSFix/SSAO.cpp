@@ -10,8 +10,22 @@
 #include "RenderstateManager.h"
 
 SSAO::SSAO(IDirect3DDevice9 *device, int width, int height, unsigned strength, Type type)
-	: Effect(device), width(width), height(height)
+	: Effect(device), width(width), height(height), historyValid(false), frameIndex(0), current(0)
 {
+	unsigned scale = std::max(Settings::get().getSsaoScale(), 1u);
+	aoWidth = std::max(width / (int)scale, 1);
+	aoHeight = std::max(height / (int)scale, 1);
+	interleaved = Settings::get().getSsaoInterleaved();
+	layerWidth = (aoWidth + 3) / 4;
+	layerHeight = (aoHeight + 3) / 4;
+	temporal = Settings::get().getSsaoTemporal();
+	// the combine pass can do the last pass of the AA effect, except for temporal SMAA which needs the blended frame for its history
+	fusedAA = AA_NONE;
+	if (Settings::get().getAAQuality())
+	{
+		if (Settings::get().getAAType() != "SMAA") fusedAA = AA_FXAA;
+		else if (!Settings::get().getAATemporal()) fusedAA = AA_SMAA;
+	}
 
 	// Setup the defines for compiling the effect
 	std::vector<D3DXMACRO> defines;
@@ -23,12 +37,46 @@ SSAO::SSAO(IDirect3DDevice9 *device, int width, int height, unsigned strength, T
 	D3DXMACRO pixelSizeMacro = { "PIXEL_SIZE", pixelSizeText.c_str() };
 	defines.push_back(pixelSizeMacro);
 
-	// Setup scale macro
-	std::stringstream ss;
-	ss << Settings::get().getSsaoScale() << ".0";
-	std::string scaleText = ss.str();
-	D3DXMACRO scaleMacro = { "SCALE", scaleText.c_str() };
-	defines.push_back(scaleMacro);
+	// Setup AO resolution pixel size macro
+	std::stringstream sa;
+	sa << "float2(1.0 / " << aoWidth << ", 1.0 / " << aoHeight << ")";
+	std::string aoPixelSizeText = sa.str();
+	D3DXMACRO aoPixelSizeMacro = { "AO_PIXEL_SIZE", aoPixelSizeText.c_str() };
+	defines.push_back(aoPixelSizeMacro);
+
+	// Setup interleaving macros
+	std::stringstream sl;
+	sl << "float2(" << layerWidth << ", " << layerHeight << ")";
+	std::string layerSizeText = sl.str();
+	D3DXMACRO layerSizeMacro = { "AO_LAYER_SIZE", layerSizeText.c_str() };
+	D3DXMACRO interleavedMacro = { "SSAO_INTERLEAVED", "1" };
+	if (interleaved)
+	{
+		defines.push_back(layerSizeMacro);
+		defines.push_back(interleavedMacro);
+	}
+	D3DXMACRO temporalMacro = { "SSAO_TEMPORAL", "1" };
+	if (temporal) defines.push_back(temporalMacro);
+
+	// Setup AA macros, matching the ones of the AA effects
+	D3DXMACRO aaMacros[] =
+	{
+		{ "SSAO_SMAA", "1" },
+		{ "SSAO_FXAA", "1" }
+	};
+	D3DXMACRO fxaaQualityMacros[] =
+	{
+		{ "FXAA_QUALITY__PRESET", "10" },
+		{ "FXAA_QUALITY__PRESET", "20" },
+		{ "FXAA_QUALITY__PRESET", "28" },
+		{ "FXAA_QUALITY__PRESET", "39" }
+	};
+	if (fusedAA == AA_SMAA) defines.push_back(aaMacros[0]);
+	if (fusedAA == AA_FXAA)
+	{
+		defines.push_back(aaMacros[1]);
+		defines.push_back(fxaaQualityMacros[std::min(Settings::get().getAAQuality(), 4u) - 1]);
+	}
 
 	D3DXMACRO strengthMacros[] =
 	{
@@ -49,71 +97,180 @@ SSAO::SSAO(IDirect3DDevice9 *device, int width, int height, unsigned strength, T
 	{
 	case VSSAO:
 		shader = "dsfix\\VSSAO.fx";
+		name = "VSSAO";
 		break;
 	case HBAO:
 		shader = "dsfix\\HBAO.fx";
+		name = "HBAO";
 		break;
 	case SCAO:
 		shader = "dsfix\\SCAO.fx";
+		name = "SCAO";
 		break;
 	case VSSAO2:
 		shader = "dsfix\\VSSAO2.fx";
+		name = "VSSAO2";
 		break;
 	default:
 		shader = "dsfix\\VSSAO2.fx";
+		name = "VSSAO2";
 		break;
 	}
-	SDLOG(0, "%s load, scale %s, strength %s", shader, scaleText.c_str(), strengthMacros[strength].Name);
+	SDLOG(0, "%s load, AO resolution %dx%d%s%s, strength %s", shader, aoWidth, aoHeight,
+		interleaved ? " (interleaved)" : "", temporal ? " (temporal)" : "", strengthMacros[strength].Name);
 	ID3DXBuffer* errors;
 	HRESULT hr = D3DXCreateEffectFromFile(device, shader, &defines.front(), NULL, flags, NULL, &effect, &errors);
 	if (hr != D3D_OK) SDLOG(0, "ERRORS:\n %s", errors->GetBufferPointer());
 
 	// Create buffers
-	device->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer1Tex, NULL);
+	device->CreateTexture(aoWidth, aoHeight, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer1Tex, NULL);
 	buffer1Tex->GetSurfaceLevel(0, &buffer1Surf);
-	device->CreateTexture(width, height, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer2Tex, NULL);
+	device->CreateTexture(aoWidth, aoHeight, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer2Tex, NULL);
 	buffer2Tex->GetSurfaceLevel(0, &buffer2Surf);
+	for (unsigned i = 0; i < (temporal ? 2u : 1u); ++i)
+	{
+		device->CreateTexture(aoWidth, aoHeight, 1, D3DUSAGE_RENDERTARGET, D3DFMT_R32F, D3DPOOL_DEFAULT, &lowDepthTex[i], NULL);
+		lowDepthTex[i]->GetSurfaceLevel(0, &lowDepthSurf[i]);
+		if (!temporal) continue;
+		device->CreateTexture(aoWidth, aoHeight, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &historyTex[i], NULL);
+		historyTex[i]->GetSurfaceLevel(0, &historySurf[i]);
+	}
+	if (interleaved)
+	{
+		device->CreateTexture(layerWidth * 4, layerHeight * 4, 1, D3DUSAGE_RENDERTARGET, D3DFMT_R32F, D3DPOOL_DEFAULT, &layerDepthTex, NULL);
+		layerDepthTex->GetSurfaceLevel(0, &layerDepthSurf);
+		device->CreateTexture(layerWidth * 4, layerHeight * 4, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &layerAoTex, NULL);
+		layerAoTex->GetSurfaceLevel(0, &layerAoSurf);
+	}
 
 	// get handles
-	depthTexHandle = effect->GetParameterByName(NULL, "depthTex2D");
+	depthTexHandle = effect->GetParameterByName(NULL, "depthPyramidTex2D");
 	frameTexHandle = effect->GetParameterByName(NULL, "frameTex2D");
+	blendTexHandle = effect->GetParameterByName(NULL, "blendTex2D");
 	prevPassTexHandle = effect->GetParameterByName(NULL, "prevPassTex2D");
+	lowDepthTexHandle = effect->GetParameterByName(NULL, "lowDepthTex2D");
+	layerDepthTexHandle = effect->GetParameterByName(NULL, "layerDepthTex2D");
+	historyTexHandle = effect->GetParameterByName(NULL, "historyTex2D");
+	prevLowDepthTexHandle = effect->GetParameterByName(NULL, "prevLowDepthTex2D");
+	frameIndexHandle = effect->GetParameterByName(NULL, "frameIndex");
+	historyValidHandle = effect->GetParameterByName(NULL, "historyValid");
 }
 
-void SSAO::go(IDirect3DTexture9 *frame, IDirect3DTexture9 *depth, IDirect3DSurface9 *dst)
+void SSAO::go(IDirect3DTexture9 *frame, IDirect3DTexture9 *depth, IDirect3DSurface9 *dst, bool applyAA, IDirect3DTexture9 *smaaBlend)
 {
 	device->SetVertexDeclaration(vertexDeclaration);
 
-	mainSsaoPass(depth, buffer1Surf);
+	if (temporal)
+	{
+		current = 1 - current;
+		// the rotation of the pattern only needs to differ between the frames of the history
+		frameIndex = (frameIndex + 1) % 1024;
+		effect->SetFloat(frameIndexHandle, float(frameIndex));
+	}
+
+	downsampleDepthPass(depth, lowDepthSurf[current]);
+	if (interleaved)
+	{
+		deinterleaveDepthPass(depth, layerDepthSurf);
+		mainSsaoPass(depth, layerAoSurf);
+		reinterleavePass(layerAoTex, buffer1Surf);
+	}
+	else
+	{
+		mainSsaoPass(depth, buffer1Surf);
+	}
+
+	IDirect3DTexture9* ao = buffer1Tex;
+	if (temporal)
+	{
+		temporalPass(buffer1Tex, historySurf[current]);
+		ao = historyTex[current];
+	}
 
 	for (size_t i = 0; i < 1; ++i)
 	{
-		hBlurPass(depth, buffer1Tex, buffer2Surf);
+		hBlurPass(depth, ao, buffer2Surf);
 		vBlurPass(depth, buffer2Tex, buffer1Surf);
+		ao = buffer1Tex;
 	}
 
-	combinePass(frame, buffer1Tex, dst);
+	combinePass(frame, depth, buffer1Tex, dst, applyAA && fusedAA != AA_NONE, smaaBlend);
+}
+
+void SSAO::downsampleDepthPass(IDirect3DTexture9* depth, IDirect3DSurface9* dst)
+{
+	GpuProfiler::Scope profile(name, "depth");
+	device->SetRenderTarget(0, dst);
+
+	// Setup variables.
+	effect->SetTexture(depthTexHandle, depth);
+
+	// Do it!
+	UINT passes;
+	effect->Begin(&passes, 0);
+	effect->BeginPass(4);
+	quad(aoWidth, aoHeight);
+	effect->EndPass();
+	effect->End();
+}
+
+void SSAO::deinterleaveDepthPass(IDirect3DTexture9* depth, IDirect3DSurface9* dst)
+{
+	GpuProfiler::Scope profile(name, "deinterleave");
+	device->SetRenderTarget(0, dst);
+
+	// Setup variables.
+	effect->SetTexture(depthTexHandle, depth);
+
+	// Do it!
+	UINT passes;
+	effect->Begin(&passes, 0);
+	effect->BeginPass(5);
+	quad(layerWidth * 4, layerHeight * 4);
+	effect->EndPass();
+	effect->End();
 }
 
 void SSAO::mainSsaoPass(IDirect3DTexture9* depth, IDirect3DSurface9* dst)
 {
+	GpuProfiler::Scope profile(name, "ao");
 	device->SetRenderTarget(0, dst);
 	device->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_ARGB(255, 0, 0, 0), 1.0f, 0);
 
 	// Setup variables.
 	effect->SetTexture(depthTexHandle, depth);
+	effect->SetTexture(layerDepthTexHandle, layerDepthTex);
 
 	// Do it!
 	UINT passes;
 	effect->Begin(&passes, 0);
 	effect->BeginPass(0);
-	quad(width, height);
+	if (interleaved) quad(layerWidth * 4, layerHeight * 4);
+	else quad(aoWidth, aoHeight);
+	effect->EndPass();
+	effect->End();
+}
+
+void SSAO::reinterleavePass(IDirect3DTexture9* src, IDirect3DSurface9* dst)
+{
+	GpuProfiler::Scope profile(name, "reinterleave");
+	device->SetRenderTarget(0, dst);
+
+	// Setup variables.
+	effect->SetTexture(prevPassTexHandle, src);
+
+	// Do it!
+	UINT passes;
+	effect->Begin(&passes, 0);
+	effect->BeginPass(6);
+	quad(aoWidth, aoHeight);
 	effect->EndPass();
 	effect->End();
 }
 
 void SSAO::hBlurPass(IDirect3DTexture9 *depth, IDirect3DTexture9* src, IDirect3DSurface9* dst)
 {
+	GpuProfiler::Scope profile(name, "hblur");
 	device->SetRenderTarget(0, dst);
 
 	// Setup variables.
@@ -124,13 +281,14 @@ void SSAO::hBlurPass(IDirect3DTexture9 *depth, IDirect3DTexture9* src, IDirect3D
 	UINT passes;
 	effect->Begin(&passes, 0);
 	effect->BeginPass(1);
-	quad(width, height);
+	quad(aoWidth, aoHeight);
 	effect->EndPass();
 	effect->End();
 }
 
 void SSAO::vBlurPass(IDirect3DTexture9 *depth, IDirect3DTexture9* src, IDirect3DSurface9* dst)
 {
+	GpuProfiler::Scope profile(name, "vblur");
 	device->SetRenderTarget(0, dst);
 
 	// Setup variables.
@@ -141,24 +299,51 @@ void SSAO::vBlurPass(IDirect3DTexture9 *depth, IDirect3DTexture9* src, IDirect3D
 	UINT passes;
 	effect->Begin(&passes, 0);
 	effect->BeginPass(2);
-	quad(width, height);
+	quad(aoWidth, aoHeight);
+	effect->EndPass();
+	effect->End();
+}
+
+void SSAO::temporalPass(IDirect3DTexture9* src, IDirect3DSurface9* dst)
+{
+	GpuProfiler::Scope profile(name, "temporal");
+	device->SetRenderTarget(0, dst);
+
+	// Setup variables.
+	effect->SetTexture(prevPassTexHandle, src);
+	effect->SetTexture(historyTexHandle, historyTex[1 - current]);
+	effect->SetTexture(lowDepthTexHandle, lowDepthTex[current]);
+	effect->SetTexture(prevLowDepthTexHandle, lowDepthTex[1 - current]);
+	effect->SetFloat(historyValidHandle, historyValid ? 1.0f : 0.0f);
+
+	// Do it!
+	UINT passes;
+	effect->Begin(&passes, 0);
+	effect->BeginPass(7);
+	quad(aoWidth, aoHeight);
 	effect->EndPass();
 	effect->End();
+
+	historyValid = true;
 }
 
-void SSAO::combinePass(IDirect3DTexture9* frame, IDirect3DTexture9* ao, IDirect3DSurface9* dst)
+void SSAO::combinePass(IDirect3DTexture9* frame, IDirect3DTexture9* depth, IDirect3DTexture9* ao, IDirect3DSurface9* dst, bool applyAA, IDirect3DTexture9* smaaBlend)
 {
+	GpuProfiler::Scope profile(name, applyAA ? "combine+AA" : "combine");
 	device->SetRenderTarget(0, dst);
 	//device->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_ARGB(255, 255, 0, 255), 1.0f, 0);
 
 	// Setup variables.
 	effect->SetTexture(prevPassTexHandle, ao);
 	effect->SetTexture(frameTexHandle, frame);
+	effect->SetTexture(depthTexHandle, depth);
+	effect->SetTexture(lowDepthTexHandle, lowDepthTex[current]);
+	if (applyAA && fusedAA == AA_SMAA) effect->SetTexture(blendTexHandle, smaaBlend);
 
 	// Do it!
 	UINT passes;
 	effect->Begin(&passes, 0);
-	effect->BeginPass(3);
+	effect->BeginPass(applyAA ? 8 : 3);
 	quad(width, height);
 	effect->EndPass();
 	effect->End();
@@ -11,14 +11,40 @@ class SSAO : public Effect
 {
 public:
 	enum Type { VSSAO, HBAO, SCAO, VSSAO2 };
+	// AA effect whose last pass can be done by the combine pass
+	enum FusedAA { AA_NONE, AA_SMAA, AA_FXAA };
 
 	SSAO(IDirect3DDevice9 *device, int width, int height, unsigned strength, Type type);
 	virtual ~SSAO() {};
 
-	void go(IDirect3DTexture9 *frame, IDirect3DTexture9 *depth, IDirect3DSurface9 *dst);
+	// depth is the texture of the DepthPyramid
+	// with applyAA, the combine pass also antialiases the frame, instead of the last pass of the AA effect
+	// (for SMAA, smaaBlend are its blending weights, see SMAA::goWeightsOnly)
+	void go(IDirect3DTexture9 *frame, IDirect3DTexture9 *depth, IDirect3DSurface9 *dst, bool applyAA = false, IDirect3DTexture9 *smaaBlend = NULL);
+
+	FusedAA getFusedAA() const
+	{
+		return fusedAA;
+	}
+
+	// drop the accumulated AO, when frames were rendered without SSAO
+	void resetHistory()
+	{
+		historyValid = false;
+	}
 
 private:
 	int width, height;
+	// AO is computed and blurred at this resolution (render resolution divided by ssaoScale) and upsampled in the combine pass
+	int aoWidth, aoHeight;
+	// interleaved rendering: AO is computed in 4x4 layers of layerWidth x layerHeight, tiled in an atlas
+	bool interleaved;
+	int layerWidth, layerHeight;
+	// temporal accumulation: history and low resolution depth alternate between two buffers, current is this frame's
+	bool temporal, historyValid;
+	unsigned frameIndex, current;
+	FusedAA fusedAA;
+	const char* name; // of the variant, for profiling
 
 	CComPtr<ID3DXEffect> effect;
 
@@ -26,11 +52,27 @@ private:
 	CComPtr<IDirect3DSurface9> buffer1Surf;
 	CComPtr<IDirect3DTexture9> buffer2Tex;
 	CComPtr<IDirect3DSurface9> buffer2Surf;
+	// linear depth at AO resolution, guides the upsampling
+	CComPtr<IDirect3DTexture9> lowDepthTex[2];
+	CComPtr<IDirect3DSurface9> lowDepthSurf[2];
+	// accumulated raw AO, when temporal
+	CComPtr<IDirect3DTexture9> historyTex[2];
+	CComPtr<IDirect3DSurface9> historySurf[2];
+	// depth and AO layer atlases, when interleaved
+	CComPtr<IDirect3DTexture9> layerDepthTex;
+	CComPtr<IDirect3DSurface9> layerDepthSurf;
+	CComPtr<IDirect3DTexture9> layerAoTex;
+	CComPtr<IDirect3DSurface9> layerAoSurf;
 
-	D3DXHANDLE depthTexHandle, frameTexHandle, prevPassTexHandle;
+	D3DXHANDLE depthTexHandle, frameTexHandle, blendTexHandle, prevPassTexHandle, lowDepthTexHandle, layerDepthTexHandle;
+	D3DXHANDLE historyTexHandle, prevLowDepthTexHandle, frameIndexHandle, historyValidHandle;
 
+	void downsampleDepthPass(IDirect3DTexture9 *depth, IDirect3DSurface9 *dst);
+	void deinterleaveDepthPass(IDirect3DTexture9 *depth, IDirect3DSurface9 *dst);
 	void mainSsaoPass(IDirect3DTexture9 *depth, IDirect3DSurface9 *dst);
+	void reinterleavePass(IDirect3DTexture9* src, IDirect3DSurface9* dst);
+	void temporalPass(IDirect3DTexture9* src, IDirect3DSurface9* dst);
 	void vBlurPass(IDirect3DTexture9 *depth, IDirect3DTexture9* src, IDirect3DSurface9* dst);
 	void hBlurPass(IDirect3DTexture9 *depth, IDirect3DTexture9* src, IDirect3DSurface9* dst);
-	void combinePass(IDirect3DTexture9* frame, IDirect3DTexture9* ao, IDirect3DSurface9* dst);
+	void combinePass(IDirect3DTexture9* frame, IDirect3DTexture9* depth, IDirect3DTexture9* ao, IDirect3DSurface9* dst, bool applyAA, IDirect3DTexture9* smaaBlend);
 };
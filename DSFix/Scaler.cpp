@@ -0,0 +1,141 @@
+
+#include "Scaler.h"
+
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <vector>
+
+// kernel radius in source pixels when upsampling
+static const float bicubicRadius = 2.0f, lanczosRadius = 3.0f;
+
+bool Scaler::parseMode(const std::string& name, Mode& mode)
+{
+	if (name == "bicubic") mode = BICUBIC;
+	else if (name == "lanczos") mode = LANCZOS;
+	else if (name == "adaptive") mode = ADAPTIVE;
+	else return false;
+	return true;
+}
+
+Scaler::Scaler(IDirect3DDevice9 *device, int srcWidth, int srcHeight, int dstWidth, int dstHeight, Mode mode, float sharpening)
+	: Effect(device), srcWidth(srcWidth), srcHeight(srcHeight), dstWidth(dstWidth), dstHeight(dstHeight)
+{
+	float ratioX = float(srcWidth) / dstWidth, ratioY = float(srcHeight) / dstHeight;
+	singlePass = mode == ADAPTIVE && ratioX <= 1.0f && ratioY <= 1.0f;
+	if (mode == ADAPTIVE && !singlePass) mode = LANCZOS;
+
+	// taps per pass cover the (widened) kernel on both sides of the target pixel
+	float radius = mode == BICUBIC ? bicubicRadius : lanczosRadius;
+	int tapsH = 2 * (int)ceil(radius * std::max(ratioX, 1.0f));
+	int tapsV = 2 * (int)ceil(radius * std::max(ratioY, 1.0f));
+
+	// Setup the defines for compiling the effect
+	std::vector<D3DXMACRO> defines;
+	std::stringstream s;
+	s << "float2(" << srcWidth << ", " << srcHeight << ")";
+	std::string srcSizeText = s.str();
+	D3DXMACRO srcSizeMacro = { "SRC_SIZE", srcSizeText.c_str() };
+	defines.push_back(srcSizeMacro);
+
+	std::stringstream sr;
+	sr << "float2(" << ratioX << ", " << ratioY << ")";
+	std::string ratioText = sr.str();
+	D3DXMACRO ratioMacro = { "RATIO", ratioText.c_str() };
+	defines.push_back(ratioMacro);
+
+	std::stringstream sk, sh, sv, ss;
+	sk << (mode == BICUBIC ? 0 : 1);
+	sh << tapsH;
+	sv << tapsV;
+	ss << sharpening;
+	std::string kernelText = sk.str(), tapsHText = sh.str(), tapsVText = sv.str(), sharpeningText = ss.str();
+	D3DXMACRO kernelMacro = { "KERNEL", kernelText.c_str() };
+	D3DXMACRO tapsHMacro = { "TAPS_H", tapsHText.c_str() };
+	D3DXMACRO tapsVMacro = { "TAPS_V", tapsVText.c_str() };
+	D3DXMACRO sharpeningMacro = { "SHARPENING", sharpeningText.c_str() };
+	defines.push_back(kernelMacro);
+	defines.push_back(tapsHMacro);
+	defines.push_back(tapsVMacro);
+	defines.push_back(sharpeningMacro);
+
+	D3DXMACRO null = { NULL, NULL };
+	defines.push_back(null);
+
+	DWORD flags = D3DXFX_NOT_CLONEABLE;
+
+	// Load effect from file
+	SDLOG(0, "Scaler load");
+	ID3DXBuffer* errors;
+	HRESULT hr = D3DXCreateEffectFromFile(device, GetDirectoryFile("dsfix\\Scaler.fx"), &defines.front(), NULL, flags, NULL, &effect, &errors);
+	if(hr != D3D_OK) SDLOG(0, "ERRORS:\n %s", errors->GetBufferPointer());
+
+	// Create buffers
+	if (!singlePass)
+	{
+		device->CreateTexture(dstWidth, srcHeight, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &buffer1Tex, NULL);
+		buffer1Tex->GetSurfaceLevel(0, &buffer1Surf);
+	}
+
+	// get handles
+	srcTexHandle = effect->GetParameterByName(NULL, "srcTex2D");
+
+	if (singlePass) SDLOG(0, "Scaler: %dx%d to %dx%d, adaptive upscaling, sharpening %.2f", srcWidth, srcHeight, dstWidth, dstHeight, sharpening);
+	else SDLOG(0, "Scaler: %dx%d to %dx%d, %s with %d/%d taps", srcWidth, srcHeight, dstWidth, dstHeight, mode == BICUBIC ? "bicubic" : "lanczos", tapsH, tapsV);
+}
+
+void Scaler::go(IDirect3DSurface9 *src, IDirect3DTexture9 *input, IDirect3DSurface9 *dst)
+{
+	if (!input)
+	{
+		if (!copyTex)
+		{
+			device->CreateTexture(srcWidth, srcHeight, 1, D3DUSAGE_RENDERTARGET, D3DFMT_A8R8G8B8, D3DPOOL_DEFAULT, &copyTex, NULL);
+			copyTex->GetSurfaceLevel(0, &copySurf);
+		}
+		device->StretchRect(src, NULL, copySurf, NULL, D3DTEXF_POINT);
+		input = copyTex;
+	}
+
+	device->SetVertexDeclaration(vertexDeclaration);
+	device->SetDepthStencilSurface(NULL);
+
+	UINT passes;
+
+	if (singlePass)
+	{
+		GpuProfiler::Scope profile("Scaler", "adaptive");
+		device->SetRenderTarget(0, dst);
+		effect->SetTexture(srcTexHandle, input);
+		effect->Begin(&passes, 0);
+		effect->BeginPass(2);
+		quad(dstWidth, dstHeight);
+		effect->EndPass();
+		effect->End();
+		return;
+	}
+
+	// Horizontal
+	{
+		GpuProfiler::Scope profile("Scaler", "horizontal");
+		device->SetRenderTarget(0, buffer1Surf);
+		effect->SetTexture(srcTexHandle, input);
+		effect->Begin(&passes, 0);
+		effect->BeginPass(0);
+		quad(dstWidth, srcHeight);
+		effect->EndPass();
+		effect->End();
+	}
+
+	// Vertical
+	{
+		GpuProfiler::Scope profile("Scaler", "vertical");
+		device->SetRenderTarget(0, dst);
+		effect->SetTexture(srcTexHandle, buffer1Tex);
+		effect->Begin(&passes, 0);
+		effect->BeginPass(1);
+		quad(dstWidth, dstHeight);
+		effect->EndPass();
+		effect->End();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <dxgi.h>
+#include <d3d9.h>
+#include <d3dx9.h>
+#include <dxerr.h>
+
+#include "Effect.h"
+
+// Resamples the frame from the render to the present resolution (presentScaling), instead of the linear StretchRect
+// Bicubic (Catmull-Rom) and Lanczos are separable, one horizontal and one vertical pass; when downsampling, the kernel
+// is widened by the ratio, so supersampled frames are filtered instead of aliased. The adaptive mode upscales in a
+// single pass, interpolating along edges in the nearest 2x2 pixels and sharpening within their range; it falls back
+// to Lanczos when downsampling.
+class Scaler : public Effect
+{
+public:
+	enum Mode
+	{
+		BICUBIC, LANCZOS, ADAPTIVE
+	};
+
+	Scaler(IDirect3DDevice9 *device, int srcWidth, int srcHeight, int dstWidth, int dstHeight, Mode mode, float sharpening);
+	virtual ~Scaler() {};
+
+	// input may be NULL for a plain surface, it is copied to a texture first
+	void go(IDirect3DSurface9 *src, IDirect3DTexture9 *input, IDirect3DSurface9 *dst);
+
+	// false for "linear" and unknown names, the StretchRect is kept then
+	static bool parseMode(const std::string& name, Mode& mode);
+
+private:
+	int srcWidth, srcHeight, dstWidth, dstHeight;
+	bool singlePass;
+
+	CComPtr<ID3DXEffect> effect;
+
+	// between the horizontal and vertical pass, dstWidth x srcHeight
+	CComPtr<IDirect3DTexture9> buffer1Tex;
+	CComPtr<IDirect3DSurface9> buffer1Surf;
+	// copy of a source which is not a texture, created when needed
+	CComPtr<IDirect3DTexture9> copyTex;
+	CComPtr<IDirect3DSurface9> copySurf;
+
+	D3DXHANDLE srcTexHandle;
+};
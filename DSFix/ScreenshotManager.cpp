@@ -0,0 +1,93 @@
+
+#include "ScreenshotManager.h"
+
+#include "main.h"
+#include "ImageWriter.h"
+
+ScreenshotManager ScreenshotManager::instance;
+
+ScreenshotManager::ScreenshotManager() : device(NULL)
+{
+}
+
+void ScreenshotManager::init(IDirect3DDevice9* pDevice)
+{
+	device = pDevice;
+}
+
+void ScreenshotManager::release()
+{
+	for (unsigned i = 0; i < NUM_SLOTS; ++i)
+	{
+		Slot& slot = slots[i];
+		if (slot.readback.isPending()) SDLOG(0, "ScreenshotManager: device released, dropped %s", slot.filename.c_str());
+		slot.readback.release();
+	}
+	device = NULL;
+}
+
+bool ScreenshotManager::capture(IDirect3DSurface9* surface, const std::string& filename)
+{
+	if (!device) return false;
+	Slot* slot = NULL;
+	for (unsigned i = 0; i < NUM_SLOTS && !slot; ++i)
+	{
+		if (!slots[i].readback.isPending()) slot = &slots[i];
+	}
+	if (!slot)
+	{
+		SDLOG(0, "ScreenshotManager: all slots busy, skipped %s", filename.c_str());
+		return false;
+	}
+
+	D3DSURFACE_DESC desc;
+	surface->GetDesc(&desc);
+	if (!slot->readback.create(device, desc.Width, desc.Height, D3DFMT_X8R8G8B8))
+	{
+		SDLOG(0, "ScreenshotManager: could not create %ux%u surfaces for %s", desc.Width, desc.Height, filename.c_str());
+		return false;
+	}
+	// also converts the format, the only work done on the GPU in this frame
+	if (FAILED(device->StretchRect(surface, NULL, slot->readback.getCopy(), NULL, D3DTEXF_NONE)))
+	{
+		SDLOG(0, "ScreenshotManager: could not copy the frame for %s", filename.c_str());
+		return false;
+	}
+	slot->filename = filename;
+	slot->readback.start();
+	return true;
+}
+
+void ScreenshotManager::endFrame()
+{
+	for (unsigned i = 0; i < NUM_SLOTS; ++i)
+	{
+		Slot& slot = slots[i];
+		if (!slot.readback.isPending()) continue;
+		if (!slot.readback.endFrame())
+		{
+			SDLOG(0, "ScreenshotManager: readback failed, dropped %s", slot.filename.c_str());
+			continue;
+		}
+		// if the readback is not done yet, try again next frame
+		finish(slot);
+	}
+}
+
+void ScreenshotManager::finish(Slot& slot)
+{
+	std::unique_ptr<ImageWriter::Image> image;
+	switch (slot.readback.lock(image, slot.readback.getWidth(), slot.readback.getHeight(), false))
+	{
+	case Readback::LOCK_WAITING:
+		break;
+	case Readback::LOCK_FAILED:
+		SDLOG(0, "ScreenshotManager: could not lock the readback of %s", slot.filename.c_str());
+		break;
+	case Readback::LOCKED:
+		SDLOG(0, "ScreenshotManager: %s read back after %u frames", slot.filename.c_str(), slot.readback.getAge());
+		image->filename = slot.filename;
+		ImageWriter::get().write(std::move(image));
+		break;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "d3d9.h"
+#include "Readback.h"
+
+// Takes screenshots without stalling the render thread
+// The frame is copied and read back over the following frames by a Readback, then written by the ImageWriter.
+// The surfaces are created for the first screenshot and reused for the following ones of the same size.
+class ScreenshotManager
+{
+	static ScreenshotManager instance;
+
+	// screenshots which can be in flight at the same time
+	static const unsigned NUM_SLOTS = 2;
+
+	struct Slot
+	{
+		Readback readback; // D3DFMT_X8R8G8B8
+		std::string filename;
+	};
+	Slot slots[NUM_SLOTS];
+
+	IDirect3DDevice9* device;
+
+	void finish(Slot& slot);
+
+public:
+	static ScreenshotManager& get()
+	{
+		return instance;
+	}
+
+	ScreenshotManager();
+
+	// call with the other device resources, screenshots which are still in flight are dropped on release
+	void init(IDirect3DDevice9* pDevice);
+	void release();
+
+	// queues a copy of the surface, to be written to filename as PNG; returns false if all slots are busy
+	bool capture(IDirect3DSurface9* surface, const std::string& filename);
+	// frame boundary, called on Present
+	void endFrame();
+};
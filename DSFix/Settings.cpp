@@ -3,8 +3,7 @@
 
 #include <fstream>
 #include "main.h"
-#include "WindowManager.h"
-#include "Detouring.h"
+#include "ResolutionRules.h"
 
 Settings Settings::instance;
 
@@ -13,6 +12,7 @@ void Settings::load()
 	std::ifstream sfile;
 	sfile.open(GetDirectoryFile("DSfix.ini"), std::ios::in);
 	char buffer[128];
+	ResolutionRules::get().clear();
 	while (!sfile.eof())
 	{
 		sfile.getline(buffer, 128);
@@ -20,6 +20,12 @@ void Settings::load()
 		if (sfile.gcount() <= 1) continue;
 		std::string bstring(buffer);
 
+		if (bstring.find("resolutionRule ") == 0)
+		{
+			ResolutionRules::get().parse(buffer + strlen("resolutionRule "));
+			continue;
+		}
+
 #define SETTING(_type, _var, _inistring, _defaultval) \
 		if(bstring.find(_inistring) == 0) { \
 			read(buffer + strlen(_inistring) + 1, _var); \
@@ -28,6 +34,7 @@ void Settings::load()
 #undef SETTING
 	}
 	sfile.close();
+	ResolutionRules::get().addBuiltinRules();
 
 	if (getBackupInterval() < 300)
 	{
@@ -47,5 +47,16 @@ public:
 	unsigned getCurrentFPSLimit();
 	void setCurrentFPSLimit(unsigned limit);
 	void toggle30FPSLimit();
+
+	// used by the standalone tools in bench/, which do not read the log level from the ini
+	void setLogLevel(unsigned level)
+	{
+		LogLevel = level;
+	}
+	// used by the tests in bench/, to cover the settings dependent overrides
+	void setDOFOverrideResolution(unsigned resolution)
+	{
+		DOFOverrideResolution = resolution;
+	}
 };
 
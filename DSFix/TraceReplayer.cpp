@@ -0,0 +1,317 @@
+
+#include "TraceReplayer.h"
+
+#include <fstream>
+
+#include "main.h"
+#include "Settings.h"
+#include "NullDevice.h"
+#include "PipelineDetector.h"
+#include "HudCache.h"
+
+TraceReplayer::TraceReplayer()
+{
+	ZeroMemory(&header, sizeof(header));
+	ZeroMemory(ticks, sizeof(ticks));
+	ZeroMemory(counts, sizeof(counts));
+}
+
+const char* TraceReplayer::getCallName(CallTrace::Call call)
+{
+	switch (call)
+	{
+	case CallTrace::TextureDesc: return "TextureDesc";
+	case CallTrace::SurfaceDesc: return "SurfaceDesc";
+	case CallTrace::TextureHash: return "TextureHash";
+	case CallTrace::CreateTexture: return "CreateTexture";
+	case CallTrace::CreateRenderTarget: return "CreateRenderTarget";
+	case CallTrace::CreateDepthStencilSurface: return "CreateDepthStencilSurface";
+	case CallTrace::SetRenderTarget: return "SetRenderTarget";
+	case CallTrace::SetDepthStencilSurface: return "SetDepthStencilSurface";
+	case CallTrace::SetTexture: return "SetTexture";
+	case CallTrace::SetRenderState: return "SetRenderState";
+	case CallTrace::SetTextureStageState: return "SetTextureStageState";
+	case CallTrace::StretchRect: return "StretchRect";
+	case CallTrace::DrawPrimitiveUP: return "DrawPrimitiveUP";
+	case CallTrace::DrawIndexedPrimitiveUP: return "DrawIndexedPrimitiveUP";
+	case CallTrace::Reset: return "Reset";
+	case CallTrace::Present: return "Present";
+	default: break;
+	}
+	return "Unknown";
+}
+
+bool TraceReplayer::load(const char* filename)
+{
+	FILE* file = NULL;
+	fopen_s(&file, filename, "rb");
+	if (!file)
+	{
+		SDLOG(0, "ERROR: could not open call trace %s", filename);
+		return false;
+	}
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != CallTrace::MAGIC || header.version != CallTrace::TRACE_VERSION)
+	{
+		SDLOG(0, "ERROR: %s is not a call trace of version %u", filename, CallTrace::TRACE_VERSION);
+		fclose(file);
+		return false;
+	}
+	if (header.renderWidth != Settings::get().getRenderWidth() || header.renderHeight != Settings::get().getRenderHeight()
+		|| header.presentWidth != Settings::get().getPresentWidth() || header.presentHeight != Settings::get().getPresentHeight()
+		|| header.dofResolution != Settings::get().getDOFOverrideResolution())
+	{
+		SDLOG(0, "WARNING: call trace was recorded with different settings (render %ux%u, present %ux%u, DoF %u), detection results will differ",
+			header.renderWidth, header.renderHeight, header.presentWidth, header.presentHeight, header.dofResolution);
+	}
+
+	words.clear();
+	frames.clear();
+	UINT32 sizes[2];
+	while (fread(sizes, sizeof(UINT32), 2, file) == 2)
+	{
+		size_t begin = words.size();
+		words.resize(begin + sizes[0]);
+		if (sizes[0] && fread(&words[begin], sizeof(UINT32), sizes[0], file) != sizes[0])
+		{
+			SDLOG(0, "WARNING: call trace is truncated, ignoring the last frame");
+			words.resize(begin);
+			break;
+		}
+		if (sizes[1]) SDLOG(0, "WARNING: frame %u of the call trace is incomplete (%u records dropped)", frames.size(), sizes[1]);
+		frames.push_back(std::make_pair(begin, words.size()));
+	}
+	fclose(file);
+	SDLOG(0, "Loaded call trace %s: %u frames, %u words", filename, frames.size(), words.size());
+	return true;
+}
+
+IDirect3DTexture9* TraceReplayer::texture(UINT32 handle)
+{
+	return handle < textures.size() ? (IDirect3DTexture9*)textures[handle] : NULL;
+}
+
+IDirect3DSurface9* TraceReplayer::surface(UINT32 handle)
+{
+	return handle < surfaces.size() ? (IDirect3DSurface9*)surfaces[handle] : NULL;
+}
+
+void TraceReplayer::setTexture(UINT32 handle, IDirect3DTexture9* pTexture)
+{
+	if (handle >= textures.size()) textures.resize(handle + 1);
+	textures[handle] = pTexture;
+}
+
+void TraceReplayer::setSurface(UINT32 handle, IDirect3DSurface9* pSurface)
+{
+	if (handle >= surfaces.size()) surfaces.resize(handle + 1);
+	surfaces[handle] = pSurface;
+}
+
+const void* TraceReplayer::vertices(const UINT32* recorded, UINT size)
+{
+	size = std::max<UINT>(size, CallTrace::VERTEX_WORDS * sizeof(UINT32));
+	if (vertexData.size() < size) vertexData.resize(size);
+	memcpy(&vertexData[0], recorded, CallTrace::VERTEX_WORDS * sizeof(UINT32));
+	return &vertexData[0];
+}
+
+const void* TraceReplayer::indices(UINT size)
+{
+	// all zero, which is valid for any vertex count
+	if (indexData.size() < size) indexData.resize(size);
+	return indexData.empty() ? NULL : &indexData[0];
+}
+
+void TraceReplayer::describeTexture(HookTarget& target, IDirect3DDevice9* device, const UINT32* args)
+{
+	// already existing when the trace started (or not created through the device), so create it directly
+	CComPtr<IDirect3DTexture9> tex;
+	device->CreateTexture(args[1], args[2], args[3], args[4], (D3DFORMAT)args[5], (D3DPOOL)args[6], &tex, NULL);
+	setTexture(args[0], tex);
+	if (args[4] & (D3DUSAGE_RENDERTARGET | D3DUSAGE_DEPTHSTENCIL)) target.registerRenderTexture(tex);
+	if ((args[4] & D3DUSAGE_RENDERTARGET) && args[1] == Settings::get().getRenderWidth() && args[2] == Settings::get().getRenderHeight()) target.registerMainRenderTexture(tex);
+}
+
+void TraceReplayer::describeSurface(HookTarget& target, IDirect3DDevice9* device, const UINT32* args)
+{
+	CComPtr<IDirect3DSurface9> surf;
+	if (IDirect3DTexture9* container = texture(args[5]))
+	{
+		container->GetSurfaceLevel(args[6], &surf);
+	}
+	else if (args[4] & D3DUSAGE_RENDERTARGET)
+	{
+		device->CreateRenderTarget(args[1], args[2], (D3DFORMAT)args[3], D3DMULTISAMPLE_NONE, 0, FALSE, &surf, NULL);
+		target.registerRenderSurface(surf);
+	}
+	else if (args[4] & D3DUSAGE_DEPTHSTENCIL)
+	{
+		device->CreateDepthStencilSurface(args[1], args[2], (D3DFORMAT)args[3], D3DMULTISAMPLE_NONE, 0, FALSE, &surf, NULL);
+		target.registerRenderSurface(surf);
+	}
+	else
+	{
+		device->CreateOffscreenPlainSurface(args[1], args[2], (D3DFORMAT)args[3], D3DPOOL_DEFAULT, &surf, NULL);
+	}
+	setSurface(args[0], surf);
+}
+
+void TraceReplayer::replayFrame(HookTarget& target, IDirect3DDevice9* device, size_t begin, size_t end, bool first)
+{
+	LARGE_INTEGER start, stop;
+	size_t pos = begin;
+	while (pos < end)
+	{
+		CallTrace::Call call = (CallTrace::Call)(words[pos] & 0xffff);
+		unsigned numArgs = words[pos] >> 16;
+		const UINT32* args = &words[pos + 1];
+		pos += 1 + numArgs;
+		if (pos > end) break;
+
+		// created resources are bound to their handle after stopping the clock
+		IDirect3DTexture9* newTexture = NULL;
+		IDirect3DSurface9* newSurface = NULL;
+		QueryPerformanceCounter(&start);
+		switch (call)
+		{
+		case CallTrace::TextureDesc:
+			describeTexture(target, device, args);
+			break;
+		case CallTrace::SurfaceDesc:
+			describeSurface(target, device, args);
+			break;
+		case CallTrace::TextureHash:
+			target.registerKnownTexture(args[1], texture(args[0]));
+			break;
+		case CallTrace::CreateTexture:
+			target.redirectCreateTexture(args[1], args[2], args[3], args[4], (D3DFORMAT)args[5], (D3DPOOL)args[6], &newTexture, NULL);
+			break;
+		case CallTrace::CreateRenderTarget:
+			target.redirectCreateRenderTarget(args[1], args[2], (D3DFORMAT)args[3], D3DMULTISAMPLE_NONE, 0, FALSE, &newSurface, NULL);
+			break;
+		case CallTrace::CreateDepthStencilSurface:
+			target.redirectCreateDepthStencilSurface(args[1], args[2], (D3DFORMAT)args[3], D3DMULTISAMPLE_NONE, 0, FALSE, &newSurface, NULL);
+			break;
+		case CallTrace::SetRenderTarget:
+			target.redirectSetRenderTarget(args[0], surface(args[1]));
+			break;
+		case CallTrace::SetDepthStencilSurface:
+			target.redirectSetDepthStencilSurface(surface(args[0]));
+			break;
+		case CallTrace::SetTexture:
+			target.redirectSetTexture(args[0], texture(args[1]));
+			break;
+		case CallTrace::SetRenderState:
+			target.redirectSetRenderState((D3DRENDERSTATETYPE)args[0], args[1]);
+			break;
+		case CallTrace::SetTextureStageState:
+			target.redirectSetTextureStageState(args[0], (D3DTEXTURESTAGESTATETYPE)args[1], args[2]);
+			break;
+		case CallTrace::StretchRect:
+			target.redirectStretchRect(surface(args[0]), NULL, surface(args[1]), NULL, (D3DTEXTUREFILTERTYPE)args[2]);
+			break;
+		case CallTrace::DrawPrimitiveUP:
+		{
+			const void* data = vertices(args + 3, HudCache::verticesPerDraw((D3DPRIMITIVETYPE)args[0], args[1]) * args[2]);
+			QueryPerformanceCounter(&start);
+			target.redirectDrawPrimitiveUP((D3DPRIMITIVETYPE)args[0], args[1], data, args[2]);
+			break;
+		}
+		case CallTrace::DrawIndexedPrimitiveUP:
+		{
+			const void* data = vertices(args + 6, args[2] * args[5]);
+			const void* index = indices(HudCache::verticesPerDraw((D3DPRIMITIVETYPE)args[0], args[3]) * (args[4] == D3DFMT_INDEX32 ? 4 : 2));
+			QueryPerformanceCounter(&start);
+			target.redirectDrawIndexedPrimitiveUP((D3DPRIMITIVETYPE)args[0], args[1], args[2], args[3], index, (D3DFORMAT)args[4], data, args[5]);
+			break;
+		}
+		case CallTrace::Reset:
+			target.resetDevice();
+			break;
+		default:
+			SDLOG(0, "WARNING: unknown call %u in call trace, skipping it", call);
+			continue;
+		}
+		QueryPerformanceCounter(&stop);
+		ticks[call] += stop.QuadPart - start.QuadPart;
+		counts[call]++;
+
+		if (newTexture)
+		{
+			setTexture(args[0], newTexture);
+			newTexture->Release();
+		}
+		if (newSurface)
+		{
+			setSurface(args[0], newSurface);
+			newSurface->Release();
+		}
+	}
+
+	if (first) frameEvents.push_back(target.getFrameEvents());
+	QueryPerformanceCounter(&start);
+	target.redirectPresent(NULL, NULL, NULL, NULL);
+	QueryPerformanceCounter(&stop);
+	ticks[CallTrace::Present] += stop.QuadPart - start.QuadPart;
+	counts[CallTrace::Present]++;
+}
+
+void TraceReplayer::run(unsigned iterations, HookTargetFactory factory)
+{
+	SDLOG(0, "Replaying call trace, %u iterations", iterations);
+	frameEvents.clear();
+	for (unsigned i = 0; i < iterations; ++i)
+	{
+		// a fresh device and target for each iteration, so that every run starts from the same state
+		NullDevice* device = new NullDevice();
+		std::unique_ptr<HookTarget> target(factory(device));
+		for (size_t f = 0; f < frames.size(); ++f)
+		{
+			replayFrame(*target, device, frames[f].first, frames[f].second, i == 0);
+		}
+		if (i == 0) device->logStatistics();
+		textures.clear();
+		surfaces.clear();
+		target.reset();
+		device->Release();
+	}
+}
+
+void TraceReplayer::report(const char* eventsFilename)
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	SDLOG(0, "Call trace replay timing (hook layer only):");
+	for (unsigned c = 0; c < CallTrace::NUM_CALLS; ++c)
+	{
+		if (counts[c] == 0) continue;
+		double ns = ticks[c] * 1000000000.0 / freq.QuadPart / counts[c];
+		SDLOG(0, " - %26s: %10llu calls, %10.1f ns/call", getCallName((CallTrace::Call)c), counts[c], ns);
+	}
+
+	// one line per frame, diffing these files between builds shows changes in the detection
+	std::ofstream out(eventsFilename);
+	for (size_t f = 0; f < frameEvents.size(); ++f)
+	{
+		out << f << ":";
+		for (unsigned e = 0; e < PipelineDetector::NUM_EVENTS; ++e)
+		{
+			if (PipelineDetector::has(frameEvents[f], (PipelineDetector::Event)e)) out << " " << PipelineDetector::getEventName((PipelineDetector::Event)e);
+		}
+		out << "\n";
+	}
+	SDLOG(0, "Pipeline events of %u frames written to %s", frameEvents.size(), eventsFilename);
+}
+
+void TraceReplayer::replayRecordedTrace(HookTargetFactory factory)
+{
+	if (CallTrace::get().isRecording())
+	{
+		SDLOG(0, "Cannot replay the call trace while recording it");
+		return;
+	}
+	TraceReplayer replayer;
+	if (!replayer.load(GetDirectoryFile("dsfix\\calltrace.bin"))) return;
+	replayer.run(10, factory);
+	replayer.report(GetDirectoryFile("dsfix\\calltrace_events.txt"));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include <d3d9.h>
+
+#include "CallTrace.h"
+#include "HookTarget.h"
+
+// Replays a recorded call trace (see CallTrace) through the redirect functions of a HookTarget running on a
+// NullDevice. Measures the time spent per call in our hook layer and records the pipeline events of each frame,
+// so that changes to the detection can be checked against a known-good trace.
+// In the DLL, the target is a headless RSManager with its resources and effects created on the NullDevice, as they
+// are after a Reset in the game. The standalone tool in bench/ replays into the same PipelineHooks, without the effects.
+class TraceReplayer
+{
+	CallTrace::TraceHeader header;
+	std::vector<UINT32> words;
+	// begin and end of the records of each frame, in words
+	std::vector<std::pair<size_t, size_t> > frames;
+
+	// timing per call type, summed over all iterations
+	LONGLONG ticks[CallTrace::NUM_CALLS];
+	unsigned long long counts[CallTrace::NUM_CALLS];
+	// pipeline events of each frame, from the first iteration
+	std::vector<unsigned> frameEvents;
+
+	// replay resources by trace handle
+	std::vector<CComPtr<IDirect3DTexture9> > textures;
+	std::vector<CComPtr<IDirect3DSurface9> > surfaces;
+	// scratch geometry for draws, only the recorded start of the vertex data is meaningful
+	std::vector<BYTE> vertexData, indexData;
+
+	static const char* getCallName(CallTrace::Call call);
+
+	IDirect3DTexture9* texture(UINT32 handle);
+	IDirect3DSurface9* surface(UINT32 handle);
+	void setTexture(UINT32 handle, IDirect3DTexture9* pTexture);
+	void setSurface(UINT32 handle, IDirect3DSurface9* pSurface);
+	const void* vertices(const UINT32* recorded, UINT size);
+	const void* indices(UINT size);
+
+	void describeTexture(HookTarget& target, IDirect3DDevice9* device, const UINT32* args);
+	void describeSurface(HookTarget& target, IDirect3DDevice9* device, const UINT32* args);
+	void replayFrame(HookTarget& target, IDirect3DDevice9* device, size_t begin, size_t end, bool first);
+
+public:
+	TraceReplayer();
+
+	bool load(const char* filename);
+	void run(unsigned iterations, HookTargetFactory factory);
+	void report(const char* eventsFilename);
+
+	// replays dsfix\calltrace.bin, used by the replayCallTrace action
+	static void replayRecordedTrace(HookTargetFactory factory);
+};
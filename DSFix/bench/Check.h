@@ -0,0 +1,10 @@
+#pragma once
+
+// Shared by the tests in this directory: a failed CHECK is printed and counted, and the test exits with the count
+
+#include <cstdio>
+
+static unsigned failures = 0;
+
+#define CHECK(_cond) \
+	if (!(_cond)) { printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #_cond); ++failures; }
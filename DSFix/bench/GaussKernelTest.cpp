@@ -0,0 +1,82 @@
+// Tests of the DoF blur kernel (GaussKernel): the linear samples, fetched bilinearly as the texture unit does,
+// have to reproduce the iterated 9 tap kernel on an impulse, also when the kernel is truncated to MAX_SAMPLES
+// Build and run on Linux, from this directory:
+//   make test
+// Exits with the number of failed checks.
+
+#include "GaussKernel.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// deviation of the blurred impulse from the iterated kernel, at the worst texel
+static double maxError(const GaussKernel& kernel, unsigned iterations)
+{
+	std::vector<double> reference = GaussKernel::iterated(iterations);
+	int radius = (int)reference.size() - 1;
+	std::vector<double> impulse(radius * 2 + 3, 0.0);
+	impulse[radius + 1] = 1.0;
+	double error = 0.0;
+	for (int x = 1; x <= radius * 2 + 1; ++x)
+	{
+		double blurred = impulse[x] * kernel.sampleWeights[0];
+		for (unsigned i = 1; i < kernel.numSamples; ++i)
+		{
+			for (int side = -1; side <= 1; side += 2)
+			{
+				double pos = x + side * kernel.sampleOffsets[i];
+				int p = (int)floor(pos);
+				double f = pos - p;
+				double a = (p >= 0 && p < (int)impulse.size()) ? impulse[p] : 0.0;
+				double b = (p + 1 >= 0 && p + 1 < (int)impulse.size()) ? impulse[p + 1] : 0.0;
+				blurred += (a + (b - a) * f) * kernel.sampleWeights[i];
+			}
+		}
+		error = std::max(error, fabs(blurred - reference[abs(x - radius - 1)]));
+	}
+	return error;
+}
+
+int main()
+{
+	// the kernel is covered by the samples up to this many iterations, the tails dropped beyond it do not matter
+	const unsigned fullIterations = 30;
+	for (unsigned iterations = 1; iterations <= 64; ++iterations)
+	{
+		GaussKernel kernel(iterations);
+		double error = maxError(kernel, iterations);
+		if (iterations <= fullIterations)
+		{
+			CHECK(kernel.dropped < 0.001);
+			CHECK(error < 0.0005);
+		}
+		else
+		{
+			// truncated to MAX_SAMPLES, the renormalized weights stay within the weight of one dropped tail
+			CHECK(kernel.numSamples == GaussKernel::MAX_SAMPLES);
+			CHECK(kernel.numTaps == GaussKernel::MAX_SAMPLES * 2 - 2);
+			CHECK(error <= kernel.dropped / 2);
+		}
+		if (failures)
+		{
+			printf("%u iterations: %u taps, %u samples, %f dropped, max error %f\n", iterations, kernel.numTaps, kernel.numSamples, kernel.dropped, error);
+			break;
+		}
+
+		std::vector<double> taps = GaussKernel::iterated(iterations);
+		CHECK(taps.size() == iterations * 4 + 1);
+		double tapSum = taps[0], weightSum = kernel.sampleWeights[0];
+		for (size_t i = 1; i < taps.size(); ++i) tapSum += 2 * taps[i];
+		for (unsigned i = 1; i < kernel.numSamples; ++i) weightSum += 2 * kernel.sampleWeights[i];
+		CHECK(fabs(tapSum - 1.0) < 1e-6);
+		CHECK(fabs(weightSum - 1.0) < 1e-5);
+		// each sample lies between the two taps it combines
+		CHECK(kernel.sampleOffsets[0] == 0.0f);
+		for (unsigned i = 1; i < kernel.numSamples; ++i) CHECK(kernel.sampleOffsets[i] >= 2 * i - 1 && kernel.sampleOffsets[i] <= 2 * i);
+	}
+	printf("GaussKernelTest: %u failed\n", failures);
+	return failures;
+}
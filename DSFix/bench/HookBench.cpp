@@ -0,0 +1,24 @@
+// Benchmark of the hook layer without the game or a GPU: HookBenchmark on a DetectorTarget, which runs the synthetic
+// call sequences through the PipelineHooks of the DLL's RSManager, without its effects, on a NullDevice
+// Build and run on Linux, from this directory:
+//   make HookBench
+//   DSFIX_DIR=../../DATA ./HookBench
+// The settings (render and DoF resolution, HUD mod, resolution rules) are read from DSfix.ini in DSFIX_DIR.
+// In the game, the benchmarkHooks action runs the same benchmark on a headless RSManager with all effects.
+
+#include "HookBenchmark.h"
+#include "DetectorTarget.h"
+#include "main.h"
+
+int main()
+{
+	if (!std::ifstream(GetDirectoryFile("DSfix.ini")))
+	{
+		printf("%s not found, set DSFIX_DIR to the directory of DSfix.ini\n", GetDirectoryFile("DSfix.ini"));
+		return 1;
+	}
+	Settings::get().load();
+	Settings::get().setLogLevel(1);
+	HookBenchmark::run(DetectorTarget::create);
+	return 0;
+}
@@ -0,0 +1,156 @@
+// Benchmark of the ImageEncoder, runs on any platform (the encoder does not use Direct3D or Windows)
+// Build and run on Linux, from this directory:
+//   g++ -O2 -std=c++11 -pthread -DBENCH_ZLIB -I.. ImageEncoderBench.cpp ../ImageEncoder.cpp -lz -o ImageEncoderBench
+//   ./ImageEncoderBench [image.ppm] [iterations]
+// Without an image, a synthetic 2560x1440 frame is used. PPM images (P6, as written by most image tools) are padded
+// to BGRX like a locked D3DFMT_X8R8G8B8 surface.
+// With BENCH_ZLIB, the same filtered rows are also compressed with zlib at its default level on one thread, which is
+// what D3DXSaveSurfaceToFile does for PNG. That is the baseline the encoder replaces.
+
+#include "ImageEncoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef BENCH_ZLIB
+#include <zlib.h>
+#endif
+
+struct Frame
+{
+	unsigned width, height;
+	std::vector<uint8_t> bgrx;
+};
+
+static bool loadPpm(const char* filename, Frame& frame)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file) return false;
+	unsigned maxValue = 0;
+	bool ok = fscanf(file, "P6 %u %u %u", &frame.width, &frame.height, &maxValue) == 3 && maxValue == 255 && fgetc(file) != EOF;
+	std::vector<uint8_t> rgb(ok ? (size_t)frame.width * frame.height * 3 : 0);
+	ok = ok && fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+	fclose(file);
+	if (!ok) return false;
+	frame.bgrx.resize((size_t)frame.width * frame.height * 4);
+	for (size_t i = 0; i < (size_t)frame.width * frame.height; ++i)
+	{
+		frame.bgrx[i * 4 + 0] = rgb[i * 3 + 2];
+		frame.bgrx[i * 4 + 1] = rgb[i * 3 + 1];
+		frame.bgrx[i * 4 + 2] = rgb[i * 3 + 0];
+		frame.bgrx[i * 4 + 3] = 255;
+	}
+	return true;
+}
+
+// smooth lighting with some high frequency detail and noise, and a flat HUD-like band, roughly like a game frame
+static void synthesize(Frame& frame)
+{
+	frame.width = 2560;
+	frame.height = 1440;
+	frame.bgrx.resize((size_t)frame.width * frame.height * 4);
+	unsigned seed = 12345;
+	for (unsigned y = 0; y < frame.height; ++y)
+	{
+		for (unsigned x = 0; x < frame.width; ++x)
+		{
+			seed = seed * 1103515245 + 12345;
+			int noise = (int)((seed >> 16) & 7) - 4;
+			double light = 0.5 + 0.5 * sin(x * 0.004) * cos(y * 0.006);
+			double detail = ((x / 7 + y / 5) % 9) / 9.0;
+			uint8_t* p = &frame.bgrx[((size_t)y * frame.width + x) * 4];
+			if (y > frame.height - 120)
+			{
+				p[0] = 20; p[1] = 20; p[2] = 24;
+			}
+			else
+			{
+				p[0] = (uint8_t)std::min(255.0, std::max(0.0, 90 * light + 40 * detail + noise));
+				p[1] = (uint8_t)std::min(255.0, std::max(0.0, 120 * light + 30 * detail + noise));
+				p[2] = (uint8_t)std::min(255.0, std::max(0.0, 140 * light + 20 * detail + noise));
+			}
+			p[3] = 255;
+		}
+	}
+}
+
+template<typename F>
+static double timeMs(unsigned iterations, F f)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned i = 0; i < iterations; ++i) f();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+static void report(const char* name, double ms, size_t inputSize, size_t outputSize)
+{
+	printf("%-24s %9.1f ms %9.1f MB/s %9.2f%% of raw (%zu bytes)\n", name, ms, inputSize / (ms * 1000.0), 100.0 * outputSize / inputSize, outputSize);
+}
+
+int main(int argc, char** argv)
+{
+	Frame frame;
+	if (argc > 1 && argv[1][0] != '-')
+	{
+		if (!loadPpm(argv[1], frame))
+		{
+			fprintf(stderr, "could not load %s (binary PPM with 8 bits per channel expected)\n", argv[1]);
+			return 1;
+		}
+	}
+	else synthesize(frame);
+	unsigned iterations = argc > 2 ? (unsigned)atoi(argv[2]) : 5;
+
+	ImageEncoder::Image image = { frame.bgrx.data(), frame.width, frame.height, frame.width * 4, false };
+	// raw size of the RGB image
+	size_t rawSize = (size_t)frame.width * frame.height * 3;
+	printf("%ux%u, %u iterations, %u hardware threads\n", frame.width, frame.height, iterations, std::thread::hardware_concurrency());
+
+	std::vector<uint8_t> out;
+	double ms = timeMs(iterations, [&]() { ImageEncoder::encodePng(image, 1, out); });
+	report("PNG, 1 thread", ms, rawSize, out.size());
+	ms = timeMs(iterations, [&]() { ImageEncoder::encodePng(image, 0, out); });
+	report("PNG, all threads", ms, rawSize, out.size());
+	if (argc > 3)
+	{
+		FILE* file = fopen(argv[3], "wb");
+		fwrite(out.data(), 1, out.size(), file);
+		fclose(file);
+	}
+	ms = timeMs(iterations, [&]() { ImageEncoder::encodeQoi(image, out); });
+	report("QOI", ms, rawSize, out.size());
+
+#ifdef BENCH_ZLIB
+	// rows with the Up filter, as the input of the baseline
+	std::vector<uint8_t> filtered;
+	for (unsigned y = 0; y < frame.height; ++y)
+	{
+		filtered.push_back(2);
+		for (unsigned x = 0; x < frame.width; ++x)
+		{
+			for (int c = 2; c >= 0; --c)
+			{
+				uint8_t v = frame.bgrx[((size_t)y * frame.width + x) * 4 + c];
+				uint8_t above = y > 0 ? frame.bgrx[((size_t)(y - 1) * frame.width + x) * 4 + c] : 0;
+				filtered.push_back((uint8_t)(v - above));
+			}
+		}
+	}
+	std::vector<uint8_t> compressed(compressBound(filtered.size()));
+	uLongf compressedSize = 0;
+	ms = timeMs(iterations, [&]()
+	{
+		compressedSize = compressed.size();
+		compress2(compressed.data(), &compressedSize, filtered.data(), filtered.size(), Z_DEFAULT_COMPRESSION);
+	});
+	report("zlib baseline, 1 thread", ms, rawSize, compressedSize);
+#endif
+	return 0;
+}
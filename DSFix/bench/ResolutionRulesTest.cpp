@@ -0,0 +1,158 @@
+// Tests of the resolution rule parsing and matching (ResolutionRules), with the default settings
+// Build and run on Linux, from this directory:
+//   make test
+// Exits with the number of failed checks.
+
+#include "ResolutionRules.h"
+#include "main.h"
+#include "Check.h"
+
+typedef ResolutionRules RR;
+
+static RR& rules(const char* const* lines, size_t count, bool builtin)
+{
+	RR& r = RR::get();
+	r.clear();
+	for (size_t i = 0; i < count; ++i) CHECK(r.parse(lines[i]));
+	if (builtin) r.addBuiltinRules();
+	return r;
+}
+
+static RR::Target target(const RR::Rule* rule)
+{
+	return rule ? rule->target : RR::KEEP;
+}
+
+static void testOrder()
+{
+	// the ini rules go first, even when parsed after the built-in ones were added
+	const char* lines[] = { "1024x720 render any *0.5" };
+	RR& r = rules(lines, 1, true);
+	const RR::Rule* rule = r.find(1024, 720, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8);
+	CHECK(rule && rule->target == RR::SCALE && !rule->builtin);
+	CHECK(target(r.find(1024, 720, RR::TEXTURE, D3DFMT_A8R8G8B8)) == RR::RENDER);
+	CHECK(r.parse("1024x720 textures any 800x600"));
+	rule = r.find(1024, 720, RR::TEXTURE, D3DFMT_A8R8G8B8);
+	CHECK(rule && rule->target == RR::SIZE && !rule->builtin);
+	// between ini rules, the first one wins
+	CHECK(target(r.find(1024, 720, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8)) == RR::SCALE);
+	CHECK(target(r.find(1024, 720, RR::DEPTH_SURFACE, D3DFMT_D24S8)) == RR::RENDER);
+}
+
+static void testKinds()
+{
+	const char* lines[] = { "100x100 render any keep", "200x200 depth any keep", "300x300 textures any keep", "400x400 depthsurface any keep" };
+	RR& r = rules(lines, _countof(lines), false);
+	CHECK(r.find(100, 100, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(r.find(100, 100, RR::RENDER_SURFACE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(100, 100, RR::TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(100, 100, RR::DEPTH_SURFACE, D3DFMT_A8R8G8B8));
+	CHECK(r.find(200, 200, RR::DEPTH_TEXTURE, D3DFMT_D24S8));
+	CHECK(r.find(200, 200, RR::DEPTH_SURFACE, D3DFMT_D24S8));
+	CHECK(!r.find(200, 200, RR::RENDER_TEXTURE, D3DFMT_D24S8));
+	CHECK(r.find(300, 300, RR::TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(r.find(300, 300, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(r.find(300, 300, RR::DEPTH_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(300, 300, RR::RENDER_SURFACE, D3DFMT_A8R8G8B8));
+	CHECK(r.find(400, 400, RR::DEPTH_SURFACE, D3DFMT_D24S8));
+	CHECK(!r.find(400, 400, RR::DEPTH_TEXTURE, D3DFMT_D24S8));
+	CHECK(RR::textureKind(D3DUSAGE_RENDERTARGET) == RR::RENDER_TEXTURE);
+	CHECK(RR::textureKind(D3DUSAGE_DEPTHSTENCIL) == RR::DEPTH_TEXTURE);
+	CHECK(RR::textureKind(0) == RR::TEXTURE);
+}
+
+static void testFormats()
+{
+	const char* lines[] = { "100x100 any any keep", "200x200 any A8R8G8B8 keep", "300x300 any r16f keep", "400x400 any 113 keep" };
+	RR& r = rules(lines, _countof(lines), false);
+	CHECK(r.find(100, 100, RR::TEXTURE, D3DFMT_DXT5));
+	CHECK(r.find(100, 100, RR::TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(r.find(200, 200, RR::TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(200, 200, RR::TEXTURE, D3DFMT_X8R8G8B8));
+	CHECK(r.find(300, 300, RR::TEXTURE, D3DFMT_R16F));
+	CHECK(!r.find(300, 300, RR::TEXTURE, D3DFMT_R32F));
+	const RR::Rule* rule = r.find(400, 400, RR::TEXTURE, D3DFMT_A16B16G16R16F);
+	CHECK(rule && rule->format == D3DFMT_A16B16G16R16F);
+	CHECK(!r.find(400, 400, RR::TEXTURE, D3DFMT_A8R8G8B8));
+}
+
+static void testTargets()
+{
+	const char* lines[] = { "100x100 any any *0.5", "101x33 any any *0.5", "1x1 any any *0.25", "200x200 any any 640x360",
+		"300x300 any any keep", "400x400 any any render", "500x500 any any dof" };
+	RR& r = rules(lines, _countof(lines), false);
+	const RR::Rule* rule = r.find(100, 100, RR::TEXTURE, D3DFMT_A8R8G8B8);
+	CHECK(rule && rule->target == RR::SCALE && rule->scale == 0.5f);
+	rule = r.find(200, 200, RR::TEXTURE, D3DFMT_A8R8G8B8);
+	CHECK(rule && rule->target == RR::SIZE && rule->targetWidth == 640 && rule->targetHeight == 360);
+
+	UINT w = 100, h = 100;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::SCALE && w == 50 && h == 50);
+	// rounded, and at least 1
+	w = 101, h = 33;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::SCALE && w == 51 && h == 17);
+	w = 1, h = 1;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::SCALE && w == 1 && h == 1);
+	w = 200, h = 200;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::SIZE && w == 640 && h == 360);
+	w = 300, h = 300;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::KEEP && w == 300 && h == 300);
+	w = 400, h = 400;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::RENDER
+		&& w == Settings::get().getRenderWidth() && h == Settings::get().getRenderHeight());
+	// without a DoF override resolution, DoF buffers keep their size
+	w = 500, h = 500;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::DOF && w == 500 && h == 500);
+	// with one, the 360 high buffers get the full DoF resolution, the 180 high ones half of it, and larger ones the full one
+	Settings::get().setDOFOverrideResolution(540);
+	CHECK(r.parse("512x360 any any dof") && r.parse("256x180 any any dof") && r.parse("1920x1080 any any dof"));
+	w = 512, h = 360;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::DOF && w == 960 && h == 540);
+	w = 256, h = 180;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::DOF && w == 480 && h == 270);
+	w = 1920, h = 1080;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::DOF && w == 960 && h == 540);
+	w = 500, h = 500;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::DOF && w == 960 && h == 540);
+	Settings::get().setDOFOverrideResolution(0);
+	w = 600, h = 600;
+	CHECK(r.apply(w, h, RR::TEXTURE, D3DFMT_A8R8G8B8) == RR::KEEP && w == 600 && h == 600);
+}
+
+static void testRejected()
+{
+	RR& r = rules(NULL, 0, false);
+	CHECK(!r.parse("100x100 any any 0x0"));
+	CHECK(!r.parse("100x100 any any 0x100"));
+	CHECK(!r.parse("100x100 any any *-1"));
+	CHECK(!r.parse("100x100 any any *0"));
+	CHECK(!r.parse("100x100 anything any keep"));
+	CHECK(!r.parse("100x100 any R9G9B9 keep"));
+	CHECK(!r.parse("100x100 any any sideways"));
+	CHECK(!r.parse("100x100 any any"));
+	CHECK(!r.parse("big any any keep"));
+	CHECK(!r.find(100, 100, RR::TEXTURE, D3DFMT_A8R8G8B8));
+}
+
+static void testMisses()
+{
+	const char* lines[] = { "100x100 render A8R8G8B8 keep" };
+	RR& r = rules(lines, 1, false);
+	CHECK(r.find(100, 100, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(100, 101, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(101, 100, RR::RENDER_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(100, 100, RR::DEPTH_TEXTURE, D3DFMT_A8R8G8B8));
+	CHECK(!r.find(100, 100, RR::RENDER_TEXTURE, D3DFMT_X8R8G8B8));
+}
+
+int main()
+{
+	testOrder();
+	testKinds();
+	testFormats();
+	testTargets();
+	testRejected();
+	testMisses();
+	printf("ResolutionRulesTest: %u failed\n", failures);
+	return failures;
+}
@@ -0,0 +1,35 @@
+// Replay of a call trace without the game or a GPU: TraceReplayer on a DetectorTarget, which runs the recorded calls
+// through the PipelineHooks of the DLL's RSManager on a NullDevice: the resolution rules, the pipeline detection and the
+// HUD redirection with the HudLayout and the UP draw batching, as configured. Only our effects are left out.
+// Build and run on Linux, from this directory:
+//   make TraceReplay
+//   DSFIX_DIR=../../DATA ./TraceReplay calltrace.bin [iterations] [events.txt]
+// The trace is recorded in the game with the recordCallTrace action (dsfix\calltrace.bin). The settings are read from
+// DSfix.ini in DSFIX_DIR, they should match the ones the trace was recorded with.
+// The pipeline events of each frame are written to events.txt (calltrace_events.txt by default), diffing these
+// between builds shows changes in the detection.
+
+#include "TraceReplayer.h"
+#include "DetectorTarget.h"
+#include "main.h"
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s calltrace.bin [iterations] [events.txt]\n", argv[0]);
+		return 1;
+	}
+	if (!std::ifstream(GetDirectoryFile("DSfix.ini")))
+	{
+		printf("%s not found, set DSFIX_DIR to the directory of DSfix.ini\n", GetDirectoryFile("DSfix.ini"));
+		return 1;
+	}
+	Settings::get().load();
+	Settings::get().setLogLevel(1);
+	TraceReplayer replayer;
+	if (!replayer.load(argv[1])) return 1;
+	replayer.run(argc > 2 ? std::max(1, atoi(argv[2])) : 10, DetectorTarget::create);
+	replayer.report(argc > 3 ? argv[3] : "calltrace_events.txt");
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "WinShim.h"
+
+#include <cstdlib>
+
+#include "main.h"
+#include "d3dutil.h"
+
+int sscanf_s(const char* buffer, const char* format, ...)
+{
+	// collect the result pointers, dropping the size argument of each string conversion
+	void* results[16] = {};
+	unsigned numResults = 0;
+	va_list args;
+	va_start(args, format);
+	for (const char* f = format; *f; ++f)
+	{
+		if (*f != '%') continue;
+		++f;
+		if (*f == '%') continue;
+		bool suppressed = *f == '*';
+		while (*f && strchr("*0123456789hlLjzt", *f)) ++f;
+		if (suppressed || !*f) continue;
+		if (numResults < _countof(results)) results[numResults++] = va_arg(args, void*);
+		if (*f == 's' || *f == 'c' || *f == '[') va_arg(args, unsigned);
+	}
+	va_end(args);
+	return sscanf(buffer, format, results[0], results[1], results[2], results[3], results[4], results[5], results[6], results[7],
+		results[8], results[9], results[10], results[11], results[12], results[13], results[14], results[15]);
+}
+
+void PrintLog(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+}
+
+// files are looked up in DSFIX_DIR (the DATA directory of the repository, for example), or the working directory
+const char* GetDirectoryFile(const char* filename)
+{
+	static char path[MAX_PATH];
+	const char* dir = getenv("DSFIX_DIR");
+	snprintf(path, sizeof(path), "%s/%s", dir ? dir : ".", filename);
+	for (char* c = path; *c; ++c)
+	{
+		if (*c == '\\') *c = '/';
+	}
+	return path;
+}
+
+// the formats declared in WinShim.h, named as by d3dutil.cpp
+TCHAR* D3DFormatToString(D3DFORMAT format, bool bWithPrefix)
+{
+	const char* pstr;
+	switch (format)
+	{
+#define FORMAT(_name) case _name: pstr = #_name; break;
+	FORMAT(D3DFMT_UNKNOWN) FORMAT(D3DFMT_R8G8B8) FORMAT(D3DFMT_A8R8G8B8) FORMAT(D3DFMT_X8R8G8B8) FORMAT(D3DFMT_R5G6B5)
+	FORMAT(D3DFMT_X1R5G5B5) FORMAT(D3DFMT_A1R5G5B5) FORMAT(D3DFMT_A4R4G4B4) FORMAT(D3DFMT_A8) FORMAT(D3DFMT_A2B10G10R10)
+	FORMAT(D3DFMT_A8B8G8R8) FORMAT(D3DFMT_X8B8G8R8) FORMAT(D3DFMT_G16R16) FORMAT(D3DFMT_A2R10G10B10)
+	FORMAT(D3DFMT_A16B16G16R16) FORMAT(D3DFMT_P8) FORMAT(D3DFMT_L8) FORMAT(D3DFMT_A8L8) FORMAT(D3DFMT_DXT1)
+	FORMAT(D3DFMT_DXT2) FORMAT(D3DFMT_DXT3) FORMAT(D3DFMT_DXT4) FORMAT(D3DFMT_DXT5) FORMAT(D3DFMT_D16_LOCKABLE)
+	FORMAT(D3DFMT_D32) FORMAT(D3DFMT_D15S1) FORMAT(D3DFMT_D24S8) FORMAT(D3DFMT_D24X8) FORMAT(D3DFMT_D16)
+	FORMAT(D3DFMT_D32F_LOCKABLE) FORMAT(D3DFMT_L16) FORMAT(D3DFMT_VERTEXDATA) FORMAT(D3DFMT_INDEX16)
+	FORMAT(D3DFMT_INDEX32) FORMAT(D3DFMT_R16F) FORMAT(D3DFMT_G16R16F) FORMAT(D3DFMT_A16B16G16R16F) FORMAT(D3DFMT_R32F)
+	FORMAT(D3DFMT_G32R32F) FORMAT(D3DFMT_A32B32G32R32F)
+#undef FORMAT
+	default:
+		pstr = "       Unknown format";
+		break;
+	}
+	return const_cast<TCHAR*>(bWithPrefix ? pstr : pstr + strlen("D3DFMT_"));
+}
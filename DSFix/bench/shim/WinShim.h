@@ -0,0 +1,707 @@
+#pragma once
+
+// Minimal stand-ins for the Windows, ATL and Direct3D 9 declarations used by the parts of DSfix which do not need
+// the game or a GPU (NullDevice, PipelineDetector, ResolutionRules, CallTrace, TraceReplayer, HookBenchmark)
+// Force included instead of stdafx.h by the standalone builds in bench/, see the Makefile there
+// Only what these files use is declared; the interfaces have the full method lists, so that the NullDevice implements
+// all of them as it does on Windows. Values of constants match the SDK headers where they end up in trace files.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+
+// Windows ////////////////////////////////////////////////////////////////////
+
+#define WINAPI
+#define APIENTRY
+#define CALLBACK
+#define CONST const
+#define TRUE 1
+#define FALSE 0
+#define MAX_PATH 260
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef float FLOAT;
+typedef int8_t INT8;
+typedef uint8_t UINT8;
+typedef int16_t INT16;
+typedef uint16_t UINT16;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uintptr_t UINT_PTR;
+typedef int32_t HRESULT;
+typedef char TCHAR;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef void* HANDLE;
+typedef struct HWND__* HWND;
+typedef struct HDC__* HDC;
+typedef struct HINSTANCE__* HINSTANCE;
+typedef struct HMONITOR__* HMONITOR;
+
+typedef union _LARGE_INTEGER
+{
+	LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct tagRECT
+{
+	LONG left, top, right, bottom;
+} RECT;
+
+typedef struct tagPOINT
+{
+	LONG x, y;
+} POINT;
+
+typedef struct _RGNDATA
+{
+	DWORD dwSize, iType, nCount, nRgnSize;
+	RECT rcBound;
+} RGNDATA;
+
+typedef struct tagPALETTEENTRY
+{
+	BYTE peRed, peGreen, peBlue, peFlags;
+} PALETTEENTRY;
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_NOINTERFACE ((HRESULT)0x80004002)
+#define E_POINTER ((HRESULT)0x80004003)
+#define E_FAIL ((HRESULT)0x80004005)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define ZeroMemory(_dest, _size) memset((_dest), 0, (_size))
+#define _countof(_array) (sizeof(_array) / sizeof((_array)[0]))
+#define _stricmp strcasecmp
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* count)
+{
+	count->QuadPart = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency)
+{
+	frequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+inline int fopen_s(FILE** file, const char* filename, const char* mode)
+{
+	*file = fopen(filename, mode);
+	return *file ? 0 : -1;
+}
+
+// the buffer size arguments following %s, %c and %[ are skipped, the conversions need an explicit width
+int sscanf_s(const char* buffer, const char* format, ...);
+
+// COM ////////////////////////////////////////////////////////////////////////
+
+typedef struct _GUID
+{
+	DWORD Data1;
+	WORD Data2, Data3;
+	BYTE Data4[8];
+} GUID, IID;
+typedef const GUID& REFGUID;
+typedef const IID& REFIID;
+
+inline bool operator==(const GUID& a, const GUID& b)
+{
+	return memcmp(&a, &b, sizeof(GUID)) == 0;
+}
+inline bool operator!=(const GUID& a, const GUID& b)
+{
+	return !(a == b);
+}
+
+#define STDMETHOD(_method) virtual HRESULT _method
+#define STDMETHOD_(_type, _method) virtual _type _method
+#define THIS_
+#define THIS void
+#define PURE = 0
+
+struct IUnknown
+{
+	STDMETHOD(QueryInterface)(THIS_ REFIID riid, void** ppvObj) PURE;
+	STDMETHOD_(ULONG, AddRef)(THIS) PURE;
+	STDMETHOD_(ULONG, Release)(THIS) PURE;
+};
+typedef IUnknown* LPUNKNOWN;
+
+// the parts of ATL's smart pointer we use
+template <class T>
+class CComPtr
+{
+public:
+	T* p;
+
+	CComPtr() : p(NULL) {}
+	CComPtr(T* lp) : p(lp)
+	{
+		if (p) p->AddRef();
+	}
+	CComPtr(const CComPtr& other) : p(other.p)
+	{
+		if (p) p->AddRef();
+	}
+	~CComPtr()
+	{
+		if (p) p->Release();
+	}
+	T* operator=(T* lp)
+	{
+		if (lp) lp->AddRef();
+		if (p) p->Release();
+		p = lp;
+		return p;
+	}
+	T* operator=(const CComPtr& other)
+	{
+		return *this = other.p;
+	}
+	operator T*() const
+	{
+		return p;
+	}
+	T& operator*() const
+	{
+		return *p;
+	}
+	T** operator&()
+	{
+		return &p;
+	}
+	T* operator->() const
+	{
+		return p;
+	}
+	bool operator!() const
+	{
+		return p == NULL;
+	}
+	void Attach(T* lp)
+	{
+		if (p) p->Release();
+		p = lp;
+	}
+	T* Detach()
+	{
+		T* lp = p;
+		p = NULL;
+		return lp;
+	}
+	void Release()
+	{
+		T* lp = p;
+		p = NULL;
+		if (lp) lp->Release();
+	}
+};
+
+// Direct3D 9 /////////////////////////////////////////////////////////////////
+
+#define MAKEFOURCC(_c0, _c1, _c2, _c3) ((DWORD)(BYTE)(_c0) | ((DWORD)(BYTE)(_c1) << 8) | ((DWORD)(BYTE)(_c2) << 16) | ((DWORD)(BYTE)(_c3) << 24))
+#define MAKE_D3DHRESULT(_code) ((HRESULT)(0x88760000 | (_code)))
+
+#define D3D_OK S_OK
+#define D3DERR_NOTFOUND MAKE_D3DHRESULT(2150)
+#define D3DERR_INVALIDCALL MAKE_D3DHRESULT(2156)
+#define D3DERR_NOTAVAILABLE MAKE_D3DHRESULT(2154)
+#define D3DERR_OUTOFVIDEOMEMORY MAKE_D3DHRESULT(380)
+
+typedef DWORD D3DCOLOR;
+#define D3DCOLOR_ARGB(_a, _r, _g, _b) ((D3DCOLOR)((((_a) & 0xff) << 24) | (((_r) & 0xff) << 16) | (((_g) & 0xff) << 8) | ((_b) & 0xff)))
+#define D3DCOLOR_RGBA(_r, _g, _b, _a) D3DCOLOR_ARGB(_a, _r, _g, _b)
+
+typedef enum _D3DFORMAT
+{
+	D3DFMT_UNKNOWN = 0,
+	D3DFMT_R8G8B8 = 20, D3DFMT_A8R8G8B8 = 21, D3DFMT_X8R8G8B8 = 22, D3DFMT_R5G6B5 = 23, D3DFMT_X1R5G5B5 = 24,
+	D3DFMT_A1R5G5B5 = 25, D3DFMT_A4R4G4B4 = 26, D3DFMT_A8 = 28, D3DFMT_A2B10G10R10 = 31, D3DFMT_A8B8G8R8 = 32,
+	D3DFMT_X8B8G8R8 = 33, D3DFMT_G16R16 = 34, D3DFMT_A2R10G10B10 = 35, D3DFMT_A16B16G16R16 = 36,
+	D3DFMT_P8 = 41, D3DFMT_L8 = 50, D3DFMT_A8L8 = 51,
+	D3DFMT_DXT1 = MAKEFOURCC('D', 'X', 'T', '1'), D3DFMT_DXT2 = MAKEFOURCC('D', 'X', 'T', '2'),
+	D3DFMT_DXT3 = MAKEFOURCC('D', 'X', 'T', '3'), D3DFMT_DXT4 = MAKEFOURCC('D', 'X', 'T', '4'),
+	D3DFMT_DXT5 = MAKEFOURCC('D', 'X', 'T', '5'),
+	D3DFMT_D16_LOCKABLE = 70, D3DFMT_D32 = 71, D3DFMT_D15S1 = 73, D3DFMT_D24S8 = 75, D3DFMT_D24X8 = 77,
+	D3DFMT_D16 = 80, D3DFMT_D32F_LOCKABLE = 82, D3DFMT_L16 = 81,
+	D3DFMT_VERTEXDATA = 100, D3DFMT_INDEX16 = 101, D3DFMT_INDEX32 = 102,
+	D3DFMT_R16F = 111, D3DFMT_G16R16F = 112, D3DFMT_A16B16G16R16F = 113,
+	D3DFMT_R32F = 114, D3DFMT_G32R32F = 115, D3DFMT_A32B32G32R32F = 116,
+	D3DFMT_FORCE_DWORD = 0x7fffffff
+} D3DFORMAT;
+
+typedef enum _D3DRESOURCETYPE
+{
+	D3DRTYPE_SURFACE = 1, D3DRTYPE_VOLUME = 2, D3DRTYPE_TEXTURE = 3, D3DRTYPE_VOLUMETEXTURE = 4,
+	D3DRTYPE_CUBETEXTURE = 5, D3DRTYPE_VERTEXBUFFER = 6, D3DRTYPE_INDEXBUFFER = 7
+} D3DRESOURCETYPE;
+
+typedef enum _D3DPOOL
+{
+	D3DPOOL_DEFAULT = 0, D3DPOOL_MANAGED = 1, D3DPOOL_SYSTEMMEM = 2, D3DPOOL_SCRATCH = 3
+} D3DPOOL;
+
+typedef enum _D3DMULTISAMPLE_TYPE
+{
+	D3DMULTISAMPLE_NONE = 0, D3DMULTISAMPLE_NONMASKABLE = 1, D3DMULTISAMPLE_2_SAMPLES = 2
+} D3DMULTISAMPLE_TYPE;
+
+#define D3DUSAGE_RENDERTARGET 0x00000001L
+#define D3DUSAGE_DEPTHSTENCIL 0x00000002L
+#define D3DUSAGE_WRITEONLY 0x00000008L
+#define D3DUSAGE_DYNAMIC 0x00000200L
+
+#define D3DLOCK_READONLY 0x00000010L
+#define D3DLOCK_DISCARD 0x00002000L
+#define D3DLOCK_NOOVERWRITE 0x00001000L
+
+#define D3DCLEAR_TARGET 0x00000001L
+#define D3DCLEAR_ZBUFFER 0x00000002L
+#define D3DCLEAR_STENCIL 0x00000004L
+
+#define D3DCOLORWRITEENABLE_RED (1L << 0)
+#define D3DCOLORWRITEENABLE_GREEN (1L << 1)
+#define D3DCOLORWRITEENABLE_BLUE (1L << 2)
+#define D3DCOLORWRITEENABLE_ALPHA (1L << 3)
+
+#define D3DTA_CURRENT 0x00000001
+#define D3DTA_TEXTURE 0x00000002
+
+#define D3DISSUE_END (1 << 0)
+#define D3DISSUE_BEGIN (1 << 1)
+#define D3DGETDATA_FLUSH (1 << 0)
+
+#define D3DDEVCAPS_HWTRANSFORMANDLIGHT 0x00010000L
+#define D3DDEVCAPS_PUREDEVICE 0x00100000L
+#define D3DPTEXTURECAPS_ALPHA 0x00000004L
+#define D3DPTEXTURECAPS_MIPMAP 0x00004000L
+#define D3DVS_VERSION(_major, _minor) (0xFFFE0000 | ((_major) << 8) | (_minor))
+#define D3DPS_VERSION(_major, _minor) (0xFFFF0000 | ((_major) << 8) | (_minor))
+
+typedef enum _D3DQUERYTYPE
+{
+	D3DQUERYTYPE_EVENT = 8, D3DQUERYTYPE_OCCLUSION = 9, D3DQUERYTYPE_TIMESTAMP = 10,
+	D3DQUERYTYPE_TIMESTAMPDISJOINT = 11, D3DQUERYTYPE_TIMESTAMPFREQ = 12
+} D3DQUERYTYPE;
+
+typedef enum _D3DPRIMITIVETYPE
+{
+	D3DPT_POINTLIST = 1, D3DPT_LINELIST = 2, D3DPT_LINESTRIP = 3, D3DPT_TRIANGLELIST = 4,
+	D3DPT_TRIANGLESTRIP = 5, D3DPT_TRIANGLEFAN = 6
+} D3DPRIMITIVETYPE;
+
+typedef enum _D3DRENDERSTATETYPE
+{
+	D3DRS_ZENABLE = 7, D3DRS_ALPHABLENDENABLE = 27, D3DRS_COLORWRITEENABLE = 168
+} D3DRENDERSTATETYPE;
+
+typedef enum _D3DTEXTURESTAGESTATETYPE
+{
+	D3DTSS_COLOROP = 1, D3DTSS_COLORARG1 = 2, D3DTSS_COLORARG2 = 3, D3DTSS_ALPHAOP = 4, D3DTSS_ALPHAARG1 = 5, D3DTSS_ALPHAARG2 = 6
+} D3DTEXTURESTAGESTATETYPE;
+
+typedef enum _D3DTEXTUREOP
+{
+	D3DTOP_SELECTARG1 = 2, D3DTOP_ADD = 7, D3DTOP_BLENDTEXTUREALPHA = 13
+} D3DTEXTUREOP;
+
+typedef enum _D3DSAMPLERSTATETYPE
+{
+	D3DSAMP_ADDRESSU = 1, D3DSAMP_ADDRESSV = 2, D3DSAMP_MAGFILTER = 5, D3DSAMP_MINFILTER = 6, D3DSAMP_MIPFILTER = 7
+} D3DSAMPLERSTATETYPE;
+
+typedef enum _D3DTEXTUREFILTERTYPE
+{
+	D3DTEXF_NONE = 0, D3DTEXF_POINT = 1, D3DTEXF_LINEAR = 2
+} D3DTEXTUREFILTERTYPE;
+
+typedef enum _D3DTRANSFORMSTATETYPE
+{
+	D3DTS_VIEW = 2, D3DTS_PROJECTION = 3
+} D3DTRANSFORMSTATETYPE;
+
+typedef enum _D3DSTATEBLOCKTYPE
+{
+	D3DSBT_ALL = 1, D3DSBT_PIXELSTATE = 2, D3DSBT_VERTEXSTATE = 3
+} D3DSTATEBLOCKTYPE;
+
+typedef enum _D3DBACKBUFFER_TYPE
+{
+	D3DBACKBUFFER_TYPE_MONO = 0
+} D3DBACKBUFFER_TYPE;
+
+typedef enum _D3DDEVTYPE
+{
+	D3DDEVTYPE_HAL = 1, D3DDEVTYPE_REF = 2, D3DDEVTYPE_SW = 3, D3DDEVTYPE_NULLREF = 4
+} D3DDEVTYPE;
+
+typedef enum _D3DDECLTYPE
+{
+	D3DDECLTYPE_FLOAT2 = 1, D3DDECLTYPE_FLOAT3 = 2, D3DDECLTYPE_FLOAT4 = 3, D3DDECLTYPE_D3DCOLOR = 4,
+	D3DDECLTYPE_SHORT2 = 6, D3DDECLTYPE_SHORT4 = 7, D3DDECLTYPE_UNUSED = 17
+} D3DDECLTYPE;
+
+typedef enum _D3DDECLUSAGE
+{
+	D3DDECLUSAGE_POSITION = 0, D3DDECLUSAGE_TEXCOORD = 5, D3DDECLUSAGE_POSITIONT = 9, D3DDECLUSAGE_COLOR = 10
+} D3DDECLUSAGE;
+
+typedef struct _D3DSURFACE_DESC
+{
+	D3DFORMAT Format;
+	D3DRESOURCETYPE Type;
+	DWORD Usage;
+	D3DPOOL Pool;
+	D3DMULTISAMPLE_TYPE MultiSampleType;
+	DWORD MultiSampleQuality;
+	UINT Width;
+	UINT Height;
+} D3DSURFACE_DESC;
+
+typedef struct _D3DVERTEXBUFFER_DESC
+{
+	D3DFORMAT Format;
+	D3DRESOURCETYPE Type;
+	DWORD Usage;
+	D3DPOOL Pool;
+	UINT Size;
+	DWORD FVF;
+} D3DVERTEXBUFFER_DESC;
+
+typedef struct _D3DINDEXBUFFER_DESC
+{
+	D3DFORMAT Format;
+	D3DRESOURCETYPE Type;
+	DWORD Usage;
+	D3DPOOL Pool;
+	UINT Size;
+} D3DINDEXBUFFER_DESC;
+
+typedef struct _D3DLOCKED_RECT
+{
+	INT Pitch;
+	void* pBits;
+} D3DLOCKED_RECT;
+
+typedef struct _D3DVERTEXELEMENT9
+{
+	WORD Stream;
+	WORD Offset;
+	BYTE Type, Method, Usage, UsageIndex;
+} D3DVERTEXELEMENT9;
+
+#define MAXD3DDECLLENGTH 64
+
+typedef struct _D3DVIEWPORT9
+{
+	DWORD X, Y, Width, Height;
+	float MinZ, MaxZ;
+} D3DVIEWPORT9;
+
+typedef struct _D3DMATRIX
+{
+	float m[4][4];
+} D3DMATRIX;
+
+typedef struct _D3DRECT
+{
+	LONG x1, y1, x2, y2;
+} D3DRECT;
+
+typedef struct _D3DCAPS9
+{
+	D3DDEVTYPE DeviceType;
+	UINT AdapterOrdinal;
+	DWORD DevCaps, TextureCaps;
+	DWORD MaxTextureWidth, MaxTextureHeight;
+	DWORD MaxTextureBlendStages, MaxSimultaneousTextures;
+	DWORD MaxPrimitiveCount, MaxVertexIndex, MaxStreams, MaxStreamStride;
+	DWORD VertexShaderVersion, MaxVertexShaderConst;
+	DWORD PixelShaderVersion;
+	float PixelShader1xMaxValue;
+	DWORD NumSimultaneousRTs;
+	DWORD MaxVShaderInstructionsExecuted, MaxPShaderInstructionsExecuted;
+	DWORD MaxVertexShader30InstructionSlots, MaxPixelShader30InstructionSlots;
+} D3DCAPS9;
+
+// only ever cleared or passed through
+typedef struct _D3DDISPLAYMODE { UINT Width, Height, RefreshRate; D3DFORMAT Format; } D3DDISPLAYMODE;
+typedef struct _D3DDEVICE_CREATION_PARAMETERS { UINT AdapterOrdinal; D3DDEVTYPE DeviceType; HWND hFocusWindow; DWORD BehaviorFlags; } D3DDEVICE_CREATION_PARAMETERS;
+typedef struct _D3DPRESENT_PARAMETERS { UINT BackBufferWidth, BackBufferHeight; D3DFORMAT BackBufferFormat; UINT BackBufferCount; } D3DPRESENT_PARAMETERS;
+typedef struct _D3DRASTER_STATUS { BOOL InVBlank; UINT ScanLine; } D3DRASTER_STATUS;
+typedef struct _D3DGAMMARAMP { WORD red[256], green[256], blue[256]; } D3DGAMMARAMP;
+typedef struct _D3DMATERIAL9 { float Diffuse[4], Ambient[4], Specular[4], Emissive[4], Power; } D3DMATERIAL9;
+typedef struct _D3DLIGHT9 { DWORD Type; float Diffuse[4], Specular[4], Ambient[4], Position[3], Direction[3], Range, Falloff, Attenuation[3], Theta, Phi; } D3DLIGHT9;
+typedef struct _D3DCLIPSTATUS9 { DWORD ClipUnion, ClipIntersection; } D3DCLIPSTATUS9;
+typedef struct _D3DRECTPATCH_INFO { UINT StartVertexOffsetWidth, StartVertexOffsetHeight, Width, Height, Stride; } D3DRECTPATCH_INFO;
+typedef struct _D3DTRIPATCH_INFO { UINT StartVertexOffset, NumVertices; } D3DTRIPATCH_INFO;
+
+struct IDirect3D9;
+struct IDirect3DDevice9;
+struct IDirect3DSwapChain9;
+struct IDirect3DVolumeTexture9;
+struct IDirect3DCubeTexture9;
+struct IDirect3DSurface9;
+
+struct IDirect3DResource9 : public IUnknown
+{
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(SetPrivateData)(THIS_ REFGUID refguid, CONST void* pData, DWORD SizeOfData, DWORD Flags) PURE;
+	STDMETHOD(GetPrivateData)(THIS_ REFGUID refguid, void* pData, DWORD* pSizeOfData) PURE;
+	STDMETHOD(FreePrivateData)(THIS_ REFGUID refguid) PURE;
+	STDMETHOD_(DWORD, SetPriority)(THIS_ DWORD PriorityNew) PURE;
+	STDMETHOD_(DWORD, GetPriority)(THIS) PURE;
+	STDMETHOD_(void, PreLoad)(THIS) PURE;
+	STDMETHOD_(D3DRESOURCETYPE, GetType)(THIS) PURE;
+};
+
+struct IDirect3DBaseTexture9 : public IDirect3DResource9
+{
+	STDMETHOD_(DWORD, SetLOD)(THIS_ DWORD LODNew) PURE;
+	STDMETHOD_(DWORD, GetLOD)(THIS) PURE;
+	STDMETHOD_(DWORD, GetLevelCount)(THIS) PURE;
+	STDMETHOD(SetAutoGenFilterType)(THIS_ D3DTEXTUREFILTERTYPE FilterType) PURE;
+	STDMETHOD_(D3DTEXTUREFILTERTYPE, GetAutoGenFilterType)(THIS) PURE;
+	STDMETHOD_(void, GenerateMipSubLevels)(THIS) PURE;
+};
+
+struct IDirect3DTexture9 : public IDirect3DBaseTexture9
+{
+	STDMETHOD(GetLevelDesc)(THIS_ UINT Level, D3DSURFACE_DESC *pDesc) PURE;
+	STDMETHOD(GetSurfaceLevel)(THIS_ UINT Level, IDirect3DSurface9** ppSurfaceLevel) PURE;
+	STDMETHOD(LockRect)(THIS_ UINT Level, D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) PURE;
+	STDMETHOD(UnlockRect)(THIS_ UINT Level) PURE;
+	STDMETHOD(AddDirtyRect)(THIS_ CONST RECT* pDirtyRect) PURE;
+};
+
+struct IDirect3DSurface9 : public IDirect3DResource9
+{
+	STDMETHOD(GetContainer)(THIS_ REFIID riid, void** ppContainer) PURE;
+	STDMETHOD(GetDesc)(THIS_ D3DSURFACE_DESC *pDesc) PURE;
+	STDMETHOD(LockRect)(THIS_ D3DLOCKED_RECT* pLockedRect, CONST RECT* pRect, DWORD Flags) PURE;
+	STDMETHOD(UnlockRect)(THIS) PURE;
+	STDMETHOD(GetDC)(THIS_ HDC *phdc) PURE;
+	STDMETHOD(ReleaseDC)(THIS_ HDC hdc) PURE;
+};
+
+struct IDirect3DVertexBuffer9 : public IDirect3DResource9
+{
+	STDMETHOD(Lock)(THIS_ UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) PURE;
+	STDMETHOD(Unlock)(THIS) PURE;
+	STDMETHOD(GetDesc)(THIS_ D3DVERTEXBUFFER_DESC *pDesc) PURE;
+};
+
+struct IDirect3DIndexBuffer9 : public IDirect3DResource9
+{
+	STDMETHOD(Lock)(THIS_ UINT OffsetToLock, UINT SizeToLock, void** ppbData, DWORD Flags) PURE;
+	STDMETHOD(Unlock)(THIS) PURE;
+	STDMETHOD(GetDesc)(THIS_ D3DINDEXBUFFER_DESC *pDesc) PURE;
+};
+
+struct IDirect3DStateBlock9 : public IUnknown
+{
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(Capture)(THIS) PURE;
+	STDMETHOD(Apply)(THIS) PURE;
+};
+
+struct IDirect3DVertexDeclaration9 : public IUnknown
+{
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(GetDeclaration)(THIS_ D3DVERTEXELEMENT9* pElement, UINT* pNumElements) PURE;
+};
+
+struct IDirect3DVertexShader9 : public IUnknown
+{
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(GetFunction)(THIS_ void* pData, UINT* pSizeOfData) PURE;
+};
+
+struct IDirect3DPixelShader9 : public IUnknown
+{
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD(GetFunction)(THIS_ void* pData, UINT* pSizeOfData) PURE;
+};
+
+struct IDirect3DQuery9 : public IUnknown
+{
+	STDMETHOD(GetDevice)(THIS_ IDirect3DDevice9** ppDevice) PURE;
+	STDMETHOD_(D3DQUERYTYPE, GetType)(THIS) PURE;
+	STDMETHOD_(DWORD, GetDataSize)(THIS) PURE;
+	STDMETHOD(Issue)(THIS_ DWORD dwIssueFlags) PURE;
+	STDMETHOD(GetData)(THIS_ void* pData, DWORD dwSize, DWORD dwGetDataFlags) PURE;
+};
+
+struct IDirect3DDevice9 : public IUnknown
+{
+	STDMETHOD(TestCooperativeLevel)(THIS) PURE;
+	STDMETHOD_(UINT, GetAvailableTextureMem)(THIS) PURE;
+	STDMETHOD(EvictManagedResources)(THIS) PURE;
+	STDMETHOD(GetDirect3D)(THIS_ IDirect3D9** ppD3D9) PURE;
+	STDMETHOD(GetDeviceCaps)(THIS_ D3DCAPS9* pCaps) PURE;
+	STDMETHOD(GetDisplayMode)(THIS_ UINT iSwapChain, D3DDISPLAYMODE* pMode) PURE;
+	STDMETHOD(GetCreationParameters)(THIS_ D3DDEVICE_CREATION_PARAMETERS *pParameters) PURE;
+	STDMETHOD(SetCursorProperties)(THIS_ UINT XHotSpot, UINT YHotSpot, IDirect3DSurface9* pCursorBitmap) PURE;
+	STDMETHOD_(void, SetCursorPosition)(THIS_ int X, int Y, DWORD Flags) PURE;
+	STDMETHOD_(BOOL, ShowCursor)(THIS_ BOOL bShow) PURE;
+	STDMETHOD(CreateAdditionalSwapChain)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters, IDirect3DSwapChain9** pSwapChain) PURE;
+	STDMETHOD(GetSwapChain)(THIS_ UINT iSwapChain, IDirect3DSwapChain9** pSwapChain) PURE;
+	STDMETHOD_(UINT, GetNumberOfSwapChains)(THIS) PURE;
+	STDMETHOD(Reset)(THIS_ D3DPRESENT_PARAMETERS* pPresentationParameters) PURE;
+	STDMETHOD(Present)(THIS_ CONST RECT* pSourceRect, CONST RECT* pDestRect, HWND hDestWindowOverride, CONST RGNDATA* pDirtyRegion) PURE;
+	STDMETHOD(GetBackBuffer)(THIS_ UINT iSwapChain, UINT iBackBuffer, D3DBACKBUFFER_TYPE Type, IDirect3DSurface9** ppBackBuffer) PURE;
+	STDMETHOD(GetRasterStatus)(THIS_ UINT iSwapChain, D3DRASTER_STATUS* pRasterStatus) PURE;
+	STDMETHOD(SetDialogBoxMode)(THIS_ BOOL bEnableDialogs) PURE;
+	STDMETHOD_(void, SetGammaRamp)(THIS_ UINT iSwapChain, DWORD Flags, CONST D3DGAMMARAMP* pRamp) PURE;
+	STDMETHOD_(void, GetGammaRamp)(THIS_ UINT iSwapChain, D3DGAMMARAMP* pRamp) PURE;
+	STDMETHOD(CreateTexture)(THIS_ UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateVolumeTexture)(THIS_ UINT Width, UINT Height, UINT Depth, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DVolumeTexture9** ppVolumeTexture, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateCubeTexture)(THIS_ UINT EdgeLength, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DCubeTexture9** ppCubeTexture, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateVertexBuffer)(THIS_ UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** ppVertexBuffer, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateIndexBuffer)(THIS_ UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer9** ppIndexBuffer, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateRenderTarget)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(CreateDepthStencilSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(UpdateSurface)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestinationSurface, CONST POINT* pDestPoint) PURE;
+	STDMETHOD(UpdateTexture)(THIS_ IDirect3DBaseTexture9* pSourceTexture, IDirect3DBaseTexture9* pDestinationTexture) PURE;
+	STDMETHOD(GetRenderTargetData)(THIS_ IDirect3DSurface9* pRenderTarget, IDirect3DSurface9* pDestSurface) PURE;
+	STDMETHOD(GetFrontBufferData)(THIS_ UINT iSwapChain, IDirect3DSurface9* pDestSurface) PURE;
+	STDMETHOD(StretchRect)(THIS_ IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter) PURE;
+	STDMETHOD(ColorFill)(THIS_ IDirect3DSurface9* pSurface, CONST RECT* pRect, D3DCOLOR color) PURE;
+	STDMETHOD(CreateOffscreenPlainSurface)(THIS_ UINT Width, UINT Height, D3DFORMAT Format, D3DPOOL Pool, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle) PURE;
+	STDMETHOD(SetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget) PURE;
+	STDMETHOD(GetRenderTarget)(THIS_ DWORD RenderTargetIndex, IDirect3DSurface9** ppRenderTarget) PURE;
+	STDMETHOD(SetDepthStencilSurface)(THIS_ IDirect3DSurface9* pNewZStencil) PURE;
+	STDMETHOD(GetDepthStencilSurface)(THIS_ IDirect3DSurface9** ppZStencilSurface) PURE;
+	STDMETHOD(BeginScene)(THIS) PURE;
+	STDMETHOD(EndScene)(THIS) PURE;
+	STDMETHOD(Clear)(THIS_ DWORD Count, CONST D3DRECT* pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil) PURE;
+	STDMETHOD(SetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix) PURE;
+	STDMETHOD(GetTransform)(THIS_ D3DTRANSFORMSTATETYPE State, D3DMATRIX* pMatrix) PURE;
+	STDMETHOD(MultiplyTransform)(THIS_ D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX* pMatrix) PURE;
+	STDMETHOD(SetViewport)(THIS_ CONST D3DVIEWPORT9* pViewport) PURE;
+	STDMETHOD(GetViewport)(THIS_ D3DVIEWPORT9* pViewport) PURE;
+	STDMETHOD(SetMaterial)(THIS_ CONST D3DMATERIAL9* pMaterial) PURE;
+	STDMETHOD(GetMaterial)(THIS_ D3DMATERIAL9* pMaterial) PURE;
+	STDMETHOD(SetLight)(THIS_ DWORD Index, CONST D3DLIGHT9* pLight) PURE;
+	STDMETHOD(GetLight)(THIS_ DWORD Index, D3DLIGHT9* pLight) PURE;
+	STDMETHOD(LightEnable)(THIS_ DWORD Index, BOOL Enable) PURE;
+	STDMETHOD(GetLightEnable)(THIS_ DWORD Index, BOOL* pEnable) PURE;
+	STDMETHOD(SetClipPlane)(THIS_ DWORD Index, CONST float* pPlane) PURE;
+	STDMETHOD(GetClipPlane)(THIS_ DWORD Index, float* pPlane) PURE;
+	STDMETHOD(SetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD Value) PURE;
+	STDMETHOD(GetRenderState)(THIS_ D3DRENDERSTATETYPE State, DWORD* pValue) PURE;
+	STDMETHOD(CreateStateBlock)(THIS_ D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB) PURE;
+	STDMETHOD(BeginStateBlock)(THIS) PURE;
+	STDMETHOD(EndStateBlock)(THIS_ IDirect3DStateBlock9** ppSB) PURE;
+	STDMETHOD(SetClipStatus)(THIS_ CONST D3DCLIPSTATUS9* pClipStatus) PURE;
+	STDMETHOD(GetClipStatus)(THIS_ D3DCLIPSTATUS9* pClipStatus) PURE;
+	STDMETHOD(GetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9** ppTexture) PURE;
+	STDMETHOD(SetTexture)(THIS_ DWORD Stage, IDirect3DBaseTexture9* pTexture) PURE;
+	STDMETHOD(GetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD* pValue) PURE;
+	STDMETHOD(SetTextureStageState)(THIS_ DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value) PURE;
+	STDMETHOD(GetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD* pValue) PURE;
+	STDMETHOD(SetSamplerState)(THIS_ DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value) PURE;
+	STDMETHOD(ValidateDevice)(THIS_ DWORD* pNumPasses) PURE;
+	STDMETHOD(SetPaletteEntries)(THIS_ UINT PaletteNumber, CONST PALETTEENTRY* pEntries) PURE;
+	STDMETHOD(GetPaletteEntries)(THIS_ UINT PaletteNumber, PALETTEENTRY* pEntries) PURE;
+	STDMETHOD(SetCurrentTexturePalette)(THIS_ UINT PaletteNumber) PURE;
+	STDMETHOD(GetCurrentTexturePalette)(THIS_ UINT *PaletteNumber) PURE;
+	STDMETHOD(SetScissorRect)(THIS_ CONST RECT* pRect) PURE;
+	STDMETHOD(GetScissorRect)(THIS_ RECT* pRect) PURE;
+	STDMETHOD(SetSoftwareVertexProcessing)(THIS_ BOOL bSoftware) PURE;
+	STDMETHOD_(BOOL, GetSoftwareVertexProcessing)(THIS) PURE;
+	STDMETHOD(SetNPatchMode)(THIS_ float nSegments) PURE;
+	STDMETHOD_(float, GetNPatchMode)(THIS) PURE;
+	STDMETHOD(DrawPrimitive)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount) PURE;
+	STDMETHOD(DrawIndexedPrimitive)(THIS_ D3DPRIMITIVETYPE PrimitiveType, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount) PURE;
+	STDMETHOD(DrawPrimitiveUP)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) PURE;
+	STDMETHOD(DrawIndexedPrimitiveUP)(THIS_ D3DPRIMITIVETYPE PrimitiveType, UINT MinVertexIndex, UINT NumVertices, UINT PrimitiveCount, CONST void* pIndexData, D3DFORMAT IndexDataFormat, CONST void* pVertexStreamZeroData, UINT VertexStreamZeroStride) PURE;
+	STDMETHOD(ProcessVertices)(THIS_ UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags) PURE;
+	STDMETHOD(CreateVertexDeclaration)(THIS_ CONST D3DVERTEXELEMENT9* pVertexElements, IDirect3DVertexDeclaration9** ppDecl) PURE;
+	STDMETHOD(SetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9* pDecl) PURE;
+	STDMETHOD(GetVertexDeclaration)(THIS_ IDirect3DVertexDeclaration9** ppDecl) PURE;
+	STDMETHOD(SetFVF)(THIS_ DWORD FVF) PURE;
+	STDMETHOD(GetFVF)(THIS_ DWORD* pFVF) PURE;
+	STDMETHOD(CreateVertexShader)(THIS_ CONST DWORD* pFunction, IDirect3DVertexShader9** ppShader) PURE;
+	STDMETHOD(SetVertexShader)(THIS_ IDirect3DVertexShader9* pShader) PURE;
+	STDMETHOD(GetVertexShader)(THIS_ IDirect3DVertexShader9** ppShader) PURE;
+	STDMETHOD(SetVertexShaderConstantF)(THIS_ UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(GetVertexShaderConstantF)(THIS_ UINT StartRegister, float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(SetVertexShaderConstantI)(THIS_ UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(GetVertexShaderConstantI)(THIS_ UINT StartRegister, int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(SetVertexShaderConstantB)(THIS_ UINT StartRegister, CONST BOOL* pConstantData, UINT BoolCount) PURE;
+	STDMETHOD(GetVertexShaderConstantB)(THIS_ UINT StartRegister, BOOL* pConstantData, UINT BoolCount) PURE;
+	STDMETHOD(SetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride) PURE;
+	STDMETHOD(GetStreamSource)(THIS_ UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* pOffsetInBytes, UINT* pStride) PURE;
+	STDMETHOD(SetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT Setting) PURE;
+	STDMETHOD(GetStreamSourceFreq)(THIS_ UINT StreamNumber, UINT* pSetting) PURE;
+	STDMETHOD(SetIndices)(THIS_ IDirect3DIndexBuffer9* pIndexData) PURE;
+	STDMETHOD(GetIndices)(THIS_ IDirect3DIndexBuffer9** ppIndexData) PURE;
+	STDMETHOD(CreatePixelShader)(THIS_ CONST DWORD* pFunction, IDirect3DPixelShader9** ppShader) PURE;
+	STDMETHOD(SetPixelShader)(THIS_ IDirect3DPixelShader9* pShader) PURE;
+	STDMETHOD(GetPixelShader)(THIS_ IDirect3DPixelShader9** ppShader) PURE;
+	STDMETHOD(SetPixelShaderConstantF)(THIS_ UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(GetPixelShaderConstantF)(THIS_ UINT StartRegister, float* pConstantData, UINT Vector4fCount) PURE;
+	STDMETHOD(SetPixelShaderConstantI)(THIS_ UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(GetPixelShaderConstantI)(THIS_ UINT StartRegister, int* pConstantData, UINT Vector4iCount) PURE;
+	STDMETHOD(SetPixelShaderConstantB)(THIS_ UINT StartRegister, CONST BOOL* pConstantData, UINT BoolCount) PURE;
+	STDMETHOD(GetPixelShaderConstantB)(THIS_ UINT StartRegister, BOOL* pConstantData, UINT BoolCount) PURE;
+	STDMETHOD(DrawRectPatch)(THIS_ UINT Handle, CONST float* pNumSegs, CONST D3DRECTPATCH_INFO* pRectPatchInfo) PURE;
+	STDMETHOD(DrawTriPatch)(THIS_ UINT Handle, CONST float* pNumSegs, CONST D3DTRIPATCH_INFO* pTriPatchInfo) PURE;
+	STDMETHOD(DeletePatch)(THIS_ UINT Handle) PURE;
+	STDMETHOD(CreateQuery)(THIS_ D3DQUERYTYPE Type, IDirect3DQuery9** ppQuery) PURE;
+};
+
+typedef IDirect3DDevice9* LPDIRECT3DDEVICE9;
+typedef IDirect3DTexture9* LPDIRECT3DTEXTURE9;
+
+// identities only, the values do not matter outside of the process
+#define SHIM_IID(_name, _n) static const IID _name = { 0x5348494d, 0, _n, { 0, 0, 0, 0, 0, 0, 0, 0 } }
+SHIM_IID(IID_IUnknown, 1);
+SHIM_IID(IID_IDirect3DDevice9, 2);
+SHIM_IID(IID_IDirect3DResource9, 3);
+SHIM_IID(IID_IDirect3DBaseTexture9, 4);
+SHIM_IID(IID_IDirect3DTexture9, 5);
+SHIM_IID(IID_IDirect3DSurface9, 6);
+SHIM_IID(IID_IDirect3DVertexBuffer9, 7);
+SHIM_IID(IID_IDirect3DIndexBuffer9, 8);
+SHIM_IID(IID_IDirect3DStateBlock9, 9);
+SHIM_IID(IID_IDirect3DVertexDeclaration9, 10);
+SHIM_IID(IID_IDirect3DVertexShader9, 11);
+SHIM_IID(IID_IDirect3DPixelShader9, 12);
+SHIM_IID(IID_IDirect3DQuery9, 13);
+#undef SHIM_IID
+
+// DSfix //////////////////////////////////////////////////////////////////////
+
+// Logger.h, writes to stdout
+void PrintLog(const char* format, ...);
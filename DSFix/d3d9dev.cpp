@@ -8,12 +8,16 @@
 #include "main.h"
 #include "d3dutil.h"
 #include "RenderstateManager.h"
+#include "CallTrace.h"
+#include "HudCache.h"
+#include "DrawBatcher.h"
 
 hkIDirect3DDevice9::hkIDirect3DDevice9(IDirect3DDevice9 **ppReturnedDeviceInterface, D3DPRESENT_PARAMETERS *pPresentParam, IDirect3D9 *pIDirect3D9)
 {
 	SDLOG(0, "hkIDirect3DDevice9");
 	m_pD3Ddev = *ppReturnedDeviceInterface;
 	m_pD3Dint = pIDirect3D9;
+	refCount = 1;
 	RSManager::get().setD3DDevice(m_pD3Ddev);
 	RSManager::get().initResources();
 
@@ -22,37 +26,49 @@ hkIDirect3DDevice9::hkIDirect3DDevice9(IDirect3DDevice9 **ppReturnedDeviceInterf
 
 HRESULT APIENTRY hkIDirect3DDevice9::Present(CONST RECT *pSourceRect, CONST RECT *pDestRect, HWND hDestWindowOverride, CONST RGNDATA *pDirtyRegion)
 {
+	DrawBatcher::get().flush();
 	SDLOG(3, "!!!!!!!!!!!!!!!!!!!!!!! Present !!!!!!!!!!!!!!!!!!");
+	// textures loaded before the trace started are only described when they show up, but we need to know which ones we recognize
+	if (CallTrace::get().endFrame()) RSManager::get().traceKnownTextures();
 	return RSManager::get().redirectPresent(pSourceRect, pDestRect, hDestWindowOverride, pDirtyRegion);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetVertexShaderConstantF(UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount)
 {
+	DrawBatcher::get().flush();
+	if (HudCache::get().isRecording()) HudCache::get().addConstants(HudCache::VERTEX_SHADER_CONSTANTS, StartRegister, pConstantData, Vector4fCount * 4 * sizeof(float));
 	return m_pD3Ddev->SetVertexShaderConstantF(StartRegister, pConstantData, Vector4fCount);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetRenderTarget(DWORD RenderTargetIndex, IDirect3DSurface9* pRenderTarget)
 {
+	DrawBatcher::get().flush();
 	if (RenderTargetIndex != 0) return D3D_OK; // rendertargets > 0 are not actually used by the game - this makes the log shorter
 	SDLOG(3, "SetRenderTarget %5d, %p", RenderTargetIndex, pRenderTarget);
+	if (CallTrace::get().isRecording()) CallTrace::get().recordSetRenderTarget(RenderTargetIndex, pRenderTarget);
 	return RSManager::get().redirectSetRenderTarget(RenderTargetIndex, pRenderTarget);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetVertexShader(IDirect3DVertexShader9* pvShader)
 {
+	DrawBatcher::get().flush();
 	SDLOG(7, "SetVertexShader: %p", pvShader);
+	if (HudCache::get().isRecording()) HudCache::get().addState(HudCache::SHADER, 0, (UINT32)(UINT_PTR)pvShader);
 	return m_pD3Ddev->SetVertexShader(pvShader);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetViewport(CONST D3DVIEWPORT9 *pViewport)
 {
+	DrawBatcher::get().flush();
 	SDLOG(6, "SetViewport X / Y - W x H : %4lu / %4lu  -  %4lu x %4lu", pViewport->X, pViewport->Y, pViewport->Width, pViewport->Height);
 	RSManager::get().setViewport(*pViewport);
-	return m_pD3Ddev->SetViewport(pViewport);
+	D3DVIEWPORT9 viewport = RSManager::get().scaleViewport(*pViewport);
+	return m_pD3Ddev->SetViewport(&viewport);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::DrawIndexedPrimitive(D3DPRIMITIVETYPE Type, INT BaseVertexIndex, UINT MinVertexIndex, UINT NumVertices, UINT startIndex, UINT primCount)
 {
+	DrawBatcher::get().flush();
 	SDLOG(9, "DrawIndexedPrimitive");
 	return m_pD3Ddev->DrawIndexedPrimitive(Type, BaseVertexIndex, MinVertexIndex, NumVertices, startIndex, primCount);
 }
@@ -60,11 +76,13 @@ HRESULT APIENTRY hkIDirect3DDevice9::DrawIndexedPrimitive(D3DPRIMITIVETYPE Type,
 HRESULT APIENTRY hkIDirect3DDevice9::DrawIndexedPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT MinIndex, UINT NumVertices, UINT PrimitiveCount, CONST void *pIndexData, D3DFORMAT IndexDataFormat, CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
 {
 	SDLOG(9, "DrawIndexedPrimitiveUP(%d, %u, %u, %u, %u, %p, %d, %p, %d)", PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
+	if (CallTrace::get().isRecording()) CallTrace::get().recordDrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
 	return RSManager::get().redirectDrawIndexedPrimitiveUP(PrimitiveType, MinIndex, NumVertices, PrimitiveCount, pIndexData, IndexDataFormat, pVertexStreamZeroData, VertexStreamZeroStride);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveType, UINT StartVertex, UINT PrimitiveCount)
 {
+	DrawBatcher::get().flush();
 	SDLOG(9, "DrawPrimitive");
 	return m_pD3Ddev->DrawPrimitive(PrimitiveType, StartVertex, PrimitiveCount);
 }
@@ -72,17 +90,20 @@ HRESULT APIENTRY hkIDirect3DDevice9::DrawPrimitive(D3DPRIMITIVETYPE PrimitiveTyp
 HRESULT APIENTRY hkIDirect3DDevice9::DrawPrimitiveUP(D3DPRIMITIVETYPE PrimitiveType, UINT PrimitiveCount, CONST void *pVertexStreamZeroData, UINT VertexStreamZeroStride)
 {
 	SDLOG(9, "DrawPrimitiveUP(%d, %u, %u, %u, %u, %p, %d, %p, %d)", PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
+	if (CallTrace::get().isRecording()) CallTrace::get().recordDrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
 	return RSManager::get().redirectDrawPrimitiveUP(PrimitiveType, PrimitiveCount, pVertexStreamZeroData, VertexStreamZeroStride);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::DrawRectPatch(UINT Handle, CONST float *pNumSegs, CONST D3DRECTPATCH_INFO *pRectPatchInfo)
 {
+	DrawBatcher::get().flush();
 	SDLOG(9, "DrawRectPatch");
 	return m_pD3Ddev->DrawRectPatch(Handle, pNumSegs, pRectPatchInfo);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::DrawTriPatch(UINT Handle, CONST float *pNumSegs, CONST D3DTRIPATCH_INFO *pTriPatchInfo)
 {
+	DrawBatcher::get().flush();
 	SDLOG(9, "DrawTriPatch");
 	return m_pD3Ddev->DrawTriPatch(Handle, pNumSegs, pTriPatchInfo);
 }
@@ -94,6 +115,7 @@ HRESULT APIENTRY hkIDirect3DDevice9::GetBackBuffer(UINT iSwapChain, UINT iBackBu
 
 HRESULT APIENTRY hkIDirect3DDevice9::EndScene()
 {
+	DrawBatcher::get().flush();
 	SDLOG(7, "EndScene");
 	return m_pD3Ddev->EndScene();
 }
@@ -105,27 +127,32 @@ HRESULT APIENTRY hkIDirect3DDevice9::QueryInterface(REFIID riid, LPVOID *ppvObj)
 
 ULONG APIENTRY hkIDirect3DDevice9::AddRef()
 {
-	return m_pD3Ddev->AddRef();
+	m_pD3Ddev->AddRef();
+	return ++refCount;
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::BeginScene()
 {
+	DrawBatcher::get().flush();
 	SDLOG(7, "BeginScene");
 	return m_pD3Ddev->BeginScene();
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::BeginStateBlock()
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->BeginStateBlock();
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::Clear(DWORD Count, CONST D3DRECT *pRects, DWORD Flags, D3DCOLOR Color, float Z, DWORD Stencil)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->Clear(Count, pRects, Flags, Color, Z, Stencil);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::ColorFill(IDirect3DSurface9* pSurface, CONST RECT* pRect, D3DCOLOR color)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->ColorFill(pSurface, pRect, color);
 }
 
@@ -141,13 +168,9 @@ HRESULT APIENTRY hkIDirect3DDevice9::CreateCubeTexture(UINT EdgeLength, UINT Lev
 
 HRESULT APIENTRY hkIDirect3DDevice9::CreateDepthStencilSurface(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Discard, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
 {
-	SDLOG(4, "CreateDepthStencilSurface w/h: %4u/%4u  format: %s", Width, Height, D3DFormatToString(Format));
-	if (Width == 1024 && Height == 720)
-	{
-		SDLOG(4, " - OVERRIDE to %4u/%4u!", Settings::get().getRenderWidth(), Settings::get().getRenderHeight());
-		return m_pD3Ddev->CreateDepthStencilSurface(Settings::get().getRenderWidth(), Settings::get().getRenderHeight(), Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
-	}
-	return m_pD3Ddev->CreateDepthStencilSurface(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
+	HRESULT hr = RSManager::get().redirectCreateDepthStencilSurface(Width, Height, Format, MultiSample, MultisampleQuality, Discard, ppSurface, pSharedHandle);
+	if (SUCCEEDED(hr) && CallTrace::get().isRecording()) CallTrace::get().recordCreateDepthStencilSurface(*ppSurface, Width, Height, Format);
+	return hr;
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::CreateIndexBuffer(UINT Length, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DIndexBuffer9** ppIndexBuffer, HANDLE* pSharedHandle)
@@ -180,25 +203,22 @@ HRESULT APIENTRY hkIDirect3DDevice9::CreateQuery(D3DQUERYTYPE Type, IDirect3DQue
 
 HRESULT APIENTRY hkIDirect3DDevice9::CreateRenderTarget(UINT Width, UINT Height, D3DFORMAT Format, D3DMULTISAMPLE_TYPE MultiSample, DWORD MultisampleQuality, BOOL Lockable, IDirect3DSurface9** ppSurface, HANDLE* pSharedHandle)
 {
-	SDLOG(1, "CreateRenderTarget w/h: %4u/%4u  format: %s", Width, Height, D3DFormatToString(Format));
-	if (Width == 1024 && Height == 720)
-	{
-		SDLOG(1, " - OVERRIDE to %4u/%4u!", Settings::get().getRenderWidth(), Settings::get().getRenderHeight());
-		HRESULT hr = m_pD3Ddev->CreateRenderTarget(Settings::get().getRenderWidth(), Settings::get().getRenderHeight(), Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
-		RSManager::get().registerMainRenderSurface(*ppSurface);
-		return hr;
-	}
-	return m_pD3Ddev->CreateRenderTarget(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
+	HRESULT hr = RSManager::get().redirectCreateRenderTarget(Width, Height, Format, MultiSample, MultisampleQuality, Lockable, ppSurface, pSharedHandle);
+	if (SUCCEEDED(hr) && CallTrace::get().isRecording()) CallTrace::get().recordCreateRenderTarget(*ppSurface, Width, Height, Format);
+	return hr;
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::CreateStateBlock(D3DSTATEBLOCKTYPE Type, IDirect3DStateBlock9** ppSB)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->CreateStateBlock(Type, ppSB);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::CreateTexture(UINT Width, UINT Height, UINT Levels, DWORD Usage, D3DFORMAT Format, D3DPOOL Pool, IDirect3DTexture9** ppTexture, HANDLE* pSharedHandle)
 {
-	return RSManager::get().redirectCreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+	HRESULT hr = RSManager::get().redirectCreateTexture(Width, Height, Levels, Usage, Format, Pool, ppTexture, pSharedHandle);
+	if (SUCCEEDED(hr) && CallTrace::get().isRecording()) CallTrace::get().recordCreateTexture(*ppTexture, Width, Height, Levels, Usage, Format, Pool);
+	return hr;
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::CreateVertexBuffer(UINT Length, DWORD Usage, DWORD FVF, D3DPOOL Pool, IDirect3DVertexBuffer9** VERTexBuffer, HANDLE* pSharedHandle)
@@ -236,11 +256,13 @@ HRESULT APIENTRY hkIDirect3DDevice9::DeletePatch(UINT Handle)
 
 HRESULT APIENTRY hkIDirect3DDevice9::EndStateBlock(IDirect3DStateBlock9** ppSB)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->EndStateBlock(ppSB);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::EvictManagedResources()
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->EvictManagedResources();
 }
 
@@ -295,6 +317,7 @@ HRESULT APIENTRY hkIDirect3DDevice9::GetDisplayMode(UINT iSwapChain, D3DDISPLAYM
 
 HRESULT APIENTRY hkIDirect3DDevice9::GetFrontBufferData(UINT iSwapChain, IDirect3DSurface9* pDestSurface)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->GetFrontBufferData(iSwapChain, pDestSurface);
 }
 
@@ -310,6 +333,7 @@ void APIENTRY hkIDirect3DDevice9::GetGammaRamp(UINT iSwapChain, D3DGAMMARAMP* pR
 
 HRESULT APIENTRY hkIDirect3DDevice9::GetIndices(IDirect3DIndexBuffer9** ppIndexData)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->GetIndices(ppIndexData);
 }
 
@@ -380,6 +404,7 @@ HRESULT APIENTRY hkIDirect3DDevice9::GetRenderTarget(DWORD renderTargetIndex, ID
 
 HRESULT APIENTRY hkIDirect3DDevice9::GetRenderTargetData(IDirect3DSurface9* renderTarget, IDirect3DSurface9* pDestSurface)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->GetRenderTargetData(renderTarget, pDestSurface);
 }
 
@@ -400,6 +425,7 @@ BOOL APIENTRY hkIDirect3DDevice9::GetSoftwareVertexProcessing()
 
 HRESULT APIENTRY hkIDirect3DDevice9::GetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9** ppStreamData, UINT* OffsetInBytes, UINT* pStride)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->GetStreamSource(StreamNumber, ppStreamData, OffsetInBytes, pStride);
 }
 
@@ -482,32 +508,47 @@ HRESULT APIENTRY hkIDirect3DDevice9::GetViewport(D3DVIEWPORT9 *pViewport)
 
 HRESULT APIENTRY hkIDirect3DDevice9::LightEnable(DWORD LightIndex, BOOL bEnable)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->LightEnable(LightIndex, bEnable);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::MultiplyTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
 {
+	DrawBatcher::get().flush();
 	SDLOG(5, "MultiplyTransform state: %u matrix: \n%s", State, D3DMatrixToString(pMatrix));
 	return m_pD3Ddev->MultiplyTransform(State, pMatrix);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::ProcessVertices(UINT SrcStartIndex, UINT DestIndex, UINT VertexCount, IDirect3DVertexBuffer9* pDestBuffer, IDirect3DVertexDeclaration9* pVertexDecl, DWORD Flags)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->ProcessVertices(SrcStartIndex, DestIndex, VertexCount, pDestBuffer, pVertexDecl, Flags);
 }
 
 ULONG APIENTRY hkIDirect3DDevice9::Release()
 {
-	ULONG refs = m_pD3Ddev->Release();
+	ULONG refs = --refCount;
+	if (!refs)
+	{
+		// our resources and the effects' shared ones hold references to the device, drop them before the game's last one
+		SDLOG(0, "Release ------");
+		DrawBatcher::get().flush();
+		RSManager::get().releaseResources();
+		Effect::releaseShared(m_pD3Ddev);
+		SMAA::releaseShared(m_pD3Ddev);
+		RSManager::get().setD3DDevice(NULL);
+	}
+	m_pD3Ddev->Release();
 	if (!refs)
 		delete this;
 
-	m_pD3Ddev = nullptr;
 	return refs;
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresentationParameters)
 {
+	DrawBatcher::get().flush();
+	if (CallTrace::get().isRecording()) CallTrace::get().recordReset();
 	RSManager::get().releaseResources();
 	SDLOG(0, "Reset ------");
 
@@ -531,16 +572,19 @@ HRESULT APIENTRY hkIDirect3DDevice9::Reset(D3DPRESENT_PARAMETERS *pPresentationP
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetClipPlane(DWORD Index, CONST float *pPlane)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetClipPlane(Index, pPlane);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetClipStatus(CONST D3DCLIPSTATUS9 *pClipStatus)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetClipStatus(pClipStatus);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetCurrentTexturePalette(UINT PaletteNumber)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetCurrentTexturePalette(PaletteNumber);
 }
 
@@ -556,7 +600,9 @@ HRESULT APIENTRY hkIDirect3DDevice9::SetCursorProperties(UINT XHotSpot, UINT YHo
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetDepthStencilSurface(IDirect3DSurface9* pNewZStencil)
 {
+	DrawBatcher::get().flush();
 	SDLOG(5, "SetDepthStencilSurface %p", pNewZStencil);
+	if (CallTrace::get().isRecording()) CallTrace::get().recordSetDepthStencilSurface(pNewZStencil);
 	return RSManager::get().redirectSetDepthStencilSurface(pNewZStencil);
 }
 
@@ -567,6 +613,7 @@ HRESULT APIENTRY hkIDirect3DDevice9::SetDialogBoxMode(BOOL bEnableDialogs)
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetFVF(DWORD FVF)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetFVF(FVF);
 }
 
@@ -577,57 +624,72 @@ void APIENTRY hkIDirect3DDevice9::SetGammaRamp(UINT iSwapChain, DWORD Flags, CON
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetIndices(IDirect3DIndexBuffer9* pIndexData)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetIndices(pIndexData);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetLight(DWORD Index, CONST D3DLIGHT9 *pLight)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetLight(Index, pLight);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetMaterial(CONST D3DMATERIAL9 *pMaterial)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetMaterial(pMaterial);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetNPatchMode(float nSegments)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetNPatchMode(nSegments);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetPaletteEntries(UINT PaletteNumber, CONST PALETTEENTRY *pEntries)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetPaletteEntries(PaletteNumber, pEntries);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetPixelShader(IDirect3DPixelShader9* pShader)
 {
+	DrawBatcher::get().flush();
+	if (HudCache::get().isRecording()) HudCache::get().addState(HudCache::SHADER, 1, (UINT32)(UINT_PTR)pShader);
 	return m_pD3Ddev->SetPixelShader(pShader);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetPixelShaderConstantB(UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetPixelShaderConstantB(StartRegister, pConstantData, BoolCount);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetPixelShaderConstantF(UINT StartRegister, CONST float* pConstantData, UINT Vector4fCount)
 {
+	DrawBatcher::get().flush();
+	if (HudCache::get().isRecording()) HudCache::get().addConstants(HudCache::PIXEL_SHADER_CONSTANTS, StartRegister, pConstantData, Vector4fCount * 4 * sizeof(float));
 	return m_pD3Ddev->SetPixelShaderConstantF(StartRegister, pConstantData, Vector4fCount);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetPixelShaderConstantI(UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetPixelShaderConstantI(StartRegister, pConstantData, Vector4iCount);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetRenderState(D3DRENDERSTATETYPE State, DWORD Value)
 {
+	DrawBatcher::get().flush();
+	if (CallTrace::get().isRecording()) CallTrace::get().recordSetRenderState(State, Value);
 	return RSManager::get().redirectSetRenderState(State, Value);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetSamplerState(DWORD Sampler, D3DSAMPLERSTATETYPE Type, DWORD Value)
 {
+	DrawBatcher::get().flush();
 	SDLOG(14, "SetSamplerState sampler %lu:   state type: %s   value: %lu", Sampler, D3DSamplerStateTypeToString(Type), Value);
+	if (HudCache::get().isRecording()) HudCache::get().addState(HudCache::SAMPLER_STATE, Sampler * 256 + Type, Value);
 	if (Settings::get().getFilteringOverride() == 2)
 	{
 		SDLOG(10, " - aniso sampling activated!");
@@ -657,6 +719,7 @@ HRESULT APIENTRY hkIDirect3DDevice9::SetSamplerState(DWORD Sampler, D3DSAMPLERST
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetScissorRect(CONST RECT* pRect)
 {
+	DrawBatcher::get().flush();
 	SDLOG(5, "SetScissorRect %s", RectToString(pRect));
 	// These are scissor rects used for shadow rendering, should not be suppressed:
 	//SetScissorRect RECT[   0/   0/1024/1024]
@@ -670,7 +733,8 @@ HRESULT APIENTRY hkIDirect3DDevice9::SetScissorRect(CONST RECT* pRect)
 	        || (pRect->left == 1024 && pRect->top == 1024 && pRect->right == 2048 && pRect->bottom == 2048)
 	   )
 	{
-		return m_pD3Ddev->SetScissorRect(pRect);
+		RECT rect = RSManager::get().scaleRect(*pRect);
+		return m_pD3Ddev->SetScissorRect(&rect);
 	}
 	SDLOG(5, " - Lyrical Tokarev, kill them all!", RectToString(pRect));
 	return D3D_OK;
@@ -678,49 +742,60 @@ HRESULT APIENTRY hkIDirect3DDevice9::SetScissorRect(CONST RECT* pRect)
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetSoftwareVertexProcessing(BOOL bSoftware)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetSoftwareVertexProcessing(bSoftware);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetStreamSource(UINT StreamNumber, IDirect3DVertexBuffer9* pStreamData, UINT OffsetInBytes, UINT Stride)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetStreamSource(StreamNumber, pStreamData, OffsetInBytes, Stride);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetStreamSourceFreq(UINT StreamNumber, UINT Divider)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetStreamSourceFreq(StreamNumber, Divider);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetTexture(DWORD Stage, IDirect3DBaseTexture9 *pTexture)
 {
+	DrawBatcher::get().flush();
 	unsigned index = RSManager::get().getTextureIndex((IDirect3DTexture9*)pTexture);
 	SDLOG(6, "setTexture %d, %p (index %u)", Stage, pTexture, index);
+	if (CallTrace::get().isRecording()) CallTrace::get().recordSetTexture(Stage, pTexture);
 	return RSManager::get().redirectSetTexture(Stage, pTexture);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetTextureStageState(DWORD Stage, D3DTEXTURESTAGESTATETYPE Type, DWORD Value)
 {
+	DrawBatcher::get().flush();
+	if (CallTrace::get().isRecording()) CallTrace::get().recordSetTextureStageState(Stage, Type, Value);
 	return RSManager::get().redirectSetTextureStageState(Stage, Type, Value);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetTransform(D3DTRANSFORMSTATETYPE State, CONST D3DMATRIX *pMatrix)
 {
+	DrawBatcher::get().flush();
 	SDLOG(0, "SetTransform state: %u matrix: \n%s", State, D3DMatrixToString(pMatrix));
 	return m_pD3Ddev->SetTransform(State, pMatrix);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetVertexDeclaration(IDirect3DVertexDeclaration9* pDecl)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetVertexDeclaration(pDecl);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetVertexShaderConstantB(UINT StartRegister, CONST BOOL* pConstantData, UINT  BoolCount)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetVertexShaderConstantB(StartRegister, pConstantData, BoolCount);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::SetVertexShaderConstantI(UINT StartRegister, CONST int* pConstantData, UINT Vector4iCount)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->SetVertexShaderConstantI(StartRegister, pConstantData, Vector4iCount);
 }
 
@@ -731,7 +806,9 @@ BOOL APIENTRY hkIDirect3DDevice9::ShowCursor(BOOL bShow)
 
 HRESULT APIENTRY hkIDirect3DDevice9::StretchRect(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestSurface, CONST RECT* pDestRect, D3DTEXTUREFILTERTYPE Filter)
 {
+	DrawBatcher::get().flush();
 	SDLOG(5, "StretchRect src -> dest, sR -> dR : %p -> %p,  %s -> %s", pSourceSurface, pDestSurface, RectToString(pSourceRect), RectToString(pDestRect));
+	if (CallTrace::get().isRecording()) CallTrace::get().recordStretchRect(pSourceSurface, pDestSurface, Filter);
 	return RSManager::get().redirectStretchRect(pSourceSurface, pSourceRect, pDestSurface, pDestRect, Filter);
 }
 
@@ -745,11 +822,13 @@ HRESULT APIENTRY hkIDirect3DDevice9::TestCooperativeLevel()
 
 HRESULT APIENTRY hkIDirect3DDevice9::UpdateSurface(IDirect3DSurface9* pSourceSurface, CONST RECT* pSourceRect, IDirect3DSurface9* pDestinationSurface, CONST POINT* pDestPoint)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->UpdateSurface(pSourceSurface, pSourceRect, pDestinationSurface, pDestPoint);
 }
 
 HRESULT APIENTRY hkIDirect3DDevice9::UpdateTexture(IDirect3DBaseTexture9 *pSourceTexture, IDirect3DBaseTexture9 *pDestinationTexture)
 {
+	DrawBatcher::get().flush();
 	return m_pD3Ddev->UpdateTexture(pSourceTexture, pDestinationTexture);
 }
 
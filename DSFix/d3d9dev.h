@@ -10,6 +10,8 @@ private:
 	// callback interface
 	IDirect3DDevice9 *m_pD3Ddev;
 	IDirect3D9 *m_pD3Dint;
+	// references held by the game, ours are not counted
+	ULONG refCount;
 public:
 	hkIDirect3DDevice9(IDirect3DDevice9 **ppReturnedDeviceInterface, D3DPRESENT_PARAMETERS *pPresentParam, IDirect3D9 *pIDirect3D9);
 
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "d3d9.h"
+#include <d3d9.h>
 
 TCHAR* D3DFormatToString(D3DFORMAT format, bool bWithPrefix = true);
 TCHAR* D3DSamplerStateTypeToString(D3DSAMPLERSTATETYPE state);
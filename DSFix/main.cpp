@@ -70,7 +70,7 @@ BOOL WINAPI DllMain(HMODULE hDll, DWORD dwReason, PVOID pvReserved)
 	return TRUE;
 }
 
-const char *GetDirectoryFile(char *filename)
+const char *GetDirectoryFile(const char *filename)
 {
 	static char path[MAX_PATH];
 	strcpy_s(path, dlldir);
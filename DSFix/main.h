@@ -27,12 +27,12 @@
 #include "Settings.h"
 
 #ifndef RELEASE_VER
-#define SDLOG(_level, _str, ...) if(Settings::get().getLogLevel() > _level) { PrintLog(_str, __VA_ARGS__); }
+#define SDLOG(_level, _str, ...) if(Settings::get().getLogLevel() > _level) { PrintLog(_str, ##__VA_ARGS__); }
 #else
 #define SDLOG(_level, _str, ...)
 #endif
 
-const char* GetDirectoryFile(char *filename);
+const char* GetDirectoryFile(const char *filename);
 
 extern bool timingIntroMode;
 